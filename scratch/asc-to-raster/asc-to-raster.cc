@@ -0,0 +1,240 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+/*
+ * Converts a digital elevation model in ESRI ASCII grid format (.asc) to the
+ * tiled binary raster read by ElevationRaster (see the electric-consumption
+ * example, --elevation). The coordinates of the grid must be the same as
+ * the ones of the mobility traces.
+ *
+ * Usage:
+ *
+ *  ./waf --run "asc-to-raster --input=terrain.asc --output=terrain.dem"
+ *
+ *  The grid is read one band of tile rows at a time, so large grids can be
+ *  converted with little memory. Samples without data are written as 0.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <strings.h>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "../electric-consumption/elevation-raster-format.h"
+
+using namespace ns3;
+
+int main (int argc, char *argv[])
+{
+  std::string input;
+  std::string output;
+  uint32_t tileSize = 64;
+
+  CommandLine cmd;
+  cmd.AddValue ("input", "ESRI ASCII grid file", input);
+  cmd.AddValue ("output", "Elevation raster file", output);
+  cmd.AddValue ("tileSize", "Samples per side of a tile, a power of two of at least 32", tileSize);
+  cmd.Parse (argc, argv);
+
+  if (input.empty () || output.empty ())
+    {
+      std::cout << "Usage of " << argv[0] << " :\n\n"
+      "./waf --run \"asc-to-raster --input=terrain.asc --output=terrain.dem\"\n";
+      return 0;
+    }
+  if (tileSize < 32 || (tileSize & (tileSize - 1)) != 0)
+    {
+      std::cerr << "The tile size must be a power of two of at least 32\n";
+      return 1;
+    }
+
+  std::ifstream file (input.c_str ());
+  if (!file.is_open ())
+    {
+      std::cerr << "Could not open " << input << "\n";
+      return 1;
+    }
+
+  // header: keys and values, in any order, until the first sample
+  uint32_t columns = 0;
+  uint32_t rows = 0;
+  double x = 0;
+  double y = 0;
+  bool corner = true;
+  double cellSize = 0;
+  double noData = -9999;
+  bool hasNoData = false;
+  std::string key;
+  std::streampos start = file.tellg ();
+  while (file >> key)
+    {
+      if (std::isdigit (key[0]) || key[0] == '-' || key[0] == '+' || key[0] == '.')
+        {
+          // first sample, read it again
+          file.seekg (start);
+          break;
+        }
+      double value;
+      if (!(file >> value))
+        {
+          std::cerr << input << " has an invalid header\n";
+          return 1;
+        }
+      if (strcasecmp (key.c_str (), "ncols") == 0)
+        {
+          columns = value;
+        }
+      else if (strcasecmp (key.c_str (), "nrows") == 0)
+        {
+          rows = value;
+        }
+      else if (strcasecmp (key.c_str (), "xllcorner") == 0 || strcasecmp (key.c_str (), "xllcenter") == 0)
+        {
+          x = value;
+          corner = strcasecmp (key.c_str (), "xllcorner") == 0;
+        }
+      else if (strcasecmp (key.c_str (), "yllcorner") == 0 || strcasecmp (key.c_str (), "yllcenter") == 0)
+        {
+          y = value;
+        }
+      else if (strcasecmp (key.c_str (), "cellsize") == 0)
+        {
+          cellSize = value;
+        }
+      else if (strcasecmp (key.c_str (), "nodata_value") == 0)
+        {
+          noData = value;
+          hasNoData = true;
+        }
+      else
+        {
+          std::cerr << "Unknown key " << key << " in the header of " << input << "\n";
+          return 1;
+        }
+      start = file.tellg ();
+    }
+  if (columns < 2 || rows < 2 || cellSize <= 0)
+    {
+      std::cerr << input << " needs ncols and nrows of at least 2 and a positive cellsize\n";
+      return 1;
+    }
+
+  ElevationRasterHeader header;
+  std::memset (&header, 0, sizeof (header));
+  std::memcpy (header.magic, ELEVATION_RASTER_MAGIC, sizeof (header.magic));
+  header.byteOrder = ELEVATION_RASTER_BYTE_ORDER;
+  header.version = ELEVATION_RASTER_VERSION;
+  header.columns = columns;
+  header.rows = rows;
+  header.tileSize = tileSize;
+  // samples are at the centers of the cells
+  header.originX = corner ? x + cellSize / 2 : x;
+  header.originY = corner ? y + cellSize / 2 : y;
+  header.resolution = cellSize;
+
+  std::FILE *out = std::fopen (output.c_str (), "wb");
+  if (out == 0)
+    {
+      std::cerr << "Could not open " << output << " for writing\n";
+      return 1;
+    }
+  std::vector<char> headerBlock (ELEVATION_RASTER_HEADER_SIZE, 0);
+  std::memcpy (&headerBlock[0], &header, sizeof (header));
+  std::fwrite (&headerBlock[0], 1, headerBlock.size (), out);
+
+  uint32_t tileColumns = (columns + tileSize - 1) / tileSize;
+  uint64_t tileSamples = (uint64_t) tileSize * tileSize;
+  std::vector<float> band ((uint64_t) tileSize * columns);
+  std::vector<float> tile (tileSamples);
+  uint64_t missing = 0;
+
+  // the grid starts with the north row, the raster with the south one
+  for (uint32_t fileRow = 0; fileRow < rows; fileRow++)
+    {
+      uint32_t row = rows - 1 - fileRow;
+      uint32_t tileRow = row / tileSize;
+      float *samples = &band[(uint64_t) (row - tileRow * tileSize) * columns];
+      for (uint32_t column = 0; column < columns; column++)
+        {
+          double value;
+          if (!(file >> value))
+            {
+              std::cerr << input << " ends before its " << rows << "x" << columns << " samples\n";
+              std::fclose (out);
+              return 1;
+            }
+          if (hasNoData && value == noData)
+            {
+              value = 0;
+              missing++;
+            }
+          samples[column] = value;
+        }
+
+      if (row != tileRow * tileSize)
+        {
+          continue;
+        }
+
+      // the band of tiles is complete, rows past the north edge repeat the last one
+      uint32_t bandRows = std::min (tileSize, rows - tileRow * tileSize);
+      for (uint32_t tileColumn = 0; tileColumn < tileColumns; tileColumn++)
+        {
+          for (uint32_t ty = 0; ty < tileSize; ty++)
+            {
+              const float *source = &band[(uint64_t) std::min (ty, bandRows - 1) * columns];
+              for (uint32_t tx = 0; tx < tileSize; tx++)
+                {
+                  tile[ty * tileSize + tx] = source[std::min (tileColumn * tileSize + tx, columns - 1)];
+                }
+            }
+          uint64_t offset = ELEVATION_RASTER_HEADER_SIZE
+            + ((uint64_t) tileRow * tileColumns + tileColumn) * tileSamples * sizeof (float);
+          if (fseeko (out, offset, SEEK_SET) != 0
+              || std::fwrite (&tile[0], sizeof (float), tileSamples, out) != tileSamples)
+            {
+              std::cerr << "Could not write " << output << "\n";
+              std::fclose (out);
+              return 1;
+            }
+        }
+    }
+
+  if (std::fclose (out) != 0)
+    {
+      std::cerr << "Could not write " << output << "\n";
+      return 1;
+    }
+  std::cout << columns << "x" << rows << " samples in " << tileColumns << "x" << (rows + tileSize - 1) / tileSize
+            << " tiles written to " << output;
+  if (missing > 0)
+    {
+      std::cout << ", " << missing << " samples without data written as 0";
+    }
+  std::cout << "\n";
+  return 0;
+}
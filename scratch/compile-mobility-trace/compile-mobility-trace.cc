@@ -0,0 +1,102 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+/*
+ * Compiles an ns-2 movement trace (e.g. one written by BonnMotion or
+ * SUMO) to the binary trace replayed by CompiledMobilityTraceHelper (see
+ * compiled-mobility-trace-format.h). The trace is replayed once with
+ * Ns2MobilityHelper, and the course changes of the nodes are written as
+ * the legs of their movements.
+ *
+ * Usage:
+ *
+ *  ./waf --run "compile-mobility-trace --traceFile=Madrid-100.1.tcl --output=Madrid-100.1.mob"
+ *
+ *  The nodes of the trace are found by scanning it, unless --nodeNum gives
+ *  the number of nodes to create.
+ *  The compiled trace can be used wherever the ns-2 one was, e.g. as the
+ *  traceFile of the electric-consumption example. With --streaming, the
+ *  ns-2 trace is read as it is replayed (see
+ *  Ns2MobilityHelper::EnableStreaming), so large traces are compiled with
+ *  the memory of their legs only.
+ */
+
+#include <iostream>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+
+using namespace ns3;
+
+int main (int argc, char *argv[])
+{
+  std::string traceFile;
+  uint32_t nodeNum = 0;
+  std::string output;
+  uint32_t indexStride = 64;
+  double streaming = 0;
+
+  CommandLine cmd;
+  cmd.AddValue ("traceFile", "Ns2 movement trace file", traceFile);
+  cmd.AddValue ("nodeNum", "Number of nodes, those of the trace if 0", nodeNum);
+  cmd.AddValue ("output", "Compiled trace file", output);
+  cmd.AddValue ("indexStride", "Legs per entry of the time index", indexStride);
+  cmd.AddValue ("streaming", "Look-ahead in s of the streaming mode, 0 to read the whole trace at install", streaming);
+  cmd.Parse (argc, argv);
+
+  if (traceFile.empty () || output.empty () || indexStride == 0)
+    {
+      std::cout << "Usage of " << argv[0] << " :\n\n"
+      "./waf --run \"compile-mobility-trace --traceFile=Madrid-100.1.tcl --output=Madrid-100.1.mob\"\n";
+      return 0;
+    }
+
+  Ns2MobilityHelper ns2 = Ns2MobilityHelper (traceFile);
+  NodeContainer nodes;
+  if (nodeNum > 0)
+    {
+      nodes.Create (nodeNum);
+    }
+  else
+    {
+      nodes = ns2.GetTraceInfo ().CreateNodes ();
+    }
+  if (streaming > 0)
+    {
+      ns2.EnableStreaming (Seconds (streaming));
+    }
+  ns2.Install (); // the initial positions are set at install
+
+  CompiledMobilityTraceWriter writer;
+  writer.SetIndexStride (indexStride);
+  writer.Install (nodes);
+
+  Simulator::Run ();
+
+  if (!writer.Write (output))
+    {
+      std::cerr << "Could not write " << output << "\n";
+      return 1;
+    }
+  Simulator::Destroy ();
+  return 0;
+}
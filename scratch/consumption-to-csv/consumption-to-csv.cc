@@ -0,0 +1,192 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+/*
+ * Converts a consumption record file written by ConsumptionRecorder (see
+ * the electric-consumption example, --recordFile) to CSV.
+ *
+ * Usage:
+ *
+ *  ./waf --run "consumption-to-csv --input=consumption.evr --output=consumption.csv"
+ *
+ *  The output is written to the standard output if no output file is given.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "../electric-consumption/consumption-record-format.h"
+
+using namespace ns3;
+
+/**
+ * \param data next byte of the column, moved past the size and the column.
+ * \param end end of the chunk.
+ * \param [out] column first byte of the column.
+ * \param [out] columnEnd end of the column.
+ * \returns false if the chunk ends before the column.
+ */
+static bool
+ReadColumn (const uint8_t *&data, const uint8_t *end, const uint8_t *&column, const uint8_t *&columnEnd)
+{
+  uint32_t size;
+  if ((size_t) (end - data) < sizeof (size))
+    {
+      return false;
+    }
+  std::memcpy (&size, data, sizeof (size));
+  data += sizeof (size);
+  if ((size_t) (end - data) < size)
+    {
+      return false;
+    }
+  column = data;
+  columnEnd = data + size;
+  data = columnEnd;
+  return true;
+}
+
+int main (int argc, char *argv[])
+{
+  std::string input;
+  std::string output;
+  int precision = 17;
+
+  CommandLine cmd;
+  cmd.AddValue ("input", "Consumption record file", input);
+  cmd.AddValue ("output", "CSV file, the standard output if empty", output);
+  cmd.AddValue ("precision", "Significant digits of the real numbers", precision);
+  cmd.Parse (argc, argv);
+
+  if (input.empty ())
+    {
+      std::cout << "Usage of " << argv[0] << " :\n\n"
+      "./waf --run \"consumption-to-csv --input=consumption.evr --output=consumption.csv\"\n";
+      return 0;
+    }
+
+  std::ifstream file (input.c_str (), std::ios::in | std::ios::binary);
+  ConsumptionRecordFileHeader header;
+  if (!file.read ((char *) &header, sizeof (header))
+      || std::memcmp (header.magic, CONSUMPTION_RECORD_MAGIC, sizeof (header.magic)) != 0
+      || header.version != CONSUMPTION_RECORD_VERSION
+      || header.columns != CONSUMPTION_RECORD_COLUMNS)
+    {
+      std::cerr << input << " is not a consumption record file\n";
+      return 1;
+    }
+
+  std::ofstream outputFile;
+  if (!output.empty ())
+    {
+      outputFile.open (output.c_str ());
+      if (!outputFile.is_open ())
+        {
+          std::cerr << "Could not open " << output << " for writing\n";
+          return 1;
+        }
+    }
+  std::ostream &os = output.empty () ? std::cout : outputFile;
+  os << std::setprecision (precision);
+  os << "time,node,x,y,z,speed,energyFraction,remainingEnergy,energyConsumed,totalEnergyConsumed\n";
+
+  int64_t lastTime = 0;
+  uint32_t lastNode = 0;
+  std::vector<uint64_t> lastValues;     // bits of the last two values of each column of each node
+  std::vector<uint8_t> buffer;
+  std::vector<int64_t> time;
+  std::vector<uint32_t> node;
+  std::vector<double> values[CONSUMPTION_RECORD_DOUBLE_COLUMNS];
+
+  ConsumptionRecordChunkHeader chunk;
+  while (file.read ((char *) &chunk, sizeof (chunk)))
+    {
+      buffer.resize (chunk.size);
+      if (!file.read ((char *) buffer.data (), chunk.size))
+        {
+          std::cerr << input << " is truncated\n";
+          return 1;
+        }
+      const uint8_t *data = buffer.data ();
+      const uint8_t *end = data + chunk.size;
+      const uint8_t *column;
+      const uint8_t *columnEnd;
+      uint64_t value;
+      bool ok = true;
+
+      time.resize (chunk.rows);
+      ok = ok && ReadColumn (data, end, column, columnEnd);
+      for (uint32_t i = 0; ok && i < chunk.rows; i++)
+        {
+          ok = ConsumptionRecordGetVarint (column, columnEnd, value);
+          lastTime += ConsumptionRecordUnZigZag (value);
+          time[i] = lastTime;
+        }
+
+      node.resize (chunk.rows);
+      ok = ok && ReadColumn (data, end, column, columnEnd);
+      for (uint32_t i = 0; ok && i < chunk.rows; i++)
+        {
+          ok = ConsumptionRecordGetVarint (column, columnEnd, value);
+          lastNode += ConsumptionRecordUnZigZag (value);
+          node[i] = lastNode;
+          if (lastValues.size () < (lastNode + 1) * CONSUMPTION_RECORD_DOUBLE_COLUMNS * 2)
+            {
+              lastValues.resize ((lastNode + 1) * CONSUMPTION_RECORD_DOUBLE_COLUMNS * 2, 0);
+            }
+        }
+
+      for (uint32_t c = 0; c < CONSUMPTION_RECORD_DOUBLE_COLUMNS; c++)
+        {
+          values[c].resize (chunk.rows);
+          ok = ok && ReadColumn (data, end, column, columnEnd);
+          for (uint32_t i = 0; ok && i < chunk.rows; i++)
+            {
+              uint64_t *last = &lastValues[(node[i] * CONSUMPTION_RECORD_DOUBLE_COLUMNS + c) * 2];
+              ok = ConsumptionRecordGetDouble (column, columnEnd, last[0], last[1], value);
+              last[1] = last[0];
+              last[0] = value;
+              values[c][i] = ConsumptionRecordDouble (value);
+            }
+        }
+
+      if (!ok)
+        {
+          std::cerr << input << " is corrupted\n";
+          return 1;
+        }
+
+      for (uint32_t i = 0; i < chunk.rows; i++)
+        {
+          os << time[i] / 1e9 << "," << node[i];
+          for (uint32_t c = 0; c < CONSUMPTION_RECORD_DOUBLE_COLUMNS; c++)
+            {
+              os << "," << values[c][i];
+            }
+          os << "\n";
+        }
+    }
+
+  return 0;
+}
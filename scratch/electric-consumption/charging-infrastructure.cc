@@ -0,0 +1,426 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <libxml/xmlreader.h>
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/simulator.h"
+#include "charging-infrastructure.h"
+
+namespace ns3 {
+
+  NS_LOG_COMPONENT_DEFINE ("ChargingInfrastructure");
+
+  NS_OBJECT_ENSURE_REGISTERED (ChargingInfrastructure);
+
+  TypeId
+  ChargingInfrastructure::GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::ChargingInfrastructure")
+      .SetParent<Object> ()
+      .SetGroupName ("Consumption")
+      .AddConstructor<ChargingInfrastructure> ()
+      .AddAttribute ("UpdateTime",
+                     "Time between each update of the charging vehicles.",
+                     TimeValue (Seconds (1)),
+                     MakeTimeAccessor (&ChargingInfrastructure::m_updateTime),
+                     MakeTimeChecker ())
+      .AddAttribute ("StopSpeed",
+                     "Maximum speed in m/s of a vehicle that can charge.",
+                     DoubleValue (0.1),
+                     MakeDoubleAccessor (&ChargingInfrastructure::m_stopSpeed),
+                     MakeDoubleChecker<double> (0))
+      .AddAttribute ("CellSize",
+                     "Side in m of the cells of the grid index of the stations. 0 uses the largest station range.",
+                     DoubleValue (0),
+                     MakeDoubleAccessor (&ChargingInfrastructure::m_cellSize),
+                     MakeDoubleChecker<double> (0))
+      .AddTraceSource ("Charge",
+                       "Energy taken from a charging station by a vehicle.",
+                       MakeTraceSourceAccessor (&ChargingInfrastructure::m_chargeTrace),
+                       "ns3::ChargingInfrastructure::ChargeCallback")
+    ;
+    return tid;
+  }
+
+  ChargingInfrastructure::ChargingInfrastructure ()
+    : m_cellSize (0),
+      m_gridCellSize (1),
+      m_minX (0),
+      m_minY (0),
+      m_columns (0),
+      m_rows (0),
+      m_updateTime (Seconds (1)),
+      m_stopSpeed (0.1)
+  {
+    NS_LOG_FUNCTION (this);
+  }
+
+  ChargingInfrastructure::~ChargingInfrastructure ()
+  {
+    NS_LOG_FUNCTION (this);
+  }
+
+  void
+  ChargingInfrastructure::DoDispose (void)
+  {
+    NS_LOG_FUNCTION (this);
+    m_stations.clear ();
+    m_vehicles.clear ();
+    Object::DoDispose ();
+  }
+
+  void
+  ChargingInfrastructure::AddStation (Ptr<ChargingStation> station)
+  {
+    NS_LOG_FUNCTION (this << station);
+    NS_ASSERT (station != NULL);
+    m_stations.push_back (station);
+  }
+
+  bool
+  ChargingInfrastructure::LoadXml (std::string filename)
+  {
+    NS_LOG_FUNCTION (this << filename);
+    xmlTextReaderPtr reader = xmlReaderForFile (filename.c_str (), NULL, 0);
+
+    // case of failure
+    if (reader == NULL)
+    {
+      NS_LOG_ERROR ("Could not parse XML file " << filename);
+      return false;
+    }
+
+    bool valid = true;
+    int ret;
+    while ((ret = xmlTextReaderRead (reader)) == 1)
+    {
+      if (xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT
+          || std::strcmp ((const char *) xmlTextReaderConstLocalName (reader), "ChargingStation") != 0)
+      {
+        continue;
+      }
+
+      Ptr<ChargingStation> station = CreateObject<ChargingStation> ();
+      bool stationValid = true;
+      while (xmlTextReaderMoveToNextAttribute (reader) == 1)
+      {
+        const char *name = (const char *) xmlTextReaderConstLocalName (reader);
+        const char *value = (const char *) xmlTextReaderConstValue (reader);
+        if (!station->SetAttributeFailSafe (name, StringValue (value)))
+        {
+          NS_LOG_ERROR ("Invalid charging station attribute " << name << "=\"" << value << "\" in " << filename);
+          stationValid = false;
+        }
+      }
+
+      if (stationValid)
+      {
+        AddStation (station);
+      } else
+      {
+        valid = false;
+      }
+    }
+
+    if (ret != 0)
+    {
+      NS_LOG_ERROR ("Could not parse XML file " << filename << ". Check the XML structure.");
+      valid = false;
+    }
+    xmlFreeTextReader (reader);
+    return valid;
+  }
+
+  uint32_t
+  ChargingInfrastructure::GetNStations (void) const
+  {
+    return m_stations.size ();
+  }
+
+  Ptr<ChargingStation>
+  ChargingInfrastructure::GetStation (uint32_t i) const
+  {
+    NS_ASSERT (i < m_stations.size ());
+    return m_stations[i];
+  }
+
+  void
+  ChargingInfrastructure::Install (Ptr<ElectricVehicleConsumptionModel> model)
+  {
+    NS_LOG_FUNCTION (this << model);
+    NS_ASSERT (model != NULL);
+    NS_ASSERT (model->GetNode () != NULL);
+
+    Vehicle vehicle;
+    vehicle.model = model;
+    vehicle.mobility = model->GetNode ()->GetObject<MobilityModel> ();
+    vehicle.station = -1;
+    vehicle.charged = false;
+    if (vehicle.mobility == NULL)
+    {
+      NS_LOG_ERROR ("Node " << model->GetNode ()->GetId () << " has no mobility model, it will not charge");
+      return;
+    }
+    m_vehicles.push_back (vehicle);
+  }
+
+  void
+  ChargingInfrastructure::InstallAll (void)
+  {
+    NS_LOG_FUNCTION (this);
+    for (uint32_t i = 0; i < NodeList::GetNNodes (); i++)
+    {
+      Ptr<ElectricVehicleConsumptionModel> model = NodeList::GetNode (i)->GetObject<ElectricVehicleConsumptionModel> ();
+      if (model != NULL)
+      {
+        Install (model);
+      }
+    }
+  }
+
+  void
+  ChargingInfrastructure::Start (void)
+  {
+    NS_LOG_FUNCTION (this);
+    if (m_stations.empty () || m_vehicles.empty ())
+    {
+      return;
+    }
+    BuildGrid ();
+    m_lastUpdateTime = Simulator::Now ();
+    Simulator::ScheduleNow (&ChargingInfrastructure::Update, this);
+  }
+
+  void
+  ChargingInfrastructure::BuildGrid (void)
+  {
+    double maxRange = 0;
+    double minX = 0;
+    double minY = 0;
+    double maxX = 0;
+    double maxY = 0;
+    for (uint32_t i = 0; i < m_stations.size (); i++)
+    {
+      Vector position = m_stations[i]->GetPosition ();
+      double range = m_stations[i]->GetRange ();
+      if (i == 0)
+      {
+        minX = position.x - range;
+        minY = position.y - range;
+        maxX = position.x + range;
+        maxY = position.y + range;
+      }
+      minX = std::min (minX, position.x - range);
+      minY = std::min (minY, position.y - range);
+      maxX = std::max (maxX, position.x + range);
+      maxY = std::max (maxY, position.y + range);
+      maxRange = std::max (maxRange, range);
+    }
+
+    // cells of about the size of a station range, but no more cells than a
+    // small multiple of the stations for sparse deployments
+    double cellSize = m_cellSize > 0 ? m_cellSize : std::max (maxRange, 1.0);
+    double maxCells = std::max (1024.0, 16.0 * m_stations.size ());
+    double cells = std::ceil ((maxX - minX) / cellSize + 1) * std::ceil ((maxY - minY) / cellSize + 1);
+    if (cells > maxCells)
+    {
+      cellSize *= std::sqrt (cells / maxCells);
+    }
+
+    m_gridCellSize = cellSize;
+    m_minX = minX;
+    m_minY = minY;
+    m_columns = (int64_t) ((maxX - minX) / cellSize) + 1;
+    m_rows = (int64_t) ((maxY - minY) / cellSize) + 1;
+
+    // compressed rows: count the stations of each cell, then fill them
+    m_cellStart.assign (m_columns * m_rows + 1, 0);
+    for (int pass = 0; pass < 2; pass++)
+    {
+      for (uint32_t i = 0; i < m_stations.size (); i++)
+      {
+        Vector position = m_stations[i]->GetPosition ();
+        double range = m_stations[i]->GetRange ();
+        int64_t firstColumn = (int64_t) ((position.x - range - m_minX) / cellSize);
+        int64_t lastColumn = std::min ((int64_t) ((position.x + range - m_minX) / cellSize), m_columns - 1);
+        int64_t firstRow = (int64_t) ((position.y - range - m_minY) / cellSize);
+        int64_t lastRow = std::min ((int64_t) ((position.y + range - m_minY) / cellSize), m_rows - 1);
+        for (int64_t row = firstRow; row <= lastRow; row++)
+        {
+          for (int64_t column = firstColumn; column <= lastColumn; column++)
+          {
+            uint32_t &entry = m_cellStart[row * m_columns + column + (pass == 0 ? 1 : 0)];
+            if (pass == 1)
+            {
+              m_cellStations[entry] = i;
+            }
+            entry++;
+          }
+        }
+      }
+      if (pass == 0)
+      {
+        for (uint32_t cell = 1; cell < m_cellStart.size (); cell++)
+        {
+          m_cellStart[cell] += m_cellStart[cell - 1];
+        }
+        m_cellStations.resize (m_cellStart.back ());
+      } else
+      {
+        // the fill moved each start to the start of the next cell
+        for (uint32_t cell = m_cellStart.size () - 1; cell > 0; cell--)
+        {
+          m_cellStart[cell] = m_cellStart[cell - 1];
+        }
+        m_cellStart[0] = 0;
+      }
+    }
+    NS_LOG_DEBUG ("Grid of " << m_columns << "x" << m_rows << " cells of " << cellSize << " m for "
+                  << m_stations.size () << " stations");
+  }
+
+  int64_t
+  ChargingInfrastructure::GetCell (const Vector &position) const
+  {
+    double x = (position.x - m_minX) / m_gridCellSize;
+    double y = (position.y - m_minY) / m_gridCellSize;
+    if (!(x >= 0 && y >= 0 && x < m_columns && y < m_rows))
+    {
+      return -1;
+    }
+    return (int64_t) y * m_columns + (int64_t) x;
+  }
+
+  int32_t
+  ChargingInfrastructure::FindStation (const Vector &position) const
+  {
+    int64_t cell = GetCell (position);
+    if (cell < 0)
+    {
+      return -1;
+    }
+    int32_t nearest = -1;
+    double nearestDistance = 0;
+    for (uint32_t i = m_cellStart[cell]; i < m_cellStart[cell + 1]; i++)
+    {
+      uint32_t station = m_cellStations[i];
+      Vector stationPosition = m_stations[station]->GetPosition ();
+      double range = m_stations[station]->GetRange ();
+      double dx = position.x - stationPosition.x;
+      double dy = position.y - stationPosition.y;
+      double dz = position.z - stationPosition.z;
+      double distance = dx * dx + dy * dy + dz * dz;
+      if (distance <= range * range && (nearest < 0 || distance < nearestDistance))
+      {
+        nearest = station;
+        nearestDistance = distance;
+      }
+    }
+    return nearest;
+  }
+
+  void
+  ChargingInfrastructure::Charge (uint32_t station, uint32_t vehicle, double power, double timeFromLastUpdate)
+  {
+    Ptr<ChargingStation> chargingStation = m_stations[station];
+    Ptr<ElectricVehicleConsumptionModel> model = m_vehicles[vehicle].model;
+
+    // kW during s to Wh
+    double energy = power * 1000 * timeFromLastUpdate / 3600 * chargingStation->GetEfficiency ();
+    energy = model->Charge (energy, timeFromLastUpdate);
+    if (energy > 0)
+    {
+      chargingStation->AddEnergyDelivered (energy);
+      m_chargeTrace (station, model->GetNode ()->GetId (), energy);
+    }
+  }
+
+  void
+  ChargingInfrastructure::Update (void)
+  {
+    if (Simulator::IsFinished ())
+    {
+      return;
+    }
+    NS_LOG_FUNCTION (this);
+
+    // energy of the last interval, with the plugs assigned in the last update
+    double timeFromLastUpdate = (Simulator::Now () - m_lastUpdateTime).GetSeconds ();
+    for (uint32_t i = 0; i < m_stations.size (); i++)
+    {
+      const std::vector<uint32_t> &charging = m_stations[i]->GetChargingVehicles ();
+      double power = m_stations[i]->GetChargingPower ();
+      for (uint32_t j = 0; j < charging.size (); j++)
+      {
+        Charge (i, charging[j], power, timeFromLastUpdate);
+      }
+    }
+
+    for (uint32_t i = 0; i < m_vehicles.size (); i++)
+    {
+      Vehicle &vehicle = m_vehicles[i];
+      Vector velocity = vehicle.mobility->GetVelocity ();
+      double speed2 = velocity.x * velocity.x + velocity.y * velocity.y + velocity.z * velocity.z;
+      int32_t station = -1;
+      if (speed2 <= m_stopSpeed * m_stopSpeed)
+      {
+        station = FindStation (vehicle.mobility->GetPosition ());
+      }
+
+      bool full = vehicle.model->GetRemainingEnergy () >= vehicle.model->GetMaximunBatteryCapacity ();
+      if (station != vehicle.station)
+      {
+        if (vehicle.station >= 0)
+        {
+          m_stations[vehicle.station]->Remove (i);
+        }
+        vehicle.station = station;
+        vehicle.charged = full;
+        if (station >= 0 && !full)
+        {
+          m_stations[station]->Enqueue (i);
+        }
+      } else if (station >= 0 && !vehicle.charged && full)
+      {
+        m_stations[station]->Remove (i);
+        vehicle.charged = true;
+      }
+    }
+
+    for (uint32_t i = 0; i < m_stations.size (); i++)
+    {
+      m_stations[i]->FillPlugs ();
+    }
+
+    m_lastUpdateTime = Simulator::Now ();
+    Simulator::Schedule (m_updateTime, &ChargingInfrastructure::Update, this);
+  }
+
+} // namespace ns3
@@ -0,0 +1,204 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#ifndef CHARGING_INFRASTRUCTURE_H
+#define CHARGING_INFRASTRUCTURE_H
+
+#include <string>
+#include <vector>
+
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/nstime.h"
+#include "ns3/traced-callback.h"
+#include "ns3/mobility-module.h"
+#include "charging-station.h"
+#include "electric-vehicle-consumption-model.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup consumption
+ * \brief Charges electric vehicles stopped near charging stations.
+ *
+ * Every UpdateTime the infrastructure first delivers to each plugged vehicle
+ * the energy of the elapsed interval, with the power its station gave it
+ * during the interval, and then looks at the vehicles again:
+ *
+ * - a vehicle slower than StopSpeed within the range of a station joins the
+ *   queue of the nearest one; it keeps its place while it stays there.
+ * - a vehicle that moves or leaves the range releases its plug or its place
+ *   in the queue.
+ * - a vehicle whose battery is full releases its plug, and does not queue
+ *   again until it has moved.
+ *
+ * Finally each station gives its free plugs to its queue in arrival order.
+ *
+ * The stations are indexed in a uniform grid of CellSize cells covering
+ * their ranges: each cell lists the stations whose range overlaps it, so a
+ * stopped vehicle only checks the stations of its cell and moving vehicles
+ * check none. The cost of an update is linear in the number of vehicles and
+ * in the number of stations near each one, not in the total number of
+ * stations.
+ *
+ * Stations can be created in code (AddStation) or loaded from an XML file
+ * (LoadXml):
+ *
+ * \verbatim
+   <ChargingStations>
+     <ChargingStation Position="120:40:0" Plugs="4" PlugPower="50" GridPower="150"/>
+     <ChargingStation Position="900:300:0" Range="20" Efficiency="0.95"/>
+   </ChargingStations>
+   \endverbatim
+ *
+ * where the attributes of each element are attributes of ns3::ChargingStation.
+ * Stations must be added before Start is called.
+ */
+class ChargingInfrastructure : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ChargingInfrastructure ();
+
+  virtual ~ChargingInfrastructure ();
+
+  /**
+   * \param station station to add.
+   */
+  void AddStation (Ptr<ChargingStation> station);
+
+  /**
+   * \param filename XML file with ChargingStation elements.
+   * \returns false if the file could not be read or has errors; the valid
+   *          stations are added anyway.
+   */
+  bool LoadXml (std::string filename);
+
+  /**
+   * \returns number of stations.
+   */
+  uint32_t GetNStations (void) const;
+
+  /**
+   * \param i index of the station, in the order they were added.
+   * \returns the station.
+   */
+  Ptr<ChargingStation> GetStation (uint32_t i) const;
+
+  /**
+   * \param model consumption model of the vehicle, with its node and mobility
+   *        model already set.
+   */
+  void Install (Ptr<ElectricVehicleConsumptionModel> model);
+
+  /**
+   * Installs the consumption models of all the nodes of the global
+   * ns3::NodeList.
+   */
+  void InstallAll (void);
+
+  /**
+   * Builds the grid index and schedules the updates, the first one now and
+   * then every UpdateTime.
+   */
+  void Start (void);
+
+  /**
+   * \param position a position.
+   * \returns index of the nearest station in range of position, or -1.
+   */
+  int32_t FindStation (const Vector &position) const;
+
+  /**
+   * TracedCallback signature for the energy delivered to a vehicle.
+   *
+   * \param [in] station index of the station.
+   * \param [in] nodeId node ID of the vehicle.
+   * \param [in] energy energy in Wh taken from the charger by the vehicle;
+   *             with a battery pack model, less of it reaches the cells.
+   */
+  typedef void (* ChargeCallback)(uint32_t station, uint32_t nodeId, double energy);
+
+private:
+  virtual void DoDispose (void);
+
+  /**
+   * Builds the grid index of the stations.
+   */
+  void BuildGrid (void);
+
+  /**
+   * \param position a position.
+   * \returns index of the grid cell of position, or -1 outside the grid.
+   */
+  int64_t GetCell (const Vector &position) const;
+
+  /**
+   * Scheduled tick.
+   */
+  void Update (void);
+
+  /**
+   * \param station index of the station.
+   * \param vehicle index of the plugged vehicle.
+   * \param power power in kW drawn from the grid for the vehicle.
+   * \param timeFromLastUpdate time since the last update in seconds.
+   *
+   * Delivers the energy of the last interval to a plugged vehicle, up to
+   * the capacity of its battery.
+   */
+  void Charge (uint32_t station, uint32_t vehicle, double power, double timeFromLastUpdate);
+
+  /**
+   * State of an installed vehicle.
+   */
+  struct Vehicle
+  {
+    Ptr<ElectricVehicleConsumptionModel> model;
+    Ptr<MobilityModel> mobility;
+    int32_t station;                 // station where it charges or waits, or -1
+    bool charged;                    // battery filled, waiting to move
+  };
+
+  std::vector<Ptr<ChargingStation> > m_stations;   // stations
+  std::vector<Vehicle> m_vehicles;                 // installed vehicles
+
+  // grid index
+  double m_cellSize;                               // side of a cell in m, 0 for the largest range
+  double m_gridCellSize;                           // side of a cell in m used by the grid
+  double m_minX;                                   // corner of the grid
+  double m_minY;
+  int64_t m_columns;                               // size of the grid in cells
+  int64_t m_rows;
+  std::vector<uint32_t> m_cellStart;               // first entry of each cell in m_cellStations
+  std::vector<uint32_t> m_cellStations;            // stations of each cell
+
+  Time m_updateTime;                               // time between updates
+  Time m_lastUpdateTime;                           // time of the last update
+  double m_stopSpeed;                              // maximum speed of a stopped vehicle in m/s
+
+  TracedCallback<uint32_t, uint32_t, double> m_chargeTrace;
+};
+
+} // namespace ns3
+
+#endif /* CHARGING_INFRASTRUCTURE_H */
@@ -0,0 +1,193 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <algorithm>
+
+#include "ns3/log.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "charging-station.h"
+
+namespace ns3 {
+
+  NS_LOG_COMPONENT_DEFINE ("ChargingStation");
+
+  NS_OBJECT_ENSURE_REGISTERED (ChargingStation);
+
+  TypeId
+  ChargingStation::GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::ChargingStation")
+      .SetParent<Object> ()
+      .SetGroupName ("Consumption")
+      .AddConstructor<ChargingStation> ()
+      .AddAttribute ("Position",
+                     "Position of the station.",
+                     VectorValue (Vector (0, 0, 0)),
+                     MakeVectorAccessor (&ChargingStation::m_position),
+                     MakeVectorChecker ())
+      .AddAttribute ("Range",
+                     "Maximum distance in m between a vehicle and the station to charge.",
+                     DoubleValue (10),
+                     MakeDoubleAccessor (&ChargingStation::m_range),
+                     MakeDoubleChecker<double> (0))
+      .AddAttribute ("Plugs",
+                     "Number of vehicles that can charge at the same time.",
+                     UintegerValue (1),
+                     MakeUintegerAccessor (&ChargingStation::m_plugs),
+                     MakeUintegerChecker<uint32_t> (1))
+      .AddAttribute ("PlugPower",
+                     "Maximum power in kW of each plug.",
+                     DoubleValue (50),
+                     MakeDoubleAccessor (&ChargingStation::m_plugPower),
+                     MakeDoubleChecker<double> (0))
+      .AddAttribute ("GridPower",
+                     "Maximum power in kW of the grid connection, shared by all the plugs. 0 is unlimited.",
+                     DoubleValue (0),
+                     MakeDoubleAccessor (&ChargingStation::m_gridPower),
+                     MakeDoubleChecker<double> (0))
+      .AddAttribute ("Efficiency",
+                     "Fraction of the power drawn from the grid that reaches the battery.",
+                     DoubleValue (0.9),
+                     MakeDoubleAccessor (&ChargingStation::m_efficiency),
+                     MakeDoubleChecker<double> (0, 1))
+    ;
+    return tid;
+  }
+
+  ChargingStation::ChargingStation ()
+    : m_range (10),
+      m_plugs (1),
+      m_plugPower (50),
+      m_gridPower (0),
+      m_efficiency (0.9),
+      m_energyDelivered (0)
+  {
+    NS_LOG_FUNCTION (this);
+  }
+
+  ChargingStation::~ChargingStation ()
+  {
+    NS_LOG_FUNCTION (this);
+  }
+
+  Vector
+  ChargingStation::GetPosition (void) const
+  {
+    return m_position;
+  }
+
+  void
+  ChargingStation::SetPosition (const Vector &position)
+  {
+    NS_LOG_FUNCTION (this << position);
+    m_position = position;
+  }
+
+  double
+  ChargingStation::GetRange (void) const
+  {
+    return m_range;
+  }
+
+  uint32_t
+  ChargingStation::GetPlugs (void) const
+  {
+    return m_plugs;
+  }
+
+  double
+  ChargingStation::GetChargingPower (void) const
+  {
+    if (m_gridPower == 0 || m_charging.empty ())
+    {
+      return m_plugPower;
+    }
+    return std::min (m_plugPower, m_gridPower / m_charging.size ());
+  }
+
+  double
+  ChargingStation::GetEfficiency (void) const
+  {
+    return m_efficiency;
+  }
+
+  const std::vector<uint32_t> &
+  ChargingStation::GetChargingVehicles (void) const
+  {
+    return m_charging;
+  }
+
+  uint32_t
+  ChargingStation::GetNWaiting (void) const
+  {
+    return m_waiting.size ();
+  }
+
+  void
+  ChargingStation::Enqueue (uint32_t vehicle)
+  {
+    NS_LOG_FUNCTION (this << vehicle);
+    m_waiting.push_back (vehicle);
+  }
+
+  void
+  ChargingStation::Remove (uint32_t vehicle)
+  {
+    NS_LOG_FUNCTION (this << vehicle);
+    std::vector<uint32_t>::iterator plug = std::find (m_charging.begin (), m_charging.end (), vehicle);
+    if (plug != m_charging.end ())
+    {
+      *plug = m_charging.back ();
+      m_charging.pop_back ();
+      return;
+    }
+    std::deque<uint32_t>::iterator waiting = std::find (m_waiting.begin (), m_waiting.end (), vehicle);
+    if (waiting != m_waiting.end ())
+    {
+      m_waiting.erase (waiting);
+    }
+  }
+
+  void
+  ChargingStation::FillPlugs (void)
+  {
+    while (m_charging.size () < m_plugs && !m_waiting.empty ())
+    {
+      NS_LOG_DEBUG ("Vehicle " << m_waiting.front () << " plugged");
+      m_charging.push_back (m_waiting.front ());
+      m_waiting.pop_front ();
+    }
+  }
+
+  void
+  ChargingStation::AddEnergyDelivered (double energy)
+  {
+    m_energyDelivered += energy;
+  }
+
+  double
+  ChargingStation::GetEnergyDelivered (void) const
+  {
+    return m_energyDelivered;
+  }
+
+} // namespace ns3
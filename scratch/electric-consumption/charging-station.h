@@ -0,0 +1,144 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#ifndef CHARGING_STATION_H
+#define CHARGING_STATION_H
+
+#include <deque>
+#include <vector>
+
+#include "ns3/object.h"
+#include "ns3/vector.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup consumption
+ * \brief Charging station for electric vehicles.
+ *
+ * A station has a number of plugs, each one delivering at most PlugPower,
+ * and a grid connection that delivers at most GridPower to all its plugs.
+ * The power that reaches the batteries is the power drawn from the grid
+ * times Efficiency. Vehicles stopped within Range of the station wait in a
+ * FIFO queue until a plug is free.
+ *
+ * The station only keeps its plugs and its queue; the vehicles are
+ * identified by the index given by ChargingInfrastructure, which moves them
+ * in and out and delivers the energy.
+ */
+class ChargingStation : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ChargingStation ();
+
+  virtual ~ChargingStation ();
+
+  /**
+   * \returns position of the station.
+   */
+  Vector GetPosition (void) const;
+
+  /**
+   * \param position position of the station.
+   */
+  void SetPosition (const Vector &position);
+
+  /**
+   * \returns maximum distance in m between a vehicle and the station to
+   *          charge.
+   */
+  double GetRange (void) const;
+
+  /**
+   * \returns number of plugs.
+   */
+  uint32_t GetPlugs (void) const;
+
+  /**
+   * \returns power in kW drawn from the grid by each charging vehicle, with
+   *          the current number of vehicles charging.
+   */
+  double GetChargingPower (void) const;
+
+  /**
+   * \returns fraction of the power drawn from the grid that reaches the
+   *          battery.
+   */
+  double GetEfficiency (void) const;
+
+  /**
+   * \returns vehicles using a plug.
+   */
+  const std::vector<uint32_t> & GetChargingVehicles (void) const;
+
+  /**
+   * \returns number of vehicles waiting for a plug.
+   */
+  uint32_t GetNWaiting (void) const;
+
+  /**
+   * \param vehicle vehicle that arrives at the station.
+   *
+   * Adds the vehicle at the end of the queue. It gets a plug on the next
+   * call to FillPlugs.
+   */
+  void Enqueue (uint32_t vehicle);
+
+  /**
+   * \param vehicle vehicle that leaves the station.
+   *
+   * Releases the plug of the vehicle, or removes it from the queue.
+   */
+  void Remove (uint32_t vehicle);
+
+  /**
+   * Gives the free plugs to the vehicles at the head of the queue.
+   */
+  void FillPlugs (void);
+
+  /**
+   * \param energy energy in Wh taken from the station by a vehicle.
+   */
+  void AddEnergyDelivered (double energy);
+
+  /**
+   * \returns total energy in Wh taken from the station by the vehicles.
+   */
+  double GetEnergyDelivered (void) const;
+
+private:
+  Vector m_position;                   // position of the station
+  double m_range;                      // maximum distance to charge in m
+  uint32_t m_plugs;                    // number of plugs
+  double m_plugPower;                  // maximum power of a plug in kW
+  double m_gridPower;                  // maximum power of the grid connection in kW, 0 unlimited
+  double m_efficiency;                 // charging efficiency
+  double m_energyDelivered;            // total energy delivered in Wh
+
+  std::vector<uint32_t> m_charging;    // vehicles using a plug
+  std::deque<uint32_t> m_waiting;      // vehicles waiting for a plug, in arrival order
+};
+
+} // namespace ns3
+
+#endif /* CHARGING_STATION_H */
@@ -0,0 +1,223 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#ifndef CONSUMPTION_RECORD_FORMAT_H
+#define CONSUMPTION_RECORD_FORMAT_H
+
+#include <stdint.h>
+#include <cstring>
+#include <vector>
+
+/**
+ * \ingroup consumption
+ * \file
+ *
+ * Binary columnar format of the consumption records written by
+ * ns3::ConsumptionRecorder, shared by the writer and the readers.
+ *
+ * A file is a ConsumptionRecordFileHeader followed by chunks. Each chunk is
+ * a ConsumptionRecordChunkHeader followed by the CONSUMPTION_RECORD_COLUMNS
+ * columns of its rows, one after the other, each one preceded by its size in
+ * bytes as a 32 bit integer. The columns are, in order: time, node, x, y,
+ * z, speed, energy fraction, remaining energy, energy consumed and total
+ * energy consumed.
+ *
+ * - time: nanoseconds, zigzag varint of the difference with the previous row.
+ * - node: node ID, zigzag varint of the difference with the previous row.
+ * - the other columns: the bits of the double xor the bits of a prediction
+ *   from the two previous values of the same column and node, see
+ *   ConsumptionRecordPutDouble.
+ *
+ * The previous values of a node are 0 before its first row. They are carried from one chunk to the next, so a file is
+ * decoded from the beginning. The headers are written in the byte order of
+ * the machine.
+ */
+
+#define CONSUMPTION_RECORD_MAGIC "EVREC\r\n"
+#define CONSUMPTION_RECORD_VERSION 2
+#define CONSUMPTION_RECORD_COLUMNS 10
+#define CONSUMPTION_RECORD_DOUBLE_COLUMNS 8
+
+struct ConsumptionRecordFileHeader
+{
+  char magic[8];         //!< CONSUMPTION_RECORD_MAGIC
+  uint32_t version;      //!< CONSUMPTION_RECORD_VERSION
+  uint32_t columns;      //!< CONSUMPTION_RECORD_COLUMNS
+};
+
+struct ConsumptionRecordChunkHeader
+{
+  uint32_t rows;         //!< number of rows of the chunk
+  uint32_t size;         //!< size in bytes of the columns of the chunk
+};
+
+inline uint64_t
+ConsumptionRecordZigZag (int64_t value)
+{
+  return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+inline int64_t
+ConsumptionRecordUnZigZag (uint64_t value)
+{
+  return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+inline uint64_t
+ConsumptionRecordBits (double value)
+{
+  uint64_t bits;
+  std::memcpy (&bits, &value, sizeof (bits));
+  return bits;
+}
+
+inline double
+ConsumptionRecordDouble (uint64_t bits)
+{
+  double value;
+  std::memcpy (&value, &bits, sizeof (value));
+  return value;
+}
+
+inline void
+ConsumptionRecordPutVarint (std::vector<uint8_t> &buffer, uint64_t value)
+{
+  while (value >= 0x80)
+    {
+      buffer.push_back ((uint8_t) (value | 0x80));
+      value >>= 7;
+    }
+  buffer.push_back ((uint8_t) value);
+}
+
+/**
+ * \param last last value.
+ * \param previous value before the last one.
+ * \returns the bits of the value extrapolated from them.
+ */
+inline uint64_t
+ConsumptionRecordExtrapolate (uint64_t last, uint64_t previous)
+{
+  return ConsumptionRecordBits (2 * ConsumptionRecordDouble (last) - ConsumptionRecordDouble (previous));
+}
+
+/**
+ * \param buffer buffer to append to.
+ * \param bits bits of the value.
+ * \param last bits of the last value.
+ * \param previous bits of the value before the last one.
+ *
+ * The value is predicted to be either the last one or the extrapolation
+ * of the last two, whichever leaves fewer meaningful bytes in the xor of
+ * the prediction with the value. A control byte gives the prediction
+ * (bit 7), the number of trailing zero bytes of the xor (bits 4 to 6) and
+ * its number of meaningful bytes (bits 0 to 3), which follow, lowest
+ * first. A value equal to its prediction takes the control byte alone.
+ */
+inline void
+ConsumptionRecordPutDouble (std::vector<uint8_t> &buffer, uint64_t bits, uint64_t last, uint64_t previous)
+{
+  uint64_t xors[2] = {bits ^ last, bits ^ ConsumptionRecordExtrapolate (last, previous)};
+  uint8_t control = 0;
+  uint64_t meaningful = 0;
+  int bytes = 9;
+  for (int prediction = 0; prediction < 2; prediction++)
+    {
+      uint64_t x = xors[prediction];
+      int trailing = 0;
+      while (trailing < 7 && x != 0 && !(x & 0xff))
+        {
+          x >>= 8;
+          trailing++;
+        }
+      int n = 0;
+      for (uint64_t rest = x; rest != 0; rest >>= 8)
+        {
+          n++;
+        }
+      if (n < bytes)
+        {
+          bytes = n;
+          meaningful = x;
+          control = (uint8_t) ((prediction << 7) | (trailing << 4) | n);
+        }
+    }
+  buffer.push_back (control);
+  for (int i = 0; i < bytes; i++)
+    {
+      buffer.push_back ((uint8_t) (meaningful >> (8 * i)));
+    }
+}
+
+/**
+ * \param [in,out] data next byte to decode, moved past the value.
+ * \param end end of the buffer.
+ * \param last bits of the last value.
+ * \param previous bits of the value before the last one.
+ * \param [out] bits bits of the decoded value.
+ * \returns false if the buffer ends before the value or it is not valid.
+ */
+inline bool
+ConsumptionRecordGetDouble (const uint8_t *&data, const uint8_t *end, uint64_t last, uint64_t previous, uint64_t &bits)
+{
+  if (data == end)
+    {
+      return false;
+    }
+  uint8_t control = *data++;
+  int trailing = (control >> 4) & 7;
+  int bytes = control & 0xf;
+  if (bytes > 8 || trailing + bytes > 8 || end - data < bytes)
+    {
+      return false;
+    }
+  uint64_t x = 0;
+  for (int i = 0; i < bytes; i++)
+    {
+      x |= (uint64_t) *data++ << (8 * i);
+    }
+  x <<= 8 * trailing;
+  bits = x ^ ((control & 0x80) ? ConsumptionRecordExtrapolate (last, previous) : last);
+  return true;
+}
+
+/**
+ * \param [in,out] data next byte to decode, moved past the varint.
+ * \param end end of the buffer.
+ * \param [out] value decoded value.
+ * \returns false if the buffer ends before the varint.
+ */
+inline bool
+ConsumptionRecordGetVarint (const uint8_t *&data, const uint8_t *end, uint64_t &value)
+{
+  value = 0;
+  for (int shift = 0; data < end && shift < 64; shift += 7)
+    {
+      uint8_t byte = *data++;
+      value |= (uint64_t) (byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+#endif /* CONSUMPTION_RECORD_FORMAT_H */
@@ -0,0 +1,325 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/uinteger.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/simulator.h"
+#include "consumption-recorder.h"
+
+namespace ns3 {
+
+  NS_LOG_COMPONENT_DEFINE ("ConsumptionRecorder");
+
+  NS_OBJECT_ENSURE_REGISTERED (ConsumptionRecorder);
+
+  TypeId
+  ConsumptionRecorder::GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::ConsumptionRecorder")
+      .SetParent<Object> ()
+      .SetGroupName ("Consumption")
+      .AddConstructor<ConsumptionRecorder> ()
+      .AddAttribute ("ChunkSize",
+                     "Number of rows buffered before they are handed to the writer thread.",
+                     UintegerValue (16384),
+                     MakeUintegerAccessor (&ConsumptionRecorder::m_chunkSize),
+                     MakeUintegerChecker<uint32_t> (1))
+    ;
+    return tid;
+  }
+
+  ConsumptionRecorder::ConsumptionRecorder ()
+    : m_chunkSize (16384),
+      m_chunk (0),
+      m_file (0),
+      m_stopWriter (false),
+      m_lastTime (0),
+      m_lastNode (0),
+      m_failed (false)
+  {
+    NS_LOG_FUNCTION (this);
+  }
+
+  ConsumptionRecorder::~ConsumptionRecorder ()
+  {
+    NS_LOG_FUNCTION (this);
+    Close ();
+  }
+
+  void
+  ConsumptionRecorder::DoDispose (void)
+  {
+    NS_LOG_FUNCTION (this);
+    Close ();
+    Object::DoDispose ();
+  }
+
+  void
+  ConsumptionRecorder::Open (std::string filename)
+  {
+    NS_LOG_FUNCTION (this << filename);
+    Close ();
+
+    m_file = std::fopen (filename.c_str (), "wb");
+    if (m_file == 0)
+    {
+      NS_FATAL_ERROR ("Could not open consumption record file " << filename << " for writing, aborting here \n");
+    }
+
+    ConsumptionRecordFileHeader header;
+    std::memcpy (header.magic, CONSUMPTION_RECORD_MAGIC, sizeof (header.magic));
+    header.version = CONSUMPTION_RECORD_VERSION;
+    header.columns = CONSUMPTION_RECORD_COLUMNS;
+    m_failed = std::fwrite (&header, sizeof (header), 1, m_file) != 1;
+
+    m_lastTime = 0;
+    m_lastNode = 0;
+    m_lastValues.clear ();
+    m_stopWriter = false;
+    m_chunk = AllocateChunk ();
+    m_writer = std::thread (&ConsumptionRecorder::WriterLoop, this);
+  }
+
+  void
+  ConsumptionRecorder::Install (Ptr<ElectricVehicleConsumptionModel> model)
+  {
+    NS_LOG_FUNCTION (this << model);
+    model->TraceConnectWithoutContext ("ConsumptionUpdate",
+                                       MakeCallback (&ConsumptionRecorder::RecordUpdate, this));
+  }
+
+  void
+  ConsumptionRecorder::InstallAll (void)
+  {
+    NS_LOG_FUNCTION (this);
+    for (uint32_t i = 0; i < NodeList::GetNNodes (); i++)
+    {
+      Ptr<ElectricVehicleConsumptionModel> model = NodeList::GetNode (i)->GetObject<ElectricVehicleConsumptionModel> ();
+      if (model != NULL)
+      {
+        Install (model);
+      }
+    }
+  }
+
+  bool
+  ConsumptionRecorder::Close (void)
+  {
+    if (m_file == 0)
+    {
+      return true;
+    }
+    NS_LOG_FUNCTION (this);
+
+    Flush ();
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_stopWriter = true;
+    }
+    m_condition.notify_one ();
+    m_writer.join ();
+
+    bool ok = !m_failed;
+    if (std::fclose (m_file) != 0)
+    {
+      ok = false;
+    }
+    m_file = 0;
+    if (!ok)
+    {
+      NS_LOG_ERROR ("Could not write the consumption record");
+    }
+
+    delete m_chunk;
+    m_chunk = 0;
+    for (uint32_t i = 0; i < m_freeChunks.size (); i++)
+    {
+      delete m_freeChunks[i];
+    }
+    m_freeChunks.clear ();
+    return ok;
+  }
+
+  void
+  ConsumptionRecorder::RecordUpdate (const ElectricVehicleConsumptionUpdate &update)
+  {
+    if (m_chunk == 0)
+    {
+      return;
+    }
+    Chunk *chunk = m_chunk;
+    chunk->time.push_back (update.time.GetNanoSeconds ());
+    chunk->node.push_back (update.nodeId);
+    chunk->values[0].push_back (update.position.x);
+    chunk->values[1].push_back (update.position.y);
+    chunk->values[2].push_back (update.position.z);
+    chunk->values[3].push_back (update.speed);
+    chunk->values[4].push_back (update.energyFraction);
+    chunk->values[5].push_back (update.remainingEnergy);
+    chunk->values[6].push_back (update.energyDiff);
+    chunk->values[7].push_back (update.totalEnergyConsumed);
+
+    if (++chunk->rows == m_chunkSize)
+    {
+      Flush ();
+    }
+  }
+
+  void
+  ConsumptionRecorder::Flush (void)
+  {
+    if (m_chunk == 0 || m_chunk->rows == 0)
+    {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_fullChunks.push_back (m_chunk);
+    }
+    m_condition.notify_one ();
+    m_chunk = AllocateChunk ();
+  }
+
+  ConsumptionRecorder::Chunk *
+  ConsumptionRecorder::AllocateChunk (void)
+  {
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      if (!m_freeChunks.empty ())
+      {
+        Chunk *chunk = m_freeChunks.back ();
+        m_freeChunks.pop_back ();
+        return chunk;
+      }
+    }
+    Chunk *chunk = new Chunk;
+    chunk->time.reserve (m_chunkSize);
+    chunk->node.reserve (m_chunkSize);
+    for (uint32_t i = 0; i < CONSUMPTION_RECORD_DOUBLE_COLUMNS; i++)
+    {
+      chunk->values[i].reserve (m_chunkSize);
+    }
+    chunk->rows = 0;
+    return chunk;
+  }
+
+  void
+  ConsumptionRecorder::WriterLoop (void)
+  {
+    std::unique_lock<std::mutex> lock (m_mutex);
+    while (true)
+    {
+      while (m_fullChunks.empty () && !m_stopWriter)
+      {
+        m_condition.wait (lock);
+      }
+      if (m_fullChunks.empty ())
+      {
+        return;
+      }
+      Chunk *chunk = m_fullChunks.front ();
+      m_fullChunks.pop_front ();
+      lock.unlock ();
+
+      WriteChunk (chunk);
+      chunk->time.clear ();
+      chunk->node.clear ();
+      for (uint32_t i = 0; i < CONSUMPTION_RECORD_DOUBLE_COLUMNS; i++)
+      {
+        chunk->values[i].clear ();
+      }
+      chunk->rows = 0;
+
+      lock.lock ();
+      m_freeChunks.push_back (chunk);
+    }
+  }
+
+  /**
+   * \param buffer buffer where the column is being encoded.
+   * \param start offset of the size of the column in the buffer.
+   *
+   * Writes the size of the column that starts at start.
+   */
+  static void
+  EndColumn (std::vector<uint8_t> &buffer, size_t start)
+  {
+    uint32_t size = buffer.size () - start - sizeof (uint32_t);
+    std::memcpy (&buffer[start], &size, sizeof (size));
+  }
+
+  void
+  ConsumptionRecorder::WriteChunk (const Chunk *chunk)
+  {
+    m_buffer.clear ();
+    size_t start;
+
+    start = m_buffer.size ();
+    m_buffer.resize (start + sizeof (uint32_t));
+    for (uint32_t i = 0; i < chunk->rows; i++)
+    {
+      ConsumptionRecordPutVarint (m_buffer, ConsumptionRecordZigZag (chunk->time[i] - m_lastTime));
+      m_lastTime = chunk->time[i];
+    }
+    EndColumn (m_buffer, start);
+
+    start = m_buffer.size ();
+    m_buffer.resize (start + sizeof (uint32_t));
+    for (uint32_t i = 0; i < chunk->rows; i++)
+    {
+      ConsumptionRecordPutVarint (m_buffer, ConsumptionRecordZigZag ((int64_t) chunk->node[i] - (int64_t) m_lastNode));
+      m_lastNode = chunk->node[i];
+      if (m_lastValues.size () < (chunk->node[i] + 1) * CONSUMPTION_RECORD_DOUBLE_COLUMNS * 2)
+      {
+        m_lastValues.resize ((chunk->node[i] + 1) * CONSUMPTION_RECORD_DOUBLE_COLUMNS * 2, 0);
+      }
+    }
+    EndColumn (m_buffer, start);
+
+    for (uint32_t column = 0; column < CONSUMPTION_RECORD_DOUBLE_COLUMNS; column++)
+    {
+      start = m_buffer.size ();
+      m_buffer.resize (start + sizeof (uint32_t));
+      const std::vector<double> &values = chunk->values[column];
+      for (uint32_t i = 0; i < chunk->rows; i++)
+      {
+        uint64_t *last = &m_lastValues[(chunk->node[i] * CONSUMPTION_RECORD_DOUBLE_COLUMNS + column) * 2];
+        uint64_t bits = ConsumptionRecordBits (values[i]);
+        ConsumptionRecordPutDouble (m_buffer, bits, last[0], last[1]);
+        last[1] = last[0];
+        last[0] = bits;
+      }
+      EndColumn (m_buffer, start);
+    }
+
+    ConsumptionRecordChunkHeader header;
+    header.rows = chunk->rows;
+    header.size = m_buffer.size ();
+    if (std::fwrite (&header, sizeof (header), 1, m_file) != 1
+        || std::fwrite (&m_buffer[0], 1, m_buffer.size (), m_file) != m_buffer.size ())
+    {
+      m_failed = true;
+    }
+  }
+
+} // namespace ns3
@@ -0,0 +1,146 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#ifndef CONSUMPTION_RECORDER_H
+#define CONSUMPTION_RECORDER_H
+
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "electric-vehicle-consumption-model.h"
+#include "consumption-record-format.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup consumption
+ * \brief Records the consumption updates of electric vehicles to a binary
+ * columnar file.
+ *
+ * Each ConsumptionUpdate of an installed vehicle appends a row (time, node,
+ * x, y, z, speed, energy fraction, remaining energy, energy consumed, total
+ * energy consumed) to the columns of the current chunk. The update carries
+ * all the values, so no context string is parsed and no object is looked
+ * up. Full chunks are compressed and written by a background thread, see
+ * consumption-record-format.h for the format.
+ * The scratch program consumption-to-csv converts a file to CSV.
+ */
+class ConsumptionRecorder : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ConsumptionRecorder ();
+
+  virtual ~ConsumptionRecorder ();
+
+  /**
+   * \param filename file to write. It is created or truncated.
+   */
+  void Open (std::string filename);
+
+  /**
+   * \param model consumption model whose updates are recorded.
+   */
+  void Install (Ptr<ElectricVehicleConsumptionModel> model);
+
+  /**
+   * Records the consumption models of all the nodes of the global
+   * ns3::NodeList.
+   */
+  void InstallAll (void);
+
+  /**
+   * Writes the pending rows and closes the file. Called on dispose.
+   *
+   * \returns false if the file could not be written.
+   */
+  bool Close (void);
+
+private:
+  virtual void DoDispose (void);
+
+  /**
+   * Columns of a chunk of rows.
+   */
+  struct Chunk
+  {
+    std::vector<int64_t> time;                                       // ns
+    std::vector<uint32_t> node;
+    std::vector<double> values[CONSUMPTION_RECORD_DOUBLE_COLUMNS];   // x, y, z, speed, fraction, remaining, consumed, total
+    uint32_t rows;
+  };
+
+  /**
+   * \param update state of the vehicle after the update.
+   *
+   * ConsumptionUpdate trace sink.
+   */
+  void RecordUpdate (const ElectricVehicleConsumptionUpdate &update);
+
+  /**
+   * Hands the current chunk to the writer thread and takes an empty one.
+   */
+  void Flush (void);
+
+  /**
+   * \returns an empty chunk.
+   */
+  Chunk * AllocateChunk (void);
+
+  /**
+   * Main loop of the writer thread.
+   */
+  void WriterLoop (void);
+
+  /**
+   * \param chunk chunk to encode and write, in the writer thread.
+   */
+  void WriteChunk (const Chunk *chunk);
+
+  uint32_t m_chunkSize;                              // rows per chunk
+  Chunk *m_chunk;                                    // chunk being filled
+
+  std::FILE *m_file;                                 // output file
+  std::thread m_writer;                              // writer thread
+  std::mutex m_mutex;                                // protects the queues and m_stopWriter
+  std::condition_variable m_condition;               // signals a full chunk to the writer
+  std::deque<Chunk *> m_fullChunks;                  // chunks to write
+  std::vector<Chunk *> m_freeChunks;                 // written chunks to reuse
+  bool m_stopWriter;                                 // the writer must exit once the queue is empty
+
+  // encoder state, only used by the writer thread
+  int64_t m_lastTime;
+  uint32_t m_lastNode;
+  std::vector<uint64_t> m_lastValues;                // bits of the last two values of each column of each node
+  std::vector<uint8_t> m_buffer;                     // encoded columns
+  bool m_failed;                                     // the header or a chunk could not be written
+};
+
+} // namespace ns3
+
+#endif /* CONSUMPTION_RECORDER_H */
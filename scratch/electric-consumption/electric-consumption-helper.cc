@@ -22,8 +22,16 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
-#include <libxml/encoding.h>
-#include <libxml/xmlwriter.h>
+#include <map>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <libxml/xmlreader.h>
 
 #include "ns3/core-module.h"
 #include "ns3/node-list.h"
@@ -36,8 +44,14 @@ namespace ns3 {
 
   NS_LOG_COMPONENT_DEFINE ("ElectricConsumptionHelper");
 
+  static void ResumeVehicles (std::vector<ElectricVehicleCheckpointRecord> records, ElectricConsumptionHelper::UpdateMode mode,
+                              double updateTime, Ptr<ElectricVehicleFleet> fleet);
+
   ElectricConsumptionHelper::ElectricConsumptionHelper (std::string filename, double updateTime)
-    : m_filename (filename)
+    : m_filename (filename),
+      m_updateMode (VEHICLE_UPDATE),
+      m_threads (1),
+      m_startTime (Seconds (0))
   {
     std::ifstream file (m_filename.c_str (), std::ios::in);
     if (updateTime <= 0.01 || std::isnan (updateTime))
@@ -54,7 +68,120 @@ namespace ns3 {
   void 
   ElectricConsumptionHelper::Install (void)
   {
-    LoadXml ();
+    if (m_updateMode == FLEET_UPDATE)
+    {
+      m_fleet = CreateObject<ElectricVehicleFleet> ();
+      m_fleet->SetThreads (m_threads);
+    }
+
+    if (IsSnapshot (m_filename))
+    {
+      LoadSnapshot ();
+    } else
+    {
+      LoadXml ();
+    }
+
+    if (!m_checkpoint.empty ())
+    {
+      Simulator::Schedule (m_startTime, &ResumeVehicles, m_checkpoint, m_updateMode, m_updateTime, m_fleet);
+    } else if (m_fleet != NULL)
+    {
+      m_fleet->Start (Seconds (m_updateTime)); // first update in second 0
+    }
+  }
+
+  bool
+  ElectricConsumptionHelper::LoadCheckpoint (std::string filename, Time time)
+  {
+    if (!ElectricVehicleCheckpoint::Load (filename, time, m_startTime, m_checkpoint))
+    {
+      m_checkpoint.clear ();
+      m_startTime = Seconds (0);
+      return false;
+    }
+    return true;
+  }
+
+  Time
+  ElectricConsumptionHelper::GetStartTime (void) const
+  {
+    return m_startTime;
+  }
+
+  void
+  ElectricConsumptionHelper::SetUpdateMode (UpdateMode mode)
+  {
+    m_updateMode = mode;
+  }
+
+  void
+  ElectricConsumptionHelper::SetThreads (uint32_t threads)
+  {
+    m_threads = threads;
+  }
+
+  void
+  ElectricConsumptionHelper::SetElevation (Ptr<ElevationRaster> elevation)
+  {
+    m_elevation = elevation;
+  }
+
+  Ptr<ElectricVehicleFleet>
+  ElectricConsumptionHelper::GetFleet (void) const
+  {
+    return m_fleet;
+  }
+
+  void
+  ElectricConsumptionHelper::WriteSnapshot (std::string filename) const
+  {
+    std::vector<ElectricVehicleSnapshotRecord> records;
+    for (uint32_t i = 0; i < NodeList::GetNNodes (); i++)
+    {
+      Ptr<ElectricVehicleConsumptionModel> model = NodeList::GetNode (i)->GetObject<ElectricVehicleConsumptionModel> ();
+      if (model == NULL)
+      {
+        continue;
+      }
+      ElectricVehicleSnapshotRecord record;
+      record.nodeId = i;
+      record.reserved = 0;
+      record.parameters.Read (model);
+      records.push_back (record);
+    }
+
+    ElectricVehicleSnapshotHeader header;
+    std::memcpy (header.magic, ELECTRIC_VEHICLE_SNAPSHOT_MAGIC, sizeof (header.magic));
+    header.byteOrder = ELECTRIC_VEHICLE_SNAPSHOT_BYTE_ORDER;
+    header.version = ELECTRIC_VEHICLE_SNAPSHOT_VERSION;
+    header.recordSize = sizeof (ElectricVehicleSnapshotRecord);
+    header.reserved = 0;
+    header.count = records.size ();
+
+    std::ofstream file (filename.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open ())
+    {
+      NS_FATAL_ERROR ("Could not open vehicle snapshot file " << filename << " for writing, aborting here \n");
+    }
+    file.write ((const char *) &header, sizeof (header));
+    if (!records.empty ())
+    {
+      file.write ((const char *) &records[0], records.size () * sizeof (ElectricVehicleSnapshotRecord));
+    }
+    if (!file)
+    {
+      NS_FATAL_ERROR ("Could not write vehicle snapshot file " << filename << ", aborting here \n");
+    }
+  }
+
+  bool
+  ElectricConsumptionHelper::IsSnapshot (std::string filename)
+  {
+    char magic[sizeof (((ElectricVehicleSnapshotHeader *) 0)->magic)];
+    std::ifstream file (filename.c_str (), std::ios::in | std::ios::binary);
+    return file.read (magic, sizeof (magic))
+           && std::memcmp (magic, ELECTRIC_VEHICLE_SNAPSHOT_MAGIC, sizeof (magic)) == 0;
   }
 
   static void
@@ -64,149 +191,420 @@ namespace ns3 {
     Simulator::Schedule (Seconds (updateTime), &UpdateModelConsumption, consumptionModel, updateTime);
   }
 
-/*
- * Private functions start here.
- */
-  void
-  ElectricConsumptionHelper::LoadXml (void)
+  /**
+   * Restores the vehicles and their mobility models from a checkpoint and
+   * resumes their updates, at the time of the checkpoint.
+   */
+  static void
+  ResumeVehicles (std::vector<ElectricVehicleCheckpointRecord> records, ElectricConsumptionHelper::UpdateMode mode,
+                  double updateTime, Ptr<ElectricVehicleFleet> fleet)
   {
-    m_xmlDoc = NULL;
-    /*parse the file and get the DOM */
-    m_xmlDoc = xmlReadFile(m_filename.c_str (), NULL, 0);
+    for (uint32_t i = 0; i < records.size (); i++)
+    {
+      const ElectricVehicleCheckpointRecord &record = records[i];
+      Ptr<ElectricVehicleConsumptionModel> model;
+      if (record.nodeId < NodeList::GetNNodes ())
+      {
+        model = NodeList::GetNode (record.nodeId)->GetObject<ElectricVehicleConsumptionModel> ();
+      }
+      if (model == NULL)
+      {
+        NS_LOG_ERROR ("Node " << record.nodeId << " of the checkpoint has no vehicle.");
+        continue;
+      }
 
-    // case of failure
-    if (m_xmlDoc == NULL)
+      // before the model listens to the changes of course
+      Ptr<MobilityModel> mobility = model->GetNode ()->GetObject<MobilityModel> ();
+      mobility->SetPosition (Vector (record.position[0], record.position[1], record.position[2]));
+      Ptr<ConstantVelocityMobilityModel> constantVelocity = mobility->GetObject<ConstantVelocityMobilityModel> ();
+      if (constantVelocity != NULL)
+      {
+        constantVelocity->SetVelocity (Vector (record.velocity[0], record.velocity[1], record.velocity[2]));
+      }
+
+      if (mode == ElectricConsumptionHelper::COURSE_CHANGE_UPDATE)
+      {
+        model->StartCourseChangeUpdate ();
+      }
+      model->RestoreState (record);
+      if (mode == ElectricConsumptionHelper::VEHICLE_UPDATE)
+      {
+        Time next = model->GetLastUpdateTime () + Seconds (updateTime);
+        Simulator::Schedule (std::max (next - Simulator::Now (), Seconds (0)), &UpdateModelConsumption, model, updateTime);
+      }
+    }
+
+    if (fleet != NULL)
     {
-      NS_LOG_ERROR ("Could not parse XML file " << m_filename);
-      return;
+      fleet->Resume (Seconds (updateTime));
     }
+  }
 
-    xmlNode *rootElement = xmlDocGetRootElement (m_xmlDoc);
-    xmlNode *firstVehicle = rootElement->children;
-    xmlNode *currentNode = NULL;
+  /**
+   * \param text text to parse.
+   * \param value parsed number.
+   * \returns false if the text is not a number.
+   */
+  static bool
+  ParseDouble (const char *text, double &value)
+  {
+    char *end;
+    value = std::strtod (text, &end);
+    return end != text && *end == '\0';
+  }
 
-    // create a consumption model for each vehicle especified in XML
-    for (currentNode = firstVehicle; currentNode; currentNode = currentNode->next) {
-        if (currentNode->type == XML_ELEMENT_NODE) {
-            CreateModelFromXml (currentNode);
-        }
+  /**
+   * \param text node ID ("5") or inclusive range of node IDs ("0-99").
+   * \param first first node ID of the range.
+   * \param last last node ID of the range.
+   * \returns false if the text is not a node ID or a range.
+   */
+  static bool
+  ParseNodeRange (const char *text, uint32_t &first, uint32_t &last)
+  {
+    char *end;
+    if (!std::isdigit (*text))
+    {
+      return false;
     }
+    first = std::strtoul (text, &end, 10);
+    last = first;
+    if (*end == '-')
+    {
+      const char *next = end + 1;
+      if (!std::isdigit (*next))
+      {
+        return false;
+      }
+      last = std::strtoul (next, &end, 10);
+    }
+    return *end == '\0' && first <= last;
+  }
 
-    /*free the document */
-    xmlFreeDoc(m_xmlDoc);
+  /**
+   * Reads the attributes of a <param key="..." value="..."/> element.
+   *
+   * \returns false if the element is malformed.
+   */
+  static bool
+  ReadParamElement (xmlTextReaderPtr reader, ElectricVehicleParameters &parameters)
+  {
+    double *field = NULL;
+    bool hasKey = false;
+    bool hasValue = false;
+    double value = 0;
+    while (xmlTextReaderMoveToNextAttribute (reader) == 1)
+    {
+      const char *name = (const char *) xmlTextReaderConstLocalName (reader);
+      const char *text = (const char *) xmlTextReaderConstValue (reader);
+      if (std::strcmp (name, "key") == 0)
+      {
+        hasKey = true;
+        field = parameters.Find (text);
+        if (field == NULL)
+        {
+          NS_LOG_ERROR ("Could not parse XML file. Key " << text << " unrecognized.");
+        }
+      } else if (std::strcmp (name, "value") == 0)
+      {
+        hasValue = ParseDouble (text, value);
+      } else
+      {
+        NS_LOG_ERROR ("Could not parse XML file. Check the XML structure.");
+        return false;
+      }
+    }
+    if (!hasKey || !hasValue)
+    {
+      NS_LOG_ERROR ("Could not parse XML file. Check the XML structure.");
+      return false;
+    }
+    if (field != NULL)
+    {
+      *field = value;
+    }
+    return true;
+  }
 
-    /*
-     *Free the global variables that may
-     *have been allocated by the parser.
-     */
-    xmlCleanupParser();
+  /**
+   * Reads the attributes of an <ElectricVehicle node="..." profile="..."> element.
+   *
+   * \param parameters set to the parameters of the profile of the vehicle,
+   *        or to the defaults if it has no profile.
+   * \returns false if the element is malformed or the profile is unknown.
+   */
+  static bool
+  ReadVehicleElement (xmlTextReaderPtr reader,
+                      const std::map<std::string, ElectricVehicleParameters> &profiles,
+                      ElectricVehicleParameters &parameters,
+                      uint32_t &firstNode, uint32_t &lastNode)
+  {
+    bool hasNode = false;
+    parameters = ElectricVehicleParameters ();
+    while (xmlTextReaderMoveToNextAttribute (reader) == 1)
+    {
+      const char *name = (const char *) xmlTextReaderConstLocalName (reader);
+      const char *text = (const char *) xmlTextReaderConstValue (reader);
+      if (std::strcmp (name, "node") == 0)
+      {
+        hasNode = ParseNodeRange (text, firstNode, lastNode);
+      } else if (std::strcmp (name, "profile") == 0)
+      {
+        std::map<std::string, ElectricVehicleParameters>::const_iterator it = profiles.find (text);
+        if (it == profiles.end ())
+        {
+          NS_LOG_ERROR ("Vehicle profile " << text << " is not defined.");
+          return false;
+        }
+        parameters = it->second;
+      } else
+      {
+        NS_LOG_ERROR ("Could not parse XML file. Check the XML structure.");
+        return false;
+      }
+    }
+    if (!hasNode)
+    {
+      NS_LOG_ERROR ("Node ID of vehicle is not defined.");
+      return false;
+    }
+    return true;
+  }
 
+  /**
+   * Reads the attributes of a <VehicleProfile id="..."> element.
+   *
+   * \returns false if the element has no id.
+   */
+  static bool
+  ReadProfileElement (xmlTextReaderPtr reader, std::string &id)
+  {
+    id.clear ();
+    while (xmlTextReaderMoveToNextAttribute (reader) == 1)
+    {
+      const char *name = (const char *) xmlTextReaderConstLocalName (reader);
+      if (std::strcmp (name, "id") == 0)
+      {
+        id = (const char *) xmlTextReaderConstValue (reader);
+      } else
+      {
+        NS_LOG_ERROR ("Could not parse XML file. Check the XML structure.");
+        return false;
+      }
+    }
+    if (id.empty ())
+    {
+      NS_LOG_ERROR ("ID of vehicle profile is not defined.");
+      return false;
+    }
+    return true;
   }
 
+/*
+ * Private functions start here.
+ */
   void
-  ElectricConsumptionHelper::CreateModelFromXml (xmlNode * xmlVehicleNode)
+  ElectricConsumptionHelper::LoadSnapshot (void)
   {
-    xmlNode *currentNode = NULL;
-
-    Ptr<ElectricVehicleConsumptionModel> consumptionModel = CreateObject<ElectricVehicleConsumptionModel> ();
-    uint32_t nodeId;
-
-    // read the node id of vehicle
-    for(xmlAttrPtr attr = xmlVehicleNode->properties; NULL != attr; attr = attr->next)
-    {
-      std::string name = Convert (attr->name);
-      if (name == "node")
-      {  
-        nodeId = std::stoi(Convert (attr->children->content));
-      } else {
-        NS_LOG_ERROR ("Node ID of vehicle is not defined.");
-        return;
+    int fd = open (m_filename.c_str (), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat (fd, &st) < 0)
+    {
+      NS_LOG_ERROR ("Could not read vehicle snapshot file " << m_filename);
+      if (fd >= 0)
+      {
+        close (fd);
       }
+      return;
+    }
+    size_t size = st.st_size;
+    void *map = size > 0 ? mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close (fd);
+    if (map == MAP_FAILED)
+    {
+      NS_LOG_ERROR ("Could not map vehicle snapshot file " << m_filename);
+      return;
     }
+    const char *data = (const char *) map;
 
-    Ptr<Node> node = NodeList::GetNode (nodeId);
-    if (node == NULL) {
-      NS_LOG_ERROR ("Node " << nodeId << " is not created in the simulation.");
+    ElectricVehicleSnapshotHeader header;
+    if (size < sizeof (header))
+    {
+      NS_LOG_ERROR ("Vehicle snapshot file " << m_filename << " is truncated.");
+      munmap (map, size);
+      return;
+    }
+    std::memcpy (&header, data, sizeof (header));
+    if (header.byteOrder != ELECTRIC_VEHICLE_SNAPSHOT_BYTE_ORDER
+        || header.version != ELECTRIC_VEHICLE_SNAPSHOT_VERSION
+        || header.recordSize < sizeof (ElectricVehicleSnapshotRecord))
+    {
+      NS_LOG_ERROR ("Vehicle snapshot file " << m_filename << " has an unsupported format.");
+      munmap (map, size);
+      return;
+    }
+    if (header.count > (size - sizeof (header)) / header.recordSize)
+    {
+      NS_LOG_ERROR ("Vehicle snapshot file " << m_filename << " is truncated.");
+      munmap (map, size);
       return;
     }
 
-    // read parameters of electric vehicle
-    for (currentNode = xmlVehicleNode->children; currentNode; currentNode = currentNode->next) {
-      if (currentNode->type == XML_ELEMENT_NODE) {
-        std::string clave;
-        std::string valor;
-        for(xmlAttrPtr attr = currentNode->properties; NULL != attr; attr = attr->next)
+    // the records are read in order, only once
+    madvise (map, size, MADV_SEQUENTIAL);
+    const char *record = data + sizeof (header);
+    for (uint64_t i = 0; i < header.count; i++, record += header.recordSize)
+    {
+      ElectricVehicleSnapshotRecord vehicle;
+      std::memcpy (&vehicle, record, sizeof (vehicle));
+      CreateModel (vehicle.nodeId, vehicle.parameters);
+    }
+
+    munmap (map, size);
+  }
+
+  void
+  ElectricConsumptionHelper::LoadXml (void)
+  {
+    // the file is streamed, only the profiles are kept in memory
+    xmlTextReaderPtr reader = xmlReaderForFile (m_filename.c_str (), NULL, 0);
+
+    // case of failure
+    if (reader == NULL)
+    {
+      NS_LOG_ERROR ("Could not parse XML file " << m_filename);
+      return;
+    }
+
+    std::map<std::string, ElectricVehicleParameters> profiles; // profiles defined so far
+    ElectricVehicleParameters parameters; // parameters of the current vehicle or profile
+    std::string profileId;                // id of the current profile
+    bool inVehicle = false;               // reading an ElectricVehicle element
+    bool inProfile = false;               // reading a VehicleProfile element
+    bool valid = false;                   // the current vehicle or profile has no errors
+    uint32_t firstNode = 0;               // node IDs of the current vehicle
+    uint32_t lastNode = 0;
+
+    int ret;
+    while ((ret = xmlTextReaderRead (reader)) == 1)
+    {
+      int type = xmlTextReaderNodeType (reader);
+      if (type != XML_READER_TYPE_ELEMENT && type != XML_READER_TYPE_END_ELEMENT)
+      {
+        continue;
+      }
+      const char *name = (const char *) xmlTextReaderConstLocalName (reader);
+      bool closed = type == XML_READER_TYPE_END_ELEMENT;
+
+      if (type == XML_READER_TYPE_ELEMENT)
+      {
+        // must be checked before moving to the attributes
+        closed = xmlTextReaderIsEmptyElement (reader) == 1;
+        if (std::strcmp (name, "ElectricVehicle") == 0)
         {
-          std::string name = Convert (attr->name);
-          if (name == "key")
-          {
-            clave = Convert (attr->children->content);
-          } else if (name == "value")
+          inVehicle = true;
+          valid = ReadVehicleElement (reader, profiles, parameters, firstNode, lastNode);
+        } else if (std::strcmp (name, "VehicleProfile") == 0)
+        {
+          inProfile = true;
+          parameters = ElectricVehicleParameters ();
+          valid = ReadProfileElement (reader, profileId);
+        } else if (std::strcmp (name, "param") == 0)
+        {
+          if (inVehicle || inProfile)
           {
-            valor = Convert (attr->children->content);
+            valid = ReadParamElement (reader, parameters) && valid;
           } else
           {
             NS_LOG_ERROR ("Could not parse XML file. Check the XML structure.");
-            return;
           }
-
-        }
-        if (clave.empty () || valor.empty ())
-        {
-          NS_LOG_ERROR ("Could not parse XML file. Check the XML structure.");
-          return;
         }
+      }
 
-        // std::cout << clave << "=" << valor << "\n";
+      if (!closed)
+      {
+        continue;
+      }
 
-        if (clave == "maximumBatteryCapacity")
-        {
-          consumptionModel->SetMaximunBatteryCapacity (std::stod (valor));
-        } else if (clave == "vehicleMass")
-        {
-          consumptionModel->SetVehicleMass (std::stod (valor));
-        } else if (clave == "frontSurfaceArea")
-        {
-          consumptionModel->SetFrontSurfaceArea (std::stod (valor));
-        } else if (clave == "airDragCoefficient")
-        {
-          consumptionModel->SetAirDragCoefficient (std::stod (valor));
-        } else if (clave == "internalMomentOfInertia")
-        {
-          consumptionModel->SetInternalMomentOfInertia (std::stod (valor));
-        } else if (clave == "radialDragCoefficient")
-        {
-          consumptionModel->SetRadialDragCoefficient (std::stod (valor));
-        } else if (clave == "rollDragCoefficient")
-        {
-          consumptionModel->SetRollDragCoefficient (std::stod (valor));
-        } else if (clave == "constantPowerIntake")
-        {
-          consumptionModel->SetConstantPowerIntake (std::stod (valor));
-        } else if (clave == "propulsionEfficiency")
+      if (inVehicle && std::strcmp (name, "ElectricVehicle") == 0)
+      {
+        // create a consumption model for each vehicle especified in XML
+        if (valid && firstNode < lastNode && lastNode >= NodeList::GetNNodes ())
         {
-          consumptionModel->SetPropulsionEfficiency (std::stod (valor));
-        } else if (clave == "recuperationEfficiency")
-        {
-          consumptionModel->SetRecuperationEfficiency (std::stod (valor));
-        } else if (clave == "initialEnergy")
+          NS_LOG_ERROR ("Nodes " << firstNode << "-" << lastNode << " are not all created in the simulation.");
+          lastNode = NodeList::GetNNodes () > firstNode ? NodeList::GetNNodes () - 1 : firstNode;
+        }
+        for (uint64_t nodeId = firstNode; valid && nodeId <= lastNode; nodeId++)
         {
-          consumptionModel->SetInitialEnergy (std::stod (valor));
-        } else
+          CreateModel (nodeId, parameters);
+        }
+        inVehicle = false;
+      } else if (inProfile && std::strcmp (name, "VehicleProfile") == 0)
+      {
+        if (valid)
         {
-          NS_LOG_ERROR ("Could not parse XML file. Key " << clave << " unrecognized.");
+          profiles[profileId] = parameters;
         }
+        inProfile = false;
       }
     }
 
-    
+    if (ret != 0)
+    {
+      NS_LOG_ERROR ("Could not parse XML file " << m_filename);
+    }
+
+    xmlFreeTextReader (reader);
+
+    /*
+     *Free the global variables that may
+     *have been allocated by the parser.
+     */
+    xmlCleanupParser();
+  }
+
+  void
+  ElectricConsumptionHelper::CreateModel (uint32_t nodeId, const ElectricVehicleParameters &parameters)
+  {
+    if (nodeId >= NodeList::GetNNodes ())
+    {
+      NS_LOG_ERROR ("Node " << nodeId << " is not created in the simulation.");
+      return;
+    }
+    Ptr<Node> node = NodeList::GetNode (nodeId);
+
+    Ptr<ElectricVehicleConsumptionModel> consumptionModel = CreateObject<ElectricVehicleConsumptionModel> ();
+    parameters.Apply (consumptionModel);
+
     //all consumption model has a mobility model
     Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
     consumptionModel->SetMobilityModel (mobility);
+    consumptionModel->SetNode (node);
+    consumptionModel->SetElevation (m_elevation);
 
     //we add the consumption model to the node
     node->AggregateObject (consumptionModel);
 
+    if (m_fleet != NULL)
+    {
+      // the fleet updates all the vehicles in a single event
+      m_fleet->AddVehicle (consumptionModel);
+      return;
+    }
+
+    if (!m_checkpoint.empty ())
+    {
+      // the updates start when the checkpoint is restored
+      return;
+    }
+
+    if (m_updateMode == COURSE_CHANGE_UPDATE)
+    {
+      // the model is updated only when the vehicle changes its course
+      consumptionModel->StartCourseChangeUpdate ();
+      return;
+    }
+
     consumptionModel->UpdateConsumption (); // first update in second 0
 
     Simulator::Schedule (Seconds (m_updateTime), &UpdateModelConsumption, consumptionModel, m_updateTime);
@@ -29,12 +29,57 @@
 #include <libxml/xmlwriter.h>
 
 #include "electric-vehicle-consumption-model.h"
+#include "electric-vehicle-parameters.h"
+#include "electric-vehicle-snapshot.h"
+#include "electric-vehicle-fleet.h"
+#include "electric-vehicle-checkpoint.h"
 
 namespace ns3 {
 
+/**
+ * \ingroup consumption
+ * \brief Installs electric vehicle consumption models from a vehicle
+ * attributes file.
+ *
+ * The file is read with a streaming parser, so the time to load it is
+ * proportional to its size and the memory used does not depend on the
+ * number of vehicles. Parameters shared by many vehicles can be defined
+ * once in a profile and referenced by the vehicles, which may override
+ * some of them:
+ *
+ * \code
+ * <ElectricVehicles>
+ *   <VehicleProfile id="bus">
+ *     <param key="vehicleMass" value="19000"/>
+ *     ...
+ *   </VehicleProfile>
+ *   <ElectricVehicle node="0-99" profile="bus"/>
+ *   <ElectricVehicle node="100" profile="bus">
+ *     <param key="vehicleMass" value="17100"/>
+ *   </ElectricVehicle>
+ * </ElectricVehicles>
+ * \endcode
+ *
+ * The node attribute is a node ID or an inclusive range of node IDs. A
+ * profile must be defined before the vehicles using it. The keys of the
+ * parameters are the names of the fields of ElectricVehicleParameters.
+ *
+ * The file can also be a binary snapshot written by WriteSnapshot, which is
+ * memory mapped instead of parsed.
+ */
 class ElectricConsumptionHelper 
 {
 public:
+  /**
+   * How the consumption of the vehicles is updated.
+   */
+  enum UpdateMode
+  {
+    VEHICLE_UPDATE,   //!< one scheduled update event per vehicle (default)
+    FLEET_UPDATE,     //!< a single scheduled update for the whole fleet, see ElectricVehicleFleet
+    COURSE_CHANGE_UPDATE //!< no scheduled update, integrate on changes of course, see ElectricVehicleConsumptionModel::StartCourseChangeUpdate
+  };
+
   /**
    * \param filename filename of file which contains the
    *        xml with vehicles attributes
@@ -49,15 +94,86 @@ public:
    */
   void Install (void);
 
+  /**
+   * \param mode how the consumption of the vehicles is updated.
+   *
+   * Must be called before Install.
+   */
+  void SetUpdateMode (UpdateMode mode);
+
+  /**
+   * \param threads number of threads used to update the fleet in
+   *        FLEET_UPDATE mode, see ElectricVehicleFleet::SetThreads.
+   *
+   * Must be called before Install.
+   */
+  void SetThreads (uint32_t threads);
+
+  /**
+   * \param elevation elevation raster giving the height of the positions of
+   *        the vehicles, see ElectricVehicleConsumptionModel::SetElevation.
+   *
+   * Must be called before Install.
+   */
+  void SetElevation (Ptr<ElevationRaster> elevation);
+
+  /**
+   * \param filename checkpoint file written by ElectricVehicleCheckpoint.
+   * \param time time of the checkpoint to resume from, the last one if
+   *        negative.
+   * \returns false if the checkpoint could not be read.
+   *
+   * Resumes the simulation from a checkpoint instead of starting the
+   * vehicles in their initial state: at the time of the checkpoint (see
+   * GetStartTime) the state of each vehicle and of its mobility model is
+   * restored and its consumption updates continue. Nothing is updated
+   * before. The movements must be resumed at the same time, e.g. with
+   * Ns2MobilityHelper::SetStartTime. Must be called before Install.
+   */
+  bool LoadCheckpoint (std::string filename, Time time = Seconds (-1));
+
+  /**
+   * \returns time the vehicles start at: the time of the loaded checkpoint,
+   *          0 if there is none.
+   */
+  Time GetStartTime (void) const;
+
+  /**
+   * \returns the fleet of installed vehicles, or 0 if the update mode is
+   *          not FLEET_UPDATE.
+   */
+  Ptr<ElectricVehicleFleet> GetFleet (void) const;
+
+  /**
+   * \param filename file to write.
+   *
+   * Writes the parameters of the consumption models installed in all the
+   * nodes of the global ns3::NodeList to a binary snapshot file (see
+   * ElectricVehicleSnapshotHeader). The snapshot can be given to a helper
+   * instead of the XML file to install the same vehicles without parsing.
+   */
+  void WriteSnapshot (std::string filename) const;
+
+  /**
+   * \param filename file to check.
+   * \returns true if the file is a binary snapshot of vehicle parameters.
+   */
+  static bool IsSnapshot (std::string filename);
 
 private:
+  void LoadSnapshot (void);
   void LoadXml (void);
-  void CreateModelFromXml (xmlNode * xmlNode);
+  void CreateModel (uint32_t nodeId, const ElectricVehicleParameters &parameters);
 
 private:
   std::string m_filename;  // filename of file containing the vehicle attributes
-  xmlDoc *m_xmlDoc;        // XML Document with XML nodes
   double m_updateTime;     // time between each update of electric vehicle consumption
+  UpdateMode m_updateMode; // how the consumption of the vehicles is updated
+  Ptr<ElectricVehicleFleet> m_fleet; // fleet of vehicles in FLEET_UPDATE mode
+  uint32_t m_threads;      // number of threads of the fleet update
+  Ptr<ElevationRaster> m_elevation; // height of the positions of the vehicles, or 0
+  std::vector<ElectricVehicleCheckpointRecord> m_checkpoint; // state to resume from, if any
+  Time m_startTime;        // time of the checkpoint to resume from
 };
 
   Ptr<Node> GetNodeFromContext(std::string context);
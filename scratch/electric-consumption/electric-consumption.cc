@@ -43,13 +43,16 @@
  *  NOTE: ns2-traces-file could be an absolute or relative path. You could use the file default.ns_movements
  *        included in the same directory as the example file.
  *  NOTE 2: Number of nodes present in the trace file must match with the command line argument.
- *          Note that you must know it before to be able to load it.
- *  NOTE 3: Duration must be a positive number and should match the trace file. Note that you must know it before to be able to load it.
+ *          Without it, the nodes of the trace are created (see Ns2MobilityHelper::GetTraceInfo).
+ *  NOTE 3: Duration must be a positive number and should match the trace file. Without it, the
+ *          simulation lasts until the last movement of the trace ends.
  */
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <chrono>
+#include <cmath>
 
 #include "ns3/log.h"
 #include "ns3/node-list.h"
@@ -58,28 +61,70 @@
 #include "ns3/mobility-module.h"
 #include "ns3/mobility-module.h"
 #include "ns3/ns2-mobility-helper.h"
+#include "ns3/compiled-mobility-trace-helper.h"
+#include "ns3/sumo-fcd-mobility-helper.h"
 #include "electric-consumption-helper.h"
+#include "consumption-recorder.h"
+#include "charging-infrastructure.h"
+#include "electric-vehicle-range-estimator.h"
+#include "electric-vehicle-checkpoint.h"
+#include "electric-vehicle-ensemble.h"
 
 using namespace ns3;
  
 
-void RemainingEnergyTrace (std::string context, double previousEnergy, double currentEnergy)
+void ConsumptionUpdateTrace (const ElectricVehicleConsumptionUpdate &update)
 {
-  Ptr<Node> node = GetNodeFromContext(context);
-  Ptr<ElectricVehicleConsumptionModel> consumptionModel = node->GetObject<ElectricVehicleConsumptionModel> ();
-  Ptr<const MobilityModel> mobilityModel = consumptionModel->GetMobilityModel ();
-  Vector pos = mobilityModel->GetPosition ();
-
-  NS_LOG_UNCOND (Simulator::Now ().GetSeconds () << "\t"
-    << node->GetId () << "\t"
-    << pos.x << "\t"
-    << pos.y << "\t"
-    << pos.z << "\t"
-    << consumptionModel->GetVelocity () << "\t"
-    << consumptionModel->GetEnergyFraction () << "\t"
-    << currentEnergy << "\t"
-    << consumptionModel->GetEnergyConsumed () << "\t"
-    << consumptionModel->GetTotalEnergyConsumed ());
+  NS_LOG_UNCOND (update.time.GetSeconds () << "\t"
+    << update.nodeId << "\t"
+    << update.position.x << "\t"
+    << update.position.y << "\t"
+    << update.position.z << "\t"
+    << update.speed << "\t"
+    << update.energyFraction << "\t"
+    << update.remainingEnergy << "\t"
+    << update.energyDiff << "\t"
+    << update.totalEnergyConsumed);
+}
+
+static uint64_t g_updates = 0;
+
+void CountConsumptionUpdate (const ElectricVehicleConsumptionUpdate &update)
+{
+  g_updates++;
+}
+
+static std::vector<double> g_predicted;
+static std::vector<double> g_consumedAtPrediction;
+
+void RecordConsumedAtPrediction (int nodeNum)
+{
+  for (int i = 0; i < nodeNum; i++)
+    {
+      g_consumedAtPrediction[i] = NodeList::GetNode (i)->GetObject<ElectricVehicleConsumptionModel> ()->GetTotalEnergyConsumed ();
+    }
+}
+
+void PredictConsumption (Ptr<ElectricVehicleRangeEstimator> estimator, int nodeNum, Time until)
+{
+  for (int i = 0; i < nodeNum; i++)
+    {
+      g_predicted[i] = estimator->GetTraceEnergy (NodeList::GetNode (i)->GetObject<ElectricVehicleConsumptionModel> (), until);
+    }
+  // after the consumption updates of this time
+  Simulator::ScheduleNow (&RecordConsumedAtPrediction, nodeNum);
+}
+
+void PrintEnsembleStatistics (std::string label, const ElectricVehicleRunningStatistics &statistics)
+{
+  std::ostringstream line;
+  line << label << " mean " << statistics.GetMean ()
+       << " std " << std::sqrt (statistics.GetVariance ());
+  for (uint32_t i = 0; i < statistics.GetNQuantiles (); i++)
+    {
+      line << " p" << statistics.GetProbability (i) * 100 << " " << statistics.GetQuantile (i);
+    }
+  NS_LOG_UNCOND (line.str ());
 }
 
 // Example to use ns2 traces file and xml file to simulate consumption of electric vehicles
@@ -88,21 +133,55 @@ int main (int argc, char *argv[])
   std::string traceFile;
   std::string vehicleAttributesFile;
 
-  int    nodeNum;
-  double duration;
+  int    nodeNum = 0;
+  double duration = 0;
   double updateTime;
+  std::string updateMode = "vehicle";
+  uint32_t threads = 1;
+  std::string snapshotFile;
+  std::string recordFile;
+  std::string chargingStationsFile;
+  bool battery = false;
+  std::string elevationFile;
+  double predictTime = -1;
+  std::string checkpointFile;
+  double checkpointInterval = 3600;
+  std::string restoreFile;
+  double restoreTime = -1;
+  bool benchmark = false;
+  uint32_t replications = 0;
+  double streaming = 0;
+  bool trajectories = false;
+  uint32_t workers = 1;
 
   // Parse command line attribute
   CommandLine cmd;
-  cmd.AddValue ("traceFile", "Ns2 movement trace file", traceFile);
+  cmd.AddValue ("traceFile", "Ns2 movement trace file, trace compiled with compile-mobility-trace, or SUMO FCD file", traceFile);
   cmd.AddValue ("vehicleAttributes", "Vehicle Attributes", vehicleAttributesFile);
-  cmd.AddValue ("nodeNum", "Number of nodes", nodeNum);
-  cmd.AddValue ("duration", "Duration of Simulation", duration);
+  cmd.AddValue ("nodeNum", "Number of nodes, those of the trace file if not given", nodeNum);
+  cmd.AddValue ("duration", "Duration of Simulation, until the end of the trace file if not given", duration);
   cmd.AddValue ("updateTime", "Time between each update of electric vehicle consumption.", updateTime);
+  cmd.AddValue ("updateMode", "Consumption update mode: vehicle (one event per vehicle), fleet (one event for the whole fleet) or event (only on changes of course).", updateMode);
+  cmd.AddValue ("threads", "Number of threads of the fleet update mode.", threads);
+  cmd.AddValue ("writeSnapshot", "Write the vehicle attributes to this binary snapshot file, which can be used as vehicleAttributes in later runs.", snapshotFile);
+  cmd.AddValue ("recordFile", "Record the consumption updates to this binary file instead of printing them, see consumption-to-csv.", recordFile);
+  cmd.AddValue ("chargingStations", "XML file of charging stations where the stopped vehicles charge.", chargingStationsFile);
+  cmd.AddValue ("battery", "Model the battery pack of each vehicle (voltage, losses and temperature), see the ns3::ElectricVehicleBattery attributes.", battery);
+  cmd.AddValue ("elevation", "Elevation raster giving the height of the vehicles, see asc-to-raster.", elevationFile);
+  cmd.AddValue ("predictTime", "Predict at this time the energy each vehicle needs for the rest of its trace, and compare it with the consumed one.", predictTime);
+  cmd.AddValue ("checkpointFile", "Save checkpoints of the vehicles to this file, see restore.", checkpointFile);
+  cmd.AddValue ("checkpointInterval", "Time in s between checkpoints.", checkpointInterval);
+  cmd.AddValue ("restore", "Resume the simulation from a checkpoint file written with checkpointFile.", restoreFile);
+  cmd.AddValue ("restoreTime", "Time of the checkpoint to resume from, the last one if negative.", restoreTime);
+  cmd.AddValue ("benchmark", "Measure the cost of the consumption updates of nodeNum vehicles moving at constant velocity instead of using a trace file.", benchmark);
+  cmd.AddValue ("streaming", "Read the trace file as the simulation advances, scheduling each command this time in s before it, instead of at start.", streaming);
+  cmd.AddValue ("trajectories", "Follow the trajectories of the vehicles of a SUMO FCD file, interpolated when they are queried instead of an event per sample.", trajectories);
+  cmd.AddValue ("replications", "Run this number of replications with different vehicle masses and power intakes, see ns3::ElectricVehicleEnsemble, and show the statistics of their results.", replications);
+  cmd.AddValue ("workers", "Number of replications run in parallel.", workers);
   cmd.Parse (argc,argv);
 
   // Check command line arguments
-  if (traceFile.empty () || vehicleAttributesFile.empty () || nodeNum <= 0 || duration <= 0)
+  if ((traceFile.empty () && !benchmark) || vehicleAttributesFile.empty () || (benchmark && (nodeNum <= 0 || duration <= 0)))
     {
       std::cout << "Usage of " << argv[0] << " :\n\n"
       "./waf --run \"electric-mobility"
@@ -112,33 +191,287 @@ int main (int argc, char *argv[])
       "NOTE: ns2-traces-file could be an absolute or relative path. You could use the file default.ns_movements\n"
       "      included in the same directory of this example file.\n\n"
       "NOTE 2: Number of nodes present in the trace file must match with the command line argument and must\n"
-      "        be a positive number. Note that you must know it before to be able to load it.\n\n"
-      "NOTE 3: Duration must be a positive number. Note that you must know it before to be able to load it.\n\n";
+      "        be a positive number. Without it, the nodes of the trace file are created.\n\n"
+      "NOTE 3: Duration must be a positive number. Without it, the simulation lasts until the last movement\n"
+      "        of the trace file ends.\n\n";
 
       return 0;
     }
 
-  // Create Ns2MobilityHelper with the specified trace log file as parameter
-  Ns2MobilityHelper ns2 = Ns2MobilityHelper (traceFile);
+  if (replications > 0 && (benchmark || threads > 1 || !recordFile.empty () || !checkpointFile.empty () || predictTime >= 0))
+    {
+      std::cout << "Replications cannot be combined with benchmark, threads, recordFile, checkpointFile or predictTime\n";
+      return 1;
+    }
+
+  if (predictTime >= 0 && !benchmark
+      && (CompiledMobilityTraceHelper::IsCompiledTrace (traceFile) || SumoFcdMobilityHelper::IsFcdTrace (traceFile)))
+    {
+      std::cout << "predictTime needs an ns-2 trace file\n";
+      return 1;
+    }
+
+  if (trajectories && (benchmark || updateMode == "event" || !SumoFcdMobilityHelper::IsFcdTrace (traceFile)))
+    {
+      std::cout << "trajectories needs a SUMO FCD file, and periodic updates as they do not change course\n";
+      return 1;
+    }
 
   // Create ElectricConsumptionHelper with the xml of vehicle attributes
   ElectricConsumptionHelper electricMobility = ElectricConsumptionHelper (vehicleAttributesFile, updateTime);
+  if (updateMode == "fleet")
+    {
+      electricMobility.SetUpdateMode (ElectricConsumptionHelper::FLEET_UPDATE);
+      electricMobility.SetThreads (threads);
+    }
+  else if (updateMode == "event")
+    {
+      electricMobility.SetUpdateMode (ElectricConsumptionHelper::COURSE_CHANGE_UPDATE);
+    }
+  else if (updateMode != "vehicle")
+    {
+      std::cout << "Unknown update mode " << updateMode << "\n";
+      return 1;
+    }
+
+  if (!elevationFile.empty ())
+    {
+      Ptr<ElevationRaster> elevation = CreateObject<ElevationRaster> ();
+      if (!elevation->Open (elevationFile))
+        {
+          std::cout << "Could not open the elevation raster " << elevationFile << "\n";
+          return 1;
+        }
+      electricMobility.SetElevation (elevation);
+    }
 
-  // Create all nodes.
+  if (!restoreFile.empty () && !electricMobility.LoadCheckpoint (restoreFile, Seconds (restoreTime)))
+    {
+      std::cout << "Could not load a checkpoint from " << restoreFile << "\n";
+      return 1;
+    }
+  Time startTime = electricMobility.GetStartTime ();
+
+  // Create all nodes, those of the trace file if their number is not given
   NodeContainer stas;
-  stas.Create (nodeNum);
+  if (!benchmark && (nodeNum <= 0 || duration <= 0))
+    {
+      MobilityTraceInfo info;
+      if (CompiledMobilityTraceHelper::IsCompiledTrace (traceFile))
+        {
+          info = CompiledMobilityTraceHelper (traceFile).GetTraceInfo ();
+        }
+      else if (SumoFcdMobilityHelper::IsFcdTrace (traceFile))
+        {
+          info = SumoFcdMobilityHelper (traceFile).GetTraceInfo ();
+        }
+      else
+        {
+          info = Ns2MobilityHelper (traceFile).GetTraceInfo ();
+        }
+      if (info.nodeIds.empty () || (duration <= 0 && !info.stop.IsStrictlyPositive ()))
+        {
+          std::cout << "No movements in " << traceFile << "\n";
+          return 1;
+        }
+      if (nodeNum <= 0)
+        {
+          info.CreateNodes ();
+          nodeNum = NodeList::GetNNodes ();
+        }
+      if (duration <= 0)
+        {
+          duration = info.stop.GetSeconds ();
+        }
+    }
+  if (NodeList::GetNNodes () < (uint32_t) nodeNum)
+    {
+      stas.Create (nodeNum - NodeList::GetNNodes ());
+    }
 
-  ns2.Install (); // configure movements for each node, while reading trace file
+  if (benchmark)
+    {
+      // vehicles with different constant velocities, no trace file
+      MobilityHelper mobility;
+      mobility.SetMobilityModel ("ns3::ConstantVelocityMobilityModel");
+      mobility.Install (stas);
+      for (int i = 0; i < nodeNum; i++)
+        {
+          stas.Get (i)->GetObject<ConstantVelocityMobilityModel> ()->SetVelocity (Vector (i % 13, i % 7, 0));
+        }
+    }
+  else if (CompiledMobilityTraceHelper::IsCompiledTrace (traceFile))
+    {
+      // trace compiled with compile-mobility-trace
+      CompiledMobilityTraceHelper compiled = CompiledMobilityTraceHelper (traceFile);
+      compiled.SetStartTime (startTime);
+      if (streaming > 0)
+        {
+          compiled.SetLookAhead (Seconds (streaming));
+        }
+      compiled.Install ();
+    }
+  else if (SumoFcdMobilityHelper::IsFcdTrace (traceFile))
+    {
+      // floating car data of SUMO, with the acceleration between its samples
+      SumoFcdMobilityHelper fcd = SumoFcdMobilityHelper (traceFile);
+      if (trajectories)
+        {
+          fcd.InstallTrajectories (NodeContainer::GetGlobal ());
+        }
+      else
+        {
+          fcd.SetStartTime (startTime);
+          if (streaming > 0)
+            {
+              fcd.SetLookAhead (Seconds (streaming));
+            }
+          fcd.Install ();
+        }
+    }
+  else
+    {
+      // Create Ns2MobilityHelper with the specified trace log file as parameter
+      Ns2MobilityHelper ns2 = Ns2MobilityHelper (traceFile);
+      ns2.SetStartTime (startTime);
+      if (streaming > 0)
+        {
+          ns2.EnableStreaming (Seconds (streaming));
+        }
+      ns2.Install (); // configure movements for each node, while reading trace file
+    }
   electricMobility.Install (); // configure the vehicle attributes for each node
 
-  Config::Connect ("/NodeList/*/$ns3::ElectricVehicleConsumptionModel/RemainingEnergy",
-              MakeCallback (&RemainingEnergyTrace));
+  if (!snapshotFile.empty ())
+    {
+      electricMobility.WriteSnapshot (snapshotFile);
+    }
+
+  if (battery)
+    {
+      for (int i = 0; i < nodeNum; i++)
+        {
+          Ptr<ElectricVehicleConsumptionModel> model = NodeList::GetNode (i)->GetObject<ElectricVehicleConsumptionModel> ();
+          if (model != NULL)
+            {
+              model->SetBattery (CreateObject<ElectricVehicleBattery> ());
+            }
+        }
+    }
+
+  Ptr<ChargingInfrastructure> charging;
+  if (!chargingStationsFile.empty ())
+    {
+      charging = CreateObject<ChargingInfrastructure> ();
+      if (!charging->LoadXml (chargingStationsFile))
+        {
+          std::cout << "Could not load the charging stations of " << chargingStationsFile << "\n";
+          return 1;
+        }
+      charging->InstallAll ();
+      Simulator::Schedule (startTime, &ChargingInfrastructure::Start, charging);
+    }
+
+  if (predictTime >= 0 && !benchmark)
+    {
+      Ptr<ElectricVehicleRangeEstimator> estimator = CreateObject<ElectricVehicleRangeEstimator> ();
+      estimator->LoadNs2Trace (traceFile);
+      g_predicted.resize (nodeNum, 0);
+      g_consumedAtPrediction.resize (nodeNum, 0);
+      Simulator::Schedule (Seconds (predictTime), &PredictConsumption, estimator, nodeNum, Seconds (duration));
+    }
 
-  // Log a header for data
-  NS_LOG_UNCOND("Time \t#\tx\ty\tz\tVel(m/s)\tEnergy Level(%)\tCurrent Energy(Wh)\tEnergy Consumed(Wh)\tTotal Consumed(Wh)");
+  Ptr<ElectricVehicleCheckpoint> checkpoint;
+  if (!checkpointFile.empty ())
+    {
+      checkpoint = CreateObject<ElectricVehicleCheckpoint> ();
+      checkpoint->SetAttribute ("Interval", TimeValue (Seconds (checkpointInterval)));
+      checkpoint->Open (checkpointFile);
+      checkpoint->InstallAll ();
+      Simulator::Schedule (startTime, &ElectricVehicleCheckpoint::Start, checkpoint);
+    }
+
+  Ptr<ConsumptionRecorder> recorder;
+  if (benchmark)
+    {
+      Config::ConnectWithoutContext ("/NodeList/*/$ns3::ElectricVehicleConsumptionModel/ConsumptionUpdate",
+                                     MakeCallback (&CountConsumptionUpdate));
+    }
+  else if (replications > 0)
+    {
+      // only the statistics of the replications are shown
+    }
+  else if (recordFile.empty ())
+    {
+      Config::ConnectWithoutContext ("/NodeList/*/$ns3::ElectricVehicleConsumptionModel/ConsumptionUpdate",
+                                     MakeCallback (&ConsumptionUpdateTrace));
+
+      // Log a header for data
+      NS_LOG_UNCOND("Time \t#\tx\ty\tz\tVel(m/s)\tEnergy Level(%)\tCurrent Energy(Wh)\tEnergy Consumed(Wh)\tTotal Consumed(Wh)");
+    }
+  else
+    {
+      recorder = CreateObject<ConsumptionRecorder> ();
+      recorder->Open (recordFile);
+      recorder->InstallAll ();
+    }
 
   Simulator::Stop (Seconds (duration));
+
+  if (replications > 0)
+    {
+      Ptr<ElectricVehicleEnsemble> ensemble = CreateObject<ElectricVehicleEnsemble> ();
+      ensemble->SetAttribute ("Replications", UintegerValue (replications));
+      ensemble->SetAttribute ("Workers", UintegerValue (workers));
+      ensemble->InstallAll ();
+      ensemble->SetFleet (electricMobility.GetFleet ());
+      ensemble->Run ();
+
+      for (uint32_t i = 0; i < ensemble->GetN (); i++)
+        {
+          uint32_t id = ensemble->GetVehicle (i)->GetNode ()->GetId ();
+          PrintEnsembleStatistics ("Node " + std::to_string (id) + " Total consumed (Wh):", ensemble->GetTotalEnergyConsumed (i));
+          PrintEnsembleStatistics ("Node " + std::to_string (id) + " Energy fraction:", ensemble->GetEnergyFraction (i));
+        }
+      if (ensemble->GetNFailed () > 0)
+        {
+          NS_LOG_UNCOND (ensemble->GetNFailed () << " replications failed");
+        }
+      Simulator::Destroy ();
+      return 0;
+    }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
   Simulator::Run ();
+  double wallTime = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+  if (benchmark)
+    {
+      std::cout << nodeNum << " vehicles, " << g_updates << " updates in " << wallTime << " s, "
+                << wallTime * 1e9 / g_updates << " ns per update\n";
+      Simulator::Destroy ();
+      return 0;
+    }
+
+  // account for the last constant-velocity segment of each vehicle
+  if (updateMode == "event")
+    {
+      for (int i = 0; i < nodeNum; i++)
+        {
+          NodeList::GetNode (i)->GetObject<ElectricVehicleConsumptionModel> ()->IntegrateConsumption ();
+        }
+    }
+
+  int status = 0;
+  if (recorder != NULL && !recorder->Close ())
+    {
+      std::cout << "Could not write the consumption record " << recordFile << "\n";
+      status = 1;
+    }
+  if (checkpoint != NULL)
+    {
+      checkpoint->Close ();
+    }
 
   // show final statics
   int i = 0;
@@ -147,9 +480,23 @@ int main (int argc, char *argv[])
     Ptr<Node> n = NodeList::GetNode (i);
     Ptr<ElectricVehicleConsumptionModel> model = n->GetObject<ElectricVehicleConsumptionModel>();
     NS_LOG_UNCOND ("Node " << i << " Total consumed: " << model->GetTotalEnergyConsumed () << " Wh");
+    if (predictTime >= 0)
+    {
+      NS_LOG_UNCOND ("Node " << i << " Predicted from " << predictTime << " s: " << g_predicted[i]
+                     << " Wh consumed: " << model->GetTotalEnergyConsumed () - g_consumedAtPrediction[i] << " Wh");
+    }
+    if (model->GetBattery () != NULL)
+    {
+      NS_LOG_UNCOND ("Node " << i << " Battery voltage: " << model->GetSupplyVoltage ()
+                     << " V temperature: " << model->GetBattery ()->GetTemperature () << " C");
+    }
+  }
+  for (uint32_t j = 0; charging != NULL && j < charging->GetNStations (); j++)
+  {
+    NS_LOG_UNCOND ("Station " << j << " Total delivered: " << charging->GetStation (j)->GetEnergyDelivered () << " Wh");
   }
 
   Simulator::Destroy ();
 
-  return 0;
+  return status;
 }
\ No newline at end of file
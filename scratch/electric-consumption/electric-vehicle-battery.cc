@@ -0,0 +1,286 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include "ns3/log.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "ns3/trace-source-accessor.h"
+#include "electric-vehicle-battery.h"
+
+namespace ns3 {
+
+  NS_LOG_COMPONENT_DEFINE ("ElectricVehicleBattery");
+
+  NS_OBJECT_ENSURE_REGISTERED (ElectricVehicleBattery);
+
+  TypeId
+  ElectricVehicleBattery::GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::ElectricVehicleBattery")
+      .SetParent<Object> ()
+      .SetGroupName ("Consumption")
+      .AddConstructor<ElectricVehicleBattery> ()
+      .AddAttribute ("OpenCircuitVoltage",
+                     "Open circuit voltages of a cell in V at evenly spaced states of charge from 0 to 1, separated by spaces.",
+                     StringValue ("3.0 3.45 3.55 3.6 3.65 3.7 3.76 3.83 3.92 4.03 4.15"),
+                     MakeStringAccessor (&ElectricVehicleBattery::SetOpenCircuitVoltageTable,
+                                         &ElectricVehicleBattery::GetOpenCircuitVoltageTable),
+                     MakeStringChecker ())
+      .AddAttribute ("CellsInSeries",
+                     "Number of cells in series in the pack.",
+                     UintegerValue (168),
+                     MakeUintegerAccessor (&ElectricVehicleBattery::m_cellsInSeries),
+                     MakeUintegerChecker<uint32_t> (1))
+      .AddAttribute ("InternalResistance",
+                     "Internal resistance of the pack in Ohm at the reference temperature.",
+                     DoubleValue (0.05),
+                     MakeDoubleAccessor (&ElectricVehicleBattery::m_resistance),
+                     MakeDoubleChecker<double> (0))
+      .AddAttribute ("ResistanceTemperatureCoefficient",
+                     "Relative increase of the internal resistance per K below the reference temperature.",
+                     DoubleValue (0.01),
+                     MakeDoubleAccessor (&ElectricVehicleBattery::m_resistanceCoefficient),
+                     MakeDoubleChecker<double> (0))
+      .AddAttribute ("ReferenceTemperature",
+                     "Temperature in Celsius of the internal resistance.",
+                     DoubleValue (25),
+                     MakeDoubleAccessor (&ElectricVehicleBattery::m_referenceTemperature),
+                     MakeDoubleChecker<double> ())
+      .AddAttribute ("MaxChargeCurrent",
+                     "Maximum current in A accepted from recuperation or from a charger.",
+                     DoubleValue (150),
+                     MakeDoubleAccessor (&ElectricVehicleBattery::m_maxChargeCurrent),
+                     MakeDoubleChecker<double> (0))
+      .AddAttribute ("HeatCapacity",
+                     "Heat capacity of the pack in J/K.",
+                     DoubleValue (2000000),
+                     MakeDoubleAccessor (&ElectricVehicleBattery::m_heatCapacity),
+                     MakeDoubleChecker<double> (0))
+      .AddAttribute ("ThermalResistance",
+                     "Thermal resistance between the pack and the ambient in K/W.",
+                     DoubleValue (0.005),
+                     MakeDoubleAccessor (&ElectricVehicleBattery::m_thermalResistance),
+                     MakeDoubleChecker<double> (0))
+      .AddAttribute ("AmbientTemperature",
+                     "Ambient temperature in Celsius.",
+                     DoubleValue (25),
+                     MakeDoubleAccessor (&ElectricVehicleBattery::m_ambientTemperature),
+                     MakeDoubleChecker<double> ())
+      .AddAttribute ("InitialTemperature",
+                     "Temperature of the pack in Celsius at the start.",
+                     DoubleValue (25),
+                     MakeDoubleAccessor (&ElectricVehicleBattery::m_temperature),
+                     MakeDoubleChecker<double> ())
+      .AddTraceSource ("Voltage",
+                       "Terminal voltage of the pack in V.",
+                       MakeTraceSourceAccessor (&ElectricVehicleBattery::m_voltage),
+                       "ns3::TracedValueCallback::Double")
+      .AddTraceSource ("Temperature",
+                       "Temperature of the pack in Celsius.",
+                       MakeTraceSourceAccessor (&ElectricVehicleBattery::m_temperature),
+                       "ns3::TracedValueCallback::Double")
+    ;
+    return tid;
+  }
+
+  ElectricVehicleBattery::ElectricVehicleBattery ()
+    : m_cellsInSeries (168),
+      m_resistance (0.05),
+      m_resistanceCoefficient (0.01),
+      m_referenceTemperature (25),
+      m_maxChargeCurrent (150),
+      m_heatCapacity (2000000),
+      m_thermalResistance (0.005),
+      m_ambientTemperature (25),
+      m_current (0),
+      m_voltage (0),
+      m_temperature (25)
+  {
+    NS_LOG_FUNCTION (this);
+  }
+
+  ElectricVehicleBattery::~ElectricVehicleBattery ()
+  {
+    NS_LOG_FUNCTION (this);
+  }
+
+  void
+  ElectricVehicleBattery::SetOpenCircuitVoltageTable (std::string table)
+  {
+    NS_LOG_FUNCTION (this << table);
+    std::istringstream is (table);
+    std::vector<double> ocv;
+    double voltage;
+    while (is >> voltage)
+    {
+      ocv.push_back (voltage);
+    }
+    if (!is.eof () || ocv.size () < 2)
+    {
+      NS_FATAL_ERROR ("Invalid open circuit voltage table \"" << table << "\", at least two voltages are needed");
+    }
+    m_cellOcv = ocv;
+  }
+
+  std::string
+  ElectricVehicleBattery::GetOpenCircuitVoltageTable (void) const
+  {
+    std::ostringstream os;
+    for (uint32_t i = 0; i < m_cellOcv.size (); i++)
+    {
+      os << (i > 0 ? " " : "") << m_cellOcv[i];
+    }
+    return os.str ();
+  }
+
+  double
+  ElectricVehicleBattery::GetOpenCircuitVoltage (double stateOfCharge) const
+  {
+    double x = std::min (std::max (stateOfCharge, 0.0), 1.0) * (m_cellOcv.size () - 1);
+    uint32_t i = std::min ((uint32_t) x, (uint32_t) m_cellOcv.size () - 2);
+    double fraction = x - i;
+    return m_cellsInSeries * (m_cellOcv[i] + fraction * (m_cellOcv[i + 1] - m_cellOcv[i]));
+  }
+
+  double
+  ElectricVehicleBattery::GetResistance (void) const
+  {
+    double cold = std::max (m_referenceTemperature - m_temperature.Get (), 0.0);
+    return m_resistance * (1 + m_resistanceCoefficient * cold);
+  }
+
+  double
+  ElectricVehicleBattery::GetVoltage (void) const
+  {
+    return m_voltage;
+  }
+
+  double
+  ElectricVehicleBattery::GetCurrent (void) const
+  {
+    return m_current;
+  }
+
+  double
+  ElectricVehicleBattery::GetTemperature (void) const
+  {
+    return m_temperature;
+  }
+
+  void
+  ElectricVehicleBattery::SetState (double voltage, double current, double temperature)
+  {
+    NS_LOG_FUNCTION (this << voltage << current << temperature);
+    m_voltage = voltage;
+    m_current = current;
+    m_temperature = temperature;
+  }
+
+  double
+  ElectricVehicleBattery::Draw (double energy, double duration, double stateOfCharge)
+  {
+    NS_LOG_FUNCTION (this << energy << duration << stateOfCharge);
+    if (duration <= 0)
+    {
+      return energy;
+    }
+
+    double ocv = GetOpenCircuitVoltage (stateOfCharge);
+    double resistance = GetResistance ();
+    double power = energy * 3600 / duration; // W at the terminals
+
+    // P = (OCV - R I) I
+    double current;
+    double discriminant = ocv * ocv - 4 * resistance * power;
+    if (resistance == 0)
+    {
+      current = power / ocv;
+    } else if (discriminant < 0)
+    {
+      NS_LOG_DEBUG ("Demand of " << power << " W beyond the maximum power of the pack");
+      current = ocv / (2 * resistance);
+    } else
+    {
+      current = (ocv - std::sqrt (discriminant)) / (2 * resistance);
+    }
+    current = std::max (current, -m_maxChargeCurrent);
+
+    m_current = current;
+    m_voltage = ocv - resistance * current;
+    UpdateTemperature (current * current * resistance, duration);
+
+    return ocv * current * duration / 3600; // Wh
+  }
+
+  double
+  ElectricVehicleBattery::Charge (double energy, double duration, double stateOfCharge, double &accepted)
+  {
+    NS_LOG_FUNCTION (this << energy << duration << stateOfCharge);
+    accepted = 0;
+    if (duration <= 0 || energy <= 0)
+    {
+      return 0;
+    }
+
+    double ocv = GetOpenCircuitVoltage (stateOfCharge);
+    double resistance = GetResistance ();
+    double power = energy * 3600 / duration; // W offered at the terminals
+
+    // P = (OCV + R I) I
+    double current;
+    if (resistance == 0)
+    {
+      current = power / ocv;
+    } else
+    {
+      current = (std::sqrt (ocv * ocv + 4 * resistance * power) - ocv) / (2 * resistance);
+    }
+    current = std::min (current, m_maxChargeCurrent);
+
+    m_current = -current;
+    m_voltage = ocv + resistance * current;
+    accepted = m_voltage * current * duration / 3600;
+    UpdateTemperature (current * current * resistance, duration);
+
+    return ocv * current * duration / 3600; // Wh
+  }
+
+  void
+  ElectricVehicleBattery::UpdateTemperature (double heat, double duration)
+  {
+    // C dT/dt = I^2 R - (T - Tambient) / Rth with a constant heat rate
+    double steady = m_ambientTemperature + heat * m_thermalResistance;
+    double timeConstant = m_heatCapacity * m_thermalResistance;
+    if (timeConstant > 0)
+    {
+      m_temperature = steady + (m_temperature - steady) * std::exp (-duration / timeConstant);
+    } else
+    {
+      m_temperature = steady;
+    }
+  }
+
+} // namespace ns3
@@ -0,0 +1,172 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#ifndef ELECTRIC_VEHICLE_BATTERY_H
+#define ELECTRIC_VEHICLE_BATTERY_H
+
+#include <string>
+#include <vector>
+
+#include "ns3/object.h"
+#include "ns3/traced-value.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup consumption
+ * \brief Electro-thermal model of the battery pack of an electric vehicle.
+ *
+ * Optional companion of ElectricVehicleConsumptionModel (see
+ * ElectricVehicleConsumptionModel::SetBattery). Without it the consumption
+ * model draws the energy demanded by the vehicle directly from its Wh
+ * counter; with it, the demand is converted into the energy taken from the
+ * cells:
+ *
+ * - the open circuit voltage of a cell is interpolated from a table
+ *   evenly spaced in state of charge, as the discharge curves of
+ *   LiIonEnergySource, and the pack voltage is CellsInSeries times it.
+ * - the pack current I that delivers the power P demanded at the terminals
+ *   solves P = (OCV - R I) I, so the I^2 R losses are drawn from the cells
+ *   and heat the pack. A demand beyond the maximum power OCV^2 / 4R is
+ *   limited to it.
+ * - the recuperation current is limited to MaxChargeCurrent; the rest of the
+ *   braking energy is lost.
+ * - a charger (see Charge) sees the pack as OCV + R I, and its current is
+ *   limited to MaxChargeCurrent too.
+ * - the pack is a single thermal mass with a thermal resistance to the
+ *   ambient. Its temperature follows the exact solution for a constant
+ *   heat rate during each update and each charge, and the internal
+ *   resistance grows as the pack gets colder than ReferenceTemperature.
+ *
+ * Each update is closed form, with a table lookup and an exponential, and
+ * allocates nothing, so every vehicle of a large fleet can have one.
+ */
+class ElectricVehicleBattery : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ElectricVehicleBattery ();
+
+  virtual ~ElectricVehicleBattery ();
+
+  /**
+   * \param energy energy in Wh demanded at the terminals during the
+   *        update, negative when the vehicle recuperates.
+   * \param duration duration of the update in seconds.
+   * \param stateOfCharge state of charge at the start of the update, from 0
+   *        to 1.
+   * \returns energy in Wh taken from the cells, negative when they are
+   *          charged.
+   *
+   * Updates the current, the terminal voltage and the temperature.
+   */
+  double Draw (double energy, double duration, double stateOfCharge);
+
+  /**
+   * \param energy energy in Wh offered to the terminals by a charger during
+   *        duration.
+   * \param duration duration of the charge in seconds.
+   * \param stateOfCharge state of charge at the start of the charge, from
+   *        0 to 1.
+   * \param [out] accepted energy in Wh taken from the charger, up to energy.
+   * \returns energy in Wh stored in the cells.
+   *
+   * Updates the current, the terminal voltage and the temperature, as
+   * Draw does: the I^2 R losses heat the pack while it exchanges heat with
+   * the ambient.
+   */
+  double Charge (double energy, double duration, double stateOfCharge, double &accepted);
+
+  /**
+   * \param stateOfCharge state of charge, from 0 to 1.
+   * \returns open circuit voltage of the pack in V.
+   */
+  double GetOpenCircuitVoltage (double stateOfCharge) const;
+
+  /**
+   * \returns internal resistance of the pack in Ohm at its temperature.
+   */
+  double GetResistance (void) const;
+
+  /**
+   * \returns terminal voltage of the pack in V in the last update.
+   */
+  double GetVoltage (void) const;
+
+  /**
+   * \returns current of the pack in A in the last update, negative when
+   *          charging.
+   */
+  double GetCurrent (void) const;
+
+  /**
+   * \returns temperature of the pack in Celsius.
+   */
+  double GetTemperature (void) const;
+
+  /**
+   * \param voltage terminal voltage in V.
+   * \param current current in A.
+   * \param temperature temperature in Celsius.
+   *
+   * Restores the state of the pack, e.g. from a checkpoint.
+   */
+  void SetState (double voltage, double current, double temperature);
+
+private:
+  /**
+   * \param table open circuit voltages of a cell in V, separated by spaces.
+   */
+  void SetOpenCircuitVoltageTable (std::string table);
+
+  /**
+   * \returns open circuit voltages of a cell in V, separated by spaces.
+   */
+  std::string GetOpenCircuitVoltageTable (void) const;
+
+  /**
+   * \param heat heat generated in the pack in W.
+   * \param duration duration in seconds.
+   *
+   * Takes the temperature to where a constant heat rate leaves it after the
+   * duration, with the exchange with the ambient.
+   */
+  void UpdateTemperature (double heat, double duration);
+
+  std::vector<double> m_cellOcv;            // cell OCV at evenly spaced states of charge, from 0 to 1
+  uint32_t m_cellsInSeries;                 // cells in series in the pack
+  double m_resistance;                      // pack resistance at the reference temperature in Ohm
+  double m_resistanceCoefficient;           // relative resistance increase per K below the reference
+  double m_referenceTemperature;            // temperature of m_resistance in Celsius
+  double m_maxChargeCurrent;                // maximum recuperation current in A
+  double m_heatCapacity;                    // heat capacity of the pack in J/K
+  double m_thermalResistance;               // thermal resistance to the ambient in K/W
+  double m_ambientTemperature;              // ambient temperature in Celsius
+
+  double m_current;                         // current in the last update in A
+  TracedValue<double> m_voltage;            // terminal voltage in V
+  TracedValue<double> m_temperature;        // temperature in Celsius
+};
+
+} // namespace ns3
+
+#endif /* ELECTRIC_VEHICLE_BATTERY_H */
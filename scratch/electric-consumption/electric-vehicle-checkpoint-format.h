@@ -0,0 +1,87 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#ifndef ELECTRIC_VEHICLE_CHECKPOINT_FORMAT_H
+#define ELECTRIC_VEHICLE_CHECKPOINT_FORMAT_H
+
+#include <stdint.h>
+
+/**
+ * \ingroup consumption
+ * \file
+ *
+ * Binary format of the checkpoints of a fleet written by
+ * ns3::ElectricVehicleCheckpoint and read by
+ * ns3::ElectricConsumptionHelper::LoadCheckpoint.
+ *
+ * A file is an ElectricVehicleCheckpointHeader followed by frames, one per
+ * checkpoint. A frame is an ElectricVehicleCheckpointFrame followed by
+ * count records of recordSize bytes. The first frame has a record for every
+ * vehicle; the next ones only for the vehicles whose state changed since
+ * the previous frame, so the state at a checkpoint is the last record of
+ * each vehicle up to its frame. A frame cut by a crash is ignored. The file
+ * is in the byte order of the machine that wrote it.
+ */
+
+#define ELECTRIC_VEHICLE_CHECKPOINT_MAGIC "EVCKPT\r\n"
+#define ELECTRIC_VEHICLE_CHECKPOINT_BYTE_ORDER 0x01020304
+#define ELECTRIC_VEHICLE_CHECKPOINT_VERSION 1
+
+/** The vehicle changed its course and its consumption was not yet integrated. */
+#define ELECTRIC_VEHICLE_CHECKPOINT_PENDING 0x1
+/** The vehicle has a battery pack model. */
+#define ELECTRIC_VEHICLE_CHECKPOINT_BATTERY 0x2
+
+struct ElectricVehicleCheckpointHeader
+{
+  char magic[8];              //!< ELECTRIC_VEHICLE_CHECKPOINT_MAGIC
+  uint32_t byteOrder;         //!< ELECTRIC_VEHICLE_CHECKPOINT_BYTE_ORDER as written by the writer
+  uint32_t version;           //!< ELECTRIC_VEHICLE_CHECKPOINT_VERSION
+  uint32_t recordSize;        //!< size in bytes of each record
+  uint32_t reserved;          //!< 0
+};
+
+struct ElectricVehicleCheckpointFrame
+{
+  int64_t time;               //!< simulation time of the checkpoint in ns
+  uint32_t count;             //!< number of records of the frame
+  uint32_t reserved;          //!< 0
+};
+
+struct ElectricVehicleCheckpointRecord
+{
+  uint32_t nodeId;            //!< node ID of the vehicle
+  uint32_t flags;             //!< ELECTRIC_VEHICLE_CHECKPOINT_PENDING, ELECTRIC_VEHICLE_CHECKPOINT_BATTERY
+  int64_t lastUpdateTime;     //!< time of the last update in ns
+  double remainingEnergy;     //!< remaining energy in Wh
+  double totalEnergyConsumed; //!< total energy consumed in Wh
+  double energyConsumed;      //!< energy consumed in the last update in Wh
+  double lastAngle;           //!< heading at the last update in radians
+  double lastPosition[3];     //!< position at the last update in m
+  double lastVelocity[3];     //!< velocity at the last update in m/s
+  double position[3];         //!< position of the mobility model in m
+  double velocity[3];         //!< velocity of the mobility model in m/s
+  double batteryVoltage;      //!< terminal voltage of the battery pack in V
+  double batteryCurrent;      //!< current of the battery pack in A
+  double batteryTemperature;  //!< temperature of the battery pack in Celsius
+};
+
+#endif /* ELECTRIC_VEHICLE_CHECKPOINT_FORMAT_H */
@@ -0,0 +1,253 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <cstring>
+#include <fstream>
+#include <map>
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/simulator.h"
+#include "electric-vehicle-checkpoint.h"
+
+namespace ns3 {
+
+  NS_LOG_COMPONENT_DEFINE ("ElectricVehicleCheckpoint");
+
+  NS_OBJECT_ENSURE_REGISTERED (ElectricVehicleCheckpoint);
+
+  TypeId
+  ElectricVehicleCheckpoint::GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::ElectricVehicleCheckpoint")
+      .SetParent<Object> ()
+      .SetGroupName ("Consumption")
+      .AddConstructor<ElectricVehicleCheckpoint> ()
+      .AddAttribute ("Interval",
+                     "Time between checkpoints.",
+                     TimeValue (Seconds (3600)),
+                     MakeTimeAccessor (&ElectricVehicleCheckpoint::m_interval),
+                     MakeTimeChecker (Seconds (0)))
+    ;
+    return tid;
+  }
+
+  ElectricVehicleCheckpoint::ElectricVehicleCheckpoint ()
+    : m_interval (Seconds (3600)),
+      m_file (0),
+      m_first (true)
+  {
+    NS_LOG_FUNCTION (this);
+  }
+
+  ElectricVehicleCheckpoint::~ElectricVehicleCheckpoint ()
+  {
+    NS_LOG_FUNCTION (this);
+    Close ();
+  }
+
+  void
+  ElectricVehicleCheckpoint::DoDispose (void)
+  {
+    NS_LOG_FUNCTION (this);
+    Close ();
+    m_event.Cancel ();
+    m_models.clear ();
+    Object::DoDispose ();
+  }
+
+  void
+  ElectricVehicleCheckpoint::Open (std::string filename)
+  {
+    NS_LOG_FUNCTION (this << filename);
+    Close ();
+
+    m_file = std::fopen (filename.c_str (), "wb");
+    if (m_file == 0)
+    {
+      NS_FATAL_ERROR ("Could not open checkpoint file " << filename << " for writing, aborting here \n");
+    }
+
+    ElectricVehicleCheckpointHeader header;
+    std::memset (&header, 0, sizeof (header));
+    std::memcpy (header.magic, ELECTRIC_VEHICLE_CHECKPOINT_MAGIC, sizeof (header.magic));
+    header.byteOrder = ELECTRIC_VEHICLE_CHECKPOINT_BYTE_ORDER;
+    header.version = ELECTRIC_VEHICLE_CHECKPOINT_VERSION;
+    header.recordSize = sizeof (ElectricVehicleCheckpointRecord);
+    std::fwrite (&header, sizeof (header), 1, m_file);
+    std::fflush (m_file);
+    m_first = true;
+  }
+
+  void
+  ElectricVehicleCheckpoint::Install (Ptr<ElectricVehicleConsumptionModel> model)
+  {
+    NS_LOG_FUNCTION (this << model);
+    m_models.push_back (model);
+    m_last.resize (m_models.size ());
+    m_first = true;
+  }
+
+  void
+  ElectricVehicleCheckpoint::InstallAll (void)
+  {
+    NS_LOG_FUNCTION (this);
+    for (uint32_t i = 0; i < NodeList::GetNNodes (); i++)
+    {
+      Ptr<ElectricVehicleConsumptionModel> model = NodeList::GetNode (i)->GetObject<ElectricVehicleConsumptionModel> ();
+      if (model != NULL)
+      {
+        Install (model);
+      }
+    }
+  }
+
+  void
+  ElectricVehicleCheckpoint::Start (void)
+  {
+    NS_LOG_FUNCTION (this);
+    if (m_interval.IsStrictlyPositive ())
+    {
+      m_event = Simulator::Schedule (m_interval, &ElectricVehicleCheckpoint::DoSave, this);
+    }
+  }
+
+  void
+  ElectricVehicleCheckpoint::DoSave (void)
+  {
+    Save ();
+    m_event = Simulator::Schedule (m_interval, &ElectricVehicleCheckpoint::DoSave, this);
+  }
+
+  void
+  ElectricVehicleCheckpoint::Save (void)
+  {
+    NS_LOG_FUNCTION (this);
+    if (m_file == 0)
+    {
+      NS_LOG_ERROR ("No checkpoint file is open");
+      return;
+    }
+
+    m_frame.clear ();
+    ElectricVehicleCheckpointRecord record;
+    for (uint32_t i = 0; i < m_models.size (); i++)
+    {
+      m_models[i]->SaveState (record);
+      if (m_first || std::memcmp (&record, &m_last[i], sizeof (record)) != 0)
+      {
+        m_frame.push_back (record);
+        m_last[i] = record;
+      }
+    }
+    m_first = false;
+
+    ElectricVehicleCheckpointFrame frame;
+    frame.time = Simulator::Now ().GetNanoSeconds ();
+    frame.count = m_frame.size ();
+    frame.reserved = 0;
+    std::fwrite (&frame, sizeof (frame), 1, m_file);
+    if (!m_frame.empty ())
+    {
+      std::fwrite (&m_frame[0], sizeof (record), m_frame.size (), m_file);
+    }
+    if (std::fflush (m_file) != 0)
+    {
+      NS_FATAL_ERROR ("Could not write checkpoint, aborting here \n");
+    }
+    NS_LOG_DEBUG ("Checkpoint at " << Simulator::Now ().GetSeconds () << " s: "
+                  << m_frame.size () << " of " << m_models.size () << " vehicles changed");
+  }
+
+  void
+  ElectricVehicleCheckpoint::Close (void)
+  {
+    if (m_file == 0)
+    {
+      return;
+    }
+    NS_LOG_FUNCTION (this);
+    std::fclose (m_file);
+    m_file = 0;
+  }
+
+  bool
+  ElectricVehicleCheckpoint::Load (std::string filename, Time time, Time &savedTime,
+                                   std::vector<ElectricVehicleCheckpointRecord> &records)
+  {
+    NS_LOG_FUNCTION (filename << time);
+
+    std::ifstream file (filename.c_str (), std::ios::in | std::ios::binary);
+    ElectricVehicleCheckpointHeader header;
+    if (!file.read ((char *) &header, sizeof (header))
+        || std::memcmp (header.magic, ELECTRIC_VEHICLE_CHECKPOINT_MAGIC, sizeof (header.magic)) != 0
+        || header.byteOrder != ELECTRIC_VEHICLE_CHECKPOINT_BYTE_ORDER
+        || header.version != ELECTRIC_VEHICLE_CHECKPOINT_VERSION
+        || header.recordSize < sizeof (ElectricVehicleCheckpointRecord))
+    {
+      NS_LOG_ERROR (filename << " is not a checkpoint file");
+      return false;
+    }
+
+    // replay the frames up to the requested time
+    std::map<uint32_t, ElectricVehicleCheckpointRecord> state;
+    std::vector<char> buffer;
+    bool found = false;
+    ElectricVehicleCheckpointFrame frame;
+    while (file.read ((char *) &frame, sizeof (frame)))
+    {
+      if (!time.IsNegative () && NanoSeconds (frame.time) > time)
+      {
+        break;
+      }
+      buffer.resize ((size_t) frame.count * header.recordSize);
+      if (!buffer.empty () && !file.read (&buffer[0], buffer.size ()))
+      {
+        NS_LOG_WARN ("Ignoring the truncated checkpoint at " << NanoSeconds (frame.time).GetSeconds () << " s");
+        break;
+      }
+      for (uint32_t i = 0; i < frame.count; i++)
+      {
+        ElectricVehicleCheckpointRecord record;
+        std::memcpy (&record, &buffer[(size_t) i * header.recordSize], sizeof (record));
+        state[record.nodeId] = record;
+      }
+      savedTime = NanoSeconds (frame.time);
+      found = true;
+    }
+    if (!found)
+    {
+      NS_LOG_ERROR (filename << " has no checkpoint before " << time.GetSeconds () << " s");
+      return false;
+    }
+
+    records.clear ();
+    records.reserve (state.size ());
+    for (std::map<uint32_t, ElectricVehicleCheckpointRecord>::const_iterator it = state.begin (); it != state.end (); it++)
+    {
+      records.push_back (it->second);
+    }
+    return true;
+  }
+
+} // namespace ns3
@@ -0,0 +1,128 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#ifndef ELECTRIC_VEHICLE_CHECKPOINT_H
+#define ELECTRIC_VEHICLE_CHECKPOINT_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/nstime.h"
+#include "electric-vehicle-consumption-model.h"
+#include "electric-vehicle-checkpoint-format.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup consumption
+ * \brief Saves checkpoints of the state of a fleet of electric vehicles,
+ * from which a later run can resume the simulation.
+ *
+ * Every Interval the state of each installed vehicle (see
+ * ElectricVehicleConsumptionModel::SaveState) is appended to the checkpoint
+ * file as a frame. Only the vehicles whose state changed since the previous
+ * checkpoint are written, e.g. not the parked ones, and the file is flushed
+ * after each frame, so a crash loses at most the frame being written. See
+ * electric-vehicle-checkpoint-format.h for the format.
+ *
+ * A checkpoint is taken after the movements of its time and before the
+ * consumption is updated for them, so Start must be called after the
+ * movements and the vehicles are installed. The simulation is resumed from
+ * a checkpoint with ElectricConsumptionHelper::LoadCheckpoint and
+ * Ns2MobilityHelper::SetStartTime.
+ */
+class ElectricVehicleCheckpoint : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ElectricVehicleCheckpoint ();
+
+  virtual ~ElectricVehicleCheckpoint ();
+
+  /**
+   * \param filename file to write. It is created or truncated.
+   */
+  void Open (std::string filename);
+
+  /**
+   * \param model consumption model whose state is saved.
+   */
+  void Install (Ptr<ElectricVehicleConsumptionModel> model);
+
+  /**
+   * Saves the consumption models of all the nodes of the global
+   * ns3::NodeList.
+   */
+  void InstallAll (void);
+
+  /**
+   * Schedules a checkpoint every Interval, the first one an interval from
+   * now.
+   */
+  void Start (void);
+
+  /**
+   * Appends a checkpoint of the installed vehicles now.
+   */
+  void Save (void);
+
+  /**
+   * Closes the file. Called on dispose.
+   */
+  void Close (void);
+
+  /**
+   * \param filename checkpoint file.
+   * \param time time of the checkpoint to read, the last one if negative.
+   * \param [out] savedTime time of the checkpoint read, the last one before
+   *        the given time.
+   * \param [out] records state of each vehicle at the checkpoint, sorted by
+   *        node ID.
+   * \returns false if the file is not a checkpoint file or has no
+   *          checkpoint before the given time.
+   */
+  static bool Load (std::string filename, Time time, Time &savedTime,
+                    std::vector<ElectricVehicleCheckpointRecord> &records);
+
+private:
+  virtual void DoDispose (void);
+
+  /**
+   * Saves a checkpoint and schedules the next one.
+   */
+  void DoSave (void);
+
+  Time m_interval;                                        // time between checkpoints
+  std::FILE *m_file;                                      // checkpoint file
+  std::vector<Ptr<ElectricVehicleConsumptionModel> > m_models; // installed vehicles
+  std::vector<ElectricVehicleCheckpointRecord> m_last;    // last saved state of each vehicle
+  std::vector<ElectricVehicleCheckpointRecord> m_frame;   // records of the frame being written
+  bool m_first;                                           // no frame written yet
+  EventId m_event;                                        // next checkpoint
+};
+
+} // namespace ns3
+
+#endif /* ELECTRIC_VEHICLE_CHECKPOINT_H */
@@ -18,7 +18,9 @@
  * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
  */
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 #include "ns3/log.h"
 #include "ns3/assert.h"
@@ -44,11 +46,33 @@ namespace ns3 {
                         "Remaining energy in vehicle in Wh.",
                         MakeTraceSourceAccessor (&ElectricVehicleConsumptionModel::m_remainingEnergyWh),
                         "ns3::TracedValueCallback::Double")
+        .AddTraceSource ("ConsumptionUpdate",
+                        "State of the vehicle and energy by term after each update.",
+                        MakeTraceSourceAccessor (&ElectricVehicleConsumptionModel::m_consumptionUpdateTrace),
+                        "ns3::ElectricVehicleConsumptionModel::ConsumptionUpdateCallback")
       ;
       return tid;
     }
 
     ElectricVehicleConsumptionModel::ElectricVehicleConsumptionModel ()
+      : m_initialEnergyWh (0),
+        m_remainingEnergyWh (0),
+        m_totalEnergyConsumed (0),
+        m_energyConsumed (0),
+        m_maximumBatteryCapacity (0),
+        m_vehicleMass (0),
+        m_frontSurfaceArea (0),
+        m_airDragCoefficient (0),
+        m_internalMomentOfInertia (0),
+        m_radialDragCoefficient (0),
+        m_rollDragCoefficient (0),
+        m_constantPowerIntake (0),
+        m_propulsionEfficiency (0),
+        m_recuperationEfficiency (0),
+        m_lastAngle (std::numeric_limits<double>::infinity ()),
+        m_courseChangeUpdate (false),
+        m_courseChangePending (false),
+        m_coefficientsValid (false)
     {
       NS_LOG_FUNCTION (this);
     }
@@ -61,6 +85,14 @@ namespace ns3 {
     void
     ElectricVehicleConsumptionModel::UpdateConsumption (void)
     {
+      if (m_courseChangeUpdate)
+      {
+        if (!Simulator::IsFinished ())
+        {
+          IntegrateConsumption ();
+        }
+        return;
+      }
 
       m_timeFromLastUpdate = Simulator::Now () - GetLastUpdateTime ();
 
@@ -74,100 +106,296 @@ namespace ns3 {
         return;
       }
       
-      double energyDiff = CalculateEnergyDiff (); // Wh
-
-      DecreaseRemainingEnergy (energyDiff);
-      SetEnergyConsumed (energyDiff);
-      IncreaseTotalEnergyConsumed (energyDiff);
+      ElectricVehicleEnergyTerms terms;
+      double energyDiff = CalculateEnergyDiff (terms); // Wh
+      energyDiff = DrawEnergy (energyDiff, m_timeFromLastUpdate.GetSeconds ());
 
       SetLastUpdateTime (Simulator::Now ());
       SaveLastPosAndVel ();
       m_lastAngle = GetAngle (GetMobilityModel ()->GetVelocity ());
+
+      NotifyConsumptionUpdate (terms, energyDiff);
     }
 
-    double ElectricVehicleConsumptionModel::CalculateEnergyDiff (void)
+    void
+    ElectricVehicleConsumptionModel::StartCourseChangeUpdate (void)
     {
+      NS_LOG_FUNCTION (this);
+      NS_ASSERT (GetNode () != NULL);
+      NS_ASSERT (m_mobilityModel != NULL);
 
-      double velocityNow = GetVelocity (m_mobilityModel->GetVelocity ());
-      double lastVelocity = GetVelocity (m_lastVelocity);
-      double heightNow = m_mobilityModel->GetPosition ().z;
-      double lastHeight = m_lastPosition.z;
+      Ptr<MobilityModel> mobility = GetNode ()->GetObject<MobilityModel> ();
+      NS_ASSERT (mobility == m_mobilityModel);
+      mobility->TraceConnectWithoutContext ("CourseChange",
+        MakeCallback (&ElectricVehicleConsumptionModel::NotifyCourseChange, this));
 
-      double distanceCovered = VelocityToDistance (velocityNow);
+      m_courseChangeUpdate = true;
+      SetLastUpdateTime (Simulator::Now ());
+      SaveLastPosAndVel ();
+      if (GetVelocity (m_lastVelocity) > 0)
+      {
+        m_lastAngle = GetAngle (m_lastVelocity);
+      }
+    }
 
-      // calculate potential energy difference
-      double energyDiff = GetVehicleMass () * STANDARD_GRAVITY * (heightNow - lastHeight);
+    bool
+    ElectricVehicleConsumptionModel::IsCourseChangeUpdate (void) const
+    {
+      return m_courseChangeUpdate;
+    }
 
-      // kinetic energy difference of vehicle
-      energyDiff += 0.5 * GetVehicleMass () * (velocityNow * velocityNow - lastVelocity * lastVelocity);
+    void
+    ElectricVehicleConsumptionModel::NotifyCourseChange (Ptr<const MobilityModel> mobility)
+    {
+      NS_LOG_FUNCTION (this << mobility);
 
-      // add rotational energy diff of internal rotating elements
-      energyDiff += GetInternalMomentOfInertia () * (velocityNow * velocityNow - lastVelocity * lastVelocity);
+      // several changes of course can happen at the same time (e.g. the stop
+      // at the end of a ns-2 setdest and the next setdest), integrate them
+      // together after all the events of this time
+      if (!m_courseChangePending)
+      {
+        m_courseChangePending = true;
+        Simulator::ScheduleNow (&ElectricVehicleConsumptionModel::IntegrateConsumption, this);
+      }
+    }
 
-      // Energy loss through Air resistance [Ws]
-      // Calculate energy losses:
-      // EnergyLoss,Air = 1/2 * rho_air [kg/m^3] * myFrontSurfaceArea [m^2] * myAirDragCoefficient [-] * v_Veh^2 [m/s] * s [m]
-      //                    ... with rho_air [kg/m^3] = 1,2041 kg/m^3 (at T = 20C)
-      //                    ... with s [m] = v_Veh [m/s] * TS [s]
-      energyDiff += 0.5 * DENSITY_AIR * GetFrontSurfaceArea () * GetAirDragCoefficient () * velocityNow * velocityNow * distanceCovered;
+    void
+    ElectricVehicleConsumptionModel::IntegrateConsumption (void)
+    {
+      NS_LOG_FUNCTION (this);
+      NS_ASSERT (m_courseChangeUpdate);
 
-      // Energy loss through Roll resistance [Ws]
-      //                    ... (fabs(veh.getSpeed())>=0.01) = 0, if vehicle isn't moving
-      // EnergyLoss,Tire = c_R [-] * F_N [N] * s [m]
-      //                    ... with c_R = ~0.012    (car tire on asphalt)
-      //                    ... with F_N [N] = myMass [kg] * g [m/s^2]
-      energyDiff += GetRollDragCoefficient () * STANDARD_GRAVITY * GetVehicleMass () * distanceCovered;
+      m_courseChangePending = false;
+      m_timeFromLastUpdate = Simulator::Now () - GetLastUpdateTime ();
 
-      // Energy loss through friction by radial force [Ws]
-      // If angle of vehicle was changed
-      const double angleDiff = m_lastAngle == std::numeric_limits<double>::infinity() ? 0. : GetAngleDiff(m_lastAngle, GetAngle (GetMobilityModel ()->GetVelocity ()));
+      Vector velocity = m_mobilityModel->GetVelocity ();
+      double velocityNow = GetVelocity (velocity);
+      double segmentVelocity = GetVelocity (m_lastVelocity);
 
-      if (angleDiff != 0.)
+      // the heading is only defined while the vehicle moves
+      double angleDiff = 0.;
+      if (velocityNow > 0)
       {
-        // Compute new radio
-        double radius = distanceCovered / fabs(angleDiff);
+        angleDiff = GetAngleDiff (m_lastAngle, GetAngle (velocity));
+      }
 
-        // Check if radius is in the interval [0.0001 - 10000] (To avoid overflow and division by zero)
-        if (radius < 0.0001)
-        {
-            radius = 0.0001;
-        } else if (radius > 10000)
-        {
-            radius = 10000;
-        }
+      ElectricVehicleEnergyTerms terms;
+      double energyDiff = ElectricVehicleSegmentEnergyDiff (GetCoefficients (),
+                                                            segmentVelocity,
+                                                            velocityNow,
+                                                            GetVehiclePosition ().z,
+                                                            m_lastPosition.z,
+                                                            angleDiff,
+                                                            m_timeFromLastUpdate.GetSeconds (),
+                                                            terms); // Wh
+      energyDiff = DrawEnergy (energyDiff, m_timeFromLastUpdate.GetSeconds ());
 
-        // EnergyLoss,internalFrictionRadialForce = c [m] * F_rad [N];
-        // Energy loss through friction by radial force [Ws]
-        energyDiff += GetRadialDragCoefficient () * GetVehicleMass () * velocityNow * velocityNow / radius;
+      SetLastUpdateTime (Simulator::Now ());
+      SaveLastPosAndVel ();
+      if (velocityNow > 0)
+      {
+        m_lastAngle = GetAngle (velocity);
       }
 
-      // EnergyLoss,constantConsumers
-      // Energy loss through constant loads (e.g. A/C) [Ws]
-      energyDiff += GetConstantPowerIntake ();
+      NotifyConsumptionUpdate (terms, energyDiff);
+    }
 
-      //E_Bat = E_kin_pot + EnergyLoss;
-      if (energyDiff > 0)
+    double
+    ElectricVehicleConsumptionModel::DrawEnergy (double energyDiff, double duration)
+    {
+      if (m_battery != NULL)
       {
-        energyDiff /= GetPropulsionEfficiency ();
-      } else
+        energyDiff = m_battery->Draw (energyDiff, duration, m_remainingEnergyWh / m_maximumBatteryCapacity);
+      }
+      DecreaseRemainingEnergy (energyDiff);
+      SetEnergyConsumed (energyDiff);
+      IncreaseTotalEnergyConsumed (energyDiff);
+      return energyDiff;
+    }
+
+    double
+    ElectricVehicleConsumptionModel::Charge (double energy, double duration)
+    {
+      NS_LOG_FUNCTION (this << energy << duration);
+      double room = m_maximumBatteryCapacity - m_remainingEnergyWh;
+      if (energy <= 0 || room <= 0)
+      {
+        return 0;
+      }
+      double stored = energy;
+      if (m_battery != NULL)
       {
-        energyDiff += GetRecuperationEfficiency ();
+        stored = m_battery->Charge (energy, duration, m_remainingEnergyWh / m_maximumBatteryCapacity, energy);
       }
+      // the charge stops when the battery is full
+      if (stored > room)
+      {
+        energy *= room / stored;
+        stored = room;
+      }
+      IncreaseRemainingEnergy (stored);
+      return energy;
+    }
 
-      // convert from [Ws] to [Wh] (3600s / 1h):
-      return energyDiff / 3600;
+    void
+    ElectricVehicleConsumptionModel::SaveState (ElectricVehicleCheckpointRecord &record)
+    {
+      NS_ASSERT (GetNode () != NULL);
+      NS_ASSERT (m_mobilityModel != NULL);
+
+      std::memset (&record, 0, sizeof (record));
+      record.nodeId = GetNode ()->GetId ();
+      record.flags = m_courseChangePending ? ELECTRIC_VEHICLE_CHECKPOINT_PENDING : 0;
+      record.lastUpdateTime = m_lastUpdateTime.GetNanoSeconds ();
+      record.remainingEnergy = m_remainingEnergyWh;
+      record.totalEnergyConsumed = m_totalEnergyConsumed;
+      record.energyConsumed = m_energyConsumed;
+      record.lastAngle = m_lastAngle;
+      Vector position = m_mobilityModel->GetPosition ();
+      Vector velocity = m_mobilityModel->GetVelocity ();
+      const Vector *vectors[4] = { &m_lastPosition, &m_lastVelocity, &position, &velocity };
+      double *values[4] = { record.lastPosition, record.lastVelocity, record.position, record.velocity };
+      for (uint32_t i = 0; i < 4; i++)
+      {
+        values[i][0] = vectors[i]->x;
+        values[i][1] = vectors[i]->y;
+        values[i][2] = vectors[i]->z;
+      }
+      if (m_battery != NULL)
+      {
+        record.flags |= ELECTRIC_VEHICLE_CHECKPOINT_BATTERY;
+        record.batteryVoltage = m_battery->GetVoltage ();
+        record.batteryCurrent = m_battery->GetCurrent ();
+        record.batteryTemperature = m_battery->GetTemperature ();
+      }
+    }
+
+    void
+    ElectricVehicleConsumptionModel::RestoreState (const ElectricVehicleCheckpointRecord &record)
+    {
+      NS_LOG_FUNCTION (this << record.nodeId);
+
+      m_lastUpdateTime = NanoSeconds (record.lastUpdateTime);
+      m_remainingEnergyWh = record.remainingEnergy;
+      m_totalEnergyConsumed = record.totalEnergyConsumed;
+      m_energyConsumed = record.energyConsumed;
+      m_lastAngle = record.lastAngle;
+      m_lastPosition = Vector (record.lastPosition[0], record.lastPosition[1], record.lastPosition[2]);
+      m_lastVelocity = Vector (record.lastVelocity[0], record.lastVelocity[1], record.lastVelocity[2]);
+      if (m_battery != NULL && (record.flags & ELECTRIC_VEHICLE_CHECKPOINT_BATTERY))
+      {
+        m_battery->SetState (record.batteryVoltage, record.batteryCurrent, record.batteryTemperature);
+      }
+
+      if (m_courseChangeUpdate && (record.flags & ELECTRIC_VEHICLE_CHECKPOINT_PENDING) && !m_courseChangePending)
+      {
+        m_courseChangePending = true;
+        Simulator::ScheduleNow (&ElectricVehicleConsumptionModel::IntegrateConsumption, this);
+      }
+    }
+
+    void
+    ElectricVehicleConsumptionModel::SetBattery (Ptr<ElectricVehicleBattery> battery)
+    {
+      NS_LOG_FUNCTION (this << battery);
+      m_battery = battery;
+    }
+
+    Ptr<ElectricVehicleBattery>
+    ElectricVehicleConsumptionModel::GetBattery (void) const
+    {
+      return m_battery;
+    }
+
+    void
+    ElectricVehicleConsumptionModel::SetElevation (Ptr<ElevationRaster> elevation)
+    {
+      NS_LOG_FUNCTION (this << elevation);
+      m_elevation = elevation;
+      if (m_elevation != NULL && m_mobilityModel != NULL)
+      {
+        // the first update must not climb from height 0
+        m_lastPosition.z = GetVehiclePosition ().z;
+      }
+    }
+
+    Ptr<ElevationRaster>
+    ElectricVehicleConsumptionModel::GetElevation (void) const
+    {
+      return m_elevation;
+    }
+
+    void
+    ElectricVehicleConsumptionModel::NotifyConsumptionUpdate (const ElectricVehicleEnergyTerms &terms, double energyDiff)
+    {
+      ElectricVehicleConsumptionUpdate update;
+      update.nodeId = GetNode ()->GetId ();
+      update.time = Simulator::Now ();
+      update.position = m_lastPosition;
+      update.speed = GetVelocity (m_lastVelocity);
+      update.potentialEnergy = terms.potential / 3600;
+      update.kineticEnergy = terms.kinetic / 3600;
+      update.rotationalEnergy = terms.rotational / 3600;
+      update.airEnergy = terms.air / 3600;
+      update.rollEnergy = terms.roll / 3600;
+      update.radialEnergy = terms.radial / 3600;
+      update.auxiliaryEnergy = terms.auxiliary / 3600;
+      update.energyDiff = energyDiff;
+      update.remainingEnergy = m_remainingEnergyWh;
+      update.totalEnergyConsumed = m_totalEnergyConsumed;
+      update.energyFraction = m_remainingEnergyWh / m_maximumBatteryCapacity;
+      m_consumptionUpdateTrace (update);
+    }
+
+    double ElectricVehicleConsumptionModel::CalculateEnergyDiff (ElectricVehicleEnergyTerms &terms)
+    {
+      Vector velocity = m_mobilityModel->GetVelocity ();
+
+      return ElectricVehicleEnergyDiff (GetCoefficients (),
+                                        GetVelocity (velocity),
+                                        GetVelocity (m_lastVelocity),
+                                        GetVehiclePosition ().z,
+                                        m_lastPosition.z,
+                                        GetAngleDiff (m_lastAngle, GetAngle (velocity)),
+                                        m_timeFromLastUpdate.GetSeconds (),
+                                        terms);
+    }
+
+    const ElectricVehicleCoefficients &
+    ElectricVehicleConsumptionModel::GetCoefficients (void)
+    {
+      if (!m_coefficientsValid)
+      {
+        m_coefficients = ElectricVehicleMakeCoefficients (m_vehicleMass,
+                                                          m_frontSurfaceArea,
+                                                          m_airDragCoefficient,
+                                                          m_internalMomentOfInertia,
+                                                          m_radialDragCoefficient,
+                                                          m_rollDragCoefficient,
+                                                          m_constantPowerIntake,
+                                                          m_propulsionEfficiency,
+                                                          m_recuperationEfficiency);
+        m_coefficientsValid = true;
+      }
+      return m_coefficients;
     }
 
     void
     ElectricVehicleConsumptionModel::SaveLastPosAndVel (void)
     {
-      m_lastPosition.x = m_mobilityModel->GetPosition ().x;
-      m_lastPosition.y = m_mobilityModel->GetPosition ().y;
-      m_lastPosition.z = m_mobilityModel->GetPosition ().z;
+      m_lastPosition = GetVehiclePosition ();
+      m_lastVelocity = m_mobilityModel->GetVelocity ();
+    }
 
-      m_lastVelocity.x = m_mobilityModel->GetVelocity ().x;
-      m_lastVelocity.y = m_mobilityModel->GetVelocity ().y;
-      m_lastVelocity.z = m_mobilityModel->GetVelocity ().z;
+    Vector
+    ElectricVehicleConsumptionModel::GetVehiclePosition (void)
+    {
+      Vector position = m_mobilityModel->GetPosition ();
+      if (m_elevation != NULL)
+      {
+        position.z = m_elevation->GetHeight (position.x, position.y);
+      }
+      return position;
     }
 
     double
@@ -179,26 +407,19 @@ namespace ns3 {
     double
     ElectricVehicleConsumptionModel::GetDistance (Vector u, Vector v)
     {
-      return std::sqrt ((std::pow (u.x - v.x, 2) + std::pow (u.y - v.y, 2) + std::pow (u.z - v.z, 2)));
+      return std::sqrt ((u.x - v.x) * (u.x - v.x) + (u.y - v.y) * (u.y - v.y) + (u.z - v.z) * (u.z - v.z));
     }
 
     double
     ElectricVehicleConsumptionModel::GetAngle (Vector v)
     {
-      return std::atan2 (v.y, v.x);
+      return ElectricVehicleAngle (v);
     }
 
     double
     ElectricVehicleConsumptionModel::GetAngleDiff (double angle1, double angle2)
     {
-      double dtheta = angle2 - angle1;
-      while (dtheta > (double) M_PI) {
-          dtheta -= (double)(2.0 * M_PI);
-      }
-      while (dtheta < (double) - M_PI) {
-          dtheta += (double)(2.0 * M_PI);
-      }
-      return dtheta;
+      return ElectricVehicleAngleDiff (angle1, angle2);
     }
 
     /*
@@ -208,14 +429,25 @@ namespace ns3 {
     double 
     ElectricVehicleConsumptionModel::GetVelocity (void)
     {
-      Vector vel = m_mobilityModel->GetVelocity ();
-      return std::sqrt (std::pow(vel.x, 2) + std::pow(vel.y, 2) + std::pow(vel.z, 2));
+      return ElectricVehicleSpeed (m_mobilityModel->GetVelocity ());
     }
 
     double 
     ElectricVehicleConsumptionModel::GetVelocity (Vector vel)
     {
-      return std::sqrt (std::pow(vel.x, 2) + std::pow(vel.y, 2) + std::pow(vel.z, 2));
+      return ElectricVehicleSpeed (vel);
+    }
+
+    double
+    ElectricVehicleConsumptionModel::GetLastAngle (void)
+    {
+      return m_lastAngle;
+    }
+
+    void
+    ElectricVehicleConsumptionModel::SetLastAngle (double lastAngle)
+    {
+      m_lastAngle = lastAngle;
     }
 
     double
@@ -240,6 +472,10 @@ namespace ns3 {
     ElectricVehicleConsumptionModel::GetSupplyVoltage (void) const
     {
       NS_LOG_FUNCTION (this);
+      if (m_battery != NULL)
+      {
+        return m_battery->GetVoltage ();
+      }
       return 0;
     }
 
@@ -336,6 +572,7 @@ namespace ns3 {
     ElectricVehicleConsumptionModel::SetVehicleMass (double vehicleMass)
     {
       m_vehicleMass = vehicleMass;
+      m_coefficientsValid = false;
     }
 
     double
@@ -348,6 +585,7 @@ namespace ns3 {
     ElectricVehicleConsumptionModel::SetFrontSurfaceArea (double frontSurfaceArea)
     {
       m_frontSurfaceArea = frontSurfaceArea;
+      m_coefficientsValid = false;
     }
 
     double
@@ -360,6 +598,7 @@ namespace ns3 {
     ElectricVehicleConsumptionModel::SetAirDragCoefficient (double airDragCoefficient)
     {
       m_airDragCoefficient = airDragCoefficient;
+      m_coefficientsValid = false;
     }
 
     double
@@ -372,6 +611,7 @@ namespace ns3 {
     ElectricVehicleConsumptionModel::SetInternalMomentOfInertia (double internalMomentOfInertia)
     {
       m_internalMomentOfInertia = internalMomentOfInertia;
+      m_coefficientsValid = false;
     }
 
     double
@@ -384,6 +624,7 @@ namespace ns3 {
     ElectricVehicleConsumptionModel::SetRadialDragCoefficient (double radialDragCoefficient)
     {
       m_radialDragCoefficient = radialDragCoefficient;
+      m_coefficientsValid = false;
     }
 
     double
@@ -396,6 +637,7 @@ namespace ns3 {
     ElectricVehicleConsumptionModel::SetRollDragCoefficient (double rollDragCoefficient)
     {
       m_rollDragCoefficient = rollDragCoefficient;
+      m_coefficientsValid = false;
     }  
 
     double
@@ -408,6 +650,7 @@ namespace ns3 {
     ElectricVehicleConsumptionModel::SetPropulsionEfficiency (double propulsionEfficiency)
     {
       m_propulsionEfficiency = propulsionEfficiency;
+      m_coefficientsValid = false;
     }
 
     double
@@ -420,6 +663,7 @@ namespace ns3 {
     ElectricVehicleConsumptionModel::SetRecuperationEfficiency (double recuperationEfficiency)
     {
       m_recuperationEfficiency = recuperationEfficiency;
+      m_coefficientsValid = false;
     }
 
     double
@@ -432,6 +676,7 @@ namespace ns3 {
     ElectricVehicleConsumptionModel::SetConstantPowerIntake(double constantPowerIntake)
     {
       m_constantPowerIntake = constantPowerIntake;
+      m_coefficientsValid = false;
     }
 
 }
\ No newline at end of file
@@ -22,17 +22,46 @@
 #define ELECTRIC_VEHICLE_CONSUMPTION_MODEL_H
 
 #include "ns3/traced-value.h"
+#include "ns3/traced-callback.h"
 #include "consumption-model.h"
 #include "ns3/nstime.h"
 #include "ns3/event-id.h"
 #include "ns3/mobility-module.h"
-
-#define STANDARD_GRAVITY 9.80665
-#define DENSITY_AIR 1.2041
-#define JOULES_TO_WH 0.0002778
+#include "electric-vehicle-energy.h"
+#include "electric-vehicle-battery.h"
+#include "elevation-raster.h"
+#include "electric-vehicle-checkpoint-format.h"
 
 namespace ns3 {
 
+/**
+ * \ingroup consumption
+ * \brief State of an electric vehicle after an update of its consumption.
+ *
+ * Passed to the ConsumptionUpdate trace source, so the sinks do not need to
+ * look up the node or the model. The energy terms are the mechanical energy
+ * differences of the update before the efficiencies, and energyDiff is the
+ * energy taken from the battery.
+ */
+struct ElectricVehicleConsumptionUpdate
+{
+  uint32_t nodeId;              //!< node ID of the vehicle
+  Time time;                    //!< time of the update
+  Vector position;              //!< position in m
+  double speed;                 //!< speed in m/s
+  double potentialEnergy;       //!< potential energy difference in Wh
+  double kineticEnergy;         //!< kinetic energy difference in Wh
+  double rotationalEnergy;      //!< rotational energy difference in Wh
+  double airEnergy;             //!< air resistance loss in Wh
+  double rollEnergy;            //!< roll resistance loss in Wh
+  double radialEnergy;          //!< radial force friction loss in Wh
+  double auxiliaryEnergy;       //!< constant consumers in Wh
+  double energyDiff;            //!< energy consumed from the battery in the update in Wh
+  double remainingEnergy;       //!< remaining energy in Wh
+  double totalEnergyConsumed;   //!< total energy consumed in Wh
+  double energyFraction;        //!< remaining energy over the maximum battery capacity
+};
+
 /**
  * \ingroup consumption
  * \brief Model consumption of electric vehicle based on [1].
@@ -41,6 +70,8 @@ namespace ns3 {
  * The default values are set to zero.
  *
  * Energy consumed each update can be trace from the attribute RemainingEnergyWh.
+ * The ConsumptionUpdate trace source fires once per update, after the model
+ * is updated, with an ElectricVehicleConsumptionUpdate.
  *
  * The model requires several parameters for simulate consumption:
  * - InitialEnergyWh, initial energy when start the simulation, in Wh
@@ -75,14 +106,136 @@ namespace ns3 {
     */
     virtual void UpdateConsumption (void);
 
+    /**
+     * \brief Update the consumption only when the course of the vehicle changes.
+     *
+     * Connects the model to the CourseChange trace of the mobility model of
+     * its node. Between two changes of course the velocity is constant, so
+     * the energy of each constant-velocity segment is integrated analytically
+     * (see ElectricVehicleSegmentEnergyDiff) when the segment ends, and no
+     * periodic update is needed. All the changes of course at the same time
+     * are integrated together once they have all happened.
+     *
+     * The node and the mobility model must be set before calling this method.
+     */
+    void StartCourseChangeUpdate (void);
+
+    /**
+     * \returns true if the model is updated on changes of course.
+     */
+    bool IsCourseChangeUpdate (void) const;
+
+    /**
+     * \brief Integrate the consumption of the current constant-velocity segment until now.
+     *
+     * Only used when the model is updated on changes of course. It is called
+     * automatically after each change of course, and can be called at the
+     * end of the simulation to account for the last segment.
+     */
+    void IntegrateConsumption (void);
+
+    /**
+     * \param energyDiff energy demanded by the vehicle in the update, in Wh.
+     * \param duration duration of the update in seconds.
+     * \returns energy consumed from the battery in the update, in Wh.
+     *
+     * Decreases the remaining energy and accounts the consumption of an
+     * update. With a battery pack model (see SetBattery) the energy demanded
+     * is converted into the energy taken from the cells, otherwise it is
+     * taken as is.
+     */
+    double DrawEnergy (double energyDiff, double duration);
+
+    /**
+     * \param energy energy offered by a charger, in Wh.
+     * \param duration duration of the charge in seconds.
+     * \returns energy taken from the charger, in Wh.
+     *
+     * Increases the remaining energy, up to the capacity of the battery.
+     * With a battery pack model (see SetBattery) the energy stored is what
+     * reaches the cells, at the charging current the pack accepts,
+     * otherwise the energy taken is stored as is.
+     */
+    double Charge (double energy, double duration);
+
+    /**
+     * \param [out] record state of the vehicle: energies, last update, and
+     *        position and velocity of its mobility model.
+     */
+    void SaveState (ElectricVehicleCheckpointRecord &record);
+
+    /**
+     * \param record state saved by SaveState.
+     *
+     * Restores the state of the vehicle, but not the one of its mobility
+     * model. If the model is updated on changes of course and the saved
+     * state had a change of course pending, it is integrated now.
+     */
+    void RestoreState (const ElectricVehicleCheckpointRecord &record);
+
+    /**
+     * \param battery battery pack model of the vehicle, or 0 to take the
+     *        energy demanded directly from the remaining energy.
+     */
+    void SetBattery (Ptr<ElectricVehicleBattery> battery);
+
+    /**
+     * \returns battery pack model of the vehicle, or 0.
+     */
+    Ptr<ElectricVehicleBattery> GetBattery (void) const;
+
+    /**
+     * \param elevation elevation raster giving the height of the positions
+     *        of the vehicle, or 0 to use their z coordinate.
+     *
+     * Must be set after the mobility model and before the first update, as
+     * the height of the current position is taken as the last height.
+     */
+    void SetElevation (Ptr<ElevationRaster> elevation);
+
+    /**
+     * \returns elevation raster of the vehicle, or 0.
+     */
+    Ptr<ElevationRaster> GetElevation (void) const;
+
+    /**
+     * \param terms energy differences of the update by term, in Ws.
+     * \param energyDiff energy consumed from the battery in the update, in Wh.
+     *
+     * Fires the ConsumptionUpdate trace source. Called at the end of each
+     * update, by the model itself or by the ElectricVehicleFleet updating it.
+     */
+    void NotifyConsumptionUpdate (const ElectricVehicleEnergyTerms &terms, double energyDiff);
+
+    /**
+     * \returns the constant factors of the energy terms of the vehicle,
+     *          computed from its parameters when they change.
+     */
+    const ElectricVehicleCoefficients & GetCoefficients (void);
+
+    /**
+     * TracedCallback signature for consumption updates.
+     *
+     * \param [in] update state of the vehicle after the update.
+     */
+    typedef void (* ConsumptionUpdateCallback)(const ElectricVehicleConsumptionUpdate &update);
+
   private:
 
     /**
+     * Called by the CourseChange trace of the mobility model.
+     *
+     * \param mobility the mobility model which changed its course.
+     */
+    void NotifyCourseChange (Ptr<const MobilityModel> mobility);
+
+    /**
+     * \param terms set to the energy differences by term, in Ws.
      * \returns Double with the difference of battery energy between a moment [k] and [k + 1]
      *
      * \brief Calculate the diferrence of battery energy. 
      */
-    double CalculateEnergyDiff (void);
+    double CalculateEnergyDiff (ElectricVehicleEnergyTerms &terms);
 
     /**
      * Save the position and velocity of the momento to use in the next update
@@ -90,6 +243,12 @@ namespace ns3 {
     */
     void SaveLastPosAndVel (void);
 
+    /**
+     * \returns position of the vehicle, with the height of the elevation
+     *          raster as z if there is one.
+     */
+    Vector GetVehiclePosition (void);
+
     /**
      * \returns Double distance in meters between two position vectors.
      *
@@ -196,7 +355,11 @@ namespace ns3 {
     double GetVelocity (void);
 
     double GetVelocity (Vector vel);
-    
+
+    double GetLastAngle (void);
+
+    void SetLastAngle (double lastAngle);
+
   private:
     double m_initialEnergyWh;                     // initial energy in Wh
     TracedValue<double> m_remainingEnergyWh;      // remaining energy in Wh
@@ -214,6 +377,13 @@ namespace ns3 {
     double m_recuperationEfficiency;              // recuperation efficiency factor
     double m_lastAngle;                           // last angle of vehicle in degrees
     Time m_timeFromLastUpdate;
+    bool m_courseChangeUpdate;                    // update only on changes of course
+    bool m_courseChangePending;                   // integration scheduled for the current time
+    TracedCallback<const ElectricVehicleConsumptionUpdate &> m_consumptionUpdateTrace; // fired after each update
+    ElectricVehicleCoefficients m_coefficients;   // factors of the energy terms
+    bool m_coefficientsValid;                     // m_coefficients match the parameters
+    Ptr<ElectricVehicleBattery> m_battery;        // battery pack model, or 0
+    Ptr<ElevationRaster> m_elevation;             // height of the positions, or 0
   };
 
 } // namespace ns3
@@ -0,0 +1,432 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#ifndef ELECTRIC_VEHICLE_ENERGY_H
+#define ELECTRIC_VEHICLE_ENERGY_H
+
+#include <cmath>
+#include <limits>
+
+#include "ns3/vector.h"
+
+#define STANDARD_GRAVITY 9.80665
+#define DENSITY_AIR 1.2041
+#define JOULES_TO_WH 0.0002778
+
+namespace ns3 {
+
+/**
+ * \ingroup consumption
+ *
+ * \param vel velocity vector in m/s.
+ * \returns the speed (module of the velocity) in m/s.
+ */
+inline double
+ElectricVehicleSpeed (const Vector &vel)
+{
+  return std::sqrt (vel.x * vel.x + vel.y * vel.y + vel.z * vel.z);
+}
+
+/**
+ * \ingroup consumption
+ *
+ * \param vel velocity vector in m/s.
+ * \returns the steering angle of the vehicle in radians.
+ */
+inline double
+ElectricVehicleAngle (const Vector &vel)
+{
+  return std::atan2 (vel.y, vel.x);
+}
+
+/**
+ * \ingroup consumption
+ *
+ * \param lastAngle steering angle at the last update, infinity if there is none.
+ * \param angle current steering angle.
+ * \returns the steering angle difference normalized to [-pi, pi], 0 if
+ *          there is no previous angle.
+ */
+inline double
+ElectricVehicleAngleDiff (double lastAngle, double angle)
+{
+  if (lastAngle == std::numeric_limits<double>::infinity ())
+    {
+      return 0.;
+    }
+  double dtheta = angle - lastAngle;
+  while (dtheta > (double) M_PI)
+    {
+      dtheta -= (double)(2.0 * M_PI);
+    }
+  while (dtheta < (double) - M_PI)
+    {
+      dtheta += (double)(2.0 * M_PI);
+    }
+  return dtheta;
+}
+
+/**
+ * \ingroup consumption
+ * \brief Energy differences of an electric vehicle by term, in Ws.
+ *
+ * The terms are the mechanical energy before the propulsion and
+ * recuperation efficiencies are applied. Their sum, in this order, is the
+ * energy difference the efficiencies are applied to.
+ */
+struct ElectricVehicleEnergyTerms
+{
+  double potential;   //!< potential energy difference
+  double kinetic;     //!< kinetic energy difference
+  double rotational;  //!< rotational energy difference of the internal rotating elements
+  double air;         //!< air resistance loss
+  double roll;        //!< roll resistance loss
+  double radial;      //!< loss by friction of the radial force
+  double auxiliary;   //!< constant consumers (e.g. A/C)
+};
+
+/**
+ * \ingroup consumption
+ * \brief Constant factors of the energy terms of a vehicle type.
+ *
+ * Each factor is the product of the vehicle parameters and constants of a
+ * term, computed once per vehicle type instead of on every update. They are
+ * multiplied in the same order as in the expanded expressions, so the
+ * results are bit-identical.
+ */
+struct ElectricVehicleCoefficients
+{
+  double potential;               //!< m * g
+  double kinetic;                 //!< 0.5 * m
+  double rotational;              //!< internal moment of inertia
+  double air;                     //!< 0.5 * rho_air * A * Cd
+  double roll;                    //!< c_R * g * m
+  double radial;                  //!< c_rad * m
+  double auxiliary;               //!< constant power intake
+  double propulsionEfficiency;
+  double recuperationEfficiency;
+};
+
+/**
+ * \ingroup consumption
+ * \returns the coefficients of a vehicle with the given parameters.
+ */
+inline ElectricVehicleCoefficients
+ElectricVehicleMakeCoefficients (double vehicleMass,
+                                 double frontSurfaceArea,
+                                 double airDragCoefficient,
+                                 double internalMomentOfInertia,
+                                 double radialDragCoefficient,
+                                 double rollDragCoefficient,
+                                 double constantPowerIntake,
+                                 double propulsionEfficiency,
+                                 double recuperationEfficiency)
+{
+  ElectricVehicleCoefficients c;
+  c.potential = vehicleMass * STANDARD_GRAVITY;
+  c.kinetic = 0.5 * vehicleMass;
+  c.rotational = internalMomentOfInertia;
+  c.air = 0.5 * DENSITY_AIR * frontSurfaceArea * airDragCoefficient;
+  c.roll = rollDragCoefficient * STANDARD_GRAVITY * vehicleMass;
+  c.radial = radialDragCoefficient * vehicleMass;
+  c.auxiliary = constantPowerIntake;
+  c.propulsionEfficiency = propulsionEfficiency;
+  c.recuperationEfficiency = recuperationEfficiency;
+  return c;
+}
+
+/**
+ * \ingroup consumption
+ * \brief Difference of battery energy of an electric vehicle between two updates.
+ *
+ * This is the physics of ElectricVehicleConsumptionModel written as a pure
+ * function of plain values, so the same code is used by the per-vehicle model
+ * and by the batched ElectricVehicleFleet kernel, and both produce identical
+ * results.
+ *
+ * The kernel is specialized at compile time: without RADIAL the radial
+ * friction loss is not computed (the radial coefficient is 0), and without
+ * ELEVATION the potential energy is not computed (the height did not
+ * change). Both give the same results as the full kernel in those cases.
+ *
+ * \param c coefficients of the vehicle.
+ * \param terms set to the energy differences by term, in Ws.
+ * \returns the energy difference in Wh between the last update and now.
+ */
+template <bool RADIAL, bool ELEVATION>
+inline double
+ElectricVehicleEnergyDiff (const ElectricVehicleCoefficients &c,
+                           double velocityNow,
+                           double lastVelocity,
+                           double heightNow,
+                           double lastHeight,
+                           double angleDiff,
+                           double timeFromLastUpdate,
+                           ElectricVehicleEnergyTerms &terms)
+{
+  double distanceCovered = velocityNow * timeFromLastUpdate;
+  double squaredVelocityDiff = velocityNow * velocityNow - lastVelocity * lastVelocity;
+
+  // calculate potential energy difference
+  terms.potential = ELEVATION ? c.potential * (heightNow - lastHeight) : 0.;
+
+  // kinetic energy difference of vehicle
+  terms.kinetic = c.kinetic * squaredVelocityDiff;
+
+  // add rotational energy diff of internal rotating elements
+  terms.rotational = c.rotational * squaredVelocityDiff;
+
+  // Energy loss through Air resistance [Ws]
+  // Calculate energy losses:
+  // EnergyLoss,Air = 1/2 * rho_air [kg/m^3] * myFrontSurfaceArea [m^2] * myAirDragCoefficient [-] * v_Veh^2 [m/s] * s [m]
+  //                    ... with rho_air [kg/m^3] = 1,2041 kg/m^3 (at T = 20C)
+  //                    ... with s [m] = v_Veh [m/s] * TS [s]
+  terms.air = c.air * velocityNow * velocityNow * distanceCovered;
+
+  // Energy loss through Roll resistance [Ws]
+  //                    ... (fabs(veh.getSpeed())>=0.01) = 0, if vehicle isn't moving
+  // EnergyLoss,Tire = c_R [-] * F_N [N] * s [m]
+  //                    ... with c_R = ~0.012    (car tire on asphalt)
+  //                    ... with F_N [N] = myMass [kg] * g [m/s^2]
+  terms.roll = c.roll * distanceCovered;
+
+  // Energy loss through friction by radial force [Ws]
+  // If angle of vehicle was changed
+  terms.radial = 0.;
+  if (RADIAL && angleDiff != 0.)
+    {
+      // Compute new radio
+      double radius = distanceCovered / std::fabs (angleDiff);
+
+      // Check if radius is in the interval [0.0001 - 10000] (To avoid overflow and division by zero)
+      if (radius < 0.0001)
+        {
+          radius = 0.0001;
+        }
+      else if (radius > 10000)
+        {
+          radius = 10000;
+        }
+
+      // EnergyLoss,internalFrictionRadialForce = c [m] * F_rad [N];
+      // Energy loss through friction by radial force [Ws]
+      terms.radial = c.radial * velocityNow * velocityNow / radius;
+    }
+
+  // EnergyLoss,constantConsumers
+  // Energy loss through constant loads (e.g. A/C) [Ws]
+  terms.auxiliary = c.auxiliary;
+
+  //E_Bat = E_kin_pot + EnergyLoss;
+  double energyDiff = terms.potential + terms.kinetic + terms.rotational + terms.air
+    + terms.roll + terms.radial + terms.auxiliary;
+  if (energyDiff > 0)
+    {
+      energyDiff /= c.propulsionEfficiency;
+    }
+  else
+    {
+      energyDiff += c.recuperationEfficiency;
+    }
+
+  // convert from [Ws] to [Wh] (3600s / 1h):
+  return energyDiff / 3600;
+}
+
+/**
+ * \ingroup consumption
+ * \brief Difference of battery energy of an electric vehicle between two updates.
+ *
+ * Selects the specialized kernel for the coefficients and heights.
+ *
+ * \param c coefficients of the vehicle.
+ * \param terms set to the energy differences by term, in Ws.
+ * \returns the energy difference in Wh between the last update and now.
+ */
+inline double
+ElectricVehicleEnergyDiff (const ElectricVehicleCoefficients &c,
+                           double velocityNow,
+                           double lastVelocity,
+                           double heightNow,
+                           double lastHeight,
+                           double angleDiff,
+                           double timeFromLastUpdate,
+                           ElectricVehicleEnergyTerms &terms)
+{
+  if (c.radial != 0.)
+    {
+      if (heightNow != lastHeight)
+        {
+          return ElectricVehicleEnergyDiff<true, true> (c, velocityNow, lastVelocity, heightNow, lastHeight,
+                                                        angleDiff, timeFromLastUpdate, terms);
+        }
+      return ElectricVehicleEnergyDiff<true, false> (c, velocityNow, lastVelocity, heightNow, lastHeight,
+                                                     angleDiff, timeFromLastUpdate, terms);
+    }
+  if (heightNow != lastHeight)
+    {
+      return ElectricVehicleEnergyDiff<false, true> (c, velocityNow, lastVelocity, heightNow, lastHeight,
+                                                     angleDiff, timeFromLastUpdate, terms);
+    }
+  return ElectricVehicleEnergyDiff<false, false> (c, velocityNow, lastVelocity, heightNow, lastHeight,
+                                                  angleDiff, timeFromLastUpdate, terms);
+}
+
+/**
+ * \ingroup consumption
+ * \brief Difference of battery energy of an electric vehicle between two updates.
+ *
+ * Same as the version with the coefficients, for a single update.
+ *
+ * \returns the energy difference in Wh between the last update and now.
+ */
+inline double
+ElectricVehicleEnergyDiff (double vehicleMass,
+                           double frontSurfaceArea,
+                           double airDragCoefficient,
+                           double internalMomentOfInertia,
+                           double radialDragCoefficient,
+                           double rollDragCoefficient,
+                           double constantPowerIntake,
+                           double propulsionEfficiency,
+                           double recuperationEfficiency,
+                           double velocityNow,
+                           double lastVelocity,
+                           double heightNow,
+                           double lastHeight,
+                           double angleDiff,
+                           double timeFromLastUpdate)
+{
+  ElectricVehicleEnergyTerms terms;
+  ElectricVehicleCoefficients c = ElectricVehicleMakeCoefficients (vehicleMass, frontSurfaceArea, airDragCoefficient,
+                                                                   internalMomentOfInertia, radialDragCoefficient,
+                                                                   rollDragCoefficient, constantPowerIntake,
+                                                                   propulsionEfficiency, recuperationEfficiency);
+  return ElectricVehicleEnergyDiff<true, true> (c, velocityNow, lastVelocity, heightNow, lastHeight,
+                                                angleDiff, timeFromLastUpdate, terms);
+}
+
+/**
+ * \ingroup consumption
+ * \brief Difference of battery energy of an electric vehicle over a segment
+ * of constant velocity followed by a change of course.
+ *
+ * The vehicle moved at segmentVelocity during segmentDuration seconds and
+ * then changed instantly to velocityNow (and maybe to another height and
+ * heading). The losses of the segment are integrated analytically, so the
+ * result does not depend on any sampling period. The constant power intake
+ * is a power in W applied during the segment, and the recuperated energy is
+ * scaled by the recuperation efficiency.
+ *
+ * \param terms set to the energy differences by term, in Ws.
+ * \returns the energy difference in Wh over the segment and the change of course.
+ */
+inline double
+ElectricVehicleSegmentEnergyDiff (const ElectricVehicleCoefficients &c,
+                                  double segmentVelocity,
+                                  double velocityNow,
+                                  double heightNow,
+                                  double lastHeight,
+                                  double angleDiff,
+                                  double segmentDuration,
+                                  ElectricVehicleEnergyTerms &terms)
+{
+  double distanceCovered = segmentVelocity * segmentDuration;
+
+  // potential energy difference
+  terms.potential = c.potential * (heightNow - lastHeight);
+
+  // kinetic and rotational energy difference at the change of course
+  terms.kinetic = c.kinetic * (velocityNow * velocityNow - segmentVelocity * segmentVelocity);
+  terms.rotational = c.rotational * (velocityNow * velocityNow - segmentVelocity * segmentVelocity);
+
+  // air and roll resistance over the segment [Ws]
+  terms.air = c.air * segmentVelocity * segmentVelocity * distanceCovered;
+  terms.roll = c.roll * distanceCovered;
+
+  // friction by radial force when the heading changes after covering some distance
+  terms.radial = 0.;
+  if (angleDiff != 0. && distanceCovered > 0.)
+    {
+      double radius = distanceCovered / std::fabs (angleDiff);
+      if (radius < 0.0001)
+        {
+          radius = 0.0001;
+        }
+      else if (radius > 10000)
+        {
+          radius = 10000;
+        }
+      terms.radial = c.radial * velocityNow * velocityNow / radius;
+    }
+
+  // constant loads (e.g. A/C) during the segment [Ws]
+  terms.auxiliary = c.auxiliary * segmentDuration;
+
+  double energyDiff = terms.potential + terms.kinetic + terms.rotational + terms.air
+    + terms.roll + terms.radial + terms.auxiliary;
+
+  if (energyDiff > 0)
+    {
+      energyDiff /= c.propulsionEfficiency;
+    }
+  else
+    {
+      energyDiff *= c.recuperationEfficiency;
+    }
+
+  // convert from [Ws] to [Wh] (3600s / 1h):
+  return energyDiff / 3600;
+}
+
+/**
+ * \ingroup consumption
+ * \brief ElectricVehicleSegmentEnergyDiff with the parameters of the vehicle
+ * instead of its coefficients.
+ */
+inline double
+ElectricVehicleSegmentEnergyDiff (double vehicleMass,
+                                  double frontSurfaceArea,
+                                  double airDragCoefficient,
+                                  double internalMomentOfInertia,
+                                  double radialDragCoefficient,
+                                  double rollDragCoefficient,
+                                  double constantPowerIntake,
+                                  double propulsionEfficiency,
+                                  double recuperationEfficiency,
+                                  double segmentVelocity,
+                                  double velocityNow,
+                                  double heightNow,
+                                  double lastHeight,
+                                  double angleDiff,
+                                  double segmentDuration,
+                                  ElectricVehicleEnergyTerms &terms)
+{
+  ElectricVehicleCoefficients c = ElectricVehicleMakeCoefficients (vehicleMass, frontSurfaceArea, airDragCoefficient,
+                                                                   internalMomentOfInertia, radialDragCoefficient,
+                                                                   rollDragCoefficient, constantPowerIntake,
+                                                                   propulsionEfficiency, recuperationEfficiency);
+  return ElectricVehicleSegmentEnergyDiff (c, segmentVelocity, velocityNow, heightNow, lastHeight,
+                                           angleDiff, segmentDuration, terms);
+}
+
+} // namespace ns3
+
+#endif /* ELECTRIC_VEHICLE_ENERGY_H */
@@ -0,0 +1,540 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/uinteger.h"
+#include "ns3/pointer.h"
+#include "ns3/string.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/simulator.h"
+#include "ns3/rng-seed-manager.h"
+#include "electric-vehicle-ensemble.h"
+
+namespace ns3 {
+
+  NS_LOG_COMPONENT_DEFINE ("ElectricVehicleEnsemble");
+
+  NS_OBJECT_ENSURE_REGISTERED (ElectricVehicleEnsemble);
+
+  ElectricVehicleRunningStatistics::ElectricVehicleRunningStatistics (const std::vector<double> &probabilities)
+    : m_count (0),
+      m_mean (0),
+      m_m2 (0)
+  {
+    m_markers.resize (probabilities.size ());
+    for (uint32_t i = 0; i < probabilities.size (); i++)
+    {
+      double p = probabilities[i];
+      NS_ASSERT (p > 0 && p < 1);
+      Markers &markers = m_markers[i];
+      markers.p = p;
+      for (int j = 0; j < 5; j++)
+      {
+        markers.height[j] = 0;
+        markers.position[j] = j + 1;
+      }
+      markers.desired[0] = 1;
+      markers.desired[1] = 1 + 2 * p;
+      markers.desired[2] = 1 + 4 * p;
+      markers.desired[3] = 3 + 2 * p;
+      markers.desired[4] = 5;
+      markers.increment[0] = 0;
+      markers.increment[1] = p / 2;
+      markers.increment[2] = p;
+      markers.increment[3] = (1 + p) / 2;
+      markers.increment[4] = 1;
+    }
+  }
+
+  void
+  ElectricVehicleRunningStatistics::Add (double value)
+  {
+    m_count++;
+    double delta = value - m_mean;
+    m_mean += delta / m_count;
+    m_m2 += delta * (value - m_mean);
+
+    if (m_count <= 5)
+    {
+      m_first[m_count - 1] = value;
+      if (m_count == 5)
+      {
+        std::sort (m_first, m_first + 5);
+        for (uint32_t i = 0; i < m_markers.size (); i++)
+        {
+          std::copy (m_first, m_first + 5, m_markers[i].height);
+        }
+      }
+      return;
+    }
+
+    for (uint32_t i = 0; i < m_markers.size (); i++)
+    {
+      Markers &m = m_markers[i];
+      double *q = m.height;
+      double *n = m.position;
+
+      // cell of the value, extending the extreme markers
+      int k;
+      if (value < q[0])
+      {
+        q[0] = value;
+        k = 0;
+      }
+      else if (value >= q[4])
+      {
+        q[4] = value;
+        k = 3;
+      }
+      else
+      {
+        k = 0;
+        while (value >= q[k + 1])
+        {
+          k++;
+        }
+      }
+      for (int j = k + 1; j < 5; j++)
+      {
+        n[j]++;
+      }
+      for (int j = 0; j < 5; j++)
+      {
+        m.desired[j] += m.increment[j];
+      }
+
+      // move the middle markers towards their desired positions
+      for (int j = 1; j < 4; j++)
+      {
+        double d = m.desired[j] - n[j];
+        if ((d >= 1 && n[j + 1] - n[j] > 1) || (d <= -1 && n[j - 1] - n[j] < -1))
+        {
+          double s = d > 0 ? 1 : -1;
+          double parabolic = q[j] + s / (n[j + 1] - n[j - 1])
+            * ((n[j] - n[j - 1] + s) * (q[j + 1] - q[j]) / (n[j + 1] - n[j])
+               + (n[j + 1] - n[j] - s) * (q[j] - q[j - 1]) / (n[j] - n[j - 1]));
+          if (q[j - 1] < parabolic && parabolic < q[j + 1])
+          {
+            q[j] = parabolic;
+          }
+          else
+          {
+            int t = j + (int) s;
+            q[j] += s * (q[t] - q[j]) / (n[t] - n[j]);
+          }
+          n[j] += s;
+        }
+      }
+    }
+  }
+
+  uint64_t
+  ElectricVehicleRunningStatistics::GetCount (void) const
+  {
+    return m_count;
+  }
+
+  double
+  ElectricVehicleRunningStatistics::GetMean (void) const
+  {
+    return m_mean;
+  }
+
+  double
+  ElectricVehicleRunningStatistics::GetVariance (void) const
+  {
+    return m_count > 1 ? m_m2 / (m_count - 1) : 0;
+  }
+
+  uint32_t
+  ElectricVehicleRunningStatistics::GetNQuantiles (void) const
+  {
+    return m_markers.size ();
+  }
+
+  double
+  ElectricVehicleRunningStatistics::GetProbability (uint32_t i) const
+  {
+    NS_ASSERT (i < m_markers.size ());
+    return m_markers[i].p;
+  }
+
+  double
+  ElectricVehicleRunningStatistics::GetQuantile (uint32_t i) const
+  {
+    NS_ASSERT (i < m_markers.size ());
+    if (m_count == 0)
+    {
+      return 0;
+    }
+    if (m_count >= 5)
+    {
+      return m_markers[i].height[2];
+    }
+    // exact, nearest rank of the few values
+    double sorted[5];
+    std::copy (m_first, m_first + m_count, sorted);
+    std::sort (sorted, sorted + m_count);
+    return sorted[(uint32_t) std::floor (m_markers[i].p * (m_count - 1) + 0.5)];
+  }
+
+  TypeId
+  ElectricVehicleEnsemble::GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::ElectricVehicleEnsemble")
+      .SetParent<Object> ()
+      .SetGroupName ("Consumption")
+      .AddConstructor<ElectricVehicleEnsemble> ()
+      .AddAttribute ("Replications",
+                     "Number of replications of the simulation.",
+                     UintegerValue (100),
+                     MakeUintegerAccessor (&ElectricVehicleEnsemble::m_replications),
+                     MakeUintegerChecker<uint32_t> (1))
+      .AddAttribute ("Workers",
+                     "Number of replications run in parallel, each one in its own process.",
+                     UintegerValue (1),
+                     MakeUintegerAccessor (&ElectricVehicleEnsemble::m_workers),
+                     MakeUintegerChecker<uint32_t> (1))
+      .AddAttribute ("MassFactor",
+                     "Factor of the mass of each vehicle in a replication.",
+                     StringValue ("ns3::NormalRandomVariable[Mean=1.0|Variance=0.0025]"),
+                     MakePointerAccessor (&ElectricVehicleEnsemble::m_massFactor),
+                     MakePointerChecker<RandomVariableStream> ())
+      .AddAttribute ("PowerIntakeFactor",
+                     "Factor of the constant power intake of each vehicle in a replication.",
+                     StringValue ("ns3::NormalRandomVariable[Mean=1.0|Variance=0.04]"),
+                     MakePointerAccessor (&ElectricVehicleEnsemble::m_powerIntakeFactor),
+                     MakePointerChecker<RandomVariableStream> ())
+    ;
+    return tid;
+  }
+
+  /**
+   * \returns the probabilities of the quantiles of the statistics.
+   */
+  static std::vector<double>
+  EnsembleProbabilities (void)
+  {
+    std::vector<double> probabilities;
+    probabilities.push_back (0.05);
+    probabilities.push_back (0.5);
+    probabilities.push_back (0.95);
+    return probabilities;
+  }
+
+  ElectricVehicleEnsemble::ElectricVehicleEnsemble ()
+    : m_replications (100),
+      m_workers (1),
+      m_stream (-1),
+      m_failed (0)
+  {
+    NS_LOG_FUNCTION (this);
+  }
+
+  ElectricVehicleEnsemble::~ElectricVehicleEnsemble ()
+  {
+    NS_LOG_FUNCTION (this);
+  }
+
+  void
+  ElectricVehicleEnsemble::DoDispose (void)
+  {
+    NS_LOG_FUNCTION (this);
+    m_models.clear ();
+    m_fleet = 0;
+    Object::DoDispose ();
+  }
+
+  void
+  ElectricVehicleEnsemble::Install (Ptr<ElectricVehicleConsumptionModel> model)
+  {
+    NS_LOG_FUNCTION (this << model);
+    m_models.push_back (model);
+    m_mass.push_back (model->GetVehicleMass ());
+    m_powerIntake.push_back (model->GetConstantPowerIntake ());
+    m_totalEnergy.push_back (ElectricVehicleRunningStatistics (EnsembleProbabilities ()));
+    m_energyFraction.push_back (ElectricVehicleRunningStatistics (EnsembleProbabilities ()));
+  }
+
+  void
+  ElectricVehicleEnsemble::InstallAll (void)
+  {
+    NS_LOG_FUNCTION (this);
+    for (uint32_t i = 0; i < NodeList::GetNNodes (); i++)
+    {
+      Ptr<ElectricVehicleConsumptionModel> model = NodeList::GetNode (i)->GetObject<ElectricVehicleConsumptionModel> ();
+      if (model != NULL)
+      {
+        Install (model);
+      }
+    }
+  }
+
+  void
+  ElectricVehicleEnsemble::SetFleet (Ptr<ElectricVehicleFleet> fleet)
+  {
+    NS_LOG_FUNCTION (this << fleet);
+    m_fleet = fleet;
+  }
+
+  int64_t
+  ElectricVehicleEnsemble::AssignStreams (int64_t stream)
+  {
+    NS_LOG_FUNCTION (this << stream);
+    m_stream = stream;
+    return 2;
+  }
+
+  uint32_t
+  ElectricVehicleEnsemble::GetN (void) const
+  {
+    return m_models.size ();
+  }
+
+  Ptr<ElectricVehicleConsumptionModel>
+  ElectricVehicleEnsemble::GetVehicle (uint32_t i) const
+  {
+    NS_ASSERT (i < m_models.size ());
+    return m_models[i];
+  }
+
+  const ElectricVehicleRunningStatistics &
+  ElectricVehicleEnsemble::GetTotalEnergyConsumed (uint32_t i) const
+  {
+    NS_ASSERT (i < m_totalEnergy.size ());
+    return m_totalEnergy[i];
+  }
+
+  const ElectricVehicleRunningStatistics &
+  ElectricVehicleEnsemble::GetEnergyFraction (uint32_t i) const
+  {
+    NS_ASSERT (i < m_energyFraction.size ());
+    return m_energyFraction[i];
+  }
+
+  uint32_t
+  ElectricVehicleEnsemble::GetNFailed (void) const
+  {
+    return m_failed;
+  }
+
+  void
+  ElectricVehicleEnsemble::RunReplication (uint32_t replication, int fd)
+  {
+    // independent streams for each replication
+    RngSeedManager::SetRun (RngSeedManager::GetRun () + replication);
+    m_massFactor->SetStream (m_stream >= 0 ? m_stream : -1);
+    m_powerIntakeFactor->SetStream (m_stream >= 0 ? m_stream + 1 : -1);
+
+    for (uint32_t i = 0; i < m_models.size (); i++)
+    {
+      double massFactor = m_massFactor->GetValue ();
+      while (massFactor <= 0)
+      {
+        massFactor = m_massFactor->GetValue ();
+      }
+      m_models[i]->SetVehicleMass (m_mass[i] * massFactor);
+      m_models[i]->SetConstantPowerIntake (m_powerIntake[i] * std::max (m_powerIntakeFactor->GetValue (), 0.));
+    }
+    if (m_fleet != NULL)
+    {
+      m_fleet->Refresh ();
+    }
+
+    Simulator::Run ();
+
+    std::vector<double> results;
+    results.reserve (2 * m_models.size ());
+    for (uint32_t i = 0; i < m_models.size (); i++)
+    {
+      // account for the last constant-velocity segment
+      if (m_models[i]->IsCourseChangeUpdate ())
+      {
+        m_models[i]->IntegrateConsumption ();
+      }
+      results.push_back (m_models[i]->GetTotalEnergyConsumed ());
+      results.push_back (m_models[i]->GetEnergyFraction ());
+    }
+
+    const char *data = (const char *) results.data ();
+    size_t size = results.size () * sizeof (double);
+    while (size > 0)
+    {
+      ssize_t written = write (fd, data, size);
+      if (written < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      if (written <= 0)
+      {
+        _exit (1);
+      }
+      data += written;
+      size -= written;
+    }
+    close (fd);
+  }
+
+  void
+  ElectricVehicleEnsemble::Run (void)
+  {
+    NS_LOG_FUNCTION (this);
+    NS_ASSERT_MSG (m_fleet == NULL || m_fleet->GetThreads () == 1,
+                   "The threads of a fleet do not survive in the replications, use a single one");
+
+    /**
+     * A running replication.
+     */
+    struct Worker
+    {
+      uint32_t replication;
+      pid_t pid;
+      int fd;
+      std::vector<char> results;
+    };
+
+    size_t resultsSize = 2 * m_models.size () * sizeof (double);
+    std::vector<Worker> workers;
+    uint32_t next = 0;
+    // finished replications are aggregated in order, so the quantile
+    // estimates do not depend on the number of workers
+    std::map<uint32_t, std::vector<double> > finished;
+    uint32_t aggregated = 0;
+
+    // the children must not write again what the parent has buffered
+    std::cout.flush ();
+    std::cerr.flush ();
+    std::fflush (0);
+
+    while (next < m_replications || !workers.empty ())
+    {
+      while (next < m_replications && workers.size () < m_workers)
+      {
+        int fds[2];
+        if (pipe (fds) != 0)
+        {
+          NS_FATAL_ERROR ("Could not create a pipe for replication " << next << ", aborting here \n");
+        }
+        pid_t pid = fork ();
+        if (pid < 0)
+        {
+          NS_FATAL_ERROR ("Could not fork replication " << next << ", aborting here \n");
+        }
+        if (pid == 0)
+        {
+          close (fds[0]);
+          RunReplication (next, fds[1]);
+          _exit (0);
+        }
+        close (fds[1]);
+        Worker worker;
+        worker.replication = next;
+        worker.pid = pid;
+        worker.fd = fds[0];
+        workers.push_back (worker);
+        next++;
+      }
+
+      std::vector<struct pollfd> polled (workers.size ());
+      for (uint32_t i = 0; i < workers.size (); i++)
+      {
+        polled[i].fd = workers[i].fd;
+        polled[i].events = POLLIN;
+        polled[i].revents = 0;
+      }
+      if (poll (polled.data (), polled.size (), -1) < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+        NS_FATAL_ERROR ("Could not wait for the replications, aborting here \n");
+      }
+
+      for (uint32_t i = workers.size (); i-- > 0; )
+      {
+        if (polled[i].revents == 0)
+        {
+          continue;
+        }
+        Worker &worker = workers[i];
+        char buffer[65536];
+        ssize_t n = read (worker.fd, buffer, sizeof (buffer));
+        if (n < 0 && errno == EINTR)
+        {
+          continue;
+        }
+        if (n > 0)
+        {
+          worker.results.insert (worker.results.end (), buffer, buffer + n);
+          continue;
+        }
+
+        // end of the replication
+        close (worker.fd);
+        int status = 0;
+        while (waitpid (worker.pid, &status, 0) < 0 && errno == EINTR)
+        {
+        }
+        if (!WIFEXITED (status) || WEXITSTATUS (status) != 0 || worker.results.size () != resultsSize)
+        {
+          NS_LOG_ERROR ("Replication " << worker.replication << " failed, its results are ignored");
+          m_failed++;
+          finished[worker.replication];
+        }
+        else
+        {
+          std::vector<double> &results = finished[worker.replication];
+          results.resize (2 * m_models.size ());
+          std::memcpy (results.data (), worker.results.data (), resultsSize);
+        }
+        workers.erase (workers.begin () + i);
+      }
+
+      while (!finished.empty () && finished.begin ()->first == aggregated)
+      {
+        const std::vector<double> &results = finished.begin ()->second;
+        for (uint32_t j = 0; j < results.size () / 2; j++)
+        {
+          m_totalEnergy[j].Add (results[2 * j]);
+          m_energyFraction[j].Add (results[2 * j + 1]);
+        }
+        finished.erase (finished.begin ());
+        aggregated++;
+      }
+    }
+  }
+
+} // namespace ns3
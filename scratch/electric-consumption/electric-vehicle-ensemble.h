@@ -0,0 +1,225 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#ifndef ELECTRIC_VEHICLE_ENSEMBLE_H
+#define ELECTRIC_VEHICLE_ENSEMBLE_H
+
+#include <vector>
+
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/random-variable-stream.h"
+#include "electric-vehicle-consumption-model.h"
+#include "electric-vehicle-fleet.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup consumption
+ * \brief Running mean, variance and quantiles of a series of values, in
+ * constant memory.
+ *
+ * The mean and the variance use Welford's algorithm. Each quantile is
+ * estimated with the P-square algorithm (Jain and Chlamtac, 1985), which
+ * keeps five markers per quantile; it is exact up to five values.
+ */
+class ElectricVehicleRunningStatistics
+{
+public:
+  /**
+   * \param probabilities probabilities of the quantiles to estimate, in (0, 1).
+   */
+  ElectricVehicleRunningStatistics (const std::vector<double> &probabilities);
+
+  /**
+   * \param value next value of the series.
+   */
+  void Add (double value);
+
+  /**
+   * \returns number of values.
+   */
+  uint64_t GetCount (void) const;
+
+  /**
+   * \returns mean of the values.
+   */
+  double GetMean (void) const;
+
+  /**
+   * \returns sample variance of the values, 0 with less than two.
+   */
+  double GetVariance (void) const;
+
+  /**
+   * \returns number of quantiles.
+   */
+  uint32_t GetNQuantiles (void) const;
+
+  /**
+   * \param i index of the quantile.
+   * \returns probability of the quantile.
+   */
+  double GetProbability (uint32_t i) const;
+
+  /**
+   * \param i index of the quantile.
+   * \returns estimate of the quantile, 0 without values.
+   */
+  double GetQuantile (uint32_t i) const;
+
+private:
+  /**
+   * P-square markers of a quantile.
+   */
+  struct Markers
+  {
+    double p;                  // probability
+    double height[5];          // marker heights
+    double position[5];        // marker positions, from 1
+    double desired[5];         // desired marker positions
+    double increment[5];       // increment of the desired positions per value
+  };
+
+  uint64_t m_count;
+  double m_mean;
+  double m_m2;                 // sum of squared differences from the mean
+  double m_first[5];           // first values, until there are five
+  std::vector<Markers> m_markers;
+};
+
+/**
+ * \ingroup consumption
+ * \brief Monte-Carlo ensemble of replications of a fleet simulation whose
+ * vehicles differ in their parameters.
+ *
+ * The scenario is set up once: nodes, movements (e.g. the ns-2 trace) and
+ * vehicles (the attributes file) are installed and their events scheduled
+ * before Run is called. Each replication runs in a process forked from that
+ * state, so the parsed scenario is shared copy-on-write by all of them
+ * instead of being read again, and the Workers processes run in parallel.
+ *
+ * In a replication the mass of each vehicle is multiplied by a value of
+ * MassFactor and its constant power intake by a value of PowerIntakeFactor.
+ * Replication r uses the run number of the RngSeedManager plus r, so their
+ * random streams are independent. Random variables created before Run keep
+ * the streams of the parent process.
+ *
+ * Each replication only sends back the total energy consumed and the final
+ * energy fraction of each vehicle, which are aggregated online into
+ * ElectricVehicleRunningStatistics, so no trace of the replications is kept.
+ * Vehicles updated as a fleet must use a single thread, since the threads
+ * of the parent are not forked.
+ */
+class ElectricVehicleEnsemble : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ElectricVehicleEnsemble ();
+
+  virtual ~ElectricVehicleEnsemble ();
+
+  /**
+   * \param model consumption model of a vehicle of the ensemble.
+   */
+  void Install (Ptr<ElectricVehicleConsumptionModel> model);
+
+  /**
+   * Adds the consumption models of all the nodes of the global
+   * ns3::NodeList.
+   */
+  void InstallAll (void);
+
+  /**
+   * \param fleet fleet updating the vehicles, if they are updated as a fleet.
+   */
+  void SetFleet (Ptr<ElectricVehicleFleet> fleet);
+
+  /**
+   * \param stream first stream number to use.
+   * \returns the number of streams used.
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * Runs the replications until the simulation stops, see Simulator::Stop,
+   * and aggregates their results. The simulation of the calling process is
+   * not run.
+   */
+  void Run (void);
+
+  /**
+   * \returns number of installed vehicles.
+   */
+  uint32_t GetN (void) const;
+
+  /**
+   * \param i index of the vehicle, in installation order.
+   * \returns its consumption model.
+   */
+  Ptr<ElectricVehicleConsumptionModel> GetVehicle (uint32_t i) const;
+
+  /**
+   * \param i index of the vehicle, in installation order.
+   * \returns statistics of its total energy consumed in Wh.
+   */
+  const ElectricVehicleRunningStatistics & GetTotalEnergyConsumed (uint32_t i) const;
+
+  /**
+   * \param i index of the vehicle, in installation order.
+   * \returns statistics of its final energy fraction.
+   */
+  const ElectricVehicleRunningStatistics & GetEnergyFraction (uint32_t i) const;
+
+  /**
+   * \returns number of replications that failed.
+   */
+  uint32_t GetNFailed (void) const;
+
+private:
+  virtual void DoDispose (void);
+
+  /**
+   * \param replication index of the replication.
+   * \param fd pipe where the results are written.
+   *
+   * Runs a replication in a forked process.
+   */
+  void RunReplication (uint32_t replication, int fd);
+
+  uint32_t m_replications;                              // number of replications
+  uint32_t m_workers;                                   // replications run in parallel
+  Ptr<RandomVariableStream> m_massFactor;               // factor of the mass of each vehicle
+  Ptr<RandomVariableStream> m_powerIntakeFactor;        // factor of the constant power intake
+  int64_t m_stream;                                     // first assigned stream, -1 if none
+  std::vector<Ptr<ElectricVehicleConsumptionModel> > m_models;
+  std::vector<double> m_mass;                           // nominal mass of each vehicle
+  std::vector<double> m_powerIntake;                    // nominal power intake of each vehicle
+  Ptr<ElectricVehicleFleet> m_fleet;
+  std::vector<ElectricVehicleRunningStatistics> m_totalEnergy;
+  std::vector<ElectricVehicleRunningStatistics> m_energyFraction;
+  uint32_t m_failed;
+};
+
+} // namespace ns3
+
+#endif /* ELECTRIC_VEHICLE_ENSEMBLE_H */
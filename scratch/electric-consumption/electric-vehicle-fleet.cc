@@ -0,0 +1,479 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#include <algorithm>
+#include <map>
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "electric-vehicle-fleet.h"
+
+namespace ns3 {
+
+  NS_LOG_COMPONENT_DEFINE ("ElectricVehicleFleet");
+
+  NS_OBJECT_ENSURE_REGISTERED (ElectricVehicleFleet);
+
+  TypeId
+  ElectricVehicleFleet::GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::ElectricVehicleFleet")
+      .SetParent<Object> ()
+      .SetGroupName ("Consumption")
+      .AddConstructor<ElectricVehicleFleet> ()
+    ;
+    return tid;
+  }
+
+  ElectricVehicleFleet::ElectricVehicleFleet ()
+    : m_radial (false),
+      m_fleetElevation (0),
+      m_hasElevation (false),
+      m_threads (1),
+      m_parallelGather (false),
+      m_timeFromLastUpdate (0),
+      m_generation (0),
+      m_pendingChunks (0),
+      m_stopWorkers (false)
+  {
+    NS_LOG_FUNCTION (this);
+  }
+
+  ElectricVehicleFleet::~ElectricVehicleFleet ()
+  {
+    NS_LOG_FUNCTION (this);
+    StopWorkers ();
+  }
+
+  void
+  ElectricVehicleFleet::DoDispose (void)
+  {
+    NS_LOG_FUNCTION (this);
+    StopWorkers ();
+    m_models.clear ();
+    m_mobility.Clear ();
+    Object::DoDispose ();
+  }
+
+  void
+  ElectricVehicleFleet::AddVehicle (Ptr<ElectricVehicleConsumptionModel> model)
+  {
+    NS_LOG_FUNCTION (this << model);
+    NS_ASSERT (model != NULL);
+    NS_ASSERT (model->GetNode () != NULL);
+    NS_ASSERT (model->GetMobilityModel () != NULL);
+    m_models.push_back (model);
+  }
+
+  uint32_t
+  ElectricVehicleFleet::GetN (void) const
+  {
+    return m_models.size ();
+  }
+
+  Ptr<ElectricVehicleConsumptionModel>
+  ElectricVehicleFleet::Get (uint32_t i) const
+  {
+    NS_ASSERT (i < m_models.size ());
+    return m_models[i];
+  }
+
+  void
+  ElectricVehicleFleet::SetThreads (uint32_t threads)
+  {
+    NS_LOG_FUNCTION (this << threads);
+    NS_ASSERT_MSG (m_workers.empty (), "The number of threads must be set before the fleet is started");
+    m_threads = threads > 0 ? threads : 1;
+  }
+
+  uint32_t
+  ElectricVehicleFleet::GetThreads (void) const
+  {
+    return m_threads;
+  }
+
+  void
+  ElectricVehicleFleet::Build (void)
+  {
+    NS_LOG_FUNCTION (this);
+
+    uint32_t n = m_models.size ();
+    m_mobility.Clear ();
+    m_nodeIds.resize (n);
+    m_type.resize (n);
+    m_coefficients.clear ();
+    m_lastVelocity.resize (n);
+    m_lastHeight.resize (n);
+    m_lastAngle.resize (n);
+    m_position.resize (n);
+    m_velocity.resize (n);
+    m_velocityNow.resize (n);
+    m_heightNow.resize (n);
+    m_angleNow.resize (n);
+    m_angleDiff.resize (n);
+    m_energyDiff.resize (n);
+    m_terms.resize (n);
+    m_elevation.resize (n);
+
+    // one block of coefficients per distinct vehicle type
+    std::map<std::vector<double>, uint32_t> types;
+
+    m_parallelGather = true;
+    m_radial = false;
+    m_hasElevation = false;
+    for (uint32_t i = 0; i < n; i++)
+      {
+        Ptr<ElectricVehicleConsumptionModel> model = m_models[i];
+        m_mobility.Add (model->GetMobilityModel ());
+        m_nodeIds[i] = model->GetNode ()->GetId ();
+        const ElectricVehicleCoefficients &c = model->GetCoefficients ();
+        double key[] = { c.potential, c.kinetic, c.rotational, c.air, c.roll, c.radial,
+                         c.auxiliary, c.propulsionEfficiency, c.recuperationEfficiency };
+        std::pair<std::map<std::vector<double>, uint32_t>::iterator, bool> type =
+          types.insert (std::make_pair (std::vector<double> (key, key + sizeof (key) / sizeof (key[0])),
+                                        (uint32_t) m_coefficients.size ()));
+        if (type.second)
+          {
+            m_coefficients.push_back (c);
+            m_radial = m_radial || c.radial != 0.;
+          }
+        m_type[i] = type.first->second;
+        m_elevation[i] = PeekPointer (model->GetElevation ());
+        m_hasElevation = m_hasElevation || m_elevation[i] != 0;
+        m_lastVelocity[i] = ElectricVehicleSpeed (model->GetLastVelocity ());
+        m_lastHeight[i] = model->GetLastPosition ().z;
+        m_lastAngle[i] = model->GetLastAngle ();
+
+        // only these models can be read concurrently, their GetPosition
+        // and GetVelocity do not touch anything outside the model
+        const MobilityModel *mobility = PeekPointer (model->GetMobilityModel ());
+        if (dynamic_cast<const ConstantVelocityMobilityModel *> (mobility) == 0
+            && dynamic_cast<const ConstantPositionMobilityModel *> (mobility) == 0
+            && dynamic_cast<const ConstantAccelerationMobilityModel *> (mobility) == 0)
+          {
+            m_parallelGather = false;
+          }
+      }
+
+    // a single batched lookup if all the vehicles share the raster
+    m_fleetElevation = n > 0 ? m_elevation[0] : 0;
+    for (uint32_t i = 1; i < n && m_fleetElevation != 0; i++)
+      {
+        if (m_elevation[i] != m_fleetElevation)
+          {
+            m_fleetElevation = 0;
+          }
+      }
+    if (m_hasElevation)
+      {
+        m_parallelGather = false;
+      }
+
+    m_lastUpdateTime = n > 0 ? m_models[0]->GetLastUpdateTime () : Time ();
+  }
+
+  void
+  ElectricVehicleFleet::Start (Time updateTime)
+  {
+    NS_LOG_FUNCTION (this << updateTime);
+    NS_ASSERT (updateTime.IsStrictlyPositive ());
+    m_updateTime = updateTime;
+    Build ();
+    StartWorkers ();
+    Update (); // first update at start time
+    Simulator::Schedule (m_updateTime, &ElectricVehicleFleet::DoUpdate, this);
+  }
+
+  void
+  ElectricVehicleFleet::Resume (Time updateTime)
+  {
+    NS_LOG_FUNCTION (this << updateTime);
+    NS_ASSERT (updateTime.IsStrictlyPositive ());
+    m_updateTime = updateTime;
+    Build ();
+    StartWorkers ();
+    Time next = m_lastUpdateTime + m_updateTime;
+    Simulator::Schedule (std::max (next - Simulator::Now (), Seconds (0)), &ElectricVehicleFleet::DoUpdate, this);
+  }
+
+  void
+  ElectricVehicleFleet::Refresh (void)
+  {
+    NS_LOG_FUNCTION (this);
+    Build ();
+  }
+
+  void
+  ElectricVehicleFleet::DoUpdate (void)
+  {
+    Update ();
+    Simulator::Schedule (m_updateTime, &ElectricVehicleFleet::DoUpdate, this);
+  }
+
+  void
+  ElectricVehicleFleet::Update (void)
+  {
+    NS_LOG_FUNCTION (this);
+
+    // do not update if simulation has finished
+    if (Simulator::IsFinished () || m_models.empty ())
+      {
+        return;
+      }
+
+    m_timeFromLastUpdate = (Simulator::Now () - m_lastUpdateTime).GetSeconds ();
+
+    if (m_workers.empty ())
+      {
+        Gather (0, m_models.size ());
+        Compute (0, m_models.size (), m_timeFromLastUpdate);
+      }
+    else
+      {
+        if (!m_parallelGather)
+          {
+            Gather (0, m_models.size ());
+          }
+
+        // wake up the workers, run the first chunk here and wait for the rest
+        {
+          std::lock_guard<std::mutex> lock (m_mutex);
+          m_pendingChunks = m_workers.size ();
+          m_generation++;
+        }
+        m_startCondition.notify_all ();
+
+        RunChunk (0);
+
+        std::unique_lock<std::mutex> lock (m_mutex);
+        while (m_pendingChunks > 0)
+          {
+            m_doneCondition.wait (lock);
+          }
+      }
+
+    // traces are fired in the order the vehicles were added, in the
+    // simulation thread
+    Scatter ();
+
+    m_lastUpdateTime = Simulator::Now ();
+  }
+
+  void
+  ElectricVehicleFleet::RunChunk (uint32_t chunk)
+  {
+    uint64_t n = m_models.size ();
+    uint32_t begin = n * chunk / m_threads;
+    uint32_t end = n * (chunk + 1) / m_threads;
+
+    if (m_parallelGather)
+      {
+        Gather (begin, end);
+      }
+    Compute (begin, end, m_timeFromLastUpdate);
+  }
+
+  void
+  ElectricVehicleFleet::WorkerLoop (uint32_t chunk)
+  {
+    uint64_t generation = 0;
+    while (true)
+      {
+        {
+          std::unique_lock<std::mutex> lock (m_mutex);
+          while (!m_stopWorkers && m_generation == generation)
+            {
+              m_startCondition.wait (lock);
+            }
+          if (m_stopWorkers)
+            {
+              return;
+            }
+          generation = m_generation;
+        }
+
+        RunChunk (chunk);
+
+        {
+          std::lock_guard<std::mutex> lock (m_mutex);
+          m_pendingChunks--;
+        }
+        m_doneCondition.notify_one ();
+      }
+  }
+
+  void
+  ElectricVehicleFleet::StartWorkers (void)
+  {
+    NS_LOG_FUNCTION (this);
+    // no point in having more threads than vehicles
+    if (m_threads > m_models.size ())
+      {
+        m_threads = m_models.size () > 0 ? m_models.size () : 1;
+      }
+    m_stopWorkers = false;
+    for (uint32_t chunk = 1; chunk < m_threads; chunk++)
+      {
+        m_workers.push_back (std::thread (&ElectricVehicleFleet::WorkerLoop, this, chunk));
+      }
+  }
+
+  void
+  ElectricVehicleFleet::StopWorkers (void)
+  {
+    if (m_workers.empty ())
+      {
+        return;
+      }
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_stopWorkers = true;
+    }
+    m_startCondition.notify_all ();
+    for (std::vector<std::thread>::iterator it = m_workers.begin (); it != m_workers.end (); ++it)
+      {
+        it->join ();
+      }
+    m_workers.clear ();
+  }
+
+  void
+  ElectricVehicleFleet::Gather (uint32_t begin, uint32_t end)
+  {
+    m_mobility.Get (begin, end, Simulator::Now (), &m_position[begin], &m_velocity[begin]);
+    for (uint32_t i = begin; i < end; i++)
+      {
+        m_velocityNow[i] = ElectricVehicleSpeed (m_velocity[i]);
+        m_heightNow[i] = m_position[i].z;
+        m_angleNow[i] = ElectricVehicleAngle (m_velocity[i]);
+        m_angleDiff[i] = ElectricVehicleAngleDiff (m_lastAngle[i], m_angleNow[i]);
+      }
+
+    if (m_fleetElevation != 0)
+      {
+        m_fleetElevation->GetHeights (&m_position[begin], &m_heightNow[begin], end - begin);
+      }
+    else if (m_hasElevation)
+      {
+        for (uint32_t i = begin; i < end; i++)
+          {
+            if (m_elevation[i] != 0)
+              {
+                m_heightNow[i] = m_elevation[i]->GetHeight (m_position[i].x, m_position[i].y);
+              }
+          }
+      }
+    if (m_hasElevation)
+      {
+        for (uint32_t i = begin; i < end; i++)
+          {
+            m_position[i].z = m_heightNow[i];
+          }
+      }
+  }
+
+  void
+  ElectricVehicleFleet::Compute (uint32_t begin, uint32_t end, double timeFromLastUpdate)
+  {
+    const double *heightNow = &m_heightNow[0];
+    const double *lastHeight = &m_lastHeight[0];
+    bool elevation = false;
+    for (uint32_t i = begin; i < end; i++)
+      {
+        elevation |= heightNow[i] != lastHeight[i];
+      }
+
+    if (m_radial)
+      {
+        if (elevation)
+          {
+            ComputeKernel<true, true> (begin, end, timeFromLastUpdate);
+          }
+        else
+          {
+            ComputeKernel<true, false> (begin, end, timeFromLastUpdate);
+          }
+      }
+    else
+      {
+        if (elevation)
+          {
+            ComputeKernel<false, true> (begin, end, timeFromLastUpdate);
+          }
+        else
+          {
+            ComputeKernel<false, false> (begin, end, timeFromLastUpdate);
+          }
+      }
+  }
+
+  template <bool RADIAL, bool ELEVATION>
+  void
+  ElectricVehicleFleet::ComputeKernel (uint32_t begin, uint32_t end, double timeFromLastUpdate)
+  {
+    const ElectricVehicleCoefficients *coefficients = &m_coefficients[0];
+    const uint32_t *type = &m_type[0];
+    const double *velocityNow = &m_velocityNow[0];
+    const double *lastVelocity = &m_lastVelocity[0];
+    const double *heightNow = &m_heightNow[0];
+    const double *lastHeight = &m_lastHeight[0];
+    const double *angleDiff = &m_angleDiff[0];
+    double *energyDiff = &m_energyDiff[0];
+    ElectricVehicleEnergyTerms *terms = &m_terms[0];
+
+    for (uint32_t i = begin; i < end; i++)
+      {
+        energyDiff[i] = ElectricVehicleEnergyDiff<RADIAL, ELEVATION> (coefficients[type[i]],
+                                                                      velocityNow[i],
+                                                                      lastVelocity[i],
+                                                                      heightNow[i],
+                                                                      lastHeight[i],
+                                                                      angleDiff[i],
+                                                                      timeFromLastUpdate,
+                                                                      terms[i]);
+      }
+  }
+
+  void
+  ElectricVehicleFleet::Scatter (void)
+  {
+    Time now = Simulator::Now ();
+    uint32_t n = m_models.size ();
+    for (uint32_t i = 0; i < n; i++)
+      {
+        ElectricVehicleConsumptionModel *model = PeekPointer (m_models[i]);
+        double energyDiff = model->DrawEnergy (m_energyDiff[i], m_timeFromLastUpdate);
+
+        model->SetLastUpdateTime (now);
+        model->SetLastPosition (m_position[i]);
+        model->SetLastVelocity (m_velocity[i]);
+        model->SetLastAngle (m_angleNow[i]);
+
+        m_lastVelocity[i] = m_velocityNow[i];
+        m_lastHeight[i] = m_heightNow[i];
+        m_lastAngle[i] = m_angleNow[i];
+
+        model->NotifyConsumptionUpdate (m_terms[i], energyDiff);
+      }
+  }
+
+} // namespace ns3
@@ -0,0 +1,264 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#ifndef ELECTRIC_VEHICLE_FLEET_H
+#define ELECTRIC_VEHICLE_FLEET_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/mobility-module.h"
+#include "electric-vehicle-consumption-model.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup consumption
+ * \brief Batched consumption update of a whole fleet of electric vehicles.
+ *
+ * Instead of scheduling one update event per vehicle, the fleet keeps the
+ * parameters and the last state of every vehicle in contiguous arrays
+ * (structure of arrays) and updates all of them in a single scheduled tick.
+ * Each tick has three phases:
+ *
+ * - gather: read the position and velocity of every vehicle from its
+ *   mobility model.
+ * - compute: run ElectricVehicleEnergyDiff over the arrays.
+ * - scatter: write the results back to each ElectricVehicleConsumptionModel,
+ *   which fires its RemainingEnergy and ConsumptionUpdate traces.
+ *
+ * Vehicles with the same parameters share a block of precomputed
+ * coefficients (see ElectricVehicleCoefficients), so fleets made of a few
+ * vehicle types keep them in cache. The kernel is specialized for fleets
+ * without radial losses and for updates where no height changed. If the
+ * vehicles have an elevation raster, the gather phase takes the heights
+ * from it, with a single batched lookup when they all share the same one.
+ *
+ * The kernel is the same function used by ElectricVehicleConsumptionModel,
+ * so the results and the traces are identical to the per-vehicle update.
+ * Vehicles are updated in the order they were added, which is the order of
+ * the per-vehicle update events of the vehicles installed the same way, so
+ * the traces are fired in the same order too.
+ *
+ * The gather and compute phases can be split across a pool of threads (see
+ * SetThreads). The vehicles are independent, so each thread works on its own
+ * contiguous range of the arrays. The scatter phase, which fires the traces,
+ * always runs in the simulation thread in that order after all the
+ * threads have finished, so the output does not depend on the number of
+ * threads. Mobility models are only read from the worker threads when all of
+ * them are constant position, velocity or acceleration models, whose
+ * GetPosition has no side effects outside the model; otherwise the gather
+ * phase runs in the simulation thread and only the kernel is parallel. The
+ * same happens with elevation rasters, which are not thread safe.
+ */
+class ElectricVehicleFleet : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ElectricVehicleFleet ();
+
+  virtual ~ElectricVehicleFleet ();
+
+  /**
+   * \param model consumption model of the vehicle, with its parameters and
+   *        mobility model already set.
+   *
+   * The parameters of the model are copied into the fleet arrays when the
+   * fleet is started, so vehicles must be added before Start is called.
+   */
+  void AddVehicle (Ptr<ElectricVehicleConsumptionModel> model);
+
+  /**
+   * \returns the number of vehicles in the fleet.
+   */
+  uint32_t GetN (void) const;
+
+  /**
+   * \param i index of the vehicle, in the order they were added.
+   * \returns the consumption model of the vehicle.
+   */
+  Ptr<ElectricVehicleConsumptionModel> Get (uint32_t i) const;
+
+  /**
+   * \param threads number of threads used to update the fleet, including the
+   *        simulation thread. 1 (the default) updates the fleet serially.
+   *
+   * Must be called before Start.
+   */
+  void SetThreads (uint32_t threads);
+
+  /**
+   * \returns number of threads used to update the fleet.
+   */
+  uint32_t GetThreads (void) const;
+
+  /**
+   * \param updateTime time between each update of the fleet consumption.
+   *
+   * Updates the whole fleet now and schedules the next updates every
+   * updateTime.
+   */
+  void Start (Time updateTime);
+
+  /**
+   * \param updateTime time between each update of the fleet consumption.
+   *
+   * Schedules the updates of a fleet whose vehicles were restored from a
+   * checkpoint: the next one is updateTime after the last update of the
+   * vehicles, and then every updateTime.
+   */
+  void Resume (Time updateTime);
+
+  /**
+   * Updates the consumption of all the vehicles of the fleet.
+   */
+  void Update (void);
+
+  /**
+   * Copies again the parameters and the state of the vehicles of a started
+   * fleet, which must be called after changing them between two updates.
+   */
+  void Refresh (void);
+
+private:
+  virtual void DoDispose (void);
+
+  /**
+   * Sorts the vehicles by node ID and copies their parameters and last
+   * state into the arrays.
+   */
+  void Build (void);
+
+  /**
+   * \param begin index of the first vehicle to read.
+   * \param end index past the last vehicle to read.
+   *
+   * Reads the position and velocity of the vehicles in [begin, end).
+   */
+  void Gather (uint32_t begin, uint32_t end);
+
+  /**
+   * \param begin index of the first vehicle to compute.
+   * \param end index past the last vehicle to compute.
+   * \param timeFromLastUpdate time since the last update in seconds.
+   *
+   * Computes the energy difference of the vehicles in [begin, end), with
+   * the kernel specialized for the fleet and the current heights.
+   */
+  void Compute (uint32_t begin, uint32_t end, double timeFromLastUpdate);
+
+  /**
+   * \param begin index of the first vehicle to compute.
+   * \param end index past the last vehicle to compute.
+   * \param timeFromLastUpdate time since the last update in seconds.
+   *
+   * Computes the energy difference of the vehicles in [begin, end) with
+   * the ElectricVehicleEnergyDiff<RADIAL, ELEVATION> kernel.
+   */
+  template <bool RADIAL, bool ELEVATION>
+  void ComputeKernel (uint32_t begin, uint32_t end, double timeFromLastUpdate);
+
+  /**
+   * Writes the results back to the consumption models.
+   */
+  void Scatter (void);
+
+  /**
+   * Scheduled tick.
+   */
+  void DoUpdate (void);
+
+  /**
+   * \param chunk index of the chunk of vehicles, from 0 to m_threads - 1.
+   *
+   * Runs the parallel phases (gather if allowed, and compute) of the
+   * current update on one chunk of the vehicles.
+   */
+  void RunChunk (uint32_t chunk);
+
+  /**
+   * \param chunk index of the chunk of vehicles run by this worker thread.
+   *
+   * Main loop of a worker thread.
+   */
+  void WorkerLoop (uint32_t chunk);
+
+  /**
+   * Starts the worker threads.
+   */
+  void StartWorkers (void);
+
+  /**
+   * Stops and joins the worker threads.
+   */
+  void StopWorkers (void);
+
+  std::vector<Ptr<ElectricVehicleConsumptionModel> > m_models;  // consumption model of each vehicle
+  MobilityBatch m_mobility;                                     // mobility model of each vehicle, read in batch
+  std::vector<uint32_t> m_nodeIds;                              // node ID of each vehicle
+
+  // vehicle parameters
+  std::vector<ElectricVehicleCoefficients> m_coefficients; // coefficients of each vehicle type
+  std::vector<uint32_t> m_type;                            // type of each vehicle
+  bool m_radial;                                           // some vehicle type has radial losses
+  std::vector<ElevationRaster *> m_elevation;              // elevation raster of each vehicle, or 0
+  ElevationRaster *m_fleetElevation;                       // elevation raster of all the vehicles, or 0
+  bool m_hasElevation;                                     // some vehicle has an elevation raster
+
+  // state of the last update
+  std::vector<double> m_lastVelocity;        // speed in m/s
+  std::vector<double> m_lastHeight;          // height in m
+  std::vector<double> m_lastAngle;           // steering angle in radians
+
+  // state of the current update
+  std::vector<Vector> m_position;
+  std::vector<Vector> m_velocity;
+  std::vector<double> m_velocityNow;         // speed in m/s
+  std::vector<double> m_heightNow;           // height in m
+  std::vector<double> m_angleNow;            // steering angle in radians
+  std::vector<double> m_angleDiff;           // steering angle difference in radians
+  std::vector<double> m_energyDiff;          // energy difference in Wh
+  std::vector<ElectricVehicleEnergyTerms> m_terms; // energy differences by term in Ws
+
+  Time m_updateTime;                         // time between updates
+  Time m_lastUpdateTime;                     // time of the last update
+
+  uint32_t m_threads;                        // number of threads, including the simulation thread
+  bool m_parallelGather;                     // mobility models can be read from worker threads
+  double m_timeFromLastUpdate;               // time since the last update of the current update, in s
+  std::vector<std::thread> m_workers;        // worker threads
+  std::mutex m_mutex;                        // protects the fields below
+  std::condition_variable m_startCondition;  // signals a new update to the workers
+  std::condition_variable m_doneCondition;   // signals the end of a chunk to the simulation thread
+  uint64_t m_generation;                     // number of updates started
+  uint32_t m_pendingChunks;                  // chunks of the current update not finished yet
+  bool m_stopWorkers;                        // the worker threads must exit
+};
+
+} // namespace ns3
+
+#endif /* ELECTRIC_VEHICLE_FLEET_H */
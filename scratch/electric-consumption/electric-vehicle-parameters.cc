@@ -0,0 +1,139 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#include <cstring>
+
+#include "electric-vehicle-parameters.h"
+
+namespace ns3 {
+
+  namespace {
+
+  /**
+   * Key of a parameter in the vehicle attributes file and its field.
+   */
+  struct ParameterKey
+  {
+    const char *key;
+    double ElectricVehicleParameters::*field;
+  };
+
+  // sorted by key, searched with a binary search
+  const ParameterKey g_parameterKeys[] = {
+    { "airDragCoefficient", &ElectricVehicleParameters::airDragCoefficient },
+    { "constantPowerIntake", &ElectricVehicleParameters::constantPowerIntake },
+    { "frontSurfaceArea", &ElectricVehicleParameters::frontSurfaceArea },
+    { "initialEnergy", &ElectricVehicleParameters::initialEnergy },
+    { "internalMomentOfInertia", &ElectricVehicleParameters::internalMomentOfInertia },
+    { "maximumBatteryCapacity", &ElectricVehicleParameters::maximumBatteryCapacity },
+    { "propulsionEfficiency", &ElectricVehicleParameters::propulsionEfficiency },
+    { "radialDragCoefficient", &ElectricVehicleParameters::radialDragCoefficient },
+    { "recuperationEfficiency", &ElectricVehicleParameters::recuperationEfficiency },
+    { "rollDragCoefficient", &ElectricVehicleParameters::rollDragCoefficient },
+    { "vehicleMass", &ElectricVehicleParameters::vehicleMass },
+  };
+
+  const int g_nParameterKeys = sizeof (g_parameterKeys) / sizeof (g_parameterKeys[0]);
+
+  } // anonymous namespace
+
+  ElectricVehicleParameters::ElectricVehicleParameters ()
+    : initialEnergy (0),
+      maximumBatteryCapacity (0),
+      vehicleMass (0),
+      frontSurfaceArea (0),
+      airDragCoefficient (0),
+      internalMomentOfInertia (0),
+      radialDragCoefficient (0),
+      rollDragCoefficient (0),
+      constantPowerIntake (0),
+      propulsionEfficiency (0),
+      recuperationEfficiency (0)
+  {
+  }
+
+  double *
+  ElectricVehicleParameters::Find (const char *key)
+  {
+    int low = 0;
+    int high = g_nParameterKeys - 1;
+    while (low <= high)
+    {
+      int middle = (low + high) / 2;
+      int cmp = std::strcmp (key, g_parameterKeys[middle].key);
+      if (cmp == 0)
+      {
+        return &(this->*g_parameterKeys[middle].field);
+      } else if (cmp < 0)
+      {
+        high = middle - 1;
+      } else
+      {
+        low = middle + 1;
+      }
+    }
+    return 0;
+  }
+
+  bool
+  ElectricVehicleParameters::Set (const char *key, double value)
+  {
+    double *field = Find (key);
+    if (field == 0)
+    {
+      return false;
+    }
+    *field = value;
+    return true;
+  }
+
+  void
+  ElectricVehicleParameters::Apply (Ptr<ElectricVehicleConsumptionModel> model) const
+  {
+    model->SetInitialEnergy (initialEnergy);
+    model->SetMaximunBatteryCapacity (maximumBatteryCapacity);
+    model->SetVehicleMass (vehicleMass);
+    model->SetFrontSurfaceArea (frontSurfaceArea);
+    model->SetAirDragCoefficient (airDragCoefficient);
+    model->SetInternalMomentOfInertia (internalMomentOfInertia);
+    model->SetRadialDragCoefficient (radialDragCoefficient);
+    model->SetRollDragCoefficient (rollDragCoefficient);
+    model->SetConstantPowerIntake (constantPowerIntake);
+    model->SetPropulsionEfficiency (propulsionEfficiency);
+    model->SetRecuperationEfficiency (recuperationEfficiency);
+  }
+
+  void
+  ElectricVehicleParameters::Read (Ptr<ElectricVehicleConsumptionModel> model)
+  {
+    initialEnergy = model->GetInitialEnergy ();
+    maximumBatteryCapacity = model->GetMaximunBatteryCapacity ();
+    vehicleMass = model->GetVehicleMass ();
+    frontSurfaceArea = model->GetFrontSurfaceArea ();
+    airDragCoefficient = model->GetAirDragCoefficient ();
+    internalMomentOfInertia = model->GetInternalMomentOfInertia ();
+    radialDragCoefficient = model->GetRadialDragCoefficient ();
+    rollDragCoefficient = model->GetRollDragCoefficient ();
+    constantPowerIntake = model->GetConstantPowerIntake ();
+    propulsionEfficiency = model->GetPropulsionEfficiency ();
+    recuperationEfficiency = model->GetRecuperationEfficiency ();
+  }
+
+} // namespace ns3
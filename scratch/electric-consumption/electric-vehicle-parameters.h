@@ -0,0 +1,81 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#ifndef ELECTRIC_VEHICLE_PARAMETERS_H
+#define ELECTRIC_VEHICLE_PARAMETERS_H
+
+#include "ns3/ptr.h"
+#include "electric-vehicle-consumption-model.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup consumption
+ * \brief Parameters of an electric vehicle as read from the vehicle
+ * attributes file.
+ *
+ * Each parameter is named by the key used in the file. The keys are mapped
+ * to the fields by a static table, see Set. Parameters not given keep the
+ * default of ElectricVehicleConsumptionModel (0).
+ */
+struct ElectricVehicleParameters
+{
+  ElectricVehicleParameters ();
+
+  /**
+   * \param key name of the parameter in the vehicle attributes file.
+   * \returns a pointer to the field of the parameter, or 0 if the key is
+   *          not a known parameter.
+   */
+  double * Find (const char *key);
+
+  /**
+   * \param key name of the parameter in the vehicle attributes file.
+   * \param value value of the parameter.
+   * \returns false if the key is not a known parameter.
+   */
+  bool Set (const char *key, double value);
+
+  /**
+   * \param model consumption model to configure with these parameters.
+   */
+  void Apply (Ptr<ElectricVehicleConsumptionModel> model) const;
+
+  /**
+   * \param model consumption model whose parameters are copied.
+   */
+  void Read (Ptr<ElectricVehicleConsumptionModel> model);
+
+  double initialEnergy;             // Wh
+  double maximumBatteryCapacity;    // Wh
+  double vehicleMass;               // kg
+  double frontSurfaceArea;          // m^2
+  double airDragCoefficient;
+  double internalMomentOfInertia;   // kg
+  double radialDragCoefficient;
+  double rollDragCoefficient;
+  double constantPowerIntake;       // W
+  double propulsionEfficiency;
+  double recuperationEfficiency;
+};
+
+} // namespace ns3
+
+#endif /* ELECTRIC_VEHICLE_PARAMETERS_H */
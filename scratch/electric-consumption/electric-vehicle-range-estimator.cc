@@ -0,0 +1,454 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/uinteger.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/mobility-model.h"
+#include "ns3/ns2-mobility-helper.h"
+#include "electric-vehicle-energy.h"
+#include "elevation-raster.h"
+#include "electric-vehicle-range-estimator.h"
+
+namespace ns3 {
+
+  NS_LOG_COMPONENT_DEFINE ("ElectricVehicleRangeEstimator");
+
+  NS_OBJECT_ENSURE_REGISTERED (ElectricVehicleRangeEstimator);
+
+  TypeId
+  ElectricVehicleRangeEstimator::GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::ElectricVehicleRangeEstimator")
+      .SetParent<Object> ()
+      .SetGroupName ("Consumption")
+      .AddConstructor<ElectricVehicleRangeEstimator> ()
+      .AddAttribute ("MaxCachedSegments",
+                     "Maximum number of waypoint segments whose geometry is cached.",
+                     UintegerValue (65536),
+                     MakeUintegerAccessor (&ElectricVehicleRangeEstimator::m_maxCachedSegments),
+                     MakeUintegerChecker<uint32_t> (1))
+    ;
+    return tid;
+  }
+
+  ElectricVehicleRangeEstimator::ElectricVehicleRangeEstimator ()
+    : m_maxCachedSegments (65536)
+  {
+    NS_LOG_FUNCTION (this);
+  }
+
+  ElectricVehicleRangeEstimator::~ElectricVehicleRangeEstimator ()
+  {
+    NS_LOG_FUNCTION (this);
+  }
+
+  void
+  ElectricVehicleRangeEstimator::DoDispose (void)
+  {
+    NS_LOG_FUNCTION (this);
+    m_traces.clear ();
+    m_geometry.clear ();
+    Object::DoDispose ();
+  }
+
+  bool
+  ElectricVehicleRangeEstimator::SegmentKey::operator== (const SegmentKey &other) const
+  {
+    return x0 == other.x0 && y0 == other.y0 && z0 == other.z0
+      && x1 == other.x1 && y1 == other.y1 && z1 == other.z1
+      && elevation == other.elevation;
+  }
+
+  size_t
+  ElectricVehicleRangeEstimator::SegmentKeyHash::operator() (const SegmentKey &key) const
+  {
+    std::hash<double> hash;
+    size_t h = std::hash<const ElevationRaster *> () (key.elevation);
+    const double values[6] = { key.x0, key.y0, key.z0, key.x1, key.y1, key.z1 };
+    for (uint32_t i = 0; i < 6; i++)
+    {
+      h ^= hash (values[i]) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+    return h;
+  }
+
+  /**
+   * Collects the changes Ns2MobilityHelper schedules for each node of a
+   * trace.
+   */
+  class ElectricVehicleRangeEstimator::TraceCollector : public Ns2TraceVisitor
+  {
+  public:
+    virtual void InitialPosition (int nodeId, const Vector &position)
+    {
+      initial[nodeId] = position;
+      events[nodeId];
+    }
+
+    virtual void Velocity (int nodeId, double at, const Vector &from, const Vector &velocity)
+    {
+      Add (nodeId, at, false, velocity);
+    }
+
+    virtual void Stop (int nodeId, double at, const Vector &position)
+    {
+      stops[nodeId] = events[nodeId].size ();
+      Add (nodeId, at, false, Vector (0, 0, 0));
+    }
+
+    virtual void CancelStop (int nodeId)
+    {
+      std::map<uint32_t, uint32_t>::const_iterator it = stops.find (nodeId);
+      if (it != stops.end ())
+      {
+        events[nodeId][it->second].cancelled = true;
+      }
+    }
+
+    virtual void Position (int nodeId, double at, const Vector &position)
+    {
+      Add (nodeId, at, true, position);
+    }
+
+    std::map<uint32_t, Vector> initial;                       // initial position of each node
+    std::map<uint32_t, std::vector<TraceEvent> > events;      // changes of each node, in the order of the file
+    std::map<uint32_t, uint32_t> stops;                       // index of the last stop of each node
+
+  private:
+    void Add (uint32_t nodeId, double at, bool position, const Vector &value)
+    {
+      TraceEvent event;
+      event.time = Seconds (at);
+      event.position = position;
+      event.value = value;
+      event.cancelled = false;
+      events[nodeId].push_back (event);
+    }
+  };
+
+  bool
+  ElectricVehicleRangeEstimator::LoadNs2Trace (std::string filename)
+  {
+    NS_LOG_FUNCTION (this << filename);
+
+    TraceCollector collector;
+    if (!Ns2MobilityHelper (filename).VisitTrace (collector))
+    {
+      return false;
+    }
+
+    m_traces.clear ();
+    for (std::map<uint32_t, std::vector<TraceEvent> >::iterator it = collector.events.begin (); it != collector.events.end (); it++)
+    {
+      BuildSegments (m_traces[it->first], collector.initial[it->first], it->second);
+    }
+    NS_LOG_DEBUG ("Loaded the trace of " << m_traces.size () << " nodes from " << filename);
+    return true;
+  }
+
+  /**
+   * Orders trace events by time, keeping the order of the file for the
+   * same time as the simulator does.
+   */
+  template <class T>
+  static bool
+  EarlierEvent (const T &a, const T &b)
+  {
+    return a.time < b.time;
+  }
+
+  void
+  ElectricVehicleRangeEstimator::BuildSegments (NodeTrace &trace, const Vector &initial, std::vector<TraceEvent> &events)
+  {
+    std::stable_sort (events.begin (), events.end (), EarlierEvent<TraceEvent>);
+
+    TraceSegment segment;
+    segment.start = Seconds (0);
+    segment.from = initial;
+    segment.velocity = Vector (0, 0, 0);
+    trace.segments.clear ();
+    trace.valid = false;
+
+    // every change of course is an update of the consumption model, several
+    // changes at the same time are a single one
+    uint32_t i = 0;
+    while (i < events.size ())
+    {
+      Time time = events[i].time;
+      segment.end = time;
+      trace.segments.push_back (segment);
+
+      double elapsed = (time - segment.start).GetSeconds ();
+      Vector position = segment.from;
+      position.x += segment.velocity.x * elapsed;
+      position.y += segment.velocity.y * elapsed;
+      position.z += segment.velocity.z * elapsed;
+      for (; i < events.size () && events[i].time == time; i++)
+      {
+        if (events[i].cancelled)
+        {
+          continue;
+        }
+        if (events[i].position)
+        {
+          position = events[i].value;
+        }
+        else
+        {
+          segment.velocity = events[i].value;
+        }
+      }
+      segment.start = time;
+      segment.from = position;
+    }
+    segment.end = Time::Max ();
+    trace.segments.push_back (segment);
+
+    // speeds and headings at the end of each segment, as the consumption
+    // model keeps them
+    double lastAngle = std::numeric_limits<double>::infinity ();
+    for (uint32_t j = 0; j < trace.segments.size (); j++)
+    {
+      TraceSegment &s = trace.segments[j];
+      s.speed = ElectricVehicleSpeed (s.velocity);
+      s.nextSpeed = s.speed;
+      s.angleDiff = 0.;
+      if (j + 1 < trace.segments.size ())
+      {
+        const Vector &next = trace.segments[j + 1].velocity;
+        s.nextSpeed = ElectricVehicleSpeed (next);
+        if (s.nextSpeed > 0)
+        {
+          s.angleDiff = ElectricVehicleAngleDiff (lastAngle, ElectricVehicleAngle (next));
+          lastAngle = ElectricVehicleAngle (next);
+        }
+      }
+    }
+  }
+
+  double
+  ElectricVehicleRangeEstimator::GetHeight (ElevationRaster *elevation, const Vector &position)
+  {
+    return elevation != 0 ? elevation->GetHeight (position.x, position.y) : position.z;
+  }
+
+  void
+  ElectricVehicleRangeEstimator::Prepare (NodeTrace &trace, Ptr<ElectricVehicleConsumptionModel> model)
+  {
+    ElevationRaster *elevation = PeekPointer (model->GetElevation ());
+    const ElectricVehicleCoefficients &c = model->GetCoefficients ();
+    if (trace.valid && trace.elevation == elevation
+        && std::memcmp (&trace.coefficients, &c, sizeof (c)) == 0)
+    {
+      return;
+    }
+
+    std::vector<TraceSegment> &segments = trace.segments;
+    if (!trace.valid || trace.elevation != elevation)
+    {
+      for (uint32_t i = 0; i < segments.size (); i++)
+      {
+        segments[i].heightFrom = GetHeight (elevation, segments[i].from);
+      }
+      for (uint32_t i = 0; i < segments.size (); i++)
+      {
+        segments[i].heightTo = i + 1 < segments.size () ? segments[i + 1].heightFrom : segments[i].heightFrom;
+      }
+    }
+
+    // energy of the segments before each one, the last one never ends
+    trace.energy.resize (segments.size ());
+    trace.energy[0] = 0;
+    ElectricVehicleEnergyTerms terms;
+    for (uint32_t i = 0; i + 1 < segments.size (); i++)
+    {
+      const TraceSegment &s = segments[i];
+      trace.energy[i + 1] = trace.energy[i]
+        + ElectricVehicleSegmentEnergyDiff (c, s.speed, s.nextSpeed, s.heightTo, s.heightFrom,
+                                            s.angleDiff, (s.end - s.start).GetSeconds (), terms);
+    }
+
+    trace.elevation = elevation;
+    trace.coefficients = c;
+    trace.valid = true;
+  }
+
+  /**
+   * Compares a time with the end of a trace segment.
+   */
+  template <class T>
+  static bool
+  EndsAfter (const Time &time, const T &segment)
+  {
+    return time < segment.end;
+  }
+
+  double
+  ElectricVehicleRangeEstimator::GetTraceEnergy (Ptr<ElectricVehicleConsumptionModel> model, Time until)
+  {
+    NS_LOG_FUNCTION (this << model << until);
+    NS_ASSERT (model->GetNode () != NULL);
+
+    Time now = Simulator::Now ();
+    uint32_t nodeId = model->GetNode ()->GetId ();
+    std::map<uint32_t, NodeTrace>::iterator it = m_traces.find (nodeId);
+    if (it == m_traces.end ())
+    {
+      NS_LOG_ERROR ("Node " << nodeId << " is not in the trace");
+      return 0;
+    }
+    if (until <= now)
+    {
+      return 0;
+    }
+    NodeTrace &trace = it->second;
+    Prepare (trace, model);
+
+    // segments of now and of the end of the prediction
+    const std::vector<TraceSegment> &segments = trace.segments;
+    uint32_t first = std::upper_bound (segments.begin (), segments.end (), now, EndsAfter<TraceSegment>) - segments.begin ();
+    uint32_t last = std::upper_bound (segments.begin (), segments.end (), until, EndsAfter<TraceSegment>) - segments.begin ();
+    NS_ASSERT (first <= last && last < segments.size ());
+
+    const ElectricVehicleCoefficients &c = trace.coefficients;
+    ElectricVehicleEnergyTerms terms;
+    const TraceSegment &s = segments[first];
+    double elapsed = (now - s.start).GetSeconds ();
+    Vector position (s.from.x + s.velocity.x * elapsed, s.from.y + s.velocity.y * elapsed, s.from.z + s.velocity.z * elapsed);
+    double heightNow = trace.elevation != 0 ? GetHeight (trace.elevation, position) : s.heightFrom;
+
+    const TraceSegment &e = segments[last];
+    elapsed = (until - e.start).GetSeconds ();
+    position = Vector (e.from.x + e.velocity.x * elapsed, e.from.y + e.velocity.y * elapsed, e.from.z + e.velocity.z * elapsed);
+    double heightUntil = trace.elevation != 0 ? GetHeight (trace.elevation, position) : e.heightFrom;
+
+    if (first == last)
+    {
+      return ElectricVehicleSegmentEnergyDiff (c, s.speed, s.speed, heightUntil, heightNow, 0.,
+                                               (until - now).GetSeconds (), terms);
+    }
+    double energy = ElectricVehicleSegmentEnergyDiff (c, s.speed, s.nextSpeed, s.heightTo, heightNow,
+                                                      s.angleDiff, (s.end - now).GetSeconds (), terms);
+    energy += trace.energy[last] - trace.energy[first + 1];
+    energy += ElectricVehicleSegmentEnergyDiff (c, e.speed, e.speed, heightUntil, e.heightFrom, 0.,
+                                                (until - e.start).GetSeconds (), terms);
+    return energy;
+  }
+
+  bool
+  ElectricVehicleRangeEstimator::CanFollowTrace (Ptr<ElectricVehicleConsumptionModel> model, Time until)
+  {
+    NS_LOG_FUNCTION (this << model << until);
+    return GetTraceEnergy (model, until) <= model->GetRemainingEnergy ();
+  }
+
+  const ElectricVehicleRangeEstimator::SegmentGeometry &
+  ElectricVehicleRangeEstimator::GetGeometry (const Vector &from, const Vector &to, ElevationRaster *elevation)
+  {
+    SegmentKey key = { from.x, from.y, from.z, to.x, to.y, to.z, elevation };
+    std::unordered_map<SegmentKey, SegmentGeometry, SegmentKeyHash>::iterator it = m_geometry.find (key);
+    if (it != m_geometry.end ())
+    {
+      return it->second;
+    }
+    if (m_geometry.size () >= m_maxCachedSegments)
+    {
+      m_geometry.clear ();
+    }
+    SegmentGeometry geometry;
+    geometry.distance = CalculateDistance (from, to);
+    geometry.heading = std::atan2 (to.y - from.y, to.x - from.x);
+    geometry.heightFrom = GetHeight (elevation, from);
+    geometry.heightTo = GetHeight (elevation, to);
+    return m_geometry[key] = geometry;
+  }
+
+  double
+  ElectricVehicleRangeEstimator::GetRouteEnergy (Ptr<ElectricVehicleConsumptionModel> model,
+                                                 const std::vector<ElectricVehicleRoutePoint> &route)
+  {
+    NS_LOG_FUNCTION (this << model << route.size ());
+    NS_ASSERT (model->GetMobilityModel () != NULL);
+
+    if (route.empty ())
+    {
+      return 0;
+    }
+    Ptr<const MobilityModel> mobility = model->GetMobilityModel ();
+    ElevationRaster *elevation = PeekPointer (model->GetElevation ());
+    const ElectricVehicleCoefficients &c = model->GetCoefficients ();
+    ElectricVehicleEnergyTerms terms;
+
+    // the segment being followed, from the current state of the vehicle
+    Vector from = mobility->GetPosition ();
+    double speed = ElectricVehicleSpeed (mobility->GetVelocity ());
+    double duration = 0;
+    double heightFrom = GetHeight (elevation, from);
+    double heightTo = heightFrom;
+    double lastAngle = model->GetLastAngle ();
+
+    double energy = 0;
+    for (uint32_t i = 0; i < route.size (); i++)
+    {
+      const ElectricVehicleRoutePoint &point = route[i];
+      if (point.speed <= 0)
+      {
+        NS_LOG_WARN ("Skipping route point " << i << " without speed");
+        continue;
+      }
+      const SegmentGeometry &geometry = GetGeometry (from, point.position, elevation);
+      if (geometry.distance == 0)
+      {
+        continue;
+      }
+      energy += ElectricVehicleSegmentEnergyDiff (c, speed, point.speed, heightTo, heightFrom,
+                                                  ElectricVehicleAngleDiff (lastAngle, geometry.heading),
+                                                  duration, terms);
+      lastAngle = geometry.heading;
+      speed = point.speed;
+      duration = geometry.distance / point.speed;
+      heightFrom = geometry.heightFrom;
+      heightTo = geometry.heightTo;
+      from = point.position;
+    }
+
+    // stop at the end of the route
+    energy += ElectricVehicleSegmentEnergyDiff (c, speed, 0., heightTo, heightFrom, 0., duration, terms);
+    return energy;
+  }
+
+  bool
+  ElectricVehicleRangeEstimator::CanReach (Ptr<ElectricVehicleConsumptionModel> model,
+                                           const std::vector<ElectricVehicleRoutePoint> &route)
+  {
+    NS_LOG_FUNCTION (this << model << route.size ());
+    return GetRouteEnergy (model, route) <= model->GetRemainingEnergy ();
+  }
+
+} // namespace ns3
@@ -0,0 +1,229 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#ifndef ELECTRIC_VEHICLE_RANGE_ESTIMATOR_H
+#define ELECTRIC_VEHICLE_RANGE_ESTIMATOR_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "electric-vehicle-consumption-model.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup consumption
+ * \brief Point of a route given to ElectricVehicleRangeEstimator.
+ */
+struct ElectricVehicleRoutePoint
+{
+  Vector position;      //!< position to reach
+  double speed;         //!< constant speed in m/s to reach it
+};
+
+/**
+ * \ingroup consumption
+ * \brief Predicts the energy an electric vehicle needs for the rest of its
+ * route, without advancing the simulation.
+ *
+ * The route is split in segments of constant velocity, and the energy of
+ * each one is ElectricVehicleSegmentEnergyDiff, the same physics used by
+ * ElectricVehicleConsumptionModel when it is updated on changes of course.
+ * The prediction starts from the current state of the model: its position,
+ * velocity, heading and elevation raster. The losses of an optional battery
+ * pack model are not included.
+ *
+ * Two kinds of routes are supported:
+ *
+ * - a list of waypoints, each one reached in a straight line at a constant
+ *   speed, with the vehicle stopping at the last one (GetRouteEnergy). The
+ *   geometry of each segment (length, heading and heights) is cached, so
+ *   the same segments queried by many vehicles are only measured once.
+ * - the legs still to come in the ns-2 trace followed by the vehicle
+ *   (GetTraceEnergy). The trace is read once (LoadNs2Trace), by
+ *   Ns2MobilityHelper::VisitTrace, and turned into the segments of constant
+ *   velocity that Ns2MobilityHelper schedules. The
+ *   energy of each segment and their prefix sums are cached per node and
+ *   vehicle parameters, so a query only integrates the partial segments at
+ *   both ends and is logarithmic in the length of the trace.
+ */
+class ElectricVehicleRangeEstimator : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ElectricVehicleRangeEstimator ();
+
+  virtual ~ElectricVehicleRangeEstimator ();
+
+  /**
+   * \param filename ns-2 trace file, the one given to Ns2MobilityHelper.
+   * \returns false if the file could not be read.
+   */
+  bool LoadNs2Trace (std::string filename);
+
+  /**
+   * \param model consumption model of the vehicle.
+   * \param route waypoints to follow from the current position.
+   * \returns energy in Wh needed to follow the route and stop at its end.
+   */
+  double GetRouteEnergy (Ptr<ElectricVehicleConsumptionModel> model,
+                         const std::vector<ElectricVehicleRoutePoint> &route);
+
+  /**
+   * \param model consumption model of the vehicle.
+   * \param route waypoints to follow from the current position.
+   * \returns true if the remaining energy of the vehicle is enough to follow
+   *          the route.
+   */
+  bool CanReach (Ptr<ElectricVehicleConsumptionModel> model,
+                 const std::vector<ElectricVehicleRoutePoint> &route);
+
+  /**
+   * \param model consumption model of a vehicle of the loaded ns-2 trace.
+   * \param until end of the prediction.
+   * \returns energy in Wh needed to follow the trace from now until the
+   *          given time.
+   */
+  double GetTraceEnergy (Ptr<ElectricVehicleConsumptionModel> model, Time until);
+
+  /**
+   * \param model consumption model of a vehicle of the loaded ns-2 trace.
+   * \param until end of the prediction.
+   * \returns true if the remaining energy of the vehicle is enough to follow
+   *          the trace until the given time.
+   */
+  bool CanFollowTrace (Ptr<ElectricVehicleConsumptionModel> model, Time until);
+
+private:
+  virtual void DoDispose (void);
+
+  /**
+   * Segment of constant velocity of a trace.
+   */
+  struct TraceSegment
+  {
+    Time start;                // start time
+    Time end;                  // end time, Time::Max () for the last one
+    Vector from;               // position at the start
+    Vector velocity;           // velocity in m/s
+    double speed;              // speed in m/s
+    double nextSpeed;          // speed of the next segment in m/s
+    double angleDiff;          // heading change at the end in radians
+    double heightFrom;         // height at the start in m
+    double heightTo;           // height at the end in m
+  };
+
+  /**
+   * Segments of a node and their energies for one vehicle.
+   */
+  struct NodeTrace
+  {
+    std::vector<TraceSegment> segments;
+    ElevationRaster *elevation;                 // raster of the heights
+    ElectricVehicleCoefficients coefficients;   // vehicle of the energies
+    bool valid;                                 // heights and energies computed
+    std::vector<double> energy;                 // energy of the segments before each one in Wh
+  };
+
+  /**
+   * Change of velocity or position scheduled by a trace.
+   */
+  struct TraceEvent
+  {
+    Time time;
+    bool position;             // sets the position instead of the velocity
+    Vector value;
+    bool cancelled;            // stop cancelled by a later leg
+  };
+
+  class TraceCollector;
+
+  /**
+   * Straight segment between two waypoints.
+   */
+  struct SegmentKey
+  {
+    double x0, y0, z0, x1, y1, z1;
+    const ElevationRaster *elevation;
+    bool operator== (const SegmentKey &other) const;
+  };
+
+  struct SegmentKeyHash
+  {
+    size_t operator() (const SegmentKey &key) const;
+  };
+
+  struct SegmentGeometry
+  {
+    double distance;           // length in m
+    double heading;            // heading in radians
+    double heightFrom;         // height of the start in m
+    double heightTo;           // height of the end in m
+  };
+
+  /**
+   * \param trace trace of a node.
+   * \param initial initial position of the node.
+   * \param events changes scheduled for the node, in the order of the file.
+   *
+   * Builds the segments of constant velocity between the changes.
+   */
+  static void BuildSegments (NodeTrace &trace, const Vector &initial, std::vector<TraceEvent> &events);
+
+  /**
+   * \param trace trace of a node.
+   * \param model consumption model of the vehicle.
+   *
+   * Computes the heights and energies of the segments if they were computed
+   * for another vehicle.
+   */
+  void Prepare (NodeTrace &trace, Ptr<ElectricVehicleConsumptionModel> model);
+
+  /**
+   * \param elevation elevation raster, or 0.
+   * \param position a position.
+   * \returns height of the position.
+   */
+  static double GetHeight (ElevationRaster *elevation, const Vector &position);
+
+  /**
+   * \param from start of the segment.
+   * \param to end of the segment.
+   * \param elevation elevation raster, or 0.
+   * \returns cached geometry of the segment.
+   */
+  const SegmentGeometry & GetGeometry (const Vector &from, const Vector &to, ElevationRaster *elevation);
+
+  std::map<uint32_t, NodeTrace> m_traces;      // trace segments of each node
+  std::unordered_map<SegmentKey, SegmentGeometry, SegmentKeyHash> m_geometry; // cached waypoint segments
+  uint32_t m_maxCachedSegments;                // size of the cache of waypoint segments
+};
+
+} // namespace ns3
+
+#endif /* ELECTRIC_VEHICLE_RANGE_ESTIMATOR_H */
@@ -0,0 +1,71 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#ifndef ELECTRIC_VEHICLE_SNAPSHOT_H
+#define ELECTRIC_VEHICLE_SNAPSHOT_H
+
+#include <stdint.h>
+
+#include "electric-vehicle-parameters.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup consumption
+ * \brief Binary snapshot of the parameters of a fleet of electric vehicles.
+ *
+ * A snapshot file is a header followed by header.count records of
+ * header.recordSize bytes, in the byte order of the machine that wrote it.
+ * It is written by ElectricConsumptionHelper::WriteSnapshot and can be used
+ * instead of the XML vehicle attributes file: it is memory mapped and the
+ * records are applied without any parsing.
+ *
+ * A reader accepts a file if the magic, the byte order mark and the version
+ * match. Records may grow in later versions; a reader only uses the first
+ * sizeof (ElectricVehicleSnapshotRecord) bytes of each one.
+ */
+struct ElectricVehicleSnapshotHeader
+{
+  char magic[8];        //!< ELECTRIC_VEHICLE_SNAPSHOT_MAGIC
+  uint32_t byteOrder;   //!< ELECTRIC_VEHICLE_SNAPSHOT_BYTE_ORDER as written by the writer
+  uint32_t version;     //!< ELECTRIC_VEHICLE_SNAPSHOT_VERSION
+  uint32_t recordSize;  //!< size in bytes of each record
+  uint32_t reserved;    //!< 0
+  uint64_t count;       //!< number of records
+};
+
+/**
+ * \ingroup consumption
+ * \brief Record of one vehicle in a snapshot file.
+ */
+struct ElectricVehicleSnapshotRecord
+{
+  uint32_t nodeId;                        //!< node ID of the vehicle
+  uint32_t reserved;                      //!< 0
+  ElectricVehicleParameters parameters;   //!< parameters of the vehicle
+};
+
+#define ELECTRIC_VEHICLE_SNAPSHOT_MAGIC "EVSNAP\r\n"
+#define ELECTRIC_VEHICLE_SNAPSHOT_BYTE_ORDER 0x01020304
+#define ELECTRIC_VEHICLE_SNAPSHOT_VERSION 1
+
+} // namespace ns3
+
+#endif /* ELECTRIC_VEHICLE_SNAPSHOT_H */
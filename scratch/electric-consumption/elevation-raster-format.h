@@ -0,0 +1,67 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#ifndef ELEVATION_RASTER_FORMAT_H
+#define ELEVATION_RASTER_FORMAT_H
+
+#include <stdint.h>
+
+/**
+ * \ingroup consumption
+ * \file
+ *
+ * Binary tiled format of the digital elevation models read by
+ * ns3::ElevationRaster, shared by the reader and the converter
+ * (scratch program asc-to-raster).
+ *
+ * The raster is a grid of columns x rows height samples in m, as float.
+ * Sample (c, r) is at x = originX + c * resolution, y = originY + r *
+ * resolution, so rows go from south to north. The grid is split in square
+ * tiles of tileSize x tileSize samples, a power of two of at least 32 so
+ * that each tile is a whole number of 4 KiB pages. The tiles are stored
+ * row by row from the south-west corner, each one row by row; the tiles on
+ * the north and east edges are padded with their last row or column.
+ *
+ * A file is an ElevationRasterHeader padded to ELEVATION_RASTER_HEADER_SIZE
+ * bytes, followed by the tiles, in the byte order of the machine that wrote
+ * it.
+ */
+
+#define ELEVATION_RASTER_MAGIC "EVDEM\r\n"
+#define ELEVATION_RASTER_BYTE_ORDER 0x01020304
+#define ELEVATION_RASTER_VERSION 1
+#define ELEVATION_RASTER_HEADER_SIZE 4096
+
+struct ElevationRasterHeader
+{
+  char magic[8];         //!< ELEVATION_RASTER_MAGIC
+  uint32_t byteOrder;    //!< ELEVATION_RASTER_BYTE_ORDER as written by the writer
+  uint32_t version;      //!< ELEVATION_RASTER_VERSION
+  uint32_t columns;      //!< samples per row, at least 2
+  uint32_t rows;         //!< rows of samples, at least 2
+  uint32_t tileSize;     //!< samples per side of a tile
+  uint32_t reserved;     //!< 0
+  double originX;        //!< x of sample (0, 0) in m
+  double originY;        //!< y of sample (0, 0) in m
+  double resolution;     //!< distance between samples in m
+};
+
+#endif /* ELEVATION_RASTER_FORMAT_H */
@@ -0,0 +1,280 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "elevation-raster.h"
+
+namespace ns3 {
+
+  NS_LOG_COMPONENT_DEFINE ("ElevationRaster");
+
+  NS_OBJECT_ENSURE_REGISTERED (ElevationRaster);
+
+  static const uint32_t NO_TILE = 0xffffffff;
+
+  TypeId
+  ElevationRaster::GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::ElevationRaster")
+      .SetParent<Object> ()
+      .SetGroupName ("Consumption")
+      .AddConstructor<ElevationRaster> ()
+      .AddAttribute ("MaxTiles",
+                     "Maximum number of tiles kept in memory.",
+                     UintegerValue (4096),
+                     MakeUintegerAccessor (&ElevationRaster::m_maxTiles),
+                     MakeUintegerChecker<uint32_t> (4))
+    ;
+    return tid;
+  }
+
+  ElevationRaster::ElevationRaster ()
+    : m_maxTiles (4096),
+      m_map (0),
+      m_mapSize (0),
+      m_tiles (0),
+      m_tileShift (0),
+      m_tileColumns (0),
+      m_first (NO_TILE),
+      m_last (NO_TILE),
+      m_residentTiles (0)
+  {
+    NS_LOG_FUNCTION (this);
+    std::memset (&m_header, 0, sizeof (m_header));
+  }
+
+  ElevationRaster::~ElevationRaster ()
+  {
+    NS_LOG_FUNCTION (this);
+    Close ();
+  }
+
+  void
+  ElevationRaster::DoDispose (void)
+  {
+    NS_LOG_FUNCTION (this);
+    Close ();
+    Object::DoDispose ();
+  }
+
+  bool
+  ElevationRaster::Open (std::string filename)
+  {
+    NS_LOG_FUNCTION (this << filename);
+    Close ();
+
+    int fd = open (filename.c_str (), O_RDONLY);
+    if (fd < 0)
+    {
+      NS_LOG_ERROR ("Could not open elevation raster " << filename);
+      return false;
+    }
+    struct stat st;
+    if (fstat (fd, &st) != 0 || (size_t) st.st_size < ELEVATION_RASTER_HEADER_SIZE)
+    {
+      NS_LOG_ERROR (filename << " is not an elevation raster");
+      close (fd);
+      return false;
+    }
+    size_t size = st.st_size;
+    void *map = mmap (0, size, PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED)
+    {
+      NS_LOG_ERROR ("Could not map elevation raster " << filename);
+      return false;
+    }
+
+    ElevationRasterHeader header;
+    std::memcpy (&header, map, sizeof (header));
+    bool valid = std::memcmp (header.magic, ELEVATION_RASTER_MAGIC, sizeof (header.magic)) == 0
+      && header.byteOrder == ELEVATION_RASTER_BYTE_ORDER
+      && header.version == ELEVATION_RASTER_VERSION
+      && header.columns >= 2 && header.rows >= 2
+      && header.tileSize >= 32 && (header.tileSize & (header.tileSize - 1)) == 0
+      && header.resolution > 0;
+    if (!valid)
+    {
+      NS_LOG_ERROR (filename << " is not an elevation raster of version " << ELEVATION_RASTER_VERSION
+                    << " written in the byte order of this machine");
+      munmap (map, size);
+      return false;
+    }
+
+    uint64_t tileColumns = (header.columns + header.tileSize - 1) / header.tileSize;
+    uint64_t tileRows = (header.rows + header.tileSize - 1) / header.tileSize;
+    uint64_t tileBytes = (uint64_t) header.tileSize * header.tileSize * sizeof (float);
+    if (size < ELEVATION_RASTER_HEADER_SIZE + tileColumns * tileRows * tileBytes)
+    {
+      NS_LOG_ERROR ("Elevation raster " << filename << " is truncated");
+      munmap (map, size);
+      return false;
+    }
+
+    // lookups jump around, read ahead would only fill the memory
+    madvise (map, size, MADV_RANDOM);
+
+    m_map = map;
+    m_mapSize = size;
+    m_header = header;
+    m_tiles = (const float *) ((const char *) map + ELEVATION_RASTER_HEADER_SIZE);
+    m_tileShift = 0;
+    while ((1u << m_tileShift) < header.tileSize)
+    {
+      m_tileShift++;
+    }
+    m_tileColumns = tileColumns;
+    m_previous.assign (tileColumns * tileRows, NO_TILE);
+    m_next.assign (tileColumns * tileRows, NO_TILE);
+    m_resident.assign (tileColumns * tileRows, false);
+    m_first = NO_TILE;
+    m_last = NO_TILE;
+    m_residentTiles = 0;
+
+    NS_LOG_DEBUG ("Elevation raster of " << header.columns << "x" << header.rows << " samples of "
+                  << header.resolution << " m in " << tileColumns * tileRows << " tiles");
+    return true;
+  }
+
+  void
+  ElevationRaster::Close (void)
+  {
+    if (m_map == 0)
+    {
+      return;
+    }
+    NS_LOG_FUNCTION (this);
+    munmap (m_map, m_mapSize);
+    m_map = 0;
+    m_mapSize = 0;
+    m_tiles = 0;
+    m_previous.clear ();
+    m_next.clear ();
+    m_resident.clear ();
+    m_residentTiles = 0;
+  }
+
+  uint32_t
+  ElevationRaster::GetNResidentTiles (void) const
+  {
+    return m_residentTiles;
+  }
+
+  void
+  ElevationRaster::Touch (uint32_t tile)
+  {
+    if (tile == m_first)
+    {
+      return;
+    }
+
+    if (m_resident[tile])
+    {
+      // unlink, it is not the first one
+      m_next[m_previous[tile]] = m_next[tile];
+      if (m_next[tile] != NO_TILE)
+      {
+        m_previous[m_next[tile]] = m_previous[tile];
+      } else
+      {
+        m_last = m_previous[tile];
+      }
+    } else
+    {
+      m_resident[tile] = true;
+      m_residentTiles++;
+    }
+
+    // link as the first one
+    m_previous[tile] = NO_TILE;
+    m_next[tile] = m_first;
+    if (m_first != NO_TILE)
+    {
+      m_previous[m_first] = tile;
+    }
+    m_first = tile;
+    if (m_last == NO_TILE)
+    {
+      m_last = tile;
+    }
+
+    if (m_residentTiles > m_maxTiles)
+    {
+      // the pages are read again from the file if the tile is used again
+      uint32_t evicted = m_last;
+      size_t tileSamples = (size_t) 1 << (2 * m_tileShift);
+      madvise ((void *) (m_tiles + evicted * tileSamples), tileSamples * sizeof (float), MADV_DONTNEED);
+      m_last = m_previous[evicted];
+      m_next[m_last] = NO_TILE;
+      m_resident[evicted] = false;
+      m_residentTiles--;
+    }
+  }
+
+  float
+  ElevationRaster::GetSample (uint32_t column, uint32_t row)
+  {
+    uint32_t mask = (1u << m_tileShift) - 1;
+    uint32_t tile = (row >> m_tileShift) * m_tileColumns + (column >> m_tileShift);
+    Touch (tile);
+    return m_tiles[((size_t) tile << (2 * m_tileShift)) + ((row & mask) << m_tileShift) + (column & mask)];
+  }
+
+  double
+  ElevationRaster::GetHeight (double x, double y)
+  {
+    NS_ASSERT_MSG (m_map != 0, "The elevation raster is not open");
+
+    double column = (x - m_header.originX) / m_header.resolution;
+    double row = (y - m_header.originY) / m_header.resolution;
+    column = std::min (std::max (column, 0.0), (double) (m_header.columns - 1));
+    row = std::min (std::max (row, 0.0), (double) (m_header.rows - 1));
+
+    uint32_t c = std::min ((uint32_t) column, m_header.columns - 2);
+    uint32_t r = std::min ((uint32_t) row, m_header.rows - 2);
+    double fx = column - c;
+    double fy = row - r;
+
+    double h00 = GetSample (c, r);
+    double h10 = GetSample (c + 1, r);
+    double h01 = GetSample (c, r + 1);
+    double h11 = GetSample (c + 1, r + 1);
+    return (h00 * (1 - fx) + h10 * fx) * (1 - fy) + (h01 * (1 - fx) + h11 * fx) * fy;
+  }
+
+  void
+  ElevationRaster::GetHeights (const Vector *positions, double *heights, uint32_t n)
+  {
+    for (uint32_t i = 0; i < n; i++)
+    {
+      heights[i] = GetHeight (positions[i].x, positions[i].y);
+    }
+  }
+
+} // namespace ns3
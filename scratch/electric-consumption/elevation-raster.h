@@ -0,0 +1,138 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#ifndef ELEVATION_RASTER_H
+#define ELEVATION_RASTER_H
+
+#include <string>
+#include <vector>
+
+#include "ns3/object.h"
+#include "ns3/vector.h"
+#include "elevation-raster-format.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup consumption
+ * \brief Digital elevation model giving the height of the terrain.
+ *
+ * Mobility traces such as the ns-2 ones usually have no height, so the
+ * potential energy term of ElectricVehicleConsumptionModel is always 0.
+ * A consumption model with an elevation raster (see
+ * ElectricVehicleConsumptionModel::SetElevation) takes the height of each
+ * position from the raster instead of its z coordinate.
+ *
+ * The raster is a tiled binary file (see elevation-raster-format.h),
+ * converted from an ESRI ASCII grid by the scratch program asc-to-raster.
+ * It is memory mapped, so opening it reads nothing, and a lookup is the
+ * bilinear interpolation of the four samples around the position, with
+ * the positions outside the raster clamped to its edges.
+ *
+ * The kernel loads the tiles that are used on demand. To keep the memory
+ * bounded for large maps, the raster keeps the tiles it used in least
+ * recently used order and gives back to the kernel the pages of the least
+ * recently used one when more than MaxTiles tiles are in use.
+ *
+ * Lookups update the tile list, so a raster must not be used by several
+ * threads at the same time.
+ */
+class ElevationRaster : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ElevationRaster ();
+
+  virtual ~ElevationRaster ();
+
+  /**
+   * \param filename raster file.
+   * \returns false if the file could not be opened or is not a valid
+   *          raster.
+   */
+  bool Open (std::string filename);
+
+  /**
+   * Unmaps the raster. Called on dispose.
+   */
+  void Close (void);
+
+  /**
+   * \param x x coordinate in m.
+   * \param y y coordinate in m.
+   * \returns height of the terrain in m.
+   */
+  double GetHeight (double x, double y);
+
+  /**
+   * \param positions positions to look up.
+   * \param [out] heights height of the terrain at each position in m.
+   * \param n number of positions.
+   *
+   * Looks up the heights of a whole fleet in a single call.
+   */
+  void GetHeights (const Vector *positions, double *heights, uint32_t n);
+
+  /**
+   * \returns number of tiles in use.
+   */
+  uint32_t GetNResidentTiles (void) const;
+
+private:
+  virtual void DoDispose (void);
+
+  /**
+   * \param column column of the sample.
+   * \param row row of the sample.
+   * \returns height of the sample.
+   */
+  float GetSample (uint32_t column, uint32_t row);
+
+  /**
+   * \param tile index of the tile.
+   *
+   * Moves the tile to the front of the least recently used list, and
+   * releases the last one if too many tiles are in use.
+   */
+  void Touch (uint32_t tile);
+
+  uint32_t m_maxTiles;                  // maximum number of tiles in use
+
+  void *m_map;                          // mapped file
+  size_t m_mapSize;                     // size of the mapped file
+  const float *m_tiles;                 // first tile
+  ElevationRasterHeader m_header;       // header of the file
+  uint32_t m_tileShift;                 // log2 of the tile size
+  uint32_t m_tileColumns;               // tiles per row of tiles
+
+  // least recently used list of the tiles in use, linked by tile index
+  std::vector<uint32_t> m_previous;     // more recently used tile
+  std::vector<uint32_t> m_next;         // less recently used tile
+  std::vector<bool> m_resident;         // the tile is in the list
+  uint32_t m_first;                     // most recently used tile
+  uint32_t m_last;                      // least recently used tile
+  uint32_t m_residentTiles;             // tiles in the list
+};
+
+} // namespace ns3
+
+#endif /* ELEVATION_RASTER_H */
@@ -0,0 +1,76 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+/*
+ * Converts a file of course changes recorded by MobilityTraceRecorder to
+ * the text written by MobilityHelper::EnableAscii.
+ *
+ * Usage:
+ *
+ *  ./waf --run "mobility-trace-to-ascii --input=mobility.evc --output=mobility.txt"
+ *
+ *  The output is written to the standard output if no output file is given.
+ */
+
+#include <fstream>
+#include <iostream>
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+
+using namespace ns3;
+
+int main (int argc, char *argv[])
+{
+  std::string input;
+  std::string output;
+
+  CommandLine cmd;
+  cmd.AddValue ("input", "Mobility trace record file", input);
+  cmd.AddValue ("output", "Text file, the standard output if empty", output);
+  cmd.Parse (argc, argv);
+
+  if (input.empty ())
+    {
+      std::cout << "Usage of " << argv[0] << " :\n\n"
+      "./waf --run \"mobility-trace-to-ascii --input=mobility.evc --output=mobility.txt\"\n";
+      return 0;
+    }
+
+  std::ofstream outputFile;
+  if (!output.empty ())
+    {
+      outputFile.open (output.c_str ());
+      if (!outputFile.is_open ())
+        {
+          std::cerr << "Could not open " << output << " for writing\n";
+          return 1;
+        }
+    }
+  std::ostream &os = output.empty () ? std::cout : outputFile;
+
+  if (!MobilityTraceRecorder::Decode (input, os))
+    {
+      std::cerr << input << " is not a valid mobility trace record\n";
+      return 1;
+    }
+  return 0;
+}
@@ -0,0 +1,154 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+/*
+ * Measures how long Ns2MobilityHelper takes to read an ns-2 movement trace.
+ *
+ * Usage:
+ *
+ *  ./waf --run "ns2-trace-benchmark --traceFile=Madrid-100.1.tcl --nodeNum=100"
+ *
+ *  With --lines, a synthetic trace of that number of setdest commands of
+ *  nodeNum nodes, sorted by time, is written to --output and read instead.
+ *  With --streaming, the trace is read as the simulation advances (see
+ *  Ns2MobilityHelper::EnableStreaming) and the simulation is run until its
+ *  end, so all the commands are read with a bounded memory.
+ *  A compiled trace (see compile-mobility-trace) is replayed with
+ *  CompiledMobilityTraceHelper, and the simulation is run until its end.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/ns2-mobility-helper.h"
+
+using namespace ns3;
+
+/**
+ * \param filename file to write.
+ * \param lines number of setdest commands.
+ * \param nodeNum number of nodes.
+ * \returns false if the file could not be written.
+ *
+ * Writes a synthetic trace: the initial positions of the nodes and then
+ * one setdest of each node every second, in turns.
+ */
+static bool
+WriteSyntheticTrace (std::string filename, uint64_t lines, uint32_t nodeNum)
+{
+  std::FILE *file = std::fopen (filename.c_str (), "w");
+  if (file == 0)
+    {
+      return false;
+    }
+  uint64_t state = 88172645463325252ULL;
+  for (uint32_t i = 0; i < nodeNum; i++)
+    {
+      std::fprintf (file, "$node_(%u) set X_ %.2f\n$node_(%u) set Y_ %.2f\n$node_(%u) set Z_ 0.0\n",
+                    i, (double) (i % 100) * 20, i, (double) (i / 100) * 20, i);
+    }
+  for (uint64_t line = 0; line < lines; line++)
+    {
+      // xorshift
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      std::fprintf (file, "$ns_ at %.1f \"$node_(%u) setdest %.2f %.2f %.2f\"\n",
+                    (double) (line / nodeNum), (uint32_t) (line % nodeNum),
+                    (double) (state % 200000) / 100, (double) ((state >> 20) % 200000) / 100,
+                    (double) ((state >> 40) % 1500) / 100);
+    }
+  return std::fclose (file) == 0;
+}
+
+int main (int argc, char *argv[])
+{
+  std::string traceFile = "Madrid-100.1.tcl";
+  uint32_t nodeNum = 100;
+  uint64_t lines = 0;
+  std::string output = "ns2-trace-benchmark.tcl";
+  double streaming = 0;
+
+  CommandLine cmd;
+  cmd.AddValue ("traceFile", "Ns2 movement trace file", traceFile);
+  cmd.AddValue ("nodeNum", "Number of nodes", nodeNum);
+  cmd.AddValue ("lines", "Write and read a synthetic trace of this number of commands instead", lines);
+  cmd.AddValue ("output", "Synthetic trace file", output);
+  cmd.AddValue ("streaming", "Look-ahead in s of the streaming mode, 0 to read the whole trace at install", streaming);
+  cmd.Parse (argc, argv);
+
+  if (lines > 0)
+    {
+      if (!WriteSyntheticTrace (output, lines, nodeNum))
+        {
+          std::cerr << "Could not write " << output << "\n";
+          return 1;
+        }
+      traceFile = output;
+    }
+
+  NodeContainer nodes;
+  nodes.Create (nodeNum);
+
+  bool compiled = CompiledMobilityTraceHelper::IsCompiledTrace (traceFile);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  if (compiled)
+    {
+      CompiledMobilityTraceHelper helper = CompiledMobilityTraceHelper (traceFile);
+      if (streaming > 0)
+        {
+          helper.SetLookAhead (Seconds (streaming));
+        }
+      helper.Install ();
+    }
+  else
+    {
+      Ns2MobilityHelper ns2 = Ns2MobilityHelper (traceFile);
+      if (streaming > 0)
+        {
+          ns2.EnableStreaming (Seconds (streaming));
+        }
+      ns2.Install ();
+    }
+  double installTime = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+  start = std::chrono::steady_clock::now ();
+  if (streaming > 0 || compiled)
+    {
+      Simulator::Run ();
+    }
+  double runTime = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+  std::cout << traceFile << ": install " << installTime << " s";
+  if (streaming > 0 || compiled)
+    {
+      std::cout << ", run " << runTime << " s";
+    }
+  std::cout << "\n";
+
+  Simulator::Destroy ();
+  return 0;
+}
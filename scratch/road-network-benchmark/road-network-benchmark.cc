@@ -0,0 +1,164 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+/*
+ * Measures how long vehicles driving with RoadNetworkMobilityModel take to
+ * simulate.
+ *
+ * Usage:
+ *
+ *  ./waf --run "road-network-benchmark --nodeNum=50000 --gridSize=100 --duration=600"
+ *
+ *  The vehicles drive on a square grid of two-way streets, gridSize
+ *  junctions a side and 100 m apart, with speed limits of 30, 50 and 70
+ *  km/h, unless --networkFile gives a road network file to read (see
+ *  RoadNetwork::Load). They start at random positions and are sampled
+ *  every second, as a consumption model would.
+ */
+
+#include <chrono>
+#include <iostream>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+
+using namespace ns3;
+
+/**
+ * \param network road network to fill.
+ * \param size junctions on each side of the grid.
+ */
+static void
+BuildGrid (Ptr<RoadNetwork> network, uint32_t size)
+{
+  double limits[] = { 30 / 3.6, 50 / 3.6, 70 / 3.6 };
+  for (uint32_t y = 0; y < size; y++)
+    {
+      for (uint32_t x = 0; x < size; x++)
+        {
+          network->AddJunction (Vector (x * 100.0, y * 100.0, 0));
+        }
+    }
+  for (uint32_t y = 0; y < size; y++)
+    {
+      for (uint32_t x = 0; x < size; x++)
+        {
+          uint32_t j = y * size + x;
+          if (x + 1 < size)
+            {
+              // avenues every 10 streets
+              double limit = limits[y % 10 == 0 ? 2 : y % 2];
+              network->AddRoad (j, j + 1, limit);
+              network->AddRoad (j + 1, j, limit);
+            }
+          if (y + 1 < size)
+            {
+              double limit = limits[x % 10 == 0 ? 2 : x % 2];
+              network->AddRoad (j, j + size, limit);
+              network->AddRoad (j + size, j, limit);
+            }
+        }
+    }
+}
+
+/**
+ * \param models mobility models of the vehicles.
+ * \param [out] distance sum of the distances of the vehicles from the origin.
+ *
+ * Reads the positions of the vehicles every second.
+ */
+static void
+Sample (const std::vector<Ptr<MobilityModel> > *models, double *distance)
+{
+  for (uint32_t i = 0; i < models->size (); i++)
+    {
+      Vector position = (*models)[i]->GetPosition ();
+      *distance += position.x + position.y;
+    }
+  Simulator::Schedule (Seconds (1), &Sample, models, distance);
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t nodeNum = 50000;
+  uint32_t gridSize = 100;
+  std::string networkFile;
+  double duration = 600;
+  uint32_t cacheSize = 4096;
+
+  CommandLine cmd;
+  cmd.AddValue ("nodeNum", "Number of vehicles", nodeNum);
+  cmd.AddValue ("gridSize", "Junctions on each side of the grid", gridSize);
+  cmd.AddValue ("networkFile", "Road network file to read instead of the grid", networkFile);
+  cmd.AddValue ("duration", "Duration of the simulation, in s", duration);
+  cmd.AddValue ("cacheSize", "Paths kept in the route cache", cacheSize);
+  cmd.Parse (argc, argv);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  Ptr<RoadNetwork> network = Create<RoadNetwork> ();
+  network->SetRouteCacheSize (cacheSize);
+  if (networkFile.empty ())
+    {
+      BuildGrid (network, gridSize);
+    }
+  else if (!network->Load (networkFile))
+    {
+      std::cerr << "Could not read road network " << networkFile << "\n";
+      return 1;
+    }
+  if (network->GetNJunctions () == 0)
+    {
+      std::cerr << "Empty road network\n";
+      return 1;
+    }
+
+  NodeContainer nodes;
+  nodes.Create (nodeNum);
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+  std::vector<Ptr<MobilityModel> > models;
+  models.reserve (nodeNum);
+  for (uint32_t i = 0; i < nodeNum; i++)
+    {
+      Ptr<RoadNetworkMobilityModel> model = CreateObject<RoadNetworkMobilityModel> ();
+      model->SetAttribute ("Pause", StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=30.0]"));
+      model->SetAttribute ("SpeedFactor", StringValue ("ns3::UniformRandomVariable[Min=0.8|Max=1.1]"));
+      model->SetPosition (network->GetJunctionPosition (random->GetInteger (0, network->GetNJunctions () - 1)));
+      model->SetRoadNetwork (network);
+      nodes.Get (i)->AggregateObject (model);
+      models.push_back (model);
+    }
+  double installTime = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+  double distance = 0;
+  Simulator::Schedule (Seconds (1), &Sample, &models, &distance);
+  Simulator::Stop (Seconds (duration));
+  start = std::chrono::steady_clock::now ();
+  Simulator::Run ();
+  double runTime = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+  std::cout << nodeNum << " vehicles on " << network->GetNJunctions () << " junctions and "
+            << network->GetNRoads () << " roads: install " << installTime << " s, run "
+            << duration << " s in " << runTime << " s\n";
+
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,114 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#ifndef COMPILED_MOBILITY_TRACE_FORMAT_H
+#define COMPILED_MOBILITY_TRACE_FORMAT_H
+
+#include <stdint.h>
+
+/**
+ * \ingroup mobility
+ * \file
+ *
+ * Binary format of the mobility traces written by
+ * ns3::CompiledMobilityTraceWriter and replayed by
+ * ns3::CompiledMobilityTraceHelper.
+ *
+ * The movement of each node is a list of legs sorted by time: at the time
+ * of a leg the node is at the position of the leg, and it moves with the
+ * velocity of the leg until the next one. The flags of a leg tell how it is
+ * replayed: the node is placed at its position (which stops it) if it
+ * jumped there, and it takes its velocity if it changed its velocity at a
+ * position it reached moving. Either way the node changes its course once,
+ * as in the original movement, except when it jumped and kept moving.
+ *
+ * A file is a CompiledMobilityTraceHeader padded to
+ * COMPILED_MOBILITY_TRACE_HEADER_SIZE bytes, followed by:
+ *  - the node table: header.nodes CompiledMobilityTraceNode, entry i for
+ *    node ID i.
+ *  - the time index: for each node, the time of every
+ *    header.indexStride-th leg of the node, from the first one, as int64_t,
+ *    so a time is found by a binary search of the index and a scan of at
+ *    most indexStride legs.
+ *  - the legs: header.legs CompiledMobilityTraceLeg, those of each node one
+ *    after the other, starting at header.legOffset.
+ *
+ * Times are in ns. Everything is in the byte order of the machine that
+ * wrote it.
+ */
+
+#define COMPILED_MOBILITY_TRACE_MAGIC "EVMOB\r\n"
+#define COMPILED_MOBILITY_TRACE_BYTE_ORDER 0x01020304
+#define COMPILED_MOBILITY_TRACE_VERSION 1
+#define COMPILED_MOBILITY_TRACE_HEADER_SIZE 4096
+
+#define COMPILED_MOBILITY_TRACE_NODE_PRESENT 1     //!< the node is in the trace
+
+#define COMPILED_MOBILITY_TRACE_LEG_POSITION 1     //!< the position of the node is set, which stops it
+#define COMPILED_MOBILITY_TRACE_LEG_VELOCITY 2     //!< the velocity of the node is set, after its position if both are
+
+struct CompiledMobilityTraceHeader
+{
+  char magic[8];         //!< COMPILED_MOBILITY_TRACE_MAGIC
+  uint32_t byteOrder;    //!< COMPILED_MOBILITY_TRACE_BYTE_ORDER as written by the writer
+  uint32_t version;      //!< COMPILED_MOBILITY_TRACE_VERSION
+  uint32_t nodes;        //!< entries of the node table, the highest node ID + 1
+  uint32_t indexStride;  //!< legs per entry of the time index
+  uint64_t legs;         //!< number of legs
+  uint64_t indexEntries; //!< entries of the time index
+  uint64_t nodeOffset;   //!< offset of the node table
+  uint64_t indexOffset;  //!< offset of the time index
+  uint64_t legOffset;    //!< offset of the legs
+  int64_t start;         //!< time of the first leg, 0 if there is none
+  int64_t stop;          //!< time of the last leg, 0 if there is none
+  double minX;           //!< bounding box of the positions of the nodes
+  double minY;
+  double minZ;
+  double maxX;
+  double maxY;
+  double maxZ;
+};
+
+struct CompiledMobilityTraceNode
+{
+  uint64_t firstLeg;     //!< index of the first leg of the node
+  uint64_t firstEntry;   //!< index of the first entry of the node in the time index
+  uint32_t legs;         //!< number of legs of the node
+  uint32_t flags;        //!< COMPILED_MOBILITY_TRACE_NODE_PRESENT
+  double x;              //!< position of the node before its first leg
+  double y;
+  double z;
+};
+
+struct CompiledMobilityTraceLeg
+{
+  int64_t time;          //!< time of the leg
+  uint32_t flags;        //!< COMPILED_MOBILITY_TRACE_LEG_POSITION and/or COMPILED_MOBILITY_TRACE_LEG_VELOCITY
+  uint32_t reserved;     //!< 0
+  double x;              //!< position at the time of the leg
+  double y;
+  double z;
+  double vx;             //!< velocity from the time of the leg
+  double vy;
+  double vz;
+};
+
+#endif /* COMPILED_MOBILITY_TRACE_FORMAT_H */
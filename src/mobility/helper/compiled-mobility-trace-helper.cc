@@ -0,0 +1,636 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/constant-velocity-mobility-model.h"
+#include "compiled-mobility-trace-helper.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CompiledMobilityTraceHelper");
+
+CompiledMobilityTrace::CompiledMobilityTrace ()
+  : m_map (0),
+    m_mapSize (0),
+    m_nodes (0),
+    m_index (0),
+    m_legs (0)
+{
+  std::memset (&m_header, 0, sizeof (m_header));
+}
+
+CompiledMobilityTrace::~CompiledMobilityTrace ()
+{
+  Close ();
+}
+
+bool
+CompiledMobilityTrace::Open (std::string filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+  Close ();
+
+  int fd = open (filename.c_str (), O_RDONLY);
+  if (fd < 0)
+    {
+      NS_LOG_ERROR ("Could not open compiled mobility trace " << filename);
+      return false;
+    }
+  struct stat st;
+  if (fstat (fd, &st) != 0 || (size_t) st.st_size < COMPILED_MOBILITY_TRACE_HEADER_SIZE)
+    {
+      NS_LOG_ERROR (filename << " is not a compiled mobility trace");
+      close (fd);
+      return false;
+    }
+  size_t size = st.st_size;
+  void *map = mmap (0, size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (map == MAP_FAILED)
+    {
+      NS_LOG_ERROR ("Could not map compiled mobility trace " << filename);
+      return false;
+    }
+
+  CompiledMobilityTraceHeader header;
+  std::memcpy (&header, map, sizeof (header));
+  bool valid = std::memcmp (header.magic, COMPILED_MOBILITY_TRACE_MAGIC, sizeof (header.magic)) == 0
+    && header.byteOrder == COMPILED_MOBILITY_TRACE_BYTE_ORDER
+    && header.version == COMPILED_MOBILITY_TRACE_VERSION
+    && header.indexStride > 0;
+  if (!valid)
+    {
+      NS_LOG_ERROR (filename << " is not a compiled mobility trace of version " << COMPILED_MOBILITY_TRACE_VERSION
+                             << " written in the byte order of this machine");
+      munmap (map, size);
+      return false;
+    }
+  if (header.nodeOffset > size || (size - header.nodeOffset) / sizeof (CompiledMobilityTraceNode) < header.nodes
+      || header.indexOffset > size || (size - header.indexOffset) / sizeof (int64_t) < header.indexEntries
+      || header.legOffset > size || (size - header.legOffset) / sizeof (CompiledMobilityTraceLeg) < header.legs)
+    {
+      NS_LOG_ERROR ("Compiled mobility trace " << filename << " is truncated");
+      munmap (map, size);
+      return false;
+    }
+  const CompiledMobilityTraceNode *nodes = (const CompiledMobilityTraceNode *) ((const char *) map + header.nodeOffset);
+  for (uint32_t i = 0; i < header.nodes; i++)
+    {
+      uint64_t entries = (nodes[i].legs + header.indexStride - 1) / header.indexStride;
+      if (nodes[i].firstLeg > header.legs || header.legs - nodes[i].firstLeg < nodes[i].legs
+          || nodes[i].firstEntry > header.indexEntries || header.indexEntries - nodes[i].firstEntry < entries)
+        {
+          NS_LOG_ERROR ("Compiled mobility trace " << filename << " is corrupted");
+          munmap (map, size);
+          return false;
+        }
+    }
+
+  m_map = map;
+  m_mapSize = size;
+  m_header = header;
+  m_nodes = nodes;
+  m_index = (const int64_t *) ((const char *) map + header.indexOffset);
+  m_legs = (const CompiledMobilityTraceLeg *) ((const char *) map + header.legOffset);
+
+  NS_LOG_DEBUG ("Compiled mobility trace of " << header.nodes << " nodes and " << header.legs << " legs");
+  return true;
+}
+
+void
+CompiledMobilityTrace::Close (void)
+{
+  if (m_map == 0)
+    {
+      return;
+    }
+  NS_LOG_FUNCTION (this);
+  munmap (m_map, m_mapSize);
+  m_map = 0;
+  m_mapSize = 0;
+  m_nodes = 0;
+  m_index = 0;
+  m_legs = 0;
+  std::memset (&m_header, 0, sizeof (m_header));
+}
+
+const CompiledMobilityTraceHeader &
+CompiledMobilityTrace::GetHeader (void) const
+{
+  return m_header;
+}
+
+bool
+CompiledMobilityTrace::HasNode (uint32_t nodeId) const
+{
+  return nodeId < m_header.nodes && (m_nodes[nodeId].flags & COMPILED_MOBILITY_TRACE_NODE_PRESENT);
+}
+
+const CompiledMobilityTraceNode &
+CompiledMobilityTrace::GetNode (uint32_t nodeId) const
+{
+  NS_ASSERT (nodeId < m_header.nodes);
+  return m_nodes[nodeId];
+}
+
+const CompiledMobilityTraceLeg *
+CompiledMobilityTrace::GetLegs (uint32_t nodeId) const
+{
+  NS_ASSERT (nodeId < m_header.nodes);
+  return m_legs + m_nodes[nodeId].firstLeg;
+}
+
+uint32_t
+CompiledMobilityTrace::FindLeg (uint32_t nodeId, int64_t time) const
+{
+  const CompiledMobilityTraceNode &node = GetNode (nodeId);
+  const CompiledMobilityTraceLeg *legs = m_legs + node.firstLeg;
+  const int64_t *begin = m_index + node.firstEntry;
+  const int64_t *end = begin + (node.legs + m_header.indexStride - 1) / m_header.indexStride;
+
+  // the legs from the first entry after the time on are after it
+  const int64_t *after = std::upper_bound (begin, end, time);
+  if (after == begin)
+    {
+      return 0;
+    }
+  uint64_t leg = (uint64_t) (after - begin - 1) * m_header.indexStride;
+  uint64_t last = std::min<uint64_t> (node.legs, (uint64_t) (after - begin) * m_header.indexStride);
+  while (leg < last && legs[leg].time <= time)
+    {
+      leg++;
+    }
+  return leg;
+}
+
+
+CompiledMobilityTraceWriter::CompiledMobilityTraceWriter ()
+  : m_indexStride (64)
+{
+}
+
+void
+CompiledMobilityTraceWriter::SetIndexStride (uint32_t stride)
+{
+  NS_ASSERT (stride > 0);
+  m_indexStride = stride;
+}
+
+void
+CompiledMobilityTraceWriter::Install (NodeContainer nodes)
+{
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); i++)
+    {
+      Ptr<MobilityModel> model = (*i)->GetObject<MobilityModel> ();
+      if (model == 0)
+        {
+          NS_LOG_ERROR ("Node " << (*i)->GetId () << " has no mobility model");
+          continue;
+        }
+      uint32_t nodeId = (*i)->GetId ();
+      if (m_tracks.size () <= nodeId)
+        {
+          m_tracks.resize (nodeId + 1);
+        }
+      Track &track = m_tracks[nodeId];
+      if (track.present)
+        {
+          continue;
+        }
+      track.present = true;
+      track.position = model->GetPosition ();
+      model->TraceConnectWithoutContext ("CourseChange", MakeCallback (&CompiledMobilityTraceWriter::CourseChanged, this));
+    }
+}
+
+void
+CompiledMobilityTraceWriter::InstallAll (void)
+{
+  Install (NodeContainer::GetGlobal ());
+}
+
+void
+CompiledMobilityTraceWriter::CourseChanged (Ptr<const MobilityModel> model)
+{
+  Track &track = m_tracks[model->GetObject<Node> ()->GetId ()];
+  CompiledMobilityTraceLeg leg;
+  Vector position = model->GetPosition ();
+  Vector velocity = model->GetVelocity ();
+  leg.time = Simulator::Now ().GetNanoSeconds ();
+  // setting the position of a ConstantVelocityMobilityModel stops it, so
+  // a node which did not jump only changed its velocity
+  Vector expected = track.position;
+  if (!track.legs.empty ())
+    {
+      const CompiledMobilityTraceLeg &last = track.legs.back ();
+      double elapsed = (leg.time - last.time) * 1e-9;
+      expected = Vector (last.x + last.vx * elapsed, last.y + last.vy * elapsed, last.z + last.vz * elapsed);
+    }
+  if (CalculateDistance (expected, position) > 1e-6)
+    {
+      leg.flags = COMPILED_MOBILITY_TRACE_LEG_POSITION;
+      if (velocity.x != 0 || velocity.y != 0 || velocity.z != 0)
+        {
+          leg.flags |= COMPILED_MOBILITY_TRACE_LEG_VELOCITY;
+        }
+    }
+  else
+    {
+      leg.flags = COMPILED_MOBILITY_TRACE_LEG_VELOCITY;
+    }
+  leg.reserved = 0;
+  leg.x = position.x;
+  leg.y = position.y;
+  leg.z = position.z;
+  leg.vx = velocity.x;
+  leg.vy = velocity.y;
+  leg.vz = velocity.z;
+  track.legs.push_back (leg);
+}
+
+bool
+CompiledMobilityTraceWriter::Write (std::string filename) const
+{
+  NS_LOG_FUNCTION (this << filename);
+  CompiledMobilityTraceHeader header;
+  std::memset (&header, 0, sizeof (header));
+  std::memcpy (header.magic, COMPILED_MOBILITY_TRACE_MAGIC, sizeof (header.magic));
+  header.byteOrder = COMPILED_MOBILITY_TRACE_BYTE_ORDER;
+  header.version = COMPILED_MOBILITY_TRACE_VERSION;
+  header.nodes = m_tracks.size ();
+  header.indexStride = m_indexStride;
+
+  std::vector<CompiledMobilityTraceNode> nodes (m_tracks.size ());
+  bool first = true;
+  for (uint32_t i = 0; i < m_tracks.size (); i++)
+    {
+      const Track &track = m_tracks[i];
+      CompiledMobilityTraceNode &node = nodes[i];
+      std::memset (&node, 0, sizeof (node));
+      node.firstLeg = header.legs;
+      node.firstEntry = header.indexEntries;
+      if (!track.present)
+        {
+          continue;
+        }
+      node.legs = track.legs.size ();
+      node.flags = COMPILED_MOBILITY_TRACE_NODE_PRESENT;
+      node.x = track.position.x;
+      node.y = track.position.y;
+      node.z = track.position.z;
+      header.legs += node.legs;
+      header.indexEntries += (node.legs + m_indexStride - 1) / m_indexStride;
+
+      if (first)
+        {
+          header.minX = header.maxX = node.x;
+          header.minY = header.maxY = node.y;
+          header.minZ = header.maxZ = node.z;
+          first = false;
+        }
+      header.minX = std::min (header.minX, node.x);
+      header.minY = std::min (header.minY, node.y);
+      header.minZ = std::min (header.minZ, node.z);
+      header.maxX = std::max (header.maxX, node.x);
+      header.maxY = std::max (header.maxY, node.y);
+      header.maxZ = std::max (header.maxZ, node.z);
+      for (uint32_t j = 0; j < track.legs.size (); j++)
+        {
+          const CompiledMobilityTraceLeg &leg = track.legs[j];
+          header.minX = std::min (header.minX, leg.x);
+          header.minY = std::min (header.minY, leg.y);
+          header.minZ = std::min (header.minZ, leg.z);
+          header.maxX = std::max (header.maxX, leg.x);
+          header.maxY = std::max (header.maxY, leg.y);
+          header.maxZ = std::max (header.maxZ, leg.z);
+        }
+      if (!track.legs.empty ())
+        {
+          if (header.legs == node.legs || track.legs.front ().time < header.start)
+            {
+              header.start = track.legs.front ().time;
+            }
+          header.stop = std::max (header.stop, track.legs.back ().time);
+        }
+    }
+  header.nodeOffset = COMPILED_MOBILITY_TRACE_HEADER_SIZE;
+  header.indexOffset = header.nodeOffset + header.nodes * sizeof (CompiledMobilityTraceNode);
+  // the legs start at a cache line
+  header.legOffset = (header.indexOffset + header.indexEntries * sizeof (int64_t) + 63) / 64 * 64;
+
+  std::FILE *file = std::fopen (filename.c_str (), "wb");
+  if (file == 0)
+    {
+      NS_LOG_ERROR ("Could not open " << filename << " for writing");
+      return false;
+    }
+  std::vector<char> padding (COMPILED_MOBILITY_TRACE_HEADER_SIZE - sizeof (header), 0);
+  std::fwrite (&header, sizeof (header), 1, file);
+  std::fwrite (&padding[0], 1, padding.size (), file);
+  if (!nodes.empty ())
+    {
+      std::fwrite (&nodes[0], sizeof (CompiledMobilityTraceNode), nodes.size (), file);
+    }
+  for (uint32_t i = 0; i < m_tracks.size (); i++)
+    {
+      const std::vector<CompiledMobilityTraceLeg> &legs = m_tracks[i].legs;
+      for (uint32_t j = 0; j < legs.size (); j += m_indexStride)
+        {
+          std::fwrite (&legs[j].time, sizeof (int64_t), 1, file);
+        }
+    }
+  padding.assign (header.legOffset - (header.indexOffset + header.indexEntries * sizeof (int64_t)), 0);
+  if (!padding.empty ())
+    {
+      std::fwrite (&padding[0], 1, padding.size (), file);
+    }
+  for (uint32_t i = 0; i < m_tracks.size (); i++)
+    {
+      const std::vector<CompiledMobilityTraceLeg> &legs = m_tracks[i].legs;
+      if (!legs.empty ())
+        {
+          std::fwrite (&legs[0], sizeof (CompiledMobilityTraceLeg), legs.size (), file);
+        }
+    }
+  bool ok = !std::ferror (file);
+  ok = std::fclose (file) == 0 && ok;
+  if (!ok)
+    {
+      NS_LOG_ERROR ("Could not write " << filename);
+    }
+  NS_LOG_DEBUG ("Wrote " << header.nodes << " nodes and " << header.legs << " legs to " << filename);
+  return ok;
+}
+
+
+/**
+ * \brief Schedules the legs of a compiled trace as the simulation advances,
+ * see CompiledMobilityTraceHelper::SetLookAhead.
+ *
+ * The next leg of each node is kept in a queue by time, so each advance
+ * only touches the legs it schedules.
+ */
+class CompiledMobilityTracePlayer : public SimpleRefCount<CompiledMobilityTracePlayer>
+{
+public:
+  /**
+   * \param trace trace to replay
+   * \param lookAhead how long before its time each leg is scheduled, 0 to
+   *        schedule them all now
+   */
+  CompiledMobilityTracePlayer (Ptr<CompiledMobilityTrace> trace, Time lookAhead);
+  /**
+   * \param nodeId node ID in the trace
+   * \param model its mobility model
+   * \param next index of the first leg of the node to schedule
+   */
+  void Add (uint32_t nodeId, Ptr<ConstantVelocityMobilityModel> model, uint32_t next);
+  /**
+   * Schedules the legs up to the look-ahead and the next advance.
+   */
+  void Advance (void);
+
+private:
+  /// Node being replayed
+  struct Track
+  {
+    Ptr<ConstantVelocityMobilityModel> model;   //!< mobility model of the node
+    const CompiledMobilityTraceLeg *next;       //!< next leg to schedule
+    const CompiledMobilityTraceLeg *end;        //!< end of the legs of the node
+  };
+  /// Time and index of the track of the next leg of a node
+  typedef std::pair<int64_t, uint32_t> Head;
+
+  Ptr<CompiledMobilityTrace> m_trace;          //!< trace, kept mapped while the legs are scheduled
+  Time m_lookAhead;                            //!< how long before its time each leg is scheduled
+  Time m_installTime;                          //!< time the trace was installed at
+  std::vector<Track> m_tracks;                 //!< nodes being replayed
+  std::priority_queue<Head, std::vector<Head>, std::greater<Head> > m_heads; //!< next leg of each node
+};
+
+/**
+ * \param model mobility model of the node
+ * \param flags what the leg changes
+ * \param position position at the time of the leg
+ * \param velocity velocity from the time of the leg
+ */
+static void
+ApplyLeg (Ptr<ConstantVelocityMobilityModel> model, uint32_t flags, Vector position, Vector velocity)
+{
+  if (flags & COMPILED_MOBILITY_TRACE_LEG_POSITION)
+    {
+      model->SetPosition (position);
+    }
+  if (flags & COMPILED_MOBILITY_TRACE_LEG_VELOCITY)
+    {
+      model->SetVelocity (velocity);
+    }
+}
+
+CompiledMobilityTracePlayer::CompiledMobilityTracePlayer (Ptr<CompiledMobilityTrace> trace, Time lookAhead)
+  : m_trace (trace),
+    m_lookAhead (lookAhead),
+    m_installTime (Simulator::Now ())
+{
+}
+
+void
+CompiledMobilityTracePlayer::Add (uint32_t nodeId, Ptr<ConstantVelocityMobilityModel> model, uint32_t next)
+{
+  const CompiledMobilityTraceLeg *legs = m_trace->GetLegs (nodeId);
+  Track track;
+  track.model = model;
+  track.next = legs + next;
+  track.end = legs + m_trace->GetNode (nodeId).legs;
+  if (track.next == track.end)
+    {
+      return;
+    }
+  m_heads.push (Head (track.next->time, m_tracks.size ()));
+  m_tracks.push_back (track);
+}
+
+void
+CompiledMobilityTracePlayer::Advance (void)
+{
+  bool all = m_lookAhead.IsZero ();
+  int64_t limit = (Simulator::Now () + m_lookAhead - m_installTime).GetNanoSeconds ();
+  int64_t elapsed = (Simulator::Now () - m_installTime).GetNanoSeconds ();
+  while (!m_heads.empty () && (all || m_heads.top ().first <= limit))
+    {
+      uint32_t index = m_heads.top ().second;
+      m_heads.pop ();
+      Track &track = m_tracks[index];
+      const CompiledMobilityTraceLeg &leg = *track.next;
+      Simulator::Schedule (NanoSeconds (leg.time - elapsed), &ApplyLeg, track.model, leg.flags,
+                           Vector (leg.x, leg.y, leg.z), Vector (leg.vx, leg.vy, leg.vz));
+      if (++track.next == track.end)
+        {
+          track.model = 0;
+        }
+      else
+        {
+          m_heads.push (Head (track.next->time, index));
+        }
+    }
+  if (m_heads.empty ())
+    {
+      return;
+    }
+  Simulator::Schedule (NanoSeconds (m_heads.top ().first - limit), &CompiledMobilityTracePlayer::Advance,
+                       Ptr<CompiledMobilityTracePlayer> (this));
+}
+
+
+CompiledMobilityTraceHelper::CompiledMobilityTraceHelper (std::string filename)
+  : m_trace (Create<CompiledMobilityTrace> ()),
+    m_startTime (Seconds (0)),
+    m_lookAhead (Seconds (60))
+{
+  if (!m_trace->Open (filename))
+    {
+      NS_FATAL_ERROR ("Could not open compiled mobility trace " << filename << ", aborting here \n");
+    }
+}
+
+bool
+CompiledMobilityTraceHelper::IsCompiledTrace (std::string filename)
+{
+  std::FILE *file = std::fopen (filename.c_str (), "rb");
+  if (file == 0)
+    {
+      return false;
+    }
+  CompiledMobilityTraceHeader header;
+  bool compiled = std::fread (header.magic, sizeof (header.magic), 1, file) == 1
+    && std::memcmp (header.magic, COMPILED_MOBILITY_TRACE_MAGIC, sizeof (header.magic)) == 0;
+  std::fclose (file);
+  return compiled;
+}
+
+Ptr<CompiledMobilityTrace>
+CompiledMobilityTraceHelper::GetTrace (void) const
+{
+  return m_trace;
+}
+
+MobilityTraceInfo
+CompiledMobilityTraceHelper::GetTraceInfo (void) const
+{
+  MobilityTraceInfo info;
+  const CompiledMobilityTraceHeader &header = m_trace->GetHeader ();
+  for (uint32_t i = 0; i < header.nodes; i++)
+    {
+      if (m_trace->HasNode (i))
+        {
+          info.nodeIds.push_back (i);
+        }
+    }
+  info.start = NanoSeconds (header.start);
+  info.stop = NanoSeconds (header.stop);
+  info.bounds = Box (header.minX, header.maxX, header.minY, header.maxY, header.minZ, header.maxZ);
+  return info;
+}
+
+void
+CompiledMobilityTraceHelper::SetStartTime (Time start)
+{
+  m_startTime = start;
+}
+
+void
+CompiledMobilityTraceHelper::SetLookAhead (Time lookAhead)
+{
+  m_lookAhead = lookAhead;
+}
+
+void
+CompiledMobilityTraceHelper::Install (void) const
+{
+  Install (NodeContainer::GetGlobal ());
+}
+
+void
+CompiledMobilityTraceHelper::Install (NodeContainer nodes) const
+{
+  Ptr<CompiledMobilityTracePlayer> player = Create<CompiledMobilityTracePlayer> (m_trace, m_lookAhead);
+  bool resume = m_startTime.IsStrictlyPositive ();
+  int64_t start = m_startTime.GetNanoSeconds ();
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); i++)
+    {
+      uint32_t nodeId = (*i)->GetId ();
+      if (!m_trace->HasNode (nodeId))
+        {
+          continue;
+        }
+      Ptr<ConstantVelocityMobilityModel> model = (*i)->GetObject<ConstantVelocityMobilityModel> ();
+      if (model == 0)
+        {
+          model = CreateObject<ConstantVelocityMobilityModel> ();
+          (*i)->AggregateObject (model);
+        }
+
+      const CompiledMobilityTraceNode &node = m_trace->GetNode (nodeId);
+      Vector position (node.x, node.y, node.z);
+      uint32_t next = 0;
+      if (resume)
+        {
+          // the legs up to the start time only give where the node is
+          next = m_trace->FindLeg (nodeId, start);
+          Vector velocity;
+          if (next > 0)
+            {
+              const CompiledMobilityTraceLeg &leg = m_trace->GetLegs (nodeId)[next - 1];
+              double traveled = (start - leg.time) * 1e-9;
+              position = Vector (leg.x + leg.vx * traveled, leg.y + leg.vy * traveled, leg.z + leg.vz * traveled);
+              velocity = Vector (leg.vx, leg.vy, leg.vz);
+            }
+          NS_LOG_DEBUG ("Resuming node " << nodeId << " at " << m_startTime.GetSeconds () << " position =" << position
+                                         << " velocity =" << velocity);
+          // stay still until the start time
+          model->SetPosition (position);
+          model->SetVelocity (Vector (0, 0, 0));
+          Simulator::Schedule (m_startTime, &ConstantVelocityMobilityModel::SetVelocity, model, velocity);
+        }
+      else
+        {
+          model->SetPosition (position);
+        }
+      player->Add (nodeId, model, next);
+    }
+  player->Advance ();
+}
+
+} // namespace ns3
@@ -0,0 +1,255 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#ifndef COMPILED_MOBILITY_TRACE_HELPER_H
+#define COMPILED_MOBILITY_TRACE_HELPER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/node-container.h"
+#include "compiled-mobility-trace-format.h"
+#include "mobility-trace-info.h"
+
+namespace ns3 {
+
+class MobilityModel;
+
+/**
+ * \ingroup mobility
+ * \brief Memory mapped compiled mobility trace, see
+ * compiled-mobility-trace-format.h.
+ *
+ * Opening a trace only maps it and checks its tables, so it takes the same
+ * time whatever its size, and the legs of a node are only read from the
+ * disk when they are used.
+ */
+class CompiledMobilityTrace : public SimpleRefCount<CompiledMobilityTrace>
+{
+public:
+  CompiledMobilityTrace ();
+  ~CompiledMobilityTrace ();
+
+  /**
+   * \param filename compiled trace file.
+   * \returns false if the file could not be opened or is not a valid
+   *          compiled trace.
+   */
+  bool Open (std::string filename);
+
+  /**
+   * Unmaps the trace.
+   */
+  void Close (void);
+
+  /**
+   * \returns the header of the trace.
+   */
+  const CompiledMobilityTraceHeader & GetHeader (void) const;
+
+  /**
+   * \param nodeId node ID.
+   * \returns true if the node is in the trace.
+   */
+  bool HasNode (uint32_t nodeId) const;
+
+  /**
+   * \param nodeId node ID, in the trace.
+   * \returns the entry of the node in the node table.
+   */
+  const CompiledMobilityTraceNode & GetNode (uint32_t nodeId) const;
+
+  /**
+   * \param nodeId node ID, in the trace.
+   * \returns the legs of the node, GetNode (nodeId).legs of them.
+   */
+  const CompiledMobilityTraceLeg * GetLegs (uint32_t nodeId) const;
+
+  /**
+   * \param nodeId node ID, in the trace.
+   * \param time time in ns.
+   * \returns the number of legs of the node up to the time, included,
+   *          i.e. the index of its first leg after the time.
+   */
+  uint32_t FindLeg (uint32_t nodeId, int64_t time) const;
+
+private:
+  void *m_map;                                  //!< mapped file
+  size_t m_mapSize;                             //!< size of the mapped file
+  CompiledMobilityTraceHeader m_header;         //!< header of the trace
+  const CompiledMobilityTraceNode *m_nodes;     //!< node table
+  const int64_t *m_index;                       //!< time index
+  const CompiledMobilityTraceLeg *m_legs;       //!< legs
+};
+
+/**
+ * \ingroup mobility
+ * \brief Records the course changes of nodes and writes them as a compiled
+ * mobility trace, see compiled-mobility-trace-format.h.
+ *
+ * The mobility models of the nodes must move at constant velocity between
+ * their course changes, as ConstantVelocityMobilityModel and the models
+ * using ConstantVelocityHelper do. To compile an ns-2 trace, install it
+ * with Ns2MobilityHelper, install the writer on the nodes and run the
+ * simulation, see the scratch program compile-mobility-trace.
+ *
+ * The writer keeps the legs in memory until they are written, and must
+ * live as long as the simulation it records.
+ */
+class CompiledMobilityTraceWriter
+{
+public:
+  CompiledMobilityTraceWriter ();
+
+  /**
+   * \param stride legs per entry of the time index, 64 by default.
+   */
+  void SetIndexStride (uint32_t stride);
+
+  /**
+   * \param nodes nodes to record. Their current positions are their
+   *        positions before their first leg.
+   */
+  void Install (NodeContainer nodes);
+
+  /**
+   * Records all the nodes of the global ns3::NodeList.
+   */
+  void InstallAll (void);
+
+  /**
+   * \param filename file to write. It is created or truncated.
+   * \returns false if the file could not be written.
+   */
+  bool Write (std::string filename) const;
+
+private:
+  /**
+   * \param model mobility model whose course changed.
+   *
+   * CourseChange trace sink.
+   */
+  void CourseChanged (Ptr<const MobilityModel> model);
+
+  /// Movement of a node
+  struct Track
+  {
+    bool present;                                  //!< the node is recorded
+    Vector position;                               //!< position before the first leg
+    std::vector<CompiledMobilityTraceLeg> legs;    //!< legs of the node
+  };
+
+  uint32_t m_indexStride;                          //!< legs per entry of the time index
+  std::vector<Track> m_tracks;                     //!< movement of each node ID
+};
+
+/**
+ * \ingroup mobility
+ * \brief Helper class which replays a compiled mobility trace, see
+ * compiled-mobility-trace-format.h, with the
+ * ConstantVelocityMobilityModel of the nodes.
+ *
+ * The trace is memory mapped, and installing it only reads the node table
+ * entries of the nodes it is installed on, so it takes milliseconds
+ * whatever the size of the trace, and the nodes of the trace which are not
+ * in the simulation cost nothing. As with Ns2MobilityHelper, the times of
+ * the trace are relative to the time it is installed at.
+ *
+ * The legs are scheduled as the simulation advances, lookAhead before their
+ * time (see SetLookAhead), so the pending events depend on the nodes moving
+ * and not on the length of the trace. With SetStartTime, the trace is
+ * resumed at a time found with the time index, without reading the legs
+ * before it.
+ */
+class CompiledMobilityTraceHelper
+{
+public:
+  /**
+   * \param filename compiled trace file. The program aborts if it is not a
+   *        valid compiled trace.
+   */
+  CompiledMobilityTraceHelper (std::string filename);
+
+  /**
+   * \param filename a file.
+   * \returns true if the file starts as a compiled trace, so it is not an
+   *          ns-2 trace.
+   */
+  static bool IsCompiledTrace (std::string filename);
+
+  /**
+   * \returns the trace.
+   */
+  Ptr<CompiledMobilityTrace> GetTrace (void) const;
+
+  /**
+   * \returns the IDs of the nodes of the trace, the time span of its legs
+   *          and their bounding box, from the header and the node table of
+   *          the trace.
+   */
+  MobilityTraceInfo GetTraceInfo (void) const;
+
+  /**
+   * \param start time to start the movements at, 0 by default.
+   *
+   * Resumes the trace at the given time, as Ns2MobilityHelper::SetStartTime:
+   * each node is placed where its legs up to the start time leave it, and at
+   * the start time it takes the velocity of the last one.
+   * Must be called before Install.
+   */
+  void SetStartTime (Time start);
+
+  /**
+   * \param lookAhead how long before its time each leg is scheduled, 60 s
+   *        by default, 0 to schedule all the legs at install.
+   *
+   * Legs at the same time as other events run after those already
+   * scheduled, so the look-ahead should be longer than the period of the
+   * periodic events that must see the new movements.
+   * Must be called before Install.
+   */
+  void SetLookAhead (Time lookAhead);
+
+  /**
+   * Configures the movements of the nodes of the global ns3::NodeList
+   * which are in the trace.
+   */
+  void Install (void) const;
+
+  /**
+   * \param nodes nodes whose movements are configured, those which are in
+   *        the trace.
+   */
+  void Install (NodeContainer nodes) const;
+
+private:
+  Ptr<CompiledMobilityTrace> m_trace;   //!< trace
+  Time m_startTime;                     //!< time of the first scheduled leg
+  Time m_lookAhead;                     //!< look-ahead of the legs, 0 to schedule them all at install
+};
+
+} // namespace ns3
+
+#endif /* COMPILED_MOBILITY_TRACE_HELPER_H */
@@ -0,0 +1,327 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <algorithm>
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/constant-velocity-mobility-model.h"
+#include "ns3/constant-acceleration-mobility-model.h"
+#include "ns3/waypoint-mobility-model.h"
+#include "mobility-batch.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("MobilityBatch");
+
+MobilityBatch::MobilityBatch ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+MobilityBatch::Add (Ptr<const MobilityModel> model)
+{
+  NS_LOG_FUNCTION (this << model);
+  NS_ASSERT (model != 0);
+  // only the exact types, subclasses may move otherwise
+  TypeId tid = model->GetInstanceTypeId ();
+  enum Kind kind = OTHER;
+  if (tid == ConstantPositionMobilityModel::GetTypeId ())
+    {
+      kind = CONSTANT_POSITION;
+    }
+  else if (tid == ConstantVelocityMobilityModel::GetTypeId ())
+    {
+      kind = CONSTANT_VELOCITY;
+    }
+  else if (tid == ConstantAccelerationMobilityModel::GetTypeId ())
+    {
+      kind = CONSTANT_ACCELERATION;
+    }
+  else if (tid == WaypointMobilityModel::GetTypeId ())
+    {
+      kind = WAYPOINT;
+    }
+  m_groups[kind].index.push_back (m_models.size ());
+  m_groups[kind].model.push_back (PeekPointer (model));
+  m_models.push_back (model);
+}
+
+void
+MobilityBatch::Add (NodeContainer nodes)
+{
+  NS_LOG_FUNCTION (this);
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); i++)
+    {
+      Ptr<MobilityModel> model = (*i)->GetObject<MobilityModel> ();
+      if (model == 0)
+        {
+          NS_FATAL_ERROR ("Node " << (*i)->GetId () << " has no mobility model");
+        }
+      Add (model);
+    }
+}
+
+void
+MobilityBatch::Clear (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_models.clear ();
+  for (uint32_t kind = 0; kind < KINDS; kind++)
+    {
+      m_groups[kind].index.clear ();
+      m_groups[kind].model.clear ();
+    }
+}
+
+uint32_t
+MobilityBatch::GetN (void) const
+{
+  return m_models.size ();
+}
+
+void
+MobilityBatch::GetPositions (Time time, Vector *positions) const
+{
+  Get (0, m_models.size (), time, positions, 0);
+}
+
+void
+MobilityBatch::GetVelocities (Time time, Vector *velocities) const
+{
+  Get (0, m_models.size (), time, 0, velocities);
+}
+
+void
+MobilityBatch::Get (uint32_t begin, uint32_t end, Time time, Vector *positions, Vector *velocities) const
+{
+  NS_ASSERT (begin <= end && end <= m_models.size ());
+  NS_ASSERT (time >= Simulator::Now ());
+  for (uint32_t kind = 0; kind < KINDS; kind++)
+    {
+      const Group &group = m_groups[kind];
+      uint32_t first = std::lower_bound (group.index.begin (), group.index.end (), begin) - group.index.begin ();
+      uint32_t last = std::lower_bound (group.index.begin () + first, group.index.end (), end) - group.index.begin ();
+      if (first == last)
+        {
+          continue;
+        }
+      switch (kind)
+        {
+        case CONSTANT_POSITION:
+          GetConstantPosition (group, first, last, begin, time, positions, velocities);
+          break;
+        case CONSTANT_VELOCITY:
+          GetConstantVelocity (group, first, last, begin, time, positions, velocities);
+          break;
+        case CONSTANT_ACCELERATION:
+          GetConstantAcceleration (group, first, last, begin, time, positions, velocities);
+          break;
+        case WAYPOINT:
+          GetWaypoint (group, first, last, begin, time, positions, velocities);
+          break;
+        default:
+          GetOther (group, first, last, begin, time, positions, velocities);
+          break;
+        }
+    }
+}
+
+void
+MobilityBatch::GetOther (const Group &group, uint32_t first, uint32_t last, uint32_t begin,
+                         Time time, Vector *positions, Vector *velocities)
+{
+  double dt = (time - Simulator::Now ()).GetSeconds ();
+  for (uint32_t i = first; i < last; i++)
+    {
+      const MobilityModel *model = group.model[i];
+      uint32_t index = group.index[i] - begin;
+      Vector position = model->GetPosition ();
+      Vector velocity = model->GetVelocity ();
+      if (positions != 0)
+        {
+          positions[index] = dt == 0 ? position : Vector (position.x + velocity.x * dt,
+                                                          position.y + velocity.y * dt,
+                                                          position.z + velocity.z * dt);
+        }
+      if (velocities != 0)
+        {
+          velocities[index] = velocity;
+        }
+    }
+}
+
+void
+MobilityBatch::GetConstantPosition (const Group &group, uint32_t first, uint32_t last, uint32_t begin,
+                                    Time time, Vector *positions, Vector *velocities)
+{
+  for (uint32_t i = first; i < last; i++)
+    {
+      const ConstantPositionMobilityModel *model = static_cast<const ConstantPositionMobilityModel *> (group.model[i]);
+      uint32_t index = group.index[i] - begin;
+      if (positions != 0)
+        {
+          positions[index] = model->m_position;
+        }
+      if (velocities != 0)
+        {
+          velocities[index] = Vector (0.0, 0.0, 0.0);
+        }
+    }
+}
+
+void
+MobilityBatch::GetConstantVelocity (const Group &group, uint32_t first, uint32_t last, uint32_t begin,
+                                    Time time, Vector *positions, Vector *velocities)
+{
+  // as ConstantVelocityHelper::Update
+  for (uint32_t i = first; i < last; i++)
+    {
+      const ConstantVelocityHelper &helper = static_cast<const ConstantVelocityMobilityModel *> (group.model[i])->m_helper;
+      uint32_t index = group.index[i] - begin;
+      if (positions != 0)
+        {
+          Vector position = helper.m_position;
+          if (!helper.m_paused)
+            {
+              double dt = (time - helper.m_lastUpdate).GetSeconds ();
+              position.x += helper.m_velocity.x * dt;
+              position.y += helper.m_velocity.y * dt;
+              position.z += helper.m_velocity.z * dt;
+            }
+          positions[index] = position;
+        }
+      if (velocities != 0)
+        {
+          velocities[index] = helper.m_paused ? Vector (0.0, 0.0, 0.0) : helper.m_velocity;
+        }
+    }
+}
+
+void
+MobilityBatch::GetConstantAcceleration (const Group &group, uint32_t first, uint32_t last, uint32_t begin,
+                                        Time time, Vector *positions, Vector *velocities)
+{
+  // as ConstantAccelerationMobilityModel::DoGetPosition and DoGetVelocity
+  for (uint32_t i = first; i < last; i++)
+    {
+      const ConstantAccelerationMobilityModel *model = static_cast<const ConstantAccelerationMobilityModel *> (group.model[i]);
+      uint32_t index = group.index[i] - begin;
+      double t = (time - model->m_baseTime).GetSeconds ();
+      if (positions != 0)
+        {
+          double half_t_square = t*t*0.5;
+          positions[index] = Vector (model->m_basePosition.x + model->m_baseVelocity.x*t + model->m_acceleration.x*half_t_square,
+                                     model->m_basePosition.y + model->m_baseVelocity.y*t + model->m_acceleration.y*half_t_square,
+                                     model->m_basePosition.z + model->m_baseVelocity.z*t + model->m_acceleration.z*half_t_square);
+        }
+      if (velocities != 0)
+        {
+          velocities[index] = Vector (model->m_baseVelocity.x + model->m_acceleration.x*t,
+                                      model->m_baseVelocity.y + model->m_acceleration.y*t,
+                                      model->m_baseVelocity.z + model->m_acceleration.z*t);
+        }
+    }
+}
+
+void
+MobilityBatch::GetWaypoint (const Group &group, uint32_t first, uint32_t last, uint32_t begin,
+                            Time time, Vector *positions, Vector *velocities)
+{
+  Time now = Simulator::Now ();
+  for (uint32_t i = first; i < last; i++)
+    {
+      const WaypointMobilityModel *model = static_cast<const WaypointMobilityModel *> (group.model[i]);
+      uint32_t index = group.index[i] - begin;
+      Vector position;
+      Vector velocity;
+      if (time < model->m_current.time)
+        {
+          // not started, or placed until the next waypoint
+          position = model->m_current.position;
+          velocity = model->m_velocity;
+        }
+      else if (time < model->m_next.time)
+        {
+          // on the current leg, as WaypointMobilityModel::Update
+          position = model->m_current.position;
+          velocity = model->m_velocity;
+          if (time > model->m_current.time)
+            {
+              double dt = (time - model->m_current.time).GetSeconds ();
+              position.x += velocity.x * dt;
+              position.y += velocity.y * dt;
+              position.z += velocity.z * dt;
+            }
+        }
+      else if (time == now)
+        {
+          // past a waypoint the model has not reached yet: it moves on,
+          // and notifies the course change if it is lazy
+          position = model->GetPosition ();
+          velocity = model->GetVelocity ();
+        }
+      else if (model->m_first || model->m_next.time < model->m_current.time)
+        {
+          // without waypoints, or past the last one
+          position = model->m_current.position;
+          velocity = Vector (0.0, 0.0, 0.0);
+        }
+      else
+        {
+          // on a later leg
+          Waypoint from = model->m_next;
+          position = from.position;
+          velocity = Vector (0.0, 0.0, 0.0);
+          for (std::deque<Waypoint>::const_iterator it = model->m_waypoints.begin (); it != model->m_waypoints.end (); it++)
+            {
+              if (time < it->time)
+                {
+                  double span = (it->time - from.time).GetSeconds ();
+                  double dt = (time - from.time).GetSeconds ();
+                  velocity = Vector ((it->position.x - from.position.x) / span,
+                                     (it->position.y - from.position.y) / span,
+                                     (it->position.z - from.position.z) / span);
+                  position = Vector (from.position.x + velocity.x * dt,
+                                     from.position.y + velocity.y * dt,
+                                     from.position.z + velocity.z * dt);
+                  break;
+                }
+              from = *it;
+              position = from.position;
+            }
+        }
+      if (positions != 0)
+        {
+          positions[index] = position;
+        }
+      if (velocities != 0)
+        {
+          velocities[index] = velocity;
+        }
+    }
+}
+
+} // namespace ns3
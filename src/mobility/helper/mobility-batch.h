@@ -0,0 +1,147 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#ifndef MOBILITY_BATCH_H
+#define MOBILITY_BATCH_H
+
+#include <stdint.h>
+#include <vector>
+#include "ns3/ptr.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/node-container.h"
+#include "ns3/mobility-model.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup mobility
+ * \brief Reads the positions and velocities of many mobility models at
+ * once.
+ *
+ * The models are grouped by type when they are added. The positions and
+ * velocities of the ConstantPositionMobilityModel,
+ * ConstantVelocityMobilityModel, ConstantAccelerationMobilityModel and
+ * WaypointMobilityModel instances are then computed in a loop per type
+ * from their state, without virtual calls and without updating them, and
+ * the other models are read through MobilityModel::GetPosition and
+ * MobilityModel::GetVelocity. The values are those the models return.
+ *
+ * The time of a query may be later than now: the position is then the one
+ * the model would have if nothing changed its course until that time, for
+ * the models above, and the current position moved at the current
+ * velocity for the others.
+ */
+class MobilityBatch
+{
+public:
+  MobilityBatch ();
+
+  /**
+   * \param model mobility model to add, at index GetN ().
+   */
+  void Add (Ptr<const MobilityModel> model);
+
+  /**
+   * \param nodes nodes whose mobility models are added, in order.
+   */
+  void Add (NodeContainer nodes);
+
+  /**
+   * Removes all the models.
+   */
+  void Clear (void);
+
+  /**
+   * \returns the number of models.
+   */
+  uint32_t GetN (void) const;
+
+  /**
+   * \param time time of the query, not before now.
+   * \param [out] positions position of each model, GetN () of them.
+   */
+  void GetPositions (Time time, Vector *positions) const;
+
+  /**
+   * \param time time of the query, not before now.
+   * \param [out] velocities velocity of each model, GetN () of them.
+   */
+  void GetVelocities (Time time, Vector *velocities) const;
+
+  /**
+   * \param begin index of the first model.
+   * \param end index past the last model.
+   * \param time time of the query, not before now.
+   * \param [out] positions position of each model from begin, or 0.
+   * \param [out] velocities velocity of each model from begin, or 0.
+   */
+  void Get (uint32_t begin, uint32_t end, Time time, Vector *positions, Vector *velocities) const;
+
+private:
+  /// Types of models with a specialized evaluation
+  enum Kind
+  {
+    OTHER,
+    CONSTANT_POSITION,
+    CONSTANT_VELOCITY,
+    CONSTANT_ACCELERATION,
+    WAYPOINT,
+    KINDS
+  };
+  /// Models of a kind
+  struct Group
+  {
+    std::vector<uint32_t> index;                  //!< index of each model, ascending
+    std::vector<const MobilityModel *> model;     //!< models
+  };
+
+  /**
+   * \param group models of a kind.
+   * \param first first model of the group to read.
+   * \param last model of the group past the last one to read.
+   * \param begin index of the model of positions[0] and velocities[0].
+   * \param time time of the query, not before now.
+   * \param [out] positions positions, or 0.
+   * \param [out] velocities velocities, or 0.
+   */
+  static void GetOther (const Group &group, uint32_t first, uint32_t last, uint32_t begin,
+                        Time time, Vector *positions, Vector *velocities);
+  /** \copydoc GetOther */
+  static void GetConstantPosition (const Group &group, uint32_t first, uint32_t last, uint32_t begin,
+                                   Time time, Vector *positions, Vector *velocities);
+  /** \copydoc GetOther */
+  static void GetConstantVelocity (const Group &group, uint32_t first, uint32_t last, uint32_t begin,
+                                   Time time, Vector *positions, Vector *velocities);
+  /** \copydoc GetOther */
+  static void GetConstantAcceleration (const Group &group, uint32_t first, uint32_t last, uint32_t begin,
+                                       Time time, Vector *positions, Vector *velocities);
+  /** \copydoc GetOther */
+  static void GetWaypoint (const Group &group, uint32_t first, uint32_t last, uint32_t begin,
+                           Time time, Vector *positions, Vector *velocities);
+
+  std::vector<Ptr<const MobilityModel> > m_models; //!< models, by index
+  Group m_groups[KINDS];                        //!< models by kind
+};
+
+} // namespace ns3
+
+#endif /* MOBILITY_BATCH_H */
@@ -21,6 +21,7 @@
 #include "ns3/mobility-model.h"
 #include "ns3/position-allocator.h"
 #include "ns3/hierarchical-mobility-model.h"
+#include "ns3/mobility-batch.h"
 #include "ns3/log.h"
 #include "ns3/pointer.h"
 #include "ns3/config.h"
@@ -208,27 +209,31 @@ DoRound (double v)
 void
 MobilityHelper::CourseChanged (Ptr<OutputStreamWrapper> stream, Ptr<const MobilityModel> mobility)
 {
-  std::ostream* os = stream->GetStream ();
   Ptr<Node> node = mobility->GetObject<Node> ();
-  *os << "now=" << Simulator::Now ()
-      << " node=" << node->GetId ();
-  Vector pos = mobility->GetPosition ();
+  WriteCourseChange (*stream->GetStream (), Simulator::Now (), node->GetId (),
+                     mobility->GetPosition (), mobility->GetVelocity ());
+}
+
+void
+MobilityHelper::WriteCourseChange (std::ostream &os, Time now, uint32_t nodeId, Vector pos, Vector vel)
+{
+  os << "now=" << now
+     << " node=" << nodeId;
   pos.x = DoRound (pos.x);
   pos.y = DoRound (pos.y);
   pos.z = DoRound (pos.z);
-  Vector vel = mobility->GetVelocity ();
   vel.x = DoRound (vel.x);
   vel.y = DoRound (vel.y);
   vel.z = DoRound (vel.z);
-  std::streamsize saved_precision = os->precision ();
-  std::ios::fmtflags saved_flags = os->flags ();
-  os->precision (3);
-  os->setf (std::ios::fixed,std::ios::floatfield);
-  *os << " pos=" << pos.x << ":" << pos.y << ":" << pos.z
-      << " vel=" << vel.x << ":" << vel.y << ":" << vel.z
-      << std::endl;
-  os->flags (saved_flags);
-  os->precision (saved_precision);
+  std::streamsize saved_precision = os.precision ();
+  std::ios::fmtflags saved_flags = os.flags ();
+  os.precision (3);
+  os.setf (std::ios::fixed,std::ios::floatfield);
+  os << " pos=" << pos.x << ":" << pos.y << ":" << pos.z
+     << " vel=" << vel.x << ":" << vel.y << ":" << vel.z
+     << std::endl;
+  os.flags (saved_flags);
+  os.precision (saved_precision);
 }
 
 void 
@@ -288,4 +293,13 @@ MobilityHelper::GetDistanceSquaredBetween (Ptr<Node> n1, Ptr<Node> n2)
   return distSq;
 }
 
+void
+MobilityHelper::GetPositions (NodeContainer nodes, Time time, Vector *positions)
+{
+  NS_LOG_FUNCTION (time);
+  MobilityBatch batch;
+  batch.Add (nodes);
+  batch.GetPositions (time, positions);
+}
+
 } // namespace ns3
@@ -25,6 +25,7 @@
 #include "ns3/object-factory.h"
 #include "ns3/attribute.h"
 #include "ns3/output-stream-wrapper.h"
+#include "ns3/nstime.h"
 #include "ns3/position-allocator.h"
 #include "node-container.h"
 
@@ -246,6 +247,17 @@ public:
    * stdc++ output stream.
    */
   static void EnableAsciiAll (Ptr<OutputStreamWrapper> stream);
+  /**
+   * \param os output stream
+   * \param now time of the course change
+   * \param nodeId id of the node
+   * \param pos position of the node
+   * \param vel velocity of the node
+   *
+   * Writes a course change as the ascii output enabled by EnableAscii,
+   * e.g. to decode a MobilityTraceRecorder file.
+   */
+  static void WriteCourseChange (std::ostream &os, Time now, uint32_t nodeId, Vector pos, Vector vel);
   /**
    * Assign a fixed random variable stream number to the random variables
    * used by the mobility models (including any position allocators assigned
@@ -267,6 +279,17 @@ public:
    */
   static double GetDistanceSquaredBetween (Ptr<Node> n1, Ptr<Node> n2);
 
+  /**
+   * \param nodes nodes with a mobility model
+   * \param time time of the positions, not before now
+   * \param [out] positions position of each node, nodes.GetN () of them
+   *
+   * Reads the positions of the nodes grouped by the type of their mobility
+   * models, see MobilityBatch. To read the positions of the same nodes
+   * many times, keep a MobilityBatch instead.
+   */
+  static void GetPositions (NodeContainer nodes, Time time, Vector *positions);
+
 private:
 
   /**
@@ -0,0 +1,584 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/mobility-model.h"
+#include "ns3/constant-acceleration-mobility-model.h"
+#include "ns3/trajectory-mobility-model.h"
+#include "ns3/waypoint-mobility-model.h"
+#include "ns3/gauss-markov-mobility-model.h"
+#include "ns3/random-walk-2d-mobility-model.h"
+#include "ns3/random-direction-2d-mobility-model.h"
+#include "mobility-spatial-index.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("MobilitySpatialIndex");
+
+NS_OBJECT_ENSURE_REGISTERED (MobilitySpatialIndex);
+
+/// Index of an entry which is in no list
+static const uint32_t NO_LIST = std::numeric_limits<uint32_t>::max ();
+
+TypeId
+MobilitySpatialIndex::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MobilitySpatialIndex")
+    .SetParent<Object> ()
+    .SetGroupName ("Mobility")
+    .AddConstructor<MobilitySpatialIndex> ()
+    .AddAttribute ("CellSize",
+                   "Side of the cells of the grid in m, about the radius of the queries.",
+                   DoubleValue (100),
+                   MakeDoubleAccessor (&MobilitySpatialIndex::m_cellSize),
+                   MakeDoubleChecker<double> (0.001))
+    .AddAttribute ("Staleness",
+                   "Longest time the moving nodes are kept in the cells they were in.",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&MobilitySpatialIndex::m_staleness),
+                   MakeTimeChecker (Seconds (0)))
+    .AddAttribute ("MaxSpeed",
+                   "Highest speed in m/s of the nodes whose models do not notify their changes of velocity.",
+                   DoubleValue (70),
+                   MakeDoubleAccessor (&MobilitySpatialIndex::m_maxSpeed),
+                   MakeDoubleChecker<double> (0))
+  ;
+  return tid;
+}
+
+MobilitySpatialIndex::MobilitySpatialIndex ()
+  : m_cellSize (100),
+    m_staleness (Seconds (1)),
+    m_maxSpeed (70),
+    m_refreshTime (0),
+    m_speed (0),
+    m_querying (false)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+MobilitySpatialIndex::~MobilitySpatialIndex ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+MobilitySpatialIndex::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < m_entries.size (); i++)
+    {
+      m_entries[i].model->TraceDisconnectWithoutContext ("CourseChange",
+                                                         MakeCallback (&MobilitySpatialIndex::CourseChanged, this));
+    }
+  m_entries.clear ();
+  m_entryOfNode.clear ();
+  m_cells.clear ();
+  m_moving.clear ();
+  m_polled.clear ();
+  m_deferred.clear ();
+  Object::DoDispose ();
+}
+
+/**
+ * \param model a mobility model.
+ * \returns true if it may change its velocity without notifying it.
+ */
+static bool
+IsPolled (Ptr<MobilityModel> model)
+{
+  if (DynamicCast<ConstantAccelerationMobilityModel> (model) != 0
+      || DynamicCast<TrajectoryMobilityModel> (model) != 0)
+    {
+      return true;
+    }
+  if (DynamicCast<WaypointMobilityModel> (model) != 0)
+    {
+      BooleanValue lazy;
+      model->GetAttribute ("LazyNotify", lazy);
+      return lazy.Get ();
+    }
+  if (DynamicCast<GaussMarkovMobilityModel> (model) != 0
+      || DynamicCast<RandomWalk2dMobilityModel> (model) != 0
+      || DynamicCast<RandomDirection2dMobilityModel> (model) != 0)
+    {
+      BooleanValue lazy;
+      model->GetAttribute ("Lazy", lazy);
+      return lazy.Get ();
+    }
+  return false;
+}
+
+/**
+ * \param v a vector.
+ * \returns its norm.
+ */
+static double
+GetNorm (const Vector &v)
+{
+  return std::sqrt (v.x * v.x + v.y * v.y + v.z * v.z);
+}
+
+void
+MobilitySpatialIndex::Install (NodeContainer nodes)
+{
+  NS_LOG_FUNCTION (this);
+  int64_t now = Simulator::Now ().GetNanoSeconds ();
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); i++)
+    {
+      uint32_t nodeId = (*i)->GetId ();
+      if (nodeId < m_entryOfNode.size () && m_entryOfNode[nodeId] >= 0)
+        {
+          continue;
+        }
+      Ptr<MobilityModel> model = (*i)->GetObject<MobilityModel> ();
+      if (model == 0)
+        {
+          NS_FATAL_ERROR ("Node " << nodeId << " has no mobility model to index");
+        }
+
+      uint32_t index = m_entries.size ();
+      Entry entry;
+      entry.model = model;
+      entry.nodeId = nodeId;
+      entry.polled = IsPolled (model);
+      entry.position = model->GetPosition ();
+      entry.velocity = model->GetVelocity ();
+      entry.time = now;
+      entry.cell = GetCell (entry.position.x, entry.position.y);
+      Cell &cell = m_cells[entry.cell];
+      entry.cellIndex = cell.size ();
+      cell.push_back (index);
+      entry.listIndex = NO_LIST;
+      m_entries.push_back (entry);
+      if (m_entryOfNode.size () <= nodeId)
+        {
+          m_entryOfNode.resize (nodeId + 1, -1);
+        }
+      m_entryOfNode[nodeId] = index;
+
+      if (entry.polled)
+        {
+          m_entries[index].listIndex = m_polled.size ();
+          m_polled.push_back (index);
+        }
+      else
+        {
+          SetMoving (index, GetNorm (entry.velocity) > 0);
+          m_speed = std::max (m_speed, GetNorm (entry.velocity));
+        }
+      model->TraceConnectWithoutContext ("CourseChange", MakeCallback (&MobilitySpatialIndex::CourseChanged, this));
+    }
+}
+
+void
+MobilitySpatialIndex::InstallAll (void)
+{
+  NS_LOG_FUNCTION (this);
+  NodeContainer nodes;
+  for (uint32_t i = 0; i < NodeList::GetNNodes (); i++)
+    {
+      if (NodeList::GetNode (i)->GetObject<MobilityModel> () != 0)
+        {
+          nodes.Add (NodeList::GetNode (i));
+        }
+    }
+  Install (nodes);
+}
+
+void
+MobilitySpatialIndex::Remove (Ptr<Node> node)
+{
+  NS_LOG_FUNCTION (this << node);
+  uint32_t nodeId = node->GetId ();
+  if (nodeId >= m_entryOfNode.size () || m_entryOfNode[nodeId] < 0)
+    {
+      return;
+    }
+  uint32_t index = m_entryOfNode[nodeId];
+  Entry &entry = m_entries[index];
+  entry.model->TraceDisconnectWithoutContext ("CourseChange", MakeCallback (&MobilitySpatialIndex::CourseChanged, this));
+
+  // out of its cell and its list
+  RemoveFromCell (index);
+  if (entry.polled)
+    {
+      m_entries[m_polled.back ()].listIndex = entry.listIndex;
+      m_polled[entry.listIndex] = m_polled.back ();
+      m_polled.pop_back ();
+    }
+  else
+    {
+      SetMoving (index, false);
+    }
+  m_entryOfNode[nodeId] = -1;
+
+  // the last entry takes its place
+  uint32_t last = m_entries.size () - 1;
+  if (index != last)
+    {
+      const Entry &moved = m_entries[last];
+      m_cells[moved.cell][moved.cellIndex] = index;
+      if (moved.polled)
+        {
+          m_polled[moved.listIndex] = index;
+        }
+      else if (moved.listIndex != NO_LIST)
+        {
+          m_moving[moved.listIndex] = index;
+        }
+      m_entryOfNode[moved.nodeId] = index;
+      m_entries[index] = moved;
+    }
+  m_entries.pop_back ();
+}
+
+uint32_t
+MobilitySpatialIndex::GetN (void) const
+{
+  return m_entries.size ();
+}
+
+void
+MobilitySpatialIndex::CourseChanged (Ptr<const MobilityModel> model)
+{
+  uint32_t nodeId = model->GetObject<Node> ()->GetId ();
+  NS_ASSERT (nodeId < m_entryOfNode.size () && m_entryOfNode[nodeId] >= 0);
+  uint32_t index = m_entryOfNode[nodeId];
+  Entry &entry = m_entries[index];
+  entry.position = model->GetPosition ();
+  entry.velocity = model->GetVelocity ();
+  entry.time = Simulator::Now ().GetNanoSeconds ();
+  if (m_querying)
+    {
+      // notified by a lazy model polled by the query, which is going
+      // through the cells: the node changes cell when the query ends
+      m_deferred.push_back (index);
+    }
+  else
+    {
+      Move (index, entry.position);
+    }
+  if (!entry.polled)
+    {
+      double speed = GetNorm (entry.velocity);
+      SetMoving (index, speed > 0);
+      m_speed = std::max (m_speed, speed);
+    }
+}
+
+uint32_t
+MobilitySpatialIndex::GetNCells (void) const
+{
+  return m_cells.size ();
+}
+
+void
+MobilitySpatialIndex::RemoveFromCell (uint32_t index)
+{
+  const Entry &entry = m_entries[index];
+  std::unordered_map<uint64_t, Cell>::iterator it = m_cells.find (entry.cell);
+  NS_ASSERT (it != m_cells.end ());
+  Cell &cell = it->second;
+  m_entries[cell.back ()].cellIndex = entry.cellIndex;
+  cell[entry.cellIndex] = cell.back ();
+  cell.pop_back ();
+  if (cell.empty ())
+    {
+      // only the cells with nodes are kept, for the queries to compare with
+      m_cells.erase (it);
+    }
+}
+
+void
+MobilitySpatialIndex::Move (uint32_t index, const Vector &position)
+{
+  Entry &entry = m_entries[index];
+  uint64_t key = GetCell (position.x, position.y);
+  if (key == entry.cell)
+    {
+      return;
+    }
+  RemoveFromCell (index);
+  Cell &to = m_cells[key];
+  entry.cell = key;
+  entry.cellIndex = to.size ();
+  to.push_back (index);
+}
+
+void
+MobilitySpatialIndex::SetMoving (uint32_t index, bool moving)
+{
+  Entry &entry = m_entries[index];
+  if (moving && entry.listIndex == NO_LIST)
+    {
+      entry.listIndex = m_moving.size ();
+      m_moving.push_back (index);
+    }
+  else if (!moving && entry.listIndex != NO_LIST)
+    {
+      m_entries[m_moving.back ()].listIndex = entry.listIndex;
+      m_moving[entry.listIndex] = m_moving.back ();
+      m_moving.pop_back ();
+      entry.listIndex = NO_LIST;
+    }
+}
+
+uint64_t
+MobilitySpatialIndex::GetCellKey (int64_t column, int64_t row)
+{
+  // out of the range of 32 bits, the cells are shared, which is correct but slower
+  return ((uint64_t) (uint32_t) column << 32) | (uint32_t) row;
+}
+
+uint64_t
+MobilitySpatialIndex::GetCell (double x, double y) const
+{
+  return GetCellKey ((int64_t) std::floor (x / m_cellSize), (int64_t) std::floor (y / m_cellSize));
+}
+
+void
+MobilitySpatialIndex::Refresh (void)
+{
+  int64_t now = Simulator::Now ().GetNanoSeconds ();
+  if (now - m_refreshTime <= m_staleness.GetNanoSeconds ())
+    {
+      return;
+    }
+  m_speed = 0;
+  for (std::vector<uint32_t>::const_iterator i = m_moving.begin (); i != m_moving.end (); i++)
+    {
+      const Entry &entry = m_entries[*i];
+      Move (*i, GetPosition (entry, now));
+      m_speed = std::max (m_speed, GetNorm (entry.velocity));
+    }
+  for (std::vector<uint32_t>::const_iterator i = m_polled.begin (); i != m_polled.end (); i++)
+    {
+      Entry &entry = m_entries[*i];
+      entry.position = entry.model->GetPosition ();
+      entry.velocity = entry.model->GetVelocity ();
+      entry.time = now;
+      Move (*i, entry.position);
+    }
+  m_refreshTime = now;
+}
+
+void
+MobilitySpatialIndex::EndQuery (void)
+{
+  m_querying = false;
+  for (std::vector<uint32_t>::const_iterator i = m_deferred.begin (); i != m_deferred.end (); i++)
+    {
+      Move (*i, m_entries[*i].position);
+    }
+  m_deferred.clear ();
+}
+
+Vector
+MobilitySpatialIndex::GetPosition (const Entry &entry, int64_t time) const
+{
+  Vector position = entry.position;
+  Vector velocity = entry.velocity;
+  int64_t base = entry.time;
+  if (entry.polled)
+    {
+      position = entry.model->GetPosition ();
+      velocity = entry.model->GetVelocity ();
+      base = Simulator::Now ().GetNanoSeconds ();
+    }
+  double t = (time - base) * 1e-9;
+  return Vector (position.x + velocity.x * t, position.y + velocity.y * t, position.z + velocity.z * t);
+}
+
+double
+MobilitySpatialIndex::GetDrift (int64_t time) const
+{
+  double speed = m_polled.empty () ? m_speed : std::max (m_speed, m_maxSpeed);
+  return speed * (time - m_refreshTime) * 1e-9;
+}
+
+void
+MobilitySpatialIndex::GetNodesInRange (const Vector &center, double radius, std::vector<uint32_t> &nodeIds)
+{
+  GetNodesInRange (center, radius, Simulator::Now (), nodeIds);
+}
+
+void
+MobilitySpatialIndex::GetNodesInRange (const Vector &center, double radius, Time time, std::vector<uint32_t> &nodeIds)
+{
+  NS_ASSERT (time >= Simulator::Now ());
+  nodeIds.clear ();
+  Refresh ();
+  m_querying = true;
+  int64_t t = time.GetNanoSeconds ();
+  double reach = radius + GetDrift (t);
+  double radius2 = radius * radius;
+  int64_t column0 = std::floor ((center.x - reach) / m_cellSize);
+  int64_t column1 = std::floor ((center.x + reach) / m_cellSize);
+  int64_t row0 = std::floor ((center.y - reach) / m_cellSize);
+  int64_t row1 = std::floor ((center.y + reach) / m_cellSize);
+
+  if ((column1 - column0 + 1.0) * (row1 - row0 + 1.0) > m_cells.size ())
+    {
+      // fewer cells with nodes than cells in reach
+      for (std::unordered_map<uint64_t, Cell>::const_iterator it = m_cells.begin (); it != m_cells.end (); it++)
+        {
+          for (Cell::const_iterator i = it->second.begin (); i != it->second.end (); i++)
+            {
+              const Entry &entry = m_entries[*i];
+              Vector position = GetPosition (entry, t);
+              double dx = position.x - center.x, dy = position.y - center.y, dz = position.z - center.z;
+              if (dx * dx + dy * dy + dz * dz <= radius2)
+                {
+                  nodeIds.push_back (entry.nodeId);
+                }
+            }
+        }
+      EndQuery ();
+      return;
+    }
+
+  for (int64_t column = column0; column <= column1; column++)
+    {
+      for (int64_t row = row0; row <= row1; row++)
+        {
+          std::unordered_map<uint64_t, Cell>::const_iterator it = m_cells.find (GetCellKey (column, row));
+          if (it == m_cells.end ())
+            {
+              continue;
+            }
+          for (Cell::const_iterator i = it->second.begin (); i != it->second.end (); i++)
+            {
+              const Entry &entry = m_entries[*i];
+              Vector position = GetPosition (entry, t);
+              double dx = position.x - center.x, dy = position.y - center.y, dz = position.z - center.z;
+              if (dx * dx + dy * dy + dz * dz <= radius2)
+                {
+                  nodeIds.push_back (entry.nodeId);
+                }
+            }
+        }
+    }
+  EndQuery ();
+}
+
+void
+MobilitySpatialIndex::GetNearestNodes (const Vector &center, uint32_t k, std::vector<uint32_t> &nodeIds)
+{
+  GetNearestNodes (center, k, Simulator::Now (), nodeIds);
+}
+
+void
+MobilitySpatialIndex::GetNearestNodes (const Vector &center, uint32_t k, Time time, std::vector<uint32_t> &nodeIds)
+{
+  NS_ASSERT (time >= Simulator::Now ());
+  nodeIds.clear ();
+  m_nearest.clear ();
+  if (k == 0 || m_entries.empty ())
+    {
+      return;
+    }
+  Refresh ();
+  m_querying = true;
+  int64_t t = time.GetNanoSeconds ();
+  double drift = GetDrift (t);
+  int64_t column = std::floor (center.x / m_cellSize);
+  int64_t row = std::floor (center.y / m_cellSize);
+
+  uint32_t seen = 0;
+  for (int64_t ring = 0; seen < m_entries.size (); ring++)
+    {
+      if ((2.0 * ring + 1) * (2.0 * ring + 1) > m_cells.size ())
+        {
+          // fewer cells with nodes than cells up to the ring
+          m_nearest.clear ();
+          for (std::unordered_map<uint64_t, Cell>::const_iterator it = m_cells.begin (); it != m_cells.end (); it++)
+            {
+              FindNearest (it->second, center, k, t);
+              seen += it->second.size ();
+            }
+          break;
+        }
+      // the cells of the border of the square of side 2 ring + 1
+      for (int64_t c = column - ring; c <= column + ring; c++)
+        {
+          int64_t step = (c == column - ring || c == column + ring) ? 1 : 2 * ring;
+          for (int64_t r = row - ring; r <= row + ring; r += step)
+            {
+              std::unordered_map<uint64_t, Cell>::const_iterator it = m_cells.find (GetCellKey (c, r));
+              if (it != m_cells.end ())
+                {
+                  FindNearest (it->second, center, k, t);
+                  seen += it->second.size ();
+                }
+            }
+        }
+      // the nodes of the next rings are at least this far
+      double bound = ring * m_cellSize - drift;
+      if (m_nearest.size () == k && bound > 0 && m_nearest.front ().first <= bound * bound)
+        {
+          break;
+        }
+    }
+  EndQuery ();
+
+  std::sort_heap (m_nearest.begin (), m_nearest.end ());
+  for (uint32_t i = 0; i < m_nearest.size (); i++)
+    {
+      nodeIds.push_back (m_nearest[i].second);
+    }
+}
+
+void
+MobilitySpatialIndex::FindNearest (const Cell &cell, const Vector &center, uint32_t k, int64_t time)
+{
+  // m_nearest is a max-heap by distance
+  for (Cell::const_iterator i = cell.begin (); i != cell.end (); i++)
+    {
+      const Entry &entry = m_entries[*i];
+      Vector position = GetPosition (entry, time);
+      double dx = position.x - center.x, dy = position.y - center.y, dz = position.z - center.z;
+      double distance2 = dx * dx + dy * dy + dz * dz;
+      if (m_nearest.size () < k)
+        {
+          m_nearest.push_back (std::make_pair (distance2, entry.nodeId));
+          std::push_heap (m_nearest.begin (), m_nearest.end ());
+        }
+      else if (distance2 < m_nearest.front ().first)
+        {
+          std::pop_heap (m_nearest.begin (), m_nearest.end ());
+          m_nearest.back () = std::make_pair (distance2, entry.nodeId);
+          std::push_heap (m_nearest.begin (), m_nearest.end ());
+        }
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,240 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#ifndef MOBILITY_SPATIAL_INDEX_H
+#define MOBILITY_SPATIAL_INDEX_H
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/node-container.h"
+
+namespace ns3 {
+
+class MobilityModel;
+
+/**
+ * \ingroup mobility
+ * \brief Finds the nodes within a distance of a point, or the nearest
+ * ones, without going through all the nodes.
+ *
+ * The nodes are kept in a uniform grid of CellSize cells in x and y,
+ * hashed so it covers any area, and moved from cell to cell as they move.
+ * The index listens to the CourseChange trace of their mobility models,
+ * and takes them to move at constant velocity between their course
+ * changes, as ConstantVelocityMobilityModel, the random mobility models
+ * and the trace helpers do: a moving node is only moved to its current
+ * cell when the index is refreshed, at most every Staleness, and the
+ * queries look for it as far as it may have gone since then, and check
+ * where it is exactly at the time of the query. The queries are exact,
+ * and take time in proportion to the nodes in the cells around the point,
+ * not to all the nodes.
+ *
+ * The models which change their velocity without notifying it
+ * (ConstantAccelerationMobilityModel, TrajectoryMobilityModel,
+ * WaypointMobilityModel with LazyNotify and the random models with Lazy)
+ * are queried when the index is refreshed and at each query which may
+ * find them, and must not move faster than MaxSpeed.
+ *
+ * A query at a future time finds the nodes at the positions their current
+ * velocities take them to.
+ */
+class MobilitySpatialIndex : public Object
+{
+public:
+  /**
+   * Register this type with the TypeId system.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  MobilitySpatialIndex ();
+  virtual ~MobilitySpatialIndex ();
+
+  /**
+   * \param nodes nodes to index. They must have a mobility model.
+   */
+  void Install (NodeContainer nodes);
+
+  /**
+   * Indexes all the nodes of the global ns3::NodeList which have a
+   * mobility model.
+   */
+  void InstallAll (void);
+
+  /**
+   * \param node node to stop indexing.
+   */
+  void Remove (Ptr<Node> node);
+
+  /**
+   * \returns the number of nodes indexed.
+   */
+  uint32_t GetN (void) const;
+
+  /**
+   * \returns the number of cells with nodes.
+   */
+  uint32_t GetNCells (void) const;
+
+  /**
+   * \param center center of the range.
+   * \param radius radius of the range in m.
+   * \param [out] nodeIds IDs of the nodes within the range now, in no
+   *        particular order.
+   */
+  void GetNodesInRange (const Vector &center, double radius, std::vector<uint32_t> &nodeIds);
+
+  /**
+   * \param center center of the range.
+   * \param radius radius of the range in m.
+   * \param time time of the query, not before now.
+   * \param [out] nodeIds IDs of the nodes within the range at the time, in
+   *        no particular order.
+   */
+  void GetNodesInRange (const Vector &center, double radius, Time time, std::vector<uint32_t> &nodeIds);
+
+  /**
+   * \param center point.
+   * \param k number of nodes to find.
+   * \param [out] nodeIds IDs of the k nodes nearest to the point now, or
+   *        of all the nodes if there are fewer, nearest first.
+   */
+  void GetNearestNodes (const Vector &center, uint32_t k, std::vector<uint32_t> &nodeIds);
+
+  /**
+   * \param center point.
+   * \param k number of nodes to find.
+   * \param time time of the query, not before now.
+   * \param [out] nodeIds IDs of the k nodes nearest to the point at the
+   *        time, or of all the nodes if there are fewer, nearest first.
+   */
+  void GetNearestNodes (const Vector &center, uint32_t k, Time time, std::vector<uint32_t> &nodeIds);
+
+private:
+  virtual void DoDispose (void);
+
+  /// Indexed node
+  struct Entry
+  {
+    Ptr<MobilityModel> model;   //!< mobility model of the node
+    uint32_t nodeId;            //!< node ID
+    bool polled;                //!< the model does not notify all its changes of velocity
+    Vector position;            //!< position at the time
+    Vector velocity;            //!< velocity from the time
+    int64_t time;               //!< time of the last course change, or of the last poll, in ns
+    uint64_t cell;              //!< cell the node is in
+    uint32_t cellIndex;         //!< index of the node in the cell
+    uint32_t listIndex;         //!< index of the node in m_moving or m_polled, if in one
+  };
+  /// Entries of the nodes in a cell
+  typedef std::vector<uint32_t> Cell;
+
+  /**
+   * \param model mobility model whose course changed.
+   *
+   * CourseChange trace sink.
+   */
+  void CourseChanged (Ptr<const MobilityModel> model);
+  /**
+   * \param entry index of the entry.
+   * \param position position to take it to.
+   */
+  void Move (uint32_t entry, const Vector &position);
+  /**
+   * \param entry index of the entry.
+   *
+   * Takes the entry out of its cell, and the cell out of the grid if it
+   * is left empty.
+   */
+  void RemoveFromCell (uint32_t entry);
+  /**
+   * \param entry index of the entry.
+   * \param moving true if it must be in m_moving.
+   */
+  void SetMoving (uint32_t entry, bool moving);
+  /**
+   * \param x x coordinate.
+   * \param y y coordinate.
+   * \returns the key of the cell of the point.
+   */
+  uint64_t GetCell (double x, double y) const;
+  /**
+   * \param column column of a cell.
+   * \param row row of a cell.
+   * \returns the key of the cell.
+   */
+  static uint64_t GetCellKey (int64_t column, int64_t row);
+  /**
+   * Moves the moving nodes to their cells now, if the index is older than
+   * the staleness.
+   */
+  void Refresh (void);
+  /**
+   * Ends a query, moving the nodes whose course changed during it to their
+   * cells.
+   */
+  void EndQuery (void);
+  /**
+   * \param entry entry of a node.
+   * \param time time in ns, not before now.
+   * \returns the position of the node at the time.
+   */
+  Vector GetPosition (const Entry &entry, int64_t time) const;
+  /**
+   * \param time time in ns, not before now.
+   * \returns how far a node may be from its cell at the time.
+   */
+  double GetDrift (int64_t time) const;
+  /**
+   * \param cell cell to look in.
+   * \param center point.
+   * \param k number of nodes to find.
+   * \param time time in ns, not before now.
+   *
+   * Adds the nodes of the cell to m_nearest if they are among the k nearest
+   * found so far.
+   */
+  void FindNearest (const Cell &cell, const Vector &center, uint32_t k, int64_t time);
+
+  double m_cellSize;                                //!< side of a cell in m
+  Time m_staleness;                                 //!< longest time between refreshes
+  double m_maxSpeed;                                //!< speed bound of the polled nodes in m/s
+
+  std::vector<Entry> m_entries;                     //!< indexed nodes
+  std::vector<int32_t> m_entryOfNode;               //!< entry of each node ID, -1 if none
+  std::unordered_map<uint64_t, Cell> m_cells;       //!< grid, by cell key
+  std::vector<uint32_t> m_moving;                   //!< entries of the nodes moving at constant velocity
+  std::vector<uint32_t> m_polled;                   //!< entries of the polled nodes
+  int64_t m_refreshTime;                            //!< time the moving nodes were last put in their cells, in ns
+  double m_speed;                                   //!< highest speed since then, in m/s
+  std::vector<std::pair<double, uint32_t> > m_nearest; //!< heap of the nearest nodes found by a query
+  bool m_querying;                                  //!< true while a query goes through the cells
+  std::vector<uint32_t> m_deferred;                 //!< entries whose course changed during the query
+};
+
+} // namespace ns3
+
+#endif /* MOBILITY_SPATIAL_INDEX_H */
@@ -0,0 +1,55 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "mobility-trace-info.h"
+
+namespace ns3 {
+
+MobilityTraceInfo::MobilityTraceInfo ()
+  : start (Seconds (0)),
+    stop (Seconds (0))
+{
+}
+
+NodeContainer
+MobilityTraceInfo::CreateNodes (void) const
+{
+  NodeContainer nodes;
+  if (nodeIds.empty ())
+    {
+      return nodes;
+    }
+  uint32_t count = nodeIds.back () + 1;
+  if (NodeList::GetNNodes () < count)
+    {
+      NodeContainer created;
+      created.Create (count - NodeList::GetNNodes ());
+    }
+  for (uint32_t i = 0; i < nodeIds.size (); i++)
+    {
+      nodes.Add (NodeList::GetNode (nodeIds[i]));
+    }
+  return nodes;
+}
+
+} // namespace ns3
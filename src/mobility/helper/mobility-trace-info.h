@@ -0,0 +1,65 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#ifndef MOBILITY_TRACE_INFO_H
+#define MOBILITY_TRACE_INFO_H
+
+#include <vector>
+#include <stdint.h>
+#include "ns3/nstime.h"
+#include "ns3/node-container.h"
+#include "ns3/box.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup mobility
+ * \brief What a mobility trace contains, as reported by
+ * Ns2MobilityHelper::GetTraceInfo and
+ * CompiledMobilityTraceHelper::GetTraceInfo.
+ *
+ * It gives the nodes and the duration to simulate a trace with, so they
+ * need not be known in advance.
+ */
+struct MobilityTraceInfo
+{
+  std::vector<uint32_t> nodeIds;  //!< IDs of the nodes of the trace, sorted
+  Time start;                     //!< time of the first movement, 0 if there is none
+  Time stop;                      //!< time the last movement ends, 0 if there is none
+  Box bounds;                     //!< bounding box of the positions of the nodes
+
+  MobilityTraceInfo ();
+
+  /**
+   * \returns the nodes of the trace, as found in the global ns3::NodeList.
+   *
+   * The helpers find the node of each ID of the trace by its index in the
+   * global ns3::NodeList, so this creates the nodes missing up to the
+   * highest ID. The nodes with the IDs between those of the trace are
+   * created too, but are not returned. Nodes created before keep their IDs,
+   * so it should be called before any other node is created.
+   */
+  NodeContainer CreateNodes (void) const;
+};
+
+} // namespace ns3
+
+#endif /* MOBILITY_TRACE_INFO_H */
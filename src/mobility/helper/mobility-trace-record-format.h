@@ -0,0 +1,137 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#ifndef MOBILITY_TRACE_RECORD_FORMAT_H
+#define MOBILITY_TRACE_RECORD_FORMAT_H
+
+#include <stdint.h>
+#include <cstring>
+#include <vector>
+
+/**
+ * \ingroup mobility
+ * \file
+ *
+ * Binary format of the course changes recorded by
+ * ns3::MobilityTraceRecorder.
+ *
+ * A file is a MobilityTraceRecordFileHeader followed by chunks. Each chunk
+ * is a MobilityTraceRecordChunkHeader followed by its rows, one after the
+ * other, each one a varint of each of the MOBILITY_TRACE_RECORD_COLUMNS
+ * columns:
+ *
+ * - time: in units of header.resolution (a Time::Unit), zigzag of the
+ *   difference with the previous row.
+ * - node: node ID, zigzag of the difference with the previous row.
+ * - x, y, z: bits of the position xor the bits of the position predicted
+ *   from the previous row of the same node, its position plus its velocity
+ *   times the time elapsed since, in header.step seconds per unit, so
+ *   the position of a node which kept its course takes a byte or two.
+ * - vx, vy, vz: bits of the velocity xor the bits of the previous velocity
+ *   of the same node.
+ *
+ * The position and velocity of a node are 0 before its first row. The
+ * previous values are carried from one chunk to the next, so a file is
+ * decoded from the beginning. The headers are written in the byte order of
+ * the machine.
+ */
+
+#define MOBILITY_TRACE_RECORD_MAGIC "EVCOURS\n"
+#define MOBILITY_TRACE_RECORD_VERSION 1
+#define MOBILITY_TRACE_RECORD_COLUMNS 8
+
+struct MobilityTraceRecordFileHeader
+{
+  char magic[8];         //!< MOBILITY_TRACE_RECORD_MAGIC
+  uint32_t version;      //!< MOBILITY_TRACE_RECORD_VERSION
+  uint32_t columns;      //!< MOBILITY_TRACE_RECORD_COLUMNS
+  uint32_t resolution;   //!< Time::Unit of the times
+  uint32_t reserved;     //!< 0
+  double step;           //!< seconds per unit of the times
+};
+
+struct MobilityTraceRecordChunkHeader
+{
+  uint32_t rows;         //!< number of rows of the chunk
+  uint32_t size;         //!< size in bytes of the rows of the chunk
+};
+
+inline uint64_t
+MobilityTraceRecordZigZag (int64_t value)
+{
+  return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+inline int64_t
+MobilityTraceRecordUnZigZag (uint64_t value)
+{
+  return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+inline uint64_t
+MobilityTraceRecordBits (double value)
+{
+  uint64_t bits;
+  std::memcpy (&bits, &value, sizeof (bits));
+  return bits;
+}
+
+inline double
+MobilityTraceRecordDouble (uint64_t bits)
+{
+  double value;
+  std::memcpy (&value, &bits, sizeof (value));
+  return value;
+}
+
+inline void
+MobilityTraceRecordPutVarint (std::vector<uint8_t> &buffer, uint64_t value)
+{
+  while (value >= 0x80)
+    {
+      buffer.push_back ((uint8_t) (value | 0x80));
+      value >>= 7;
+    }
+  buffer.push_back ((uint8_t) value);
+}
+
+/**
+ * \param [in,out] data next byte to decode, moved past the varint.
+ * \param end end of the buffer.
+ * \param [out] value decoded value.
+ * \returns false if the buffer ends before the varint.
+ */
+inline bool
+MobilityTraceRecordGetVarint (const uint8_t *&data, const uint8_t *end, uint64_t &value)
+{
+  value = 0;
+  for (int shift = 0; data < end && shift < 64; shift += 7)
+    {
+      uint8_t byte = *data++;
+      value |= (uint64_t) (byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+#endif /* MOBILITY_TRACE_RECORD_FORMAT_H */
@@ -0,0 +1,376 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <fstream>
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/mobility-model.h"
+#include "ns3/mobility-helper.h"
+#include "mobility-trace-recorder.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("MobilityTraceRecorder");
+
+MobilityTraceRecorder::MobilityTraceRecorder ()
+  : m_chunkSize (16384),
+    m_maxChunks (4),
+    m_chunk (0),
+    m_file (0),
+    m_chunks (0),
+    m_stopWriter (false),
+    m_step (0),
+    m_lastTime (0),
+    m_lastNode (0),
+    m_failed (false)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+MobilityTraceRecorder::~MobilityTraceRecorder ()
+{
+  NS_LOG_FUNCTION (this);
+  Close ();
+}
+
+void
+MobilityTraceRecorder::SetChunkSize (uint32_t rows)
+{
+  NS_ASSERT (rows > 0);
+  m_chunkSize = rows;
+}
+
+void
+MobilityTraceRecorder::SetMaxChunks (uint32_t chunks)
+{
+  NS_ASSERT (chunks >= 2);
+  m_maxChunks = chunks;
+}
+
+bool
+MobilityTraceRecorder::Open (std::string filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+  Close ();
+
+  m_file = std::fopen (filename.c_str (), "wb");
+  if (m_file == 0)
+    {
+      NS_LOG_ERROR ("Could not open " << filename << " for writing");
+      return false;
+    }
+
+  MobilityTraceRecordFileHeader header;
+  std::memset (&header, 0, sizeof (header));
+  std::memcpy (header.magic, MOBILITY_TRACE_RECORD_MAGIC, sizeof (header.magic));
+  header.version = MOBILITY_TRACE_RECORD_VERSION;
+  header.columns = MOBILITY_TRACE_RECORD_COLUMNS;
+  header.resolution = Time::GetResolution ();
+  header.step = Time::FromInteger (1, Time::GetResolution ()).GetSeconds ();
+  m_failed = std::fwrite (&header, sizeof (header), 1, m_file) != 1;
+
+  m_step = header.step;
+  m_lastTime = 0;
+  m_lastNode = 0;
+  m_tracks.clear ();
+  m_stopWriter = false;
+  m_chunk = AllocateChunk ();
+  m_writer = std::thread (&MobilityTraceRecorder::WriterLoop, this);
+  return true;
+}
+
+void
+MobilityTraceRecorder::Install (NodeContainer nodes)
+{
+  NS_LOG_FUNCTION (this);
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); i++)
+    {
+      Ptr<MobilityModel> model = (*i)->GetObject<MobilityModel> ();
+      if (model == 0)
+        {
+          NS_LOG_ERROR ("Node " << (*i)->GetId () << " has no mobility model");
+          continue;
+        }
+      model->TraceConnectWithoutContext ("CourseChange", MakeCallback (&MobilityTraceRecorder::CourseChanged, this));
+    }
+}
+
+void
+MobilityTraceRecorder::InstallAll (void)
+{
+  Install (NodeContainer::GetGlobal ());
+}
+
+bool
+MobilityTraceRecorder::Close (void)
+{
+  if (m_file == 0)
+    {
+      return true;
+    }
+  NS_LOG_FUNCTION (this);
+
+  Flush ();
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_stopWriter = true;
+  }
+  m_chunkFull.notify_one ();
+  m_writer.join ();
+
+  bool ok = !m_failed;
+  if (std::fclose (m_file) != 0)
+    {
+      ok = false;
+    }
+  m_file = 0;
+  if (!ok)
+    {
+      NS_LOG_ERROR ("Could not write the mobility trace record");
+    }
+
+  delete m_chunk;
+  m_chunk = 0;
+  for (uint32_t i = 0; i < m_freeChunks.size (); i++)
+    {
+      delete m_freeChunks[i];
+    }
+  m_freeChunks.clear ();
+  m_chunks = 0;
+  return ok;
+}
+
+void
+MobilityTraceRecorder::CourseChanged (Ptr<const MobilityModel> model)
+{
+  if (m_chunk == 0)
+    {
+      return;
+    }
+  Vector position = model->GetPosition ();
+  Vector velocity = model->GetVelocity ();
+  m_chunk->push_back (Row ());
+  Row &row = m_chunk->back ();
+  row.time = Simulator::Now ().GetTimeStep ();
+  row.node = model->GetObject<Node> ()->GetId ();
+  row.values[0] = position.x;
+  row.values[1] = position.y;
+  row.values[2] = position.z;
+  row.values[3] = velocity.x;
+  row.values[4] = velocity.y;
+  row.values[5] = velocity.z;
+
+  if (m_chunk->size () == m_chunkSize)
+    {
+      Flush ();
+    }
+}
+
+void
+MobilityTraceRecorder::Flush (void)
+{
+  if (m_chunk == 0 || m_chunk->empty ())
+    {
+      return;
+    }
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_fullChunks.push_back (m_chunk);
+  }
+  m_chunkFull.notify_one ();
+  m_chunk = AllocateChunk ();
+}
+
+std::vector<MobilityTraceRecorder::Row> *
+MobilityTraceRecorder::AllocateChunk (void)
+{
+  {
+    std::unique_lock<std::mutex> lock (m_mutex);
+    while (m_freeChunks.empty () && m_chunks == m_maxChunks)
+      {
+        m_chunkFree.wait (lock);
+      }
+    if (!m_freeChunks.empty ())
+      {
+        std::vector<Row> *chunk = m_freeChunks.back ();
+        m_freeChunks.pop_back ();
+        return chunk;
+      }
+    m_chunks++;
+  }
+  std::vector<Row> *chunk = new std::vector<Row>;
+  chunk->reserve (m_chunkSize);
+  return chunk;
+}
+
+void
+MobilityTraceRecorder::WriterLoop (void)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  while (true)
+    {
+      while (m_fullChunks.empty () && !m_stopWriter)
+        {
+          m_chunkFull.wait (lock);
+        }
+      if (m_fullChunks.empty ())
+        {
+          return;
+        }
+      std::vector<Row> *chunk = m_fullChunks.front ();
+      m_fullChunks.pop_front ();
+      lock.unlock ();
+
+      WriteChunk (*chunk);
+      chunk->clear ();
+
+      lock.lock ();
+      m_freeChunks.push_back (chunk);
+      m_chunkFree.notify_one ();
+    }
+}
+
+void
+MobilityTraceRecorder::Predict (const Track &track, int64_t time, double step, double position[3])
+{
+  double elapsed = (time - track.time) * step;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      position[i] = track.values[i] + track.values[3 + i] * elapsed;
+    }
+}
+
+void
+MobilityTraceRecorder::WriteChunk (const std::vector<Row> &chunk)
+{
+  m_buffer.clear ();
+  for (uint32_t i = 0; i < chunk.size (); i++)
+    {
+      const Row &row = chunk[i];
+      MobilityTraceRecordPutVarint (m_buffer, MobilityTraceRecordZigZag (row.time - m_lastTime));
+      MobilityTraceRecordPutVarint (m_buffer, MobilityTraceRecordZigZag ((int64_t) row.node - (int64_t) m_lastNode));
+      m_lastTime = row.time;
+      m_lastNode = row.node;
+      if (m_tracks.size () <= row.node)
+        {
+          m_tracks.resize (row.node + 1, Track ());
+        }
+
+      Track &track = m_tracks[row.node];
+      double predicted[3];
+      Predict (track, row.time, m_step, predicted);
+      for (uint32_t j = 0; j < 3; j++)
+        {
+          MobilityTraceRecordPutVarint (m_buffer, MobilityTraceRecordBits (row.values[j]) ^ MobilityTraceRecordBits (predicted[j]));
+        }
+      for (uint32_t j = 3; j < 6; j++)
+        {
+          MobilityTraceRecordPutVarint (m_buffer, MobilityTraceRecordBits (row.values[j]) ^ MobilityTraceRecordBits (track.values[j]));
+        }
+      track.time = row.time;
+      std::memcpy (track.values, row.values, sizeof (track.values));
+    }
+
+  MobilityTraceRecordChunkHeader header;
+  header.rows = chunk.size ();
+  header.size = m_buffer.size ();
+  if (std::fwrite (&header, sizeof (header), 1, m_file) != 1
+      || std::fwrite (&m_buffer[0], 1, m_buffer.size (), m_file) != m_buffer.size ())
+    {
+      m_failed = true;
+    }
+}
+
+bool
+MobilityTraceRecorder::Decode (std::string filename, std::ostream &os)
+{
+  NS_LOG_FUNCTION (filename);
+  std::ifstream file (filename.c_str (), std::ios::in | std::ios::binary);
+  MobilityTraceRecordFileHeader header;
+  if (!file.read ((char *) &header, sizeof (header))
+      || std::memcmp (header.magic, MOBILITY_TRACE_RECORD_MAGIC, sizeof (header.magic)) != 0
+      || header.version != MOBILITY_TRACE_RECORD_VERSION
+      || header.columns != MOBILITY_TRACE_RECORD_COLUMNS
+      || header.resolution >= Time::LAST)
+    {
+      NS_LOG_ERROR (filename << " is not a mobility trace record");
+      return false;
+    }
+  Time::Unit unit = (Time::Unit) header.resolution;
+
+  int64_t lastTime = 0;
+  uint32_t lastNode = 0;
+  std::vector<Track> tracks;
+  std::vector<uint8_t> buffer;
+  MobilityTraceRecordChunkHeader chunk;
+  while (file.read ((char *) &chunk, sizeof (chunk)))
+    {
+      buffer.resize (chunk.size);
+      if (!file.read ((char *) buffer.data (), chunk.size))
+        {
+          NS_LOG_ERROR (filename << " is truncated");
+          return false;
+        }
+      const uint8_t *data = buffer.data ();
+      const uint8_t *end = data + chunk.size;
+      uint64_t value;
+      for (uint32_t i = 0; i < chunk.rows; i++)
+        {
+          bool ok = MobilityTraceRecordGetVarint (data, end, value);
+          lastTime += MobilityTraceRecordUnZigZag (value);
+          ok = ok && MobilityTraceRecordGetVarint (data, end, value);
+          lastNode += MobilityTraceRecordUnZigZag (value);
+          if (tracks.size () <= lastNode)
+            {
+              tracks.resize (lastNode + 1, Track ());
+            }
+
+          Track &track = tracks[lastNode];
+          double predicted[3];
+          Predict (track, lastTime, header.step, predicted);
+          for (uint32_t j = 0; ok && j < 3; j++)
+            {
+              ok = MobilityTraceRecordGetVarint (data, end, value);
+              track.values[j] = MobilityTraceRecordDouble (MobilityTraceRecordBits (predicted[j]) ^ value);
+            }
+          for (uint32_t j = 3; ok && j < 6; j++)
+            {
+              ok = MobilityTraceRecordGetVarint (data, end, value);
+              track.values[j] = MobilityTraceRecordDouble (MobilityTraceRecordBits (track.values[j]) ^ value);
+            }
+          track.time = lastTime;
+          if (!ok)
+            {
+              NS_LOG_ERROR (filename << " is corrupted");
+              return false;
+            }
+
+          MobilityHelper::WriteCourseChange (os, Time::FromInteger (lastTime, unit), lastNode,
+                                             Vector (track.values[0], track.values[1], track.values[2]),
+                                             Vector (track.values[3], track.values[4], track.values[5]));
+        }
+    }
+  return true;
+}
+
+} // namespace ns3
@@ -0,0 +1,199 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#ifndef MOBILITY_TRACE_RECORDER_H
+#define MOBILITY_TRACE_RECORDER_H
+
+#include <cstdio>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+#include "ns3/ptr.h"
+#include "ns3/node-container.h"
+#include "mobility-trace-record-format.h"
+
+namespace ns3 {
+
+class MobilityModel;
+
+/**
+ * \ingroup mobility
+ * \brief Records the course changes of nodes to a binary file, see
+ * mobility-trace-record-format.h, as a faster and smaller replacement of
+ * the ascii traces of MobilityHelper::EnableAscii.
+ *
+ * Each course change appends the time, the node ID, the position and the
+ * velocity of the node to the current chunk, without any formatting. Full
+ * chunks are encoded and written by a background thread. The chunks are
+ * recycled in a ring of at most SetMaxChunks of them: if the writer falls
+ * that far behind, the simulation waits for it instead of buffering
+ * without bound.
+ *
+ * Decode writes a recorded file as the text EnableAscii would have
+ * written, see the scratch program mobility-trace-to-ascii.
+ *
+ * The recorder must live as long as the simulation it records.
+ */
+class MobilityTraceRecorder
+{
+public:
+  MobilityTraceRecorder ();
+
+  /**
+   * Closes the file.
+   */
+  ~MobilityTraceRecorder ();
+
+  /**
+   * \param rows course changes per chunk, 16384 by default.
+   *
+   * Must be called before Open.
+   */
+  void SetChunkSize (uint32_t rows);
+
+  /**
+   * \param chunks chunks of the ring, at least 2, 4 by default.
+   *
+   * Must be called before Open.
+   */
+  void SetMaxChunks (uint32_t chunks);
+
+  /**
+   * \param filename file to write. It is created or truncated.
+   * \returns false if the file could not be opened.
+   */
+  bool Open (std::string filename);
+
+  /**
+   * \param nodes nodes whose course changes are recorded.
+   */
+  void Install (NodeContainer nodes);
+
+  /**
+   * Records the course changes of all the nodes of the global
+   * ns3::NodeList.
+   */
+  void InstallAll (void);
+
+  /**
+   * Writes the pending course changes and closes the file.
+   *
+   * \returns false if the file could not be written.
+   */
+  bool Close (void);
+
+  /**
+   * \param filename file written by a MobilityTraceRecorder.
+   * \param os stream to write the course changes to, as
+   *        MobilityHelper::EnableAscii does, with the time resolution of
+   *        this program.
+   * \returns false if the file could not be read or is not a valid record.
+   */
+  static bool Decode (std::string filename, std::ostream &os);
+
+private:
+  MobilityTraceRecorder (const MobilityTraceRecorder &);
+  MobilityTraceRecorder & operator = (const MobilityTraceRecorder &);
+
+  /// Course change
+  struct Row
+  {
+    int64_t time;          //!< time, in units of the time resolution
+    uint32_t node;         //!< node ID
+    double values[6];      //!< x, y, z, vx, vy, vz
+  };
+
+  /// Last course change of a node, to encode or decode the next one
+  struct Track
+  {
+    int64_t time;          //!< time of the last course change
+    double values[6];      //!< position and velocity at that time
+  };
+
+  /**
+   * \param track last course change of a node.
+   * \param time time of its next course change.
+   * \param step seconds per unit of the times.
+   * \param [out] position position of the node at that time if it kept
+   *        its course.
+   *
+   * The same function predicts the positions in the writer and in Decode,
+   * so they agree to the bit.
+   */
+  static void Predict (const Track &track, int64_t time, double step, double position[3]);
+
+  /**
+   * \param model mobility model whose course changed.
+   *
+   * CourseChange trace sink.
+   */
+  void CourseChanged (Ptr<const MobilityModel> model);
+
+  /**
+   * Hands the current chunk to the writer thread and takes an empty one.
+   */
+  void Flush (void);
+
+  /**
+   * \returns an empty chunk, once there is one in the ring.
+   */
+  std::vector<Row> * AllocateChunk (void);
+
+  /**
+   * Main loop of the writer thread.
+   */
+  void WriterLoop (void);
+
+  /**
+   * \param chunk chunk to encode and write, in the writer thread.
+   */
+  void WriteChunk (const std::vector<Row> &chunk);
+
+  uint32_t m_chunkSize;                          //!< rows per chunk
+  uint32_t m_maxChunks;                          //!< chunks of the ring
+  std::vector<Row> *m_chunk;                     //!< chunk being filled
+
+  std::FILE *m_file;                             //!< output file
+  std::thread m_writer;                          //!< writer thread
+  std::mutex m_mutex;                            //!< protects the queues, m_chunks and m_stopWriter
+  std::condition_variable m_chunkFull;           //!< signals a full chunk to the writer
+  std::condition_variable m_chunkFree;           //!< signals a written chunk to the simulation
+  std::deque<std::vector<Row> *> m_fullChunks;   //!< chunks to write
+  std::vector<std::vector<Row> *> m_freeChunks;  //!< written chunks to reuse
+  uint32_t m_chunks;                             //!< chunks allocated
+  bool m_stopWriter;                             //!< the writer must exit once the queue is empty
+
+  // encoder state, only used by the writer thread until it is joined
+  double m_step;                                 //!< seconds per unit of the times
+  int64_t m_lastTime;                            //!< time of the last row
+  uint32_t m_lastNode;                           //!< node of the last row
+  std::vector<Track> m_tracks;                   //!< last row of each node ID
+  std::vector<uint8_t> m_buffer;                 //!< encoded rows
+  bool m_failed;                                 //!< a chunk could not be written
+};
+
+} // namespace ns3
+
+#endif /* MOBILITY_TRACE_RECORDER_H */
@@ -38,9 +38,17 @@
  */
 
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <map>
+#include <set>
+#include <queue>
+#include <vector>
+#include <limits>
 #include "ns3/log.h"
 #include "ns3/unused.h"
 #include "ns3/simulator.h"
@@ -65,16 +73,27 @@ NS_LOG_COMPONENT_DEFINE ("Ns2MobilityHelper");
 
 
 /**
- * Type to maintain line parsed and its values
+ * Slice of a line of the trace, which is not copied
+ */
+struct Ns2Token
+{
+  const char *data; //!< first character
+  size_t size;      //!< number of characters
+};
+
+/**
+ * Type to maintain line parsed and its values. The tokens point into the
+ * line, which must outlive them, and the vectors are reused from one line
+ * to the next one.
  */
 struct ParseResult
 {
-  std::vector<std::string> tokens; //!< tokens from a line
+  std::vector<Ns2Token> tokens; //!< tokens from a line
   std::vector<int> ivals;     //!< int values for each tokens
   std::vector<bool> has_ival; //!< points if a tokens has an int value
   std::vector<double> dvals;  //!< double values for each tokens
   std::vector<bool> has_dval; //!< points if a tokens has a double value
-  std::vector<std::string> svals;  //!< string value for each token
+  std::vector<Ns2Token> svals;  //!< string value for each token
 };
 /**
  * Keeps last movement schedule. If new movement occurs during
@@ -102,88 +121,245 @@ struct DestinationPoint
 
 
 /**
- * Parses a line of ns2 mobility
+ * Movements of the nodes while the commands of a trace are applied.
+ */
+struct Ns2TraceState
+{
+  std::map<int, DestinationPoint> lastPos; //!< previous movement scheduled for each node
+  std::map<int, Vector> position;          //!< positions set by the trace, if they are not taken from the models
+  bool trackPosition;                      //!< take the positions from position instead of the models
+  bool resume;                             //!< the trace is resumed at the start time
+  double start;                            //!< start time in seconds
+  std::set<int> resumed;                   //!< nodes whose movement at the start time is scheduled
+  Time installTime;                        //!< time the trace was installed at
+  Ns2TraceVisitor *visitor;                //!< receiver of the movements instead of the models, 0 if none
+  Ns2TraceState () :
+    trackPosition (false),
+    resume (false),
+    start (0),
+    visitor (0)
+  {};
+};
+
+
+/**
+ * Check if a token is equal to a string
  */
-static ParseResult ParseNs2Line (const std::string& str);
+static bool operator== (const Ns2Token& token, const char *str);
 
-/** 
- * Put out blank spaces at the start and end of a line
+/**
+ * Print a token
  */
-static std::string TrimNs2Line (const std::string& str);
+static std::ostream& operator<< (std::ostream& os, const Ns2Token& token);
+
+/**
+ * Parses a line of ns2 mobility into ret, reusing its buffers
+ */
+static void ParseNs2Line (const std::string& str, ParseResult& ret);
+
+/**
+ * Sets the values of the i-th token of a parsed line
+ */
+static void SetTokenValues (ParseResult& ret, size_t i);
 
 /**
  * Checks if a string represents a number or it has others characters than digits an point.
  */
-static bool IsNumber (const std::string& s);
+static bool IsNumber (const Ns2Token& s);
+
+/**
+ * Gets the value of a plain decimal number ([+-]digits[.digits]) of up to
+ * 15 significant digits, which is exact
+ * \param str string to check
+ * \param ival integer value of the number
+ * \param dval double value of the number
+ * \return false if the string is not such a number
+ */
+static bool ParseDecimal (const Ns2Token& str, int& ival, double& dval);
 
 /**
  * Check if s string represents a numeric value
  * \param str string to check
- * \param ret numeric value to return
+ * \param ival integer value to return
+ * \param dval double value to return
  * \return true if string represents a numeric value
  */
-template<class T>
-static bool IsVal (const std::string& str, T& ret);
+static bool IsVal (const Ns2Token& str, int& ival, double& dval);
 
 /**
  * Checks if the value between brackets is a correct nodeId number
  */ 
-static bool HasNodeIdNumber (std::string str);
+static bool HasNodeIdNumber (const Ns2Token& str);
 
 /** 
  * Gets nodeId number in string format from the string like $node_(4)
  */
-static std::string GetNodeIdFromToken (std::string str);
+static Ns2Token GetNodeIdFromToken (const Ns2Token& str);
 
 /** 
  * Get node id number in int format
  */
-static int GetNodeIdInt (ParseResult pr);
+static int GetNodeIdInt (const ParseResult& pr);
 
 /**  
  * Get node id number in string format
  */
-static std::string GetNodeIdString (ParseResult pr);
+static std::string GetNodeIdString (const ParseResult& pr);
 
 /**
  * Add one coord to a vector position
  */
-static Vector SetOneInitialCoord (Vector actPos, std::string& coord, double value);
+static Vector SetOneInitialCoord (Vector actPos, const Ns2Token& coord, double value);
 
 /** 
  * Check if this corresponds to a line like this: $node_(0) set X_ 123
  */
-static bool IsSetInitialPos (ParseResult pr);
+static bool IsSetInitialPos (const ParseResult& pr);
 
 /** 
  * Check if this corresponds to a line like this: $ns_ at 1 "$node_(0) setdest 2 3 4"
  */
-static bool IsSchedSetPos (ParseResult pr);
+static bool IsSchedSetPos (const ParseResult& pr);
 
 /**
  * Check if this corresponds to a line like this: $ns_ at 1 "$node_(0) set X_ 2"
  */
-static bool IsSchedMobilityPos (ParseResult pr);
+static bool IsSchedMobilityPos (const ParseResult& pr);
+
+/**
+ * Check if a line is a scheduled command and get its time and node id
+ * without parsing all of it
+ */
+static bool ScanNs2Command (const std::string& line, size_t first, double& at, int& nodeId);
 
 /**
- * Set waypoints and speed for movement.
+ * Apply a scheduled command (a line which is not an initial position) to
+ * the movement of its node, or give it to the visitor of the state.
+ */
+static void ApplyNs2Command (const std::string& line, const ParseResult& pr, int iNodeId, const std::string& nodeId,
+                             Ptr<ConstantVelocityMobilityModel> model, Ns2TraceState& state);
+
+/**
+ * Set waypoints and speed for movement, and give them to the visitor if
+ * there is one.
  */
 static DestinationPoint SetMovement (Ptr<ConstantVelocityMobilityModel> model, Vector lastPos, double at,
-                                     double xFinalPosition, double yFinalPosition, double speed);
+                                     double xFinalPosition, double yFinalPosition, double speed,
+                                     bool schedule = true, Time elapsed = Seconds (0),
+                                     Ns2TraceVisitor *visitor = 0, int nodeId = -1);
 
 /**
  * Set initial position for a node
  */
-static Vector SetInitialPosition (Ptr<ConstantVelocityMobilityModel> model, std::string coord, double coordVal);
+static Vector SetInitialPosition (Ptr<ConstantVelocityMobilityModel> model, const Ns2Token& coord, double coordVal);
 
 /** 
  * Schedule a set of position for a node
  */
-static Vector SetSchedPosition (Ptr<ConstantVelocityMobilityModel> model, double at, std::string coord, double coordVal);
+static Vector SetSchedPosition (Ptr<ConstantVelocityMobilityModel> model, double at, const Ns2Token& coord, double coordVal,
+                                bool schedule = true, Time elapsed = Seconds (0), Vector *tracked = 0);
+
+/**
+ * Place a node where the movements before the start time leave it and
+ * schedule the rest of the movement it is in the middle of.
+ */
+static void ResumeMovement (Ptr<ConstantVelocityMobilityModel> model, DestinationPoint &point, double start);
+
+
+/**
+ * \brief Reads the commands of a trace as the simulation advances, see
+ * Ns2MobilityHelper::EnableStreaming.
+ *
+ * The file is split in runs of commands whose times do not decrease. Each
+ * run is read from its own offset, a block at a time, and the runs are
+ * merged by time and line, so only the next command of each run is kept.
+ */
+class Ns2TraceStream : public SimpleRefCount<Ns2TraceStream>
+{
+public:
+  /**
+   * \param filename trace file
+   * \param lookAhead how long before its time each command is scheduled
+   */
+  Ns2TraceStream (std::string filename, Time lookAhead);
+  /**
+   * \return the movements of the nodes
+   */
+  Ns2TraceState & GetState (void);
+  /**
+   * \param nodeId node id in the trace
+   * \return true if the mobility model of the node was added
+   */
+  bool HasModel (int nodeId) const;
+  /**
+   * \param nodeId node id in the trace
+   * \param model its mobility model, 0 if the node is unknown
+   */
+  void AddModel (int nodeId, Ptr<ConstantVelocityMobilityModel> model);
+  /**
+   * \param begin offset of the first line of the run
+   * \param end offset after its last line
+   */
+  void AddRun (std::streamoff begin, std::streamoff end);
+  /**
+   * Applies the commands up to the start time, if the trace is resumed,
+   * and schedules the first ones.
+   */
+  void Start (void);
+
+private:
+  /// A run of commands whose times do not decrease
+  struct Run
+  {
+    std::streamoff next;        //!< offset of the next block to read
+    std::streamoff end;         //!< offset after the last line
+    std::streamoff bufferStart; //!< offset of the first byte of the buffer
+    std::string buffer;         //!< lines read
+    size_t pos;                 //!< next line in the buffer
+    std::string head;           //!< next command
+  };
+  /// Time, offset of the line and run of the next command of a run
+  typedef std::pair<std::pair<double, std::streamoff>, uint32_t> Head;
+
+  /**
+   * \param run run to read
+   * \param line next line of the run
+   * \param offset offset of the line
+   * \return false at the end of the run
+   */
+  bool ReadLine (Run &run, std::string &line, std::streamoff &offset);
+  /**
+   * Reads the next command of a run, applying the lines which are not.
+   * \param index index of the run
+   */
+  void ReadHead (uint32_t index);
+  /**
+   * \param line line of the trace to apply
+   */
+  void Apply (const std::string &line);
+  /**
+   * Schedules the commands up to the look-ahead and the next advance.
+   */
+  void Advance (void);
+
+  std::ifstream m_file;                    //!< trace file
+  Time m_lookAhead;                        //!< how long before its time each command is scheduled
+  Ns2TraceState m_state;                   //!< movements of the nodes
+  std::map<int, Ptr<ConstantVelocityMobilityModel> > m_models; //!< mobility model of each node id
+  std::vector<Run> m_runs;                 //!< runs of the file
+  std::priority_queue<Head, std::vector<Head>, std::greater<Head> > m_heads; //!< next command of each run
+  ParseResult m_parse;                     //!< parsed line, reused for all the lines
+};
 
 
+Ns2TraceVisitor::~Ns2TraceVisitor ()
+{
+}
+
 Ns2MobilityHelper::Ns2MobilityHelper (std::string filename)
-  : m_filename (filename)
+  : m_filename (filename),
+    m_startTime (Seconds (0)),
+    m_lookAhead (Seconds (0))
 {
   std::ifstream file (m_filename.c_str (), std::ios::in);
   if (!(file.is_open ())) NS_FATAL_ERROR("Could not open trace file " << m_filename.c_str() << " for reading, aborting here \n"); 
@@ -211,10 +387,35 @@ Ns2MobilityHelper::GetMobilityModel (std::string idString, const ObjectStore &st
 }
 
 
+void
+Ns2MobilityHelper::SetStartTime (Time start)
+{
+  m_startTime = start;
+}
+
+void
+Ns2MobilityHelper::EnableStreaming (Time lookAhead)
+{
+  NS_ASSERT (lookAhead.IsStrictlyPositive ());
+  m_lookAhead = lookAhead;
+}
+
 void
 Ns2MobilityHelper::ConfigNodesMovements (const ObjectStore &store) const
 {
-  std::map<int, DestinationPoint> last_pos;    // Stores previous movement scheduled for each node
+  if (m_lookAhead.IsStrictlyPositive ())
+    {
+      StreamNodesMovements (store);
+      return;
+    }
+
+  Ns2TraceState state;
+  std::map<int, DestinationPoint> &last_pos = state.lastPos; // Stores previous movement scheduled for each node
+  state.resume = m_startTime.IsStrictlyPositive ();
+  state.start = m_startTime.GetSeconds ();
+  state.installTime = Simulator::Now ();
+  std::string line;                              // reused for all the lines
+  ParseResult pr;                                // reused for all the lines
 
   //*****************************************************************
   // Parse the file the first time to get the initial node positions.
@@ -230,7 +431,6 @@ Ns2MobilityHelper::ConfigNodesMovements (const ObjectStore &store) const
         {
           int         iNodeId = 0;
           std::string nodeId;
-          std::string line;
 
           getline (file, line);
 
@@ -240,7 +440,7 @@ Ns2MobilityHelper::ConfigNodesMovements (const ObjectStore &store) const
               continue;
             }
 
-          ParseResult pr = ParseNs2Line (line); // Parse line and obtain tokens
+          ParseNs2Line (line, pr); // Parse line and obtain tokens
 
           // Check if the line corresponds with setting the initial
           // node positions
@@ -301,7 +501,6 @@ Ns2MobilityHelper::ConfigNodesMovements (const ObjectStore &store) const
         {
           int         iNodeId = 0;
           std::string nodeId;
-          std::string line;
 
           getline (file, line);
 
@@ -311,7 +510,7 @@ Ns2MobilityHelper::ConfigNodesMovements (const ObjectStore &store) const
               continue;
             }
 
-          ParseResult pr = ParseNs2Line (line); // Parse line and obtain tokens
+          ParseNs2Line (line, pr); // Parse line and obtain tokens
 
           // Check if the line corresponds with one of the three types of line
           if (pr.tokens.size () != 4 && pr.tokens.size () != 7 && pr.tokens.size () != 8)
@@ -352,163 +551,559 @@ Ns2MobilityHelper::ConfigNodesMovements (const ObjectStore &store) const
               continue;
             }
 
-          else // NOW EVENTS TO BE SCHEDULED
-            {
+          ApplyNs2Command (line, pr, iNodeId, nodeId, model, state);
+        }
+      file.close ();
+    }
 
-              // This is a scheduled event, so time at should be present
-              double at;
-
-              if (!IsNumber (pr.tokens[2]))
-                {
-                  NS_LOG_WARN ("Time is not a number: " << pr.tokens[2]);
-                  continue;
-                }
-
-              at = pr.dvals[2]; // set time at
-
-              if ( at < 0 )
-                {
-                  NS_LOG_WARN ("Time is less than cero: " << at);
-                  continue;
-                }
-
-
-
-              /*
-               * In this case a new waypoint is added
-               * line like $ns_ at 1 "$node_(0) setdest 2 3 4"
-               */
-              if (IsSchedMobilityPos (pr))
-                {
-                  if (last_pos[iNodeId].m_targetArrivalTime > at)
-                    {
-                      NS_LOG_LOGIC ("Did not reach a destination! stoptime = " << last_pos[iNodeId].m_targetArrivalTime << ", at = "<<  at);
-                      double actuallytraveled = at - last_pos[iNodeId].m_travelStartTime;
-                      Vector reached = Vector (
-                          last_pos[iNodeId].m_startPosition.x + last_pos[iNodeId].m_speed.x * actuallytraveled,
-                          last_pos[iNodeId].m_startPosition.y + last_pos[iNodeId].m_speed.y * actuallytraveled,
-                          0
-                          );
-                      NS_LOG_LOGIC ("Final point = " << last_pos[iNodeId].m_finalPosition << ", actually reached = " << reached);
-                      last_pos[iNodeId].m_stopEvent.Cancel ();
-                      last_pos[iNodeId].m_finalPosition = reached;
-                    }
-                  //                                     last position     time  X coord     Y coord      velocity
-                  last_pos[iNodeId] = SetMovement (model, last_pos[iNodeId].m_finalPosition, at, pr.dvals[5], pr.dvals[6], pr.dvals[7]);
-
-                  // Log new position
-                  NS_LOG_DEBUG ("Positions after parse for node " << iNodeId << " " << nodeId << " position =" << last_pos[iNodeId].m_finalPosition);
-                }
-
-
-              /*
-               * Scheduled set position
-               * line like $ns_ at 4.634906291962 "$node_(0) set X_ 28.675920486450"
-               */
-              else if (IsSchedSetPos (pr))
-                {
-                  //                                         time  coordinate   coord value
-                  last_pos[iNodeId].m_finalPosition = SetSchedPosition (model, at, pr.tokens[5], pr.dvals[6]);
-                  if (last_pos[iNodeId].m_targetArrivalTime > at)
-                    {
-                      last_pos[iNodeId].m_stopEvent.Cancel ();
-                    }
-                  last_pos[iNodeId].m_targetArrivalTime = at;
-                  last_pos[iNodeId].m_travelStartTime = at;
-                  // Log new position
-                  NS_LOG_DEBUG ("Positions after parse for node " << iNodeId << " " << nodeId <<
-                                " position =" << last_pos[iNodeId].m_finalPosition);
-                }
-              else
-                {
-                  NS_LOG_WARN ("Format Line is not correct: " << line << "\n");
-                }
+  // nodes without commands after the start time
+  for (std::map<int, DestinationPoint>::iterator it = last_pos.begin (); state.resume && it != last_pos.end (); it++)
+    {
+      if (state.resumed.find (it->first) == state.resumed.end ())
+        {
+          std::ostringstream nodeId;
+          nodeId << it->first;
+          Ptr<ConstantVelocityMobilityModel> model = GetMobilityModel (nodeId.str (), store);
+          if (model != 0)
+            {
+              ResumeMovement (model, it->second, state.start);
             }
         }
-      file.close ();
     }
 }
 
+/**
+ * \param bounds bounding box to extend
+ * \param position position to include
+ * \param empty bounds is empty, it becomes the position
+ */
+static void
+ExtendBounds (Box &bounds, const Vector &position, bool &empty)
+{
+  if (empty)
+    {
+      bounds = Box (position.x, position.x, position.y, position.y, position.z, position.z);
+      empty = false;
+      return;
+    }
+  bounds.xMin = std::min (bounds.xMin, position.x);
+  bounds.xMax = std::max (bounds.xMax, position.x);
+  bounds.yMin = std::min (bounds.yMin, position.y);
+  bounds.yMax = std::max (bounds.yMax, position.y);
+  bounds.zMin = std::min (bounds.zMin, position.z);
+  bounds.zMax = std::max (bounds.zMax, position.z);
+}
 
-ParseResult
-ParseNs2Line (const std::string& str)
+/**
+ * \brief Gathers the nodes, time span and bounding box of the movements of
+ * a trace, see Ns2MobilityHelper::GetTraceInfo.
+ */
+class Ns2TraceInfoVisitor : public Ns2TraceVisitor
 {
-  ParseResult ret;
-  std::istringstream s;
+public:
+  Ns2TraceInfoVisitor ()
+    : m_start (std::numeric_limits<double>::max ()),
+      m_stop (0),
+      m_moved (false),
+      m_empty (true)
+  {
+  }
+
+  virtual void InitialPosition (int nodeId, const Vector &position)
+  {
+    m_nodes.insert (nodeId);
+    ExtendBounds (m_bounds, position, m_empty);
+  }
+
+  virtual void Velocity (int nodeId, double at, const Vector &from, const Vector &velocity)
+  {
+    Reach (nodeId, at, from);
+  }
+
+  virtual void Stop (int nodeId, double at, const Vector &position)
+  {
+    // the previous stop of the node can no longer be withdrawn
+    std::map<int, std::pair<double, Vector> >::iterator it = m_stops.find (nodeId);
+    if (it != m_stops.end ())
+      {
+        Reach (nodeId, it->second.first, it->second.second);
+      }
+    m_stops[nodeId] = std::make_pair (at, position);
+    m_nodes.insert (nodeId);
+    m_start = std::min (m_start, at);
+  }
+
+  virtual void CancelStop (int nodeId)
+  {
+    m_stops.erase (nodeId);
+  }
+
+  virtual void Position (int nodeId, double at, const Vector &position)
+  {
+    Reach (nodeId, at, position);
+  }
+
+  /**
+   * \returns the nodes, time span and bounds of the movements visited.
+   */
+  MobilityTraceInfo GetInfo (void)
+  {
+    for (std::map<int, std::pair<double, Vector> >::const_iterator it = m_stops.begin (); it != m_stops.end (); it++)
+      {
+        Reach (it->first, it->second.first, it->second.second);
+      }
+    m_stops.clear ();
+
+    MobilityTraceInfo info;
+    info.nodeIds.assign (m_nodes.begin (), m_nodes.end ());
+    info.bounds = m_bounds;
+    if (m_moved)
+      {
+        info.start = Seconds (m_start);
+        info.stop = Seconds (m_stop);
+      }
+    return info;
+  }
+
+private:
+  /**
+   * \param nodeId ID of the node.
+   * \param at time in seconds.
+   * \param position position of the node at that time.
+   */
+  void Reach (int nodeId, double at, const Vector &position)
+  {
+    // the movements go in straight lines between these positions
+    m_nodes.insert (nodeId);
+    ExtendBounds (m_bounds, position, m_empty);
+    m_start = std::min (m_start, at);
+    m_stop = std::max (m_stop, at);
+    m_moved = true;
+  }
+
+  std::set<int> m_nodes;                                  //!< IDs of the nodes
+  std::map<int, std::pair<double, Vector> > m_stops;      //!< last stop of each node, which may be withdrawn
+  Box m_bounds;                                           //!< bounding box of the positions reached
+  double m_start;                                         //!< time of the first change, in s
+  double m_stop;                                          //!< time of the last change, in s
+  bool m_moved;                                           //!< a change was visited
+  bool m_empty;                                           //!< m_bounds is empty
+};
+
+MobilityTraceInfo
+Ns2MobilityHelper::GetTraceInfo (void) const
+{
+  Ns2TraceInfoVisitor visitor;
+  if (!VisitTrace (visitor))
+    {
+      return MobilityTraceInfo ();
+    }
+  MobilityTraceInfo info = visitor.GetInfo ();
+  NS_LOG_DEBUG (m_filename << ": " << info.nodeIds.size () << " nodes from " << info.start.GetSeconds ()
+                           << " s to " << info.stop.GetSeconds () << " s");
+  return info;
+}
+
+bool
+Ns2MobilityHelper::VisitTrace (Ns2TraceVisitor &visitor) const
+{
+  std::ifstream file (m_filename.c_str (), std::ios::in);
+  if (!file.is_open ())
+    {
+      NS_LOG_ERROR ("Could not open trace file " << m_filename);
+      return false;
+    }
+
+  Ns2TraceState state;
+  state.trackPosition = true;
+  state.installTime = Simulator::Now ();
+  state.visitor = &visitor;
   std::string line;
+  ParseResult pr;
 
-  // ignore comments (#)
-  size_t pos_sharp = str.find_first_of ('#');
-  if (pos_sharp != std::string::npos)
+  // a single read: the initial positions are set as they come, and the
+  // commands are kept until the end, since initial positions may follow them
+  std::vector<std::string> commands;
+  while (std::getline (file, line))
+    {
+      if (line.empty ())
+        {
+          continue;
+        }
+      ParseNs2Line (line, pr);
+      if (pr.tokens.size () != 4 && pr.tokens.size () != 7 && pr.tokens.size () != 8)
+        {
+          NS_LOG_ERROR ("Line has not correct number of parameters (corrupted file?): " << line << "\n");
+          continue;
+        }
+      int iNodeId = GetNodeIdInt (pr);
+      if (iNodeId == -1)
+        {
+          NS_LOG_ERROR ("Node number couldn't be obtained (corrupted file?): " << line << "\n");
+          continue;
+        }
+      if (IsSetInitialPos (pr))
+        {
+          Vector &position = state.position[iNodeId];
+          position = SetOneInitialCoord (position, pr.tokens[2], pr.dvals[3]);
+          state.lastPos[iNodeId].m_finalPosition = position;
+        }
+      else
+        {
+          commands.push_back (line);
+        }
+    }
+  for (std::map<int, Vector>::const_iterator it = state.position.begin (); it != state.position.end (); it++)
+    {
+      visitor.InitialPosition (it->first, it->second);
+    }
+
+  // then the commands, in the order of the file
+  for (std::vector<std::string>::const_iterator it = commands.begin (); it != commands.end (); it++)
+    {
+      ParseNs2Line (*it, pr);
+      ApplyNs2Command (*it, pr, GetNodeIdInt (pr), GetNodeIdString (pr), 0, state);
+    }
+  return true;
+}
+
+void
+Ns2MobilityHelper::StreamNodesMovements (const ObjectStore &store) const
+{
+  Ptr<Ns2TraceStream> stream = Create<Ns2TraceStream> (m_filename, m_lookAhead);
+  Ns2TraceState &state = stream->GetState ();
+  state.trackPosition = true;
+  state.resume = m_startTime.IsStrictlyPositive ();
+  state.start = m_startTime.GetSeconds ();
+  state.installTime = Simulator::Now ();
+
+  //*****************************************************************
+  // Scan the file once for the initial node positions, the nodes and
+  // the runs of commands whose times do not decrease
+  //*****************************************************************
+
+  std::ifstream file (m_filename.c_str (), std::ios::in | std::ios::binary);
+  std::streamoff offset = 0;
+  std::streamoff runBegin = 0;
+  double lastTime = -std::numeric_limits<double>::infinity ();
+  std::string line;
+  ParseResult pr;
+  while (std::getline (file, line))
+    {
+      std::streamoff lineOffset = offset;
+      offset += line.size () + 1;
+
+      size_t first = line.find_first_not_of (" \t");
+      if (first == std::string::npos)
+        {
+          continue;
+        }
+
+      double at;
+      int iNodeId;
+      if (ScanNs2Command (line, first, at, iNodeId))
+        {
+          if (at < lastTime)
+            {
+              stream->AddRun (runBegin, lineOffset);
+              runBegin = lineOffset;
+            }
+          lastTime = at;
+          if (!stream->HasModel (iNodeId))
+            {
+              std::ostringstream nodeId;
+              nodeId << iNodeId;
+              stream->AddModel (iNodeId, GetMobilityModel (nodeId.str (), store));
+            }
+          continue;
+        }
+      if (line.compare (first, std::strlen (NS2_NODEID), NS2_NODEID) != 0)
+        {
+          continue;
+        }
+
+      // as in the first parse of ConfigNodesMovements
+      ParseNs2Line (line, pr);
+      if (pr.tokens.size () != 4)
+        {
+          continue;
+        }
+      std::string nodeId = GetNodeIdString (pr);
+      iNodeId = GetNodeIdInt (pr);
+      if (iNodeId == -1)
+        {
+          NS_LOG_ERROR ("Node number couldn't be obtained (corrupted file?): " << line << "\n");
+          continue;
+        }
+      Ptr<ConstantVelocityMobilityModel> model = GetMobilityModel (nodeId, store);
+      if (!stream->HasModel (iNodeId))
+        {
+          stream->AddModel (iNodeId, model);
+        }
+      if (model == 0)
+        {
+          NS_LOG_ERROR ("Unknown node ID (corrupted file?): " << nodeId << "\n");
+          continue;
+        }
+      if (IsSetInitialPos (pr))
+        {
+          DestinationPoint point;
+          point.m_finalPosition = SetInitialPosition (model, pr.tokens[2], pr.dvals[3]);
+          state.lastPos[iNodeId] = point;
+          NS_LOG_DEBUG ("Positions after parse for node " << iNodeId << " " << nodeId <<
+                        " position = " << point.m_finalPosition);
+        }
+    }
+  stream->AddRun (runBegin, offset);
+
+  stream->Start ();
+}
+
+
+void
+ApplyNs2Command (const std::string& line, const ParseResult& pr, int iNodeId, const std::string& nodeId,
+                 Ptr<ConstantVelocityMobilityModel> model, Ns2TraceState& state)
+{
+  // This is a scheduled event, so time at should be present
+  double at;
+
+  if (!IsNumber (pr.tokens[2]))
+    {
+      NS_LOG_WARN ("Time is not a number: " << pr.tokens[2]);
+      return;
+    }
+
+  at = pr.dvals[2]; // set time at
+
+  if ( at < 0 )
+    {
+      NS_LOG_WARN ("Time is less than cero: " << at);
+      return;
+    }
+
+  // commands up to the start time only update the movement of the node,
+  // and nothing is scheduled for a visitor
+  bool schedule = (!state.resume || at > state.start) && state.visitor == 0;
+  Time elapsed = Simulator::Now () - state.installTime;
+  if (schedule && Seconds (at) < elapsed)
+    {
+      NS_LOG_WARN ("Time has already passed: " << at);
+      return;
+    }
+  DestinationPoint &point = state.lastPos[iNodeId];
+  if (schedule && state.resume && state.resumed.insert (iNodeId).second)
     {
-      line = str.substr (0, pos_sharp);
+      ResumeMovement (model, point, state.start);
+    }
+
+
+
+  /*
+   * In this case a new waypoint is added
+   * line like $ns_ at 1 "$node_(0) setdest 2 3 4"
+   */
+  if (IsSchedMobilityPos (pr))
+    {
+      if (point.m_targetArrivalTime > at)
+        {
+          NS_LOG_LOGIC ("Did not reach a destination! stoptime = " << point.m_targetArrivalTime << ", at = "<<  at);
+          double actuallytraveled = at - point.m_travelStartTime;
+          Vector reached = Vector (
+              point.m_startPosition.x + point.m_speed.x * actuallytraveled,
+              point.m_startPosition.y + point.m_speed.y * actuallytraveled,
+              0
+              );
+          NS_LOG_LOGIC ("Final point = " << point.m_finalPosition << ", actually reached = " << reached);
+          point.m_stopEvent.Cancel ();
+          if (state.visitor != 0)
+            {
+              state.visitor->CancelStop (iNodeId);
+            }
+          point.m_finalPosition = reached;
+        }
+      //                           last position     time  X coord     Y coord      velocity
+      point = SetMovement (model, point.m_finalPosition, at, pr.dvals[5], pr.dvals[6], pr.dvals[7], schedule, elapsed,
+                           state.visitor, iNodeId);
+
+      // Log new position
+      NS_LOG_DEBUG ("Positions after parse for node " << iNodeId << " " << nodeId << " position =" << point.m_finalPosition);
+    }
+
+
+  /*
+   * Scheduled set position
+   * line like $ns_ at 4.634906291962 "$node_(0) set X_ 28.675920486450"
+   */
+  else if (IsSchedSetPos (pr))
+    {
+      //                                               time  coordinate   coord value
+      point.m_finalPosition = SetSchedPosition (model, at, pr.tokens[5], pr.dvals[6], schedule, elapsed,
+                                                state.trackPosition ? &state.position[iNodeId] : 0);
+      if (point.m_targetArrivalTime > at)
+        {
+          point.m_stopEvent.Cancel ();
+          if (state.visitor != 0)
+            {
+              state.visitor->CancelStop (iNodeId);
+            }
+        }
+      if (state.visitor != 0)
+        {
+          state.visitor->Position (iNodeId, at, point.m_finalPosition);
+        }
+      point.m_targetArrivalTime = at;
+      point.m_travelStartTime = at;
+      // Log new position
+      NS_LOG_DEBUG ("Positions after parse for node " << iNodeId << " " << nodeId <<
+                    " position =" << point.m_finalPosition);
     }
   else
     {
-      line = str;
+      NS_LOG_WARN ("Format Line is not correct: " << line << "\n");
     }
+}
+
+
+bool
+ScanNs2Command (const std::string& line, size_t first, double& at, int& nodeId)
+{
+  // $ns_ at <time> "$node_(<id>) ...
+  if (line.compare (first, std::strlen (NS2_NS_SCH), NS2_NS_SCH) != 0)
+    {
+      return false;
+    }
+  const char *p = line.c_str () + first + std::strlen (NS2_NS_SCH);
+  if (!isblank (*p))
+    {
+      return false;
+    }
+  while (isblank (*p))
+    {
+      p++;
+    }
+  if (std::strncmp (p, NS2_AT, std::strlen (NS2_AT)) != 0 || !isblank (p[std::strlen (NS2_AT)]))
+    {
+      return false;
+    }
+  p += std::strlen (NS2_AT);
+  while (isblank (*p))
+    {
+      p++;
+    }
+  char *end;
+  at = std::strtod (p, &end);
+  if (end == p || !isblank (*end))
+    {
+      return false;
+    }
+  size_t node = line.find (NS2_NODEID, end - line.c_str ());
+  if (node == std::string::npos)
+    {
+      return false;
+    }
+  p = line.c_str () + node + std::strlen (NS2_NODEID);
+  long id = std::strtol (p, &end, 10);
+  if (end == p || *end != ')' || id < 0 || id > std::numeric_limits<int>::max ())
+    {
+      return false;
+    }
+  nodeId = id;
+  return true;
+}
+
+
+bool
+operator== (const Ns2Token& token, const char *str)
+{
+  return std::strlen (str) == token.size && std::memcmp (token.data, str, token.size) == 0;
+}
 
-  line = TrimNs2Line (line);
+
+std::ostream&
+operator<< (std::ostream& os, const Ns2Token& token)
+{
+  return os.write (token.data, token.size);
+}
+
+
+void
+ParseNs2Line (const std::string& str, ParseResult& ret)
+{
+  ret.tokens.clear ();
+  ret.ivals.clear ();
+  ret.has_ival.clear ();
+  ret.dvals.clear ();
+  ret.has_dval.clear ();
+  ret.svals.clear ();
+
+  const char *begin = str.data ();
+  const char *end = begin + str.size ();
+
+  // ignore comments (#)
+  const char *sharp = static_cast<const char *> (std::memchr (begin, '#', str.size ()));
+  if (sharp != 0)
+    {
+      end = sharp;
+    }
+
+  // Removes blank spaces at the begining and at the end of the line
+  while (begin < end && isblank (*begin))
+    {
+      begin++;
+    }
+  while (end > begin && (isblank (end[-1]) || end[-1] == ';'))
+    {
+      end--;
+    }
+  Ns2Token line = { begin, static_cast<size_t> (end - begin) };
 
   // If line hasn't a correct node Id
   if (!HasNodeIdNumber (line))
     {
       NS_LOG_WARN ("Line has no node Id: " << line);
-      return ret;
+      return;
     }
 
-  s.str (line);
-
-  while (!s.eof ())
+  for (const char *p = begin; p < end; )
     {
-      std::string x;
-      s >> x;
-      if (x.length () == 0)
+      while (p < end && isspace (*p))
         {
-          continue;
+          p++;
+        }
+      if (p == end)
+        {
+          break;
         }
-      ret.tokens.push_back (x);
-      int ii (0);
-      double d (0);
-      if (HasNodeIdNumber (x))
+      const char *tokenEnd = p;
+      while (tokenEnd < end && !isspace (*tokenEnd))
         {
-          x = GetNodeIdFromToken (x);
+          tokenEnd++;
         }
-      ret.has_ival.push_back (IsVal<int> (x, ii));
-      ret.ivals.push_back (ii);
-      ret.has_dval.push_back (IsVal<double> (x, d));
-      ret.dvals.push_back (d);
-      ret.svals.push_back (x);
+      Ns2Token token = { p, static_cast<size_t> (tokenEnd - p) };
+      ret.tokens.push_back (token);
+      ret.has_ival.push_back (false);
+      ret.ivals.push_back (0);
+      ret.has_dval.push_back (false);
+      ret.dvals.push_back (0);
+      ret.svals.push_back (token);
+      SetTokenValues (ret, ret.tokens.size () - 1);
+      p = tokenEnd;
     }
 
   size_t tokensLength   = ret.tokens.size ();                 // number of tokens in line
-  size_t lasTokenLength = ret.tokens[tokensLength - 1].size (); // length of the last token
+  size_t lasTokenLength = ret.tokens[tokensLength - 1].size; // length of the last token
 
   // if it is a scheduled set _[XYZ] or a setdest I need to remove the last "
   // and re-calculate values
   if ( (tokensLength == 7 || tokensLength == 8)
-       && (ret.tokens[tokensLength - 1][lasTokenLength - 1] == '"') )
+       && (ret.tokens[tokensLength - 1].data[lasTokenLength - 1] == '"') )
     {
 
       // removes " from the last position
-      ret.tokens[tokensLength - 1] = ret.tokens[tokensLength - 1].substr (0,lasTokenLength - 1);
-
-      std::string x;
-      x = ret.tokens[tokensLength - 1];
-
-      if (HasNodeIdNumber (x))
-        {
-          x = GetNodeIdFromToken (x);
-        }
+      ret.tokens[tokensLength - 1].size--;
 
       // Re calculate values
-      int ii (0);
-      double d (0);
-      ret.has_ival[tokensLength - 1] = IsVal<int> (x, ii);
-      ret.ivals[tokensLength - 1] = ii;
-      ret.has_dval[tokensLength - 1] = IsVal<double> (x, d);
-      ret.dvals[tokensLength - 1] = d;
-      ret.svals[tokensLength - 1] = x;
+      SetTokenValues (ret, tokensLength - 1);
 
     }
   else if ( (tokensLength == 9 && ret.tokens[tokensLength - 1] == "\"")
@@ -517,122 +1112,224 @@ ParseNs2Line (const std::string& str)
       // if the line has the " character in this way: $ns_ at 1 "$node_(0) setdest 2 2 1  "
       // or in this: $ns_ at 4 "$node_(0) set X_ 2  " we need to ignore this last token
 
-      ret.tokens.erase (ret.tokens.begin () + tokensLength - 1);
-      ret.has_ival.erase (ret.has_ival.begin () + tokensLength - 1);
-      ret.ivals.erase (ret.ivals.begin () + tokensLength - 1);
-      ret.has_dval.erase (ret.has_dval.begin () + tokensLength - 1);
-      ret.dvals.erase (ret.dvals.begin () + tokensLength - 1);
-      ret.svals.erase (ret.svals.begin () + tokensLength - 1);
+      ret.tokens.pop_back ();
+      ret.has_ival.pop_back ();
+      ret.ivals.pop_back ();
+      ret.has_dval.pop_back ();
+      ret.dvals.pop_back ();
+      ret.svals.pop_back ();
 
     }
+}
 
 
-
-  return ret;
+void
+SetTokenValues (ParseResult& ret, size_t i)
+{
+  Ns2Token x = ret.tokens[i];
+  if (HasNodeIdNumber (x))
+    {
+      x = GetNodeIdFromToken (x);
+    }
+  int ii (0);
+  double d (0);
+  bool isVal = IsVal (x, ii, d);
+  ret.has_ival[i] = isVal;
+  ret.ivals[i] = ii;
+  ret.has_dval[i] = isVal;
+  ret.dvals[i] = d;
+  ret.svals[i] = x;
 }
 
 
-std::string
-TrimNs2Line (const std::string& s)
+bool
+ParseDecimal (const Ns2Token& str, int& ival, double& dval)
 {
-  std::string ret = s;
-
-  while (ret.size () > 0 && isblank (ret[0]))
+  static const double powersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+                                        1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+  const char *p = str.data;
+  const char *end = str.data + str.size;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+'))
     {
-      ret.erase (0, 1);    // Removes blank spaces at the begining of the line
+      negative = *p == '-';
+      p++;
     }
-
-  while (ret.size () > 0 && (isblank (ret[ret.size () - 1]) || (ret[ret.size () - 1] == ';')))
+  uint64_t mantissa = 0;
+  int digits = 0;        // significant digits in the mantissa
+  int decimals = 0;      // digits of the mantissa after the point
+  int pendingZeros = 0;  // zeros after the point not added to the mantissa yet
+  bool any = false;
+  bool point = false;
+  int64_t integer = 0;
+  for (; p < end; p++)
+    {
+      if (*p == '.' && !point)
+        {
+          point = true;
+          integer = mantissa;
+          continue;
+        }
+      if (*p < '0' || *p > '9')
+        {
+          return false;
+        }
+      any = true;
+      if (point && *p == '0')
+        {
+          // trailing zeros of the decimals do not change the value
+          pendingZeros++;
+          continue;
+        }
+      for (; pendingZeros > 0; pendingZeros--)
+        {
+          mantissa *= 10;
+          decimals++;
+          digits++;
+        }
+      if (mantissa != 0 || *p != '0')
+        {
+          digits++;
+        }
+      mantissa = mantissa * 10 + (*p - '0');
+      decimals += point ? 1 : 0;
+      if (digits > 15 || decimals > 15)
+        {
+          return false;
+        }
+    }
+  if (!any)
+    {
+      return false;
+    }
+  if (!point)
     {
-      ret.erase (ret.size () - 1, 1); // Removes blank spaces from at end of line
+      integer = mantissa;
     }
 
-  return ret;
+  // one correctly rounded division of two exact values, as strtod
+  dval = static_cast<double> (mantissa) / powersOfTen[decimals];
+  ival = static_cast<int> (integer > std::numeric_limits<int>::max () ? std::numeric_limits<int>::max () : integer);
+  if (negative)
+    {
+      dval = -dval;
+      ival = integer > std::numeric_limits<int>::max () ? std::numeric_limits<int>::min () : -ival;
+    }
+  return true;
 }
 
 
 bool
-IsNumber (const std::string& s)
+IsNumber (const Ns2Token& s)
 {
+  int ival;
+  double dval;
+  if (s.size == 0 || ParseDecimal (s, ival, dval))
+    {
+      return true;
+    }
+  // only blanks and these characters can start a number for strtod
+  if (!isspace (s.data[0]) && std::strchr ("0123456789+-.iInN", s.data[0]) == 0)
+    {
+      return false;
+    }
+
+  // the token is followed by a blank, a quote, a bracket or the end of the
+  // line, which end the number
   char *endp;
-  double v = strtod (s.c_str (), &endp); // declared with warn_unused_result
+  double v = strtod (s.data, &endp); // declared with warn_unused_result
   NS_UNUSED (v); // suppress "set but not used" compiler warning
-  return endp == s.c_str () + s.size ();
+  return endp == s.data + s.size || s.size == 0;
 }
 
 
-template<class T>
-bool IsVal (const std::string& str, T& ret)
+bool
+IsVal (const Ns2Token& str, int& ival, double& dval)
 {
-  if (str.size () == 0)
+  if (str.size == 0)
     {
       return false;
     }
-  else if (IsNumber (str))
+  if (ParseDecimal (str, ival, dval))
     {
-      std::string s2 = str;
-      std::istringstream s (s2);
-      s >> ret;
       return true;
     }
-  else
+  if (!IsNumber (str))
     {
       return false;
     }
+
+  // the values a std::istringstream reads from the token
+  bool decimal = true;
+  for (size_t i = 0; i < str.size && decimal; i++)
+    {
+      decimal = std::strchr ("0123456789+-.eE", str.data[i]) != 0;
+    }
+  if (!decimal)
+    {
+      // inf, nan or hexadecimal, which are rare
+      std::string copy (str.data, str.size);
+      std::istringstream is (copy);
+      is >> ival;
+      is.clear ();
+      is.str (copy);
+      is >> dval;
+      return true;
+    }
+
+  long l = strtol (str.data, 0, 10);
+  ival = l > std::numeric_limits<int>::max () ? std::numeric_limits<int>::max ()
+    : l < std::numeric_limits<int>::min () ? std::numeric_limits<int>::min () : static_cast<int> (l);
+  dval = strtod (str.data, 0);
+  if (std::isinf (dval))
+    {
+      dval = dval > 0 ? std::numeric_limits<double>::max () : -std::numeric_limits<double>::max ();
+    }
+  return true;
 }
 
 
 bool
-HasNodeIdNumber (std::string str)
+HasNodeIdNumber (const Ns2Token& str)
 {
 
   // find brackets
-  std::string::size_type startNodeId = str.find_first_of ("("); // index of left bracket
-  std::string::size_type endNodeId   = str.find_first_of (")"); // index of right bracket
-
-  // Get de nodeId in a string and in a int value
-  std::string nodeId;     // node id
+  const char *startNodeId = static_cast<const char *> (std::memchr (str.data, '(', str.size)); // left bracket
+  const char *endNodeId   = static_cast<const char *> (std::memchr (str.data, ')', str.size)); // right bracket
 
   // if no brackets, continue!
-  if (startNodeId == std::string::npos || endNodeId == std::string::npos)
+  if (startNodeId == 0 || endNodeId == 0)
     {
       return false;
     }
 
-  nodeId = str.substr (startNodeId + 1, endNodeId - (startNodeId + 1)); // set node id
+  // Get de nodeId
+  Ns2Token nodeId = GetNodeIdFromToken (str);
 
   //   is number              is integer                                       is not negative
-  if (IsNumber (nodeId) && (nodeId.find_first_of (".") == std::string::npos) && (nodeId[0] != '-'))
-    {
-      return true;
-    }
-  else
-    {
-      return false;
-    }
+  return IsNumber (nodeId) && std::memchr (nodeId.data, '.', nodeId.size) == 0 && (nodeId.size == 0 || nodeId.data[0] != '-');
 }
 
 
-std::string
-GetNodeIdFromToken (std::string str)
+Ns2Token
+GetNodeIdFromToken (const Ns2Token& str)
 {
-  if (HasNodeIdNumber (str))
+  const char *startNodeId = static_cast<const char *> (std::memchr (str.data, '(', str.size)); // left bracket
+  const char *endNodeId   = static_cast<const char *> (std::memchr (str.data, ')', str.size)); // right bracket
+  if (startNodeId == 0 || endNodeId == 0)
     {
-      // find brackets
-      std::string::size_type startNodeId = str.find_first_of ("(");     // index of left bracket
-      std::string::size_type endNodeId   = str.find_first_of (")");     // index of right bracket
-
-      return str.substr (startNodeId + 1, endNodeId - (startNodeId + 1)); // set node id
-    }
-  else
-    {
-      return "";
+      Ns2Token empty = { str.data, 0 };
+      return empty;
     }
+  // up to the end of the token if the right bracket is before the left one
+  const char *end = endNodeId > startNodeId ? endNodeId : str.data + str.size;
+  Ns2Token nodeId = { startNodeId + 1, static_cast<size_t> (end - (startNodeId + 1)) };
+  return nodeId;
 }
 
 
 int
-GetNodeIdInt (ParseResult pr)
+GetNodeIdInt (const ParseResult& pr)
 {
   int result = -1;
   switch (pr.tokens.size ())
@@ -654,18 +1351,18 @@ GetNodeIdInt (ParseResult pr)
 
 // Get node id number in string format
 std::string
-GetNodeIdString (ParseResult pr)
+GetNodeIdString (const ParseResult& pr)
 {
   switch (pr.tokens.size ())
     {
     case 4:   // line like $node_(0) set X_ 11
-      return pr.svals[0];
+      return std::string (pr.svals[0].data, pr.svals[0].size);
       break;
     case 7:   // line like $ns_ at 4 "$node_(0) set X_ 28"
-      return pr.svals[3];
+      return std::string (pr.svals[3].data, pr.svals[3].size);
       break;
     case 8:   // line like $ns_ at 1 "$node_(0) setdest 2 3 4"
-      return pr.svals[3];
+      return std::string (pr.svals[3].data, pr.svals[3].size);
       break;
     default:
       return "";
@@ -674,7 +1371,7 @@ GetNodeIdString (ParseResult pr)
 
 
 Vector
-SetOneInitialCoord (Vector position, std::string& coord, double value)
+SetOneInitialCoord (Vector position, const Ns2Token& coord, double value)
 {
 
   // set the position for the coord.
@@ -698,7 +1395,7 @@ SetOneInitialCoord (Vector position, std::string& coord, double value)
 
 
 bool
-IsSetInitialPos (ParseResult pr)
+IsSetInitialPos (const ParseResult& pr)
 {
   //        number of tokens         has $node_( ?                        has "set"           has doble for position?
   return pr.tokens.size () == 4 && HasNodeIdNumber (pr.tokens[0]) && pr.tokens[1] == NS2_SET && pr.has_dval[3]
@@ -709,7 +1406,7 @@ IsSetInitialPos (ParseResult pr)
 
 
 bool
-IsSchedSetPos (ParseResult pr)
+IsSchedSetPos (const ParseResult& pr)
 {
   //      correct number of tokens,    has $ns_                   and at
   return pr.tokens.size () == 7 && pr.tokens[0] == NS2_NS_SCH && pr.tokens[1] == NS2_AT
@@ -719,7 +1416,7 @@ IsSchedSetPos (ParseResult pr)
 }
 
 bool
-IsSchedMobilityPos (ParseResult pr)
+IsSchedMobilityPos (const ParseResult& pr)
 {
   //     number of tokens      and    has $ns_                and    has at
   return pr.tokens.size () == 8 && pr.tokens[0] == NS2_NS_SCH && pr.tokens[1] == NS2_AT
@@ -731,7 +1428,8 @@ IsSchedMobilityPos (ParseResult pr)
 
 DestinationPoint
 SetMovement (Ptr<ConstantVelocityMobilityModel> model, Vector last_pos, double at,
-             double xFinalPosition, double yFinalPosition, double speed)
+             double xFinalPosition, double yFinalPosition, double speed, bool schedule, Time elapsed,
+             Ns2TraceVisitor *visitor, int nodeId)
 {
   DestinationPoint retval;
   retval.m_startPosition = last_pos;
@@ -742,7 +1440,15 @@ SetMovement (Ptr<ConstantVelocityMobilityModel> model, Vector last_pos, double a
   if (speed == 0)
     {
       // We have to maintain last position, and stop the movement
-      retval.m_stopEvent = Simulator::Schedule (Seconds (at), &ConstantVelocityMobilityModel::SetVelocity, model,
+      if (visitor != 0)
+        {
+          visitor->Stop (nodeId, at, retval.m_finalPosition);
+        }
+      if (!schedule)
+        {
+          return retval;
+        }
+      retval.m_stopEvent = Simulator::Schedule (Seconds (at) - elapsed, &ConstantVelocityMobilityModel::SetVelocity, model,
                                                 Vector (0, 0, 0));
       return retval;
     }
@@ -766,18 +1472,26 @@ SetMovement (Ptr<ConstantVelocityMobilityModel> model, Vector last_pos, double a
       NS_LOG_DEBUG ("Calculated Speed: X=" << xSpeed << " Y=" << ySpeed << " Z=" << zSpeed);
 
       // Set the Values
-      Simulator::Schedule (Seconds (at), &ConstantVelocityMobilityModel::SetVelocity, model, Vector (xSpeed, ySpeed, zSpeed));
-      retval.m_stopEvent = Simulator::Schedule (Seconds (at + time), &ConstantVelocityMobilityModel::SetVelocity, model, Vector (0, 0, 0));
+      if (schedule)
+        {
+          Simulator::Schedule (Seconds (at) - elapsed, &ConstantVelocityMobilityModel::SetVelocity, model, Vector (xSpeed, ySpeed, zSpeed));
+          retval.m_stopEvent = Simulator::Schedule (Seconds (at + time) - elapsed, &ConstantVelocityMobilityModel::SetVelocity, model, Vector (0, 0, 0));
+        }
       retval.m_finalPosition.x += xSpeed * time;
       retval.m_finalPosition.y += ySpeed * time;
       retval.m_targetArrivalTime += time;
+      if (visitor != 0)
+        {
+          visitor->Velocity (nodeId, at, retval.m_startPosition, retval.m_speed);
+          visitor->Stop (nodeId, retval.m_targetArrivalTime, retval.m_finalPosition);
+        }
     }
   return retval;
 }
 
 
 Vector
-SetInitialPosition (Ptr<ConstantVelocityMobilityModel> model, std::string coord, double coordVal)
+SetInitialPosition (Ptr<ConstantVelocityMobilityModel> model, const Ns2Token& coord, double coordVal)
 {
   model->SetPosition (SetOneInitialCoord (model->GetPosition (), coord, coordVal));
 
@@ -791,22 +1505,277 @@ SetInitialPosition (Ptr<ConstantVelocityMobilityModel> model, std::string coord,
 
 // Schedule a set of position for a node
 Vector
-SetSchedPosition (Ptr<ConstantVelocityMobilityModel> model, double at, std::string coord, double coordVal)
+SetSchedPosition (Ptr<ConstantVelocityMobilityModel> model, double at, const Ns2Token& coord, double coordVal, bool schedule,
+                  Time elapsed, Vector *tracked)
 {
-  // update position
-  model->SetPosition (SetOneInitialCoord (model->GetPosition (), coord, coordVal));
-
   Vector position;
-  position.x = model->GetPosition ().x;
-  position.y = model->GetPosition ().y;
-  position.z = model->GetPosition ().z;
+  if (tracked != 0)
+    {
+      // the model keeps moving until the time of the command
+      *tracked = SetOneInitialCoord (*tracked, coord, coordVal);
+      position = *tracked;
+      if (!schedule && model != 0)
+        {
+          model->SetPosition (position);
+        }
+    }
+  else
+    {
+      // update position
+      model->SetPosition (SetOneInitialCoord (model->GetPosition (), coord, coordVal));
+
+      position.x = model->GetPosition ().x;
+      position.y = model->GetPosition ().y;
+      position.z = model->GetPosition ().z;
+    }
 
   // Chedule next positions
-  Simulator::Schedule (Seconds (at), &ConstantVelocityMobilityModel::SetPosition, model,position);
+  if (schedule)
+    {
+      Simulator::Schedule (Seconds (at) - elapsed, &ConstantVelocityMobilityModel::SetPosition, model,position);
+    }
 
   return position;
 }
 
+void
+ResumeMovement (Ptr<ConstantVelocityMobilityModel> model, DestinationPoint &point, double start)
+{
+  Vector position = model->GetPosition ();
+  Vector velocity = Vector (0, 0, 0);
+  if (point.m_targetArrivalTime > start)
+    {
+      // in the middle of a movement, which must still stop at its destination
+      double traveled = start - point.m_travelStartTime;
+      position.x = point.m_startPosition.x + point.m_speed.x * traveled;
+      position.y = point.m_startPosition.y + point.m_speed.y * traveled;
+      velocity = point.m_speed;
+      point.m_stopEvent = Simulator::Schedule (Seconds (point.m_targetArrivalTime), &ConstantVelocityMobilityModel::SetVelocity, model,
+                                               Vector (0, 0, 0));
+    }
+  else
+    {
+      position.x = point.m_finalPosition.x;
+      position.y = point.m_finalPosition.y;
+    }
+  NS_LOG_DEBUG ("Resuming at " << start << " position =" << position << " velocity =" << velocity);
+
+  // stay still until the start time
+  model->SetPosition (position);
+  model->SetVelocity (Vector (0, 0, 0));
+  Simulator::Schedule (Seconds (start), &ConstantVelocityMobilityModel::SetVelocity, model, velocity);
+}
+
+Ns2TraceStream::Ns2TraceStream (std::string filename, Time lookAhead)
+  : m_file (filename.c_str (), std::ios::in | std::ios::binary),
+    m_lookAhead (lookAhead)
+{
+  if (!m_file.is_open ())
+    {
+      NS_FATAL_ERROR ("Could not open trace file " << filename << " for reading, aborting here \n");
+    }
+}
+
+Ns2TraceState &
+Ns2TraceStream::GetState (void)
+{
+  return m_state;
+}
+
+bool
+Ns2TraceStream::HasModel (int nodeId) const
+{
+  return m_models.find (nodeId) != m_models.end ();
+}
+
+void
+Ns2TraceStream::AddModel (int nodeId, Ptr<ConstantVelocityMobilityModel> model)
+{
+  m_models[nodeId] = model;
+}
+
+void
+Ns2TraceStream::AddRun (std::streamoff begin, std::streamoff end)
+{
+  if (begin >= end)
+    {
+      return;
+    }
+  Run run;
+  run.next = begin;
+  run.end = end;
+  run.bufferStart = begin;
+  run.pos = 0;
+  m_runs.push_back (run);
+}
+
+void
+Ns2TraceStream::Start (void)
+{
+  NS_LOG_DEBUG ("Streaming " << m_runs.size () << " runs of commands");
+  // the models keep moving until the scheduled set positions
+  for (std::map<int, Ptr<ConstantVelocityMobilityModel> >::iterator it = m_models.begin (); it != m_models.end (); it++)
+    {
+      if (it->second != 0)
+        {
+          m_state.position[it->first] = it->second->GetPosition ();
+        }
+    }
+
+  for (uint32_t i = 0; i < m_runs.size (); i++)
+    {
+      ReadHead (i);
+    }
+
+  if (m_state.resume)
+    {
+      // commands up to the start time only update the movement of the nodes
+      while (!m_heads.empty () && m_heads.top ().first.first <= m_state.start)
+        {
+          uint32_t index = m_heads.top ().second;
+          m_heads.pop ();
+          Apply (m_runs[index].head);
+          ReadHead (index);
+        }
+      for (std::map<int, Ptr<ConstantVelocityMobilityModel> >::iterator it = m_models.begin (); it != m_models.end (); it++)
+        {
+          if (it->second != 0 && m_state.resumed.insert (it->first).second)
+            {
+              ResumeMovement (it->second, m_state.lastPos[it->first], m_state.start);
+            }
+        }
+    }
+
+  Advance ();
+}
+
+bool
+Ns2TraceStream::ReadLine (Run &run, std::string &line, std::streamoff &offset)
+{
+  static const std::streamoff blockSize = 4096;
+  while (true)
+    {
+      size_t eol = run.buffer.find ('\n', run.pos);
+      if (eol != std::string::npos)
+        {
+          line = run.buffer.substr (run.pos, eol - run.pos);
+          offset = run.bufferStart + run.pos;
+          run.pos = eol + 1;
+          return true;
+        }
+      if (run.next >= run.end)
+        {
+          if (run.pos < run.buffer.size ())
+            {
+              // last line without end of line
+              line = run.buffer.substr (run.pos);
+              offset = run.bufferStart + run.pos;
+              run.pos = run.buffer.size ();
+              return true;
+            }
+          std::string ().swap (run.buffer);
+          return false;
+        }
+
+      // read the next block after the rest of the buffer
+      run.buffer.erase (0, run.pos);
+      run.bufferStart += run.pos;
+      run.pos = 0;
+      std::streamoff size = std::min (blockSize, run.end - run.next);
+      size_t used = run.buffer.size ();
+      run.buffer.resize (used + size);
+      m_file.clear ();
+      m_file.seekg (run.next);
+      m_file.read (&run.buffer[used], size);
+      if (m_file.gcount () != size)
+        {
+          NS_LOG_ERROR ("Trace file is shorter than when it was scanned");
+          run.buffer.resize (used + m_file.gcount ());
+          run.next = run.end;
+          continue;
+        }
+      run.next += size;
+    }
+}
+
+void
+Ns2TraceStream::ReadHead (uint32_t index)
+{
+  Run &run = m_runs[index];
+  std::string line;
+  std::streamoff offset;
+  while (ReadLine (run, line, offset))
+    {
+      size_t first = line.find_first_not_of (" \t");
+      if (first == std::string::npos)
+        {
+          continue;
+        }
+      double at;
+      int nodeId;
+      if (ScanNs2Command (line, first, at, nodeId))
+        {
+          run.head = line;
+          m_heads.push (Head (std::make_pair (at, offset), index));
+          return;
+        }
+      // not a command, it is not scheduled
+      Apply (line);
+    }
+}
+
+void
+Ns2TraceStream::Apply (const std::string &line)
+{
+  // as in the second parse of Ns2MobilityHelper::ConfigNodesMovements
+  ParseResult &pr = m_parse;
+  ParseNs2Line (line, pr);
+  if (pr.tokens.size () != 4 && pr.tokens.size () != 7 && pr.tokens.size () != 8)
+    {
+      NS_LOG_ERROR ("Line has not correct number of parameters (corrupted file?): " << line << "\n");
+      return;
+    }
+  std::string nodeId = GetNodeIdString (pr);
+  int iNodeId = GetNodeIdInt (pr);
+  if (iNodeId == -1)
+    {
+      NS_LOG_ERROR ("Node number couldn't be obtained (corrupted file?): " << line << "\n");
+      return;
+    }
+  std::map<int, Ptr<ConstantVelocityMobilityModel> >::const_iterator it = m_models.find (iNodeId);
+  if (it == m_models.end () || it->second == 0)
+    {
+      NS_LOG_ERROR ("Unknown node ID (corrupted file?): " << nodeId << "\n");
+      return;
+    }
+  if (IsSetInitialPos (pr))
+    {
+      // already set when the file was scanned
+      return;
+    }
+  ApplyNs2Command (line, pr, iNodeId, nodeId, it->second, m_state);
+}
+
+void
+Ns2TraceStream::Advance (void)
+{
+  Time limit = Simulator::Now () + m_lookAhead;
+  while (!m_heads.empty () && m_state.installTime + Seconds (m_heads.top ().first.first) <= limit)
+    {
+      uint32_t index = m_heads.top ().second;
+      m_heads.pop ();
+      Apply (m_runs[index].head);
+      ReadHead (index);
+    }
+  if (m_heads.empty ())
+    {
+      m_file.close ();
+      return;
+    }
+  Time next = m_state.installTime + Seconds (m_heads.top ().first.first) - limit;
+  Simulator::Schedule (next, &Ns2TraceStream::Advance, Ptr<Ns2TraceStream> (this));
+}
+
 void
 Ns2MobilityHelper::Install (void) const
 {
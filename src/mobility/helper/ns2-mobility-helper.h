@@ -27,11 +27,66 @@
 #include <stdint.h>
 #include "ns3/ptr.h"
 #include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "mobility-trace-info.h"
 
 namespace ns3 {
 
 class ConstantVelocityMobilityModel;
 
+/**
+ * \ingroup mobility
+ * \brief Receives the movements of the nodes of an ns-2 trace, as
+ * Ns2MobilityHelper would schedule them, see Ns2MobilityHelper::VisitTrace.
+ *
+ * The changes of each node are given in the order of the commands of the
+ * trace. A stop is withdrawn when a later command interrupts the movement
+ * it ends.
+ */
+class Ns2TraceVisitor
+{
+public:
+  virtual ~Ns2TraceVisitor ();
+
+  /**
+   * \param nodeId ID of the node.
+   * \param position initial position of the node.
+   *
+   * Called for each node with an initial position, before any command.
+   */
+  virtual void InitialPosition (int nodeId, const Vector &position) = 0;
+
+  /**
+   * \param nodeId ID of the node.
+   * \param at time of the change in seconds.
+   * \param from position of the node at that time.
+   * \param velocity velocity the node takes.
+   */
+  virtual void Velocity (int nodeId, double at, const Vector &from, const Vector &velocity) = 0;
+
+  /**
+   * \param nodeId ID of the node.
+   * \param at time of the stop in seconds.
+   * \param position position of the node at that time.
+   */
+  virtual void Stop (int nodeId, double at, const Vector &position) = 0;
+
+  /**
+   * \param nodeId ID of the node.
+   *
+   * Withdraws the last stop given for the node.
+   */
+  virtual void CancelStop (int nodeId) = 0;
+
+  /**
+   * \param nodeId ID of the node.
+   * \param at time of the change in seconds.
+   * \param position position the node is moved to.
+   */
+  virtual void Position (int nodeId, double at, const Vector &position) = 0;
+};
+
 /**
  * \ingroup mobility
  * \brief Helper class which can read ns-2 movement files and configure nodes mobility.
@@ -103,6 +158,67 @@ public:
    */
   template <typename T>
   void Install (T begin, T end) const;
+
+  /**
+   * \param start time to start the movements at, 0 by default.
+   *
+   * Resumes the trace at the given time, e.g. to continue a simulation
+   * saved at that time. The commands of the trace up to the start time are
+   * not scheduled: each node is placed where they leave it, and at the
+   * start time it takes the velocity of the movement it is in the middle
+   * of, if any. The commands after the start time are scheduled as usual.
+   * Must be called before Install.
+   */
+  void SetStartTime (Time start);
+
+  /**
+   * \param lookAhead how long before its time each command is scheduled.
+   *
+   * Reads the trace as the simulation advances instead of scheduling all
+   * its commands when it is installed, so the memory used and the events
+   * pending depend on the nodes moving and not on the length of the trace.
+   *
+   * The file is scanned once at install, without parsing the commands, to
+   * set the initial positions and split it in runs of commands whose times
+   * do not decrease: a single run if it is sorted by time, or one per node
+   * if it is grouped by node. The runs are then read and merged by time, and
+   * each command is scheduled lookAhead before its time. Commands at the
+   * same time as other events run after those already scheduled, so the
+   * look-ahead should be longer than the period of the periodic events that
+   * must see the new movements (e.g. updates of the nodes). The commands of
+   * a node must be in time order, and the scheduled set positions do not
+   * change the position of the node before their time.
+   * Must be called before Install.
+   */
+  void EnableStreaming (Time lookAhead = Seconds (60));
+
+  /**
+   * \return the IDs of the nodes of the trace, the time span of its
+   *         movements and their bounding box.
+   *
+   * Reads the trace once without installing it (see VisitTrace), so the nodes
+   * and the duration of a simulation can be taken from the trace (see
+   * MobilityTraceInfo::CreateNodes). The stop time is when the last
+   * movement reaches its destination, as computed by Install, and the
+   * movements interrupted by a later command end where they are
+   * interrupted.
+   */
+  MobilityTraceInfo GetTraceInfo (void) const;
+
+  /**
+   * \param visitor receiver of the movements of the nodes.
+   * \return false if the trace could not be read.
+   *
+   * Reads the trace as Install does, without scheduling any event, and
+   * gives the movements of all its nodes to the visitor: first their
+   * initial positions, wherever they are in the file, and then the changes
+   * its commands make, see Ns2TraceVisitor.
+   *
+   * The file is read once. Since initial positions may come after the
+   * commands, the lines of the commands are kept in memory until the end
+   * of the file, and parsed again to be visited.
+   */
+  bool VisitTrace (Ns2TraceVisitor &visitor) const;
 private:
   /**
    * \brief a class to hold input objects internally
@@ -123,6 +239,12 @@ public:
    * \param store Object store containing ns-3 mobility models
    */
   void ConfigNodesMovements (const ObjectStore &store) const;
+  /**
+   * Scans the ns-2 mobility file and starts reading its commands as the
+   * simulation advances, see EnableStreaming
+   * \param store Object store containing ns-3 mobility models
+   */
+  void StreamNodesMovements (const ObjectStore &store) const;
   /**
    * Get or create a ConstantVelocityMobilityModel corresponding to idString
    * \param idString string name for a node
@@ -131,6 +253,8 @@ public:
    */
   Ptr<ConstantVelocityMobilityModel> GetMobilityModel (std::string idString, const ObjectStore &store) const;
   std::string m_filename; //!< filename of file containing ns-2 mobility trace 
+  Time m_startTime;       //!< time of the first scheduled movement
+  Time m_lookAhead;       //!< look-ahead of the commands read as the simulation advances, 0 to schedule them all at install
 };
 
 } // namespace ns3
@@ -0,0 +1,883 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/constant-acceleration-mobility-model.h"
+#include "ns3/trajectory-mobility-model.h"
+#include "sumo-fcd-mobility-helper.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("SumoFcdMobilityHelper");
+
+/**
+ * Attributes of a vehicle element of an FCD file. The ID points into the
+ * buffer of the reader, and is valid until the next element is read.
+ */
+struct SumoFcdSample
+{
+  const char *id;     //!< first character of the SUMO ID
+  size_t idSize;      //!< number of characters of the SUMO ID
+  double x;           //!< x coordinate
+  double y;           //!< y coordinate
+  double z;           //!< z coordinate, if hasZ
+  bool hasZ;          //!< the element has a z coordinate
+  double angle;       //!< heading, degrees clockwise from the y axis
+  double speed;       //!< speed in m/s
+  double slope;       //!< slope in degrees
+};
+
+/**
+ * State of a vehicle after its last sample.
+ */
+struct SumoFcdVehicle
+{
+  double time;        //!< time of the last sample, in s
+  uint32_t step;      //!< number of the time step of the last sample, 0 if none
+  Vector position;    //!< position at the last sample
+  Vector velocity;    //!< velocity at the last sample
+  SumoFcdVehicle () :
+    time (0),
+    step (0)
+  {};
+};
+
+/**
+ * \brief Reads the time steps and vehicles of an FCD file, a block at a
+ * time.
+ *
+ * This is not a general XML parser: it only splits the file in elements,
+ * skipping the comments and the text between them, and reads the
+ * attributes of the timestep and vehicle elements without copying them.
+ */
+class SumoFcdReader
+{
+public:
+  /**
+   * \param filename FCD file
+   */
+  SumoFcdReader (std::string filename);
+  /**
+   * \return true if the file could be opened
+   */
+  bool IsOpen (void) const;
+  /**
+   * Skips to the next time step.
+   * \param time its time, in s
+   * \return false at the end of the file
+   */
+  bool NextTimestep (double &time);
+  /**
+   * \param sample next vehicle of the time step
+   * \return false at the end of the time step
+   */
+  bool NextVehicle (SumoFcdSample &sample);
+
+private:
+  /**
+   * Reads the next element, which is kept in the buffer until the next
+   * call.
+   * \return false at the end of the file
+   */
+  bool NextElement (void);
+  /**
+   * \param name element name
+   * \return true if the current element is a name start or empty element
+   */
+  bool IsElement (const char *name) const;
+
+  std::ifstream m_file;     //!< FCD file
+  std::string m_buffer;     //!< bytes read and not parsed
+  size_t m_pos;             //!< next byte to parse
+  const char *m_element;    //!< current element, after the <
+  size_t m_elementSize;     //!< characters of the current element, up to the >
+  bool m_inTimestep;        //!< the vehicles of a time step are being read
+};
+
+/**
+ * \param p next character of an element, moved past the attribute.
+ * \param end end of the element.
+ * \param [out] name first character of the attribute name.
+ * \param [out] nameSize characters of the name.
+ * \param [out] value first character of the value, followed by its quote.
+ * \param [out] valueSize characters of the value.
+ * \return false if there are no more attributes.
+ */
+static bool
+NextAttribute (const char *&p, const char *end, const char *&name, size_t &nameSize, const char *&value,
+               size_t &valueSize)
+{
+  while (p < end && std::isspace ((unsigned char) *p))
+    {
+      p++;
+    }
+  name = p;
+  while (p < end && *p != '=' && !std::isspace ((unsigned char) *p) && *p != '/')
+    {
+      p++;
+    }
+  nameSize = p - name;
+  while (p < end && *p != '"' && *p != '\'')
+    {
+      p++;
+    }
+  if (nameSize == 0 || p == end)
+    {
+      return false;
+    }
+  char quote = *p++;
+  value = p;
+  while (p < end && *p != quote)
+    {
+      p++;
+    }
+  if (p == end)
+    {
+      return false;
+    }
+  valueSize = p - value;
+  p++;
+  return true;
+}
+
+/**
+ * \param name attribute name
+ * \param size characters of the name
+ * \param str name to compare with
+ * \return true if the name is str
+ */
+static bool
+IsName (const char *name, size_t size, const char *str)
+{
+  return std::strlen (str) == size && std::memcmp (name, str, size) == 0;
+}
+
+SumoFcdReader::SumoFcdReader (std::string filename)
+  : m_file (filename.c_str (), std::ios::in | std::ios::binary),
+    m_pos (0),
+    m_element (0),
+    m_elementSize (0),
+    m_inTimestep (false)
+{
+}
+
+bool
+SumoFcdReader::IsOpen (void) const
+{
+  return m_file.is_open ();
+}
+
+bool
+SumoFcdReader::NextElement (void)
+{
+  static const size_t blockSize = 65536;
+  while (true)
+    {
+      size_t open = m_buffer.find ('<', m_pos);
+      size_t keep = m_buffer.size ();
+      if (open != std::string::npos)
+        {
+          keep = open;
+          if (m_buffer.size () - open >= 4)
+            {
+              bool comment = m_buffer.compare (open, 4, "<!--") == 0;
+              size_t close = comment ? m_buffer.find ("-->", open + 4) : m_buffer.find ('>', open);
+              if (close != std::string::npos)
+                {
+                  if (comment)
+                    {
+                      m_pos = close + 3;
+                      continue;
+                    }
+                  m_element = m_buffer.data () + open + 1;
+                  m_elementSize = close - open - 1;
+                  m_pos = close + 1;
+                  return true;
+                }
+            }
+        }
+
+      // read the next block after the incomplete element, if any
+      m_buffer.erase (0, keep);
+      m_pos = 0;
+      size_t used = m_buffer.size ();
+      m_buffer.resize (used + blockSize);
+      m_file.read (&m_buffer[used], blockSize);
+      m_buffer.resize (used + m_file.gcount ());
+      if (m_file.gcount () == 0)
+        {
+          if (!m_buffer.empty ())
+            {
+              NS_LOG_ERROR ("FCD file ends in the middle of an element");
+            }
+          return false;
+        }
+    }
+}
+
+bool
+SumoFcdReader::IsElement (const char *name) const
+{
+  size_t size = std::strlen (name);
+  return m_elementSize >= size && std::memcmp (m_element, name, size) == 0
+         && (m_elementSize == size || std::isspace ((unsigned char) m_element[size]) || m_element[size] == '/');
+}
+
+bool
+SumoFcdReader::NextTimestep (double &time)
+{
+  while (NextElement ())
+    {
+      if (!IsElement ("timestep"))
+        {
+          continue;
+        }
+      const char *p = m_element + std::strlen ("timestep");
+      const char *end = m_element + m_elementSize;
+      const char *name;
+      size_t nameSize;
+      const char *value;
+      size_t valueSize;
+      bool found = false;
+      while (NextAttribute (p, end, name, nameSize, value, valueSize))
+        {
+          if (IsName (name, nameSize, "time"))
+            {
+              time = std::strtod (value, 0);
+              found = true;
+            }
+        }
+      if (!found)
+        {
+          NS_LOG_ERROR ("Time step without time (corrupted file?)");
+          continue;
+        }
+      m_inTimestep = m_element[m_elementSize - 1] != '/';
+      return true;
+    }
+  return false;
+}
+
+bool
+SumoFcdReader::NextVehicle (SumoFcdSample &sample)
+{
+  while (m_inTimestep && NextElement ())
+    {
+      if (IsElement ("/timestep"))
+        {
+          m_inTimestep = false;
+          return false;
+        }
+      if (!IsElement ("vehicle"))
+        {
+          continue;
+        }
+      const char *p = m_element + std::strlen ("vehicle");
+      const char *end = m_element + m_elementSize;
+      const char *name;
+      size_t nameSize;
+      const char *value;
+      size_t valueSize;
+      std::memset (&sample, 0, sizeof (sample));
+      bool hasX = false;
+      bool hasY = false;
+      while (NextAttribute (p, end, name, nameSize, value, valueSize))
+        {
+          if (IsName (name, nameSize, "id"))
+            {
+              sample.id = value;
+              sample.idSize = valueSize;
+            }
+          else if (IsName (name, nameSize, "x"))
+            {
+              sample.x = std::strtod (value, 0);
+              hasX = true;
+            }
+          else if (IsName (name, nameSize, "y"))
+            {
+              sample.y = std::strtod (value, 0);
+              hasY = true;
+            }
+          else if (IsName (name, nameSize, "z"))
+            {
+              sample.z = std::strtod (value, 0);
+              sample.hasZ = true;
+            }
+          else if (IsName (name, nameSize, "angle"))
+            {
+              sample.angle = std::strtod (value, 0);
+            }
+          else if (IsName (name, nameSize, "speed"))
+            {
+              sample.speed = std::strtod (value, 0);
+            }
+          else if (IsName (name, nameSize, "slope"))
+            {
+              sample.slope = std::strtod (value, 0);
+            }
+        }
+      if (sample.id == 0 || !hasX || !hasY)
+        {
+          NS_LOG_ERROR ("Vehicle without id, x or y (corrupted file?)");
+          continue;
+        }
+      return true;
+    }
+  return false;
+}
+
+/**
+ * \param vehicle state of the vehicle, updated to the sample
+ * \param step number of the time step of the sample, from 1
+ * \param time time of the sample, in s
+ * \param sample sample of the vehicle
+ * \return true if the vehicle was in the previous time step
+ */
+static bool
+UpdateVehicle (SumoFcdVehicle &vehicle, uint32_t step, double time, const SumoFcdSample &sample)
+{
+  static const double degrees = M_PI / 180;
+  bool continued = vehicle.step != 0 && vehicle.step + 1 == step;
+  double horizontal = sample.speed * std::cos (sample.slope * degrees);
+  Vector velocity (horizontal * std::sin (sample.angle * degrees),
+                   horizontal * std::cos (sample.angle * degrees),
+                   sample.speed * std::sin (sample.slope * degrees));
+  double z = vehicle.position.z;
+  if (sample.hasZ)
+    {
+      z = sample.z;
+    }
+  else if (continued)
+    {
+      // as the mobility model moves it between the samples
+      z += (vehicle.velocity.z + velocity.z) / 2 * (time - vehicle.time);
+    }
+  vehicle.time = time;
+  vehicle.step = step;
+  vehicle.position = Vector (sample.x, sample.y, z);
+  vehicle.velocity = velocity;
+  return continued;
+}
+
+/**
+ * \param model mobility model of the node
+ * \param position position at the time of the sample
+ * \param velocity velocity at the time of the sample
+ * \param acceleration acceleration up to the next sample
+ */
+static void
+ApplySample (Ptr<ConstantAccelerationMobilityModel> model, Vector position, Vector velocity, Vector acceleration)
+{
+  model->SetPositionVelocityAndAcceleration (position, velocity, acceleration);
+}
+
+
+/**
+ * \brief Reads the time steps of an FCD file as the simulation advances,
+ * see SumoFcdMobilityHelper::SetLookAhead.
+ *
+ * The sample of a vehicle is scheduled when its next one is read, which
+ * gives its acceleration, or when the vehicle leaves, so only the last
+ * sample of each vehicle is kept.
+ */
+class SumoFcdPlayer : public SimpleRefCount<SumoFcdPlayer>
+{
+public:
+  /**
+   * \param filename FCD file
+   * \param vehicleIds SUMO ID of each vehicle
+   * \param start time to start the movements at
+   * \param lookAhead how long before its time each sample is scheduled, 0
+   *        to schedule them all now
+   */
+  SumoFcdPlayer (std::string filename, const std::vector<std::string> &vehicleIds, Time start, Time lookAhead);
+  /**
+   * \param index index of the vehicle
+   * \param model mobility model of its node
+   */
+  void Add (uint32_t index, Ptr<ConstantAccelerationMobilityModel> model);
+  /**
+   * Schedules the samples up to the look-ahead and the next advance.
+   */
+  void Advance (void);
+
+private:
+  /// Vehicle being replayed
+  struct Vehicle
+  {
+    Ptr<ConstantAccelerationMobilityModel> model;   //!< mobility model of its node, 0 if it has none
+    SumoFcdVehicle state;                           //!< its last sample
+  };
+
+  /**
+   * Reads the vehicles of a time step.
+   * \param time time of the time step, in s
+   */
+  void ReadTimestep (double time);
+  /**
+   * \param vehicle vehicle whose last sample is scheduled
+   * \param velocity velocity at the time of the sample
+   * \param acceleration acceleration up to the next sample
+   * \param next time of the next sample, in s
+   */
+  void Schedule (const Vehicle &vehicle, Vector velocity, Vector acceleration, double next);
+
+  SumoFcdReader m_reader;                               //!< FCD file
+  std::unordered_map<std::string, uint32_t> m_index;    //!< index of each SUMO ID
+  std::string m_id;                                     //!< SUMO ID being looked up
+  std::vector<Vehicle> m_vehicles;                      //!< vehicles of the file
+  std::vector<uint32_t> m_active;                       //!< vehicles of the last time step
+  std::vector<uint32_t> m_seen;                         //!< vehicles of the time step being read
+  uint32_t m_step;                                      //!< number of the last time step read
+  double m_time;                                        //!< time of the last time step read, in s
+  bool m_more;                                          //!< the file has more time steps
+  Time m_start;                                         //!< time to start the movements at
+  Time m_lookAhead;                                     //!< how long before its time each sample is scheduled
+  Time m_installTime;                                   //!< time the file was installed at
+};
+
+SumoFcdPlayer::SumoFcdPlayer (std::string filename, const std::vector<std::string> &vehicleIds, Time start,
+                              Time lookAhead)
+  : m_reader (filename),
+    m_vehicles (vehicleIds.size ()),
+    m_step (0),
+    m_time (-std::numeric_limits<double>::max ()),
+    m_more (true),
+    m_start (start),
+    m_lookAhead (lookAhead),
+    m_installTime (Simulator::Now ())
+{
+  if (!m_reader.IsOpen ())
+    {
+      NS_FATAL_ERROR ("Could not open FCD file " << filename << " for reading, aborting here \n");
+    }
+  for (uint32_t i = 0; i < vehicleIds.size (); i++)
+    {
+      m_index[vehicleIds[i]] = i;
+    }
+}
+
+void
+SumoFcdPlayer::Add (uint32_t index, Ptr<ConstantAccelerationMobilityModel> model)
+{
+  m_vehicles[index].model = model;
+}
+
+void
+SumoFcdPlayer::Schedule (const Vehicle &vehicle, Vector velocity, Vector acceleration, double next)
+{
+  double at = vehicle.state.time;
+  Vector position = vehicle.state.position;
+  double start = m_start.GetSeconds ();
+  if (at < start)
+    {
+      // only the state at the start time is scheduled
+      if (next <= start)
+        {
+          return;
+        }
+      double t = start - at;
+      position = Vector (position.x + velocity.x * t + acceleration.x * t * t / 2,
+                         position.y + velocity.y * t + acceleration.y * t * t / 2,
+                         position.z + velocity.z * t + acceleration.z * t * t / 2);
+      velocity = Vector (velocity.x + acceleration.x * t, velocity.y + acceleration.y * t, velocity.z + acceleration.z * t);
+      at = start;
+    }
+  Simulator::Schedule (m_installTime + Seconds (at) - Simulator::Now (), &ApplySample, vehicle.model,
+                       position, velocity, acceleration);
+}
+
+void
+SumoFcdPlayer::ReadTimestep (double time)
+{
+  m_step++;
+  m_seen.clear ();
+  SumoFcdSample sample;
+  while (m_reader.NextVehicle (sample))
+    {
+      m_id.assign (sample.id, sample.idSize);
+      std::unordered_map<std::string, uint32_t>::const_iterator it = m_index.find (m_id);
+      if (it == m_index.end ())
+        {
+          NS_LOG_ERROR ("Unknown vehicle " << m_id << " (file changed?)");
+          continue;
+        }
+      Vehicle &vehicle = m_vehicles[it->second];
+      if (vehicle.model == 0)
+        {
+          continue;
+        }
+      Vehicle previous = vehicle;
+      if (UpdateVehicle (vehicle.state, m_step, time, sample))
+        {
+          // the acceleration which takes it to this sample
+          Vector velocity = previous.state.velocity;
+          double dt = time - previous.state.time;
+          Vector acceleration ((vehicle.state.velocity.x - velocity.x) / dt,
+                               (vehicle.state.velocity.y - velocity.y) / dt,
+                               (vehicle.state.velocity.z - velocity.z) / dt);
+          Schedule (previous, velocity, acceleration, time);
+        }
+      m_seen.push_back (it->second);
+    }
+
+  // the vehicles which left stop at their last sample
+  for (std::vector<uint32_t>::const_iterator i = m_active.begin (); i != m_active.end (); i++)
+    {
+      const Vehicle &vehicle = m_vehicles[*i];
+      if (vehicle.state.step != m_step)
+        {
+          Schedule (vehicle, Vector (0, 0, 0), Vector (0, 0, 0), std::numeric_limits<double>::max ());
+        }
+    }
+  m_active.swap (m_seen);
+}
+
+void
+SumoFcdPlayer::Advance (void)
+{
+  bool all = m_lookAhead.IsZero ();
+  double limit = (std::max (Simulator::Now () - m_installTime, m_start) + m_lookAhead).GetSeconds ();
+  while (m_more && (all || m_time <= limit))
+    {
+      double time;
+      if (!m_reader.NextTimestep (time))
+        {
+          m_more = false;
+          break;
+        }
+      if (time <= m_time)
+        {
+          NS_LOG_ERROR ("Time step " << time << " is not after " << m_time << " (corrupted file?)");
+          SumoFcdSample sample;
+          while (m_reader.NextVehicle (sample))
+            {
+            }
+          continue;
+        }
+      m_time = time;
+      ReadTimestep (time);
+    }
+  if (!m_more)
+    {
+      // the vehicles stop at the end of the file
+      for (std::vector<uint32_t>::const_iterator i = m_active.begin (); i != m_active.end (); i++)
+        {
+          Schedule (m_vehicles[*i], Vector (0, 0, 0), Vector (0, 0, 0), std::numeric_limits<double>::max ());
+        }
+      m_active.clear ();
+      return;
+    }
+  Simulator::Schedule (m_installTime + Seconds (m_time) - m_lookAhead - Simulator::Now (), &SumoFcdPlayer::Advance,
+                       Ptr<SumoFcdPlayer> (this));
+}
+
+
+/**
+ * \param bounds bounding box, extended to the position
+ * \param position position
+ * \param empty true if the box has no positions yet, then false
+ */
+static void
+ExtendBounds (Box &bounds, const Vector &position, bool &empty)
+{
+  if (empty)
+    {
+      bounds = Box (position.x, position.x, position.y, position.y, position.z, position.z);
+      empty = false;
+      return;
+    }
+  bounds.xMin = std::min (bounds.xMin, position.x);
+  bounds.xMax = std::max (bounds.xMax, position.x);
+  bounds.yMin = std::min (bounds.yMin, position.y);
+  bounds.yMax = std::max (bounds.yMax, position.y);
+  bounds.zMin = std::min (bounds.zMin, position.z);
+  bounds.zMax = std::max (bounds.zMax, position.z);
+}
+
+SumoFcdMobilityHelper::SumoFcdMobilityHelper (std::string filename)
+  : m_filename (filename),
+    m_startTime (Seconds (0)),
+    m_lookAhead (Seconds (60))
+{
+  SumoFcdReader reader (m_filename);
+  if (!reader.IsOpen ())
+    {
+      NS_FATAL_ERROR ("Could not open FCD file " << m_filename << " for reading, aborting here \n");
+    }
+
+  // find the vehicles, as the player will
+  std::unordered_map<std::string, uint32_t> index;
+  std::vector<SumoFcdVehicle> vehicles;
+  std::string id;
+  bool empty = true;
+  uint32_t step = 0;
+  double time;
+  SumoFcdSample sample;
+  while (reader.NextTimestep (time))
+    {
+      step++;
+      while (reader.NextVehicle (sample))
+        {
+          id.assign (sample.id, sample.idSize);
+          std::pair<std::unordered_map<std::string, uint32_t>::iterator, bool> it =
+            index.insert (std::make_pair (id, (uint32_t) vehicles.size ()));
+          if (it.second)
+            {
+              m_vehicleIds.push_back (id);
+              vehicles.push_back (SumoFcdVehicle ());
+            }
+          SumoFcdVehicle &vehicle = vehicles[it.first->second];
+          UpdateVehicle (vehicle, step, time, sample);
+          if (it.second)
+            {
+              m_firstPositions.push_back (vehicle.position);
+            }
+          if (empty)
+            {
+              m_info.start = Seconds (time);
+            }
+          m_info.stop = Seconds (time);
+          ExtendBounds (m_info.bounds, vehicle.position, empty);
+        }
+    }
+  for (uint32_t i = 0; i < m_vehicleIds.size (); i++)
+    {
+      m_info.nodeIds.push_back (i);
+    }
+  NS_LOG_DEBUG (m_vehicleIds.size () << " vehicles in " << step << " time steps");
+}
+
+bool
+SumoFcdMobilityHelper::IsFcdTrace (std::string filename)
+{
+  std::FILE *file = std::fopen (filename.c_str (), "rb");
+  if (file == 0)
+    {
+      return false;
+    }
+  char buffer[4096];
+  std::string head (buffer, std::fread (buffer, 1, sizeof (buffer), file));
+  std::fclose (file);
+
+  // skip the byte order mark, the XML declaration and the comments
+  size_t pos = head.compare (0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+  while (true)
+    {
+      pos = head.find_first_not_of (" \t\r\n", pos);
+      if (pos == std::string::npos || head[pos] != '<')
+        {
+          return false;
+        }
+      if (head.compare (pos, 4, "<!--") == 0)
+        {
+          pos = head.find ("-->", pos + 4);
+          if (pos != std::string::npos)
+            {
+              pos += 2;
+            }
+        }
+      else if (head.compare (pos, 2, "<?") == 0 || head.compare (pos, 2, "<!") == 0)
+        {
+          pos = head.find ('>', pos);
+        }
+      else
+        {
+          std::string root = "<fcd-export";
+          return head.compare (pos, root.size (), root) == 0
+                 && pos + root.size () < head.size ()
+                 && (std::isspace ((unsigned char) head[pos + root.size ()])
+                     || head[pos + root.size ()] == '>' || head[pos + root.size ()] == '/');
+        }
+      if (pos == std::string::npos)
+        {
+          return false;
+        }
+      pos++;
+    }
+}
+
+uint32_t
+SumoFcdMobilityHelper::GetNVehicles (void) const
+{
+  return m_vehicleIds.size ();
+}
+
+std::string
+SumoFcdMobilityHelper::GetVehicleId (uint32_t index) const
+{
+  NS_ASSERT (index < m_vehicleIds.size ());
+  return m_vehicleIds[index];
+}
+
+MobilityTraceInfo
+SumoFcdMobilityHelper::GetTraceInfo (void) const
+{
+  return m_info;
+}
+
+void
+SumoFcdMobilityHelper::SetStartTime (Time start)
+{
+  m_startTime = start;
+}
+
+void
+SumoFcdMobilityHelper::SetLookAhead (Time lookAhead)
+{
+  m_lookAhead = lookAhead;
+}
+
+void
+SumoFcdMobilityHelper::Install (void) const
+{
+  Install (NodeContainer::GetGlobal ());
+}
+
+void
+SumoFcdMobilityHelper::Install (NodeContainer nodes) const
+{
+  Ptr<SumoFcdPlayer> player = Create<SumoFcdPlayer> (m_filename, m_vehicleIds, m_startTime, m_lookAhead);
+  for (uint32_t i = 0; i < nodes.GetN () && i < m_vehicleIds.size (); i++)
+    {
+      Ptr<Node> node = nodes.Get (i);
+      Ptr<ConstantAccelerationMobilityModel> model = node->GetObject<ConstantAccelerationMobilityModel> ();
+      if (model == 0)
+        {
+          model = CreateObject<ConstantAccelerationMobilityModel> ();
+          node->AggregateObject (model);
+        }
+      // still at its first position until the vehicle appears
+      model->SetPosition (m_firstPositions[i]);
+      player->Add (i, model);
+    }
+  player->Advance ();
+}
+
+std::vector<Ptr<Trajectory> >
+SumoFcdMobilityHelper::ReadTrajectories (void) const
+{
+  SumoFcdReader reader (m_filename);
+  if (!reader.IsOpen ())
+    {
+      NS_FATAL_ERROR ("Could not open FCD file " << m_filename << " for reading, aborting here \n");
+    }
+  std::unordered_map<std::string, uint32_t> index;
+  std::vector<Ptr<Trajectory> > trajectories;
+  for (uint32_t i = 0; i < m_vehicleIds.size (); i++)
+    {
+      index[m_vehicleIds[i]] = i;
+      trajectories.push_back (Create<Trajectory> ());
+    }
+
+  // as SumoFcdPlayer, with a sample where it schedules a stop
+  std::vector<SumoFcdVehicle> vehicles (m_vehicleIds.size ());
+  std::vector<uint32_t> active;
+  std::vector<uint32_t> seen;
+  std::string id;
+  uint32_t step = 0;
+  double last = -std::numeric_limits<double>::max ();
+  double time;
+  SumoFcdSample sample;
+  while (reader.NextTimestep (time))
+    {
+      if (time <= last)
+        {
+          NS_LOG_ERROR ("Time step " << time << " is not after " << last << " (corrupted file?)");
+          while (reader.NextVehicle (sample))
+            {
+            }
+          continue;
+        }
+      last = time;
+      step++;
+      seen.clear ();
+      while (reader.NextVehicle (sample))
+        {
+          id.assign (sample.id, sample.idSize);
+          std::unordered_map<std::string, uint32_t>::const_iterator it = index.find (id);
+          if (it == index.end ())
+            {
+              NS_LOG_ERROR ("Unknown vehicle " << id << " (file changed?)");
+              continue;
+            }
+          SumoFcdVehicle &vehicle = vehicles[it->second];
+          Ptr<Trajectory> trajectory = trajectories[it->second];
+          bool appeared = vehicle.step != 0;
+          if (!UpdateVehicle (vehicle, step, time, sample) && appeared)
+            {
+              // held since it left
+              trajectory->Add (Seconds (time), trajectory->GetPosition (trajectory->GetN () - 1), Vector (0, 0, 0));
+            }
+          trajectory->Add (Seconds (time), vehicle.position, vehicle.velocity);
+          seen.push_back (it->second);
+        }
+      for (std::vector<uint32_t>::const_iterator i = active.begin (); i != active.end (); i++)
+        {
+          const SumoFcdVehicle &vehicle = vehicles[*i];
+          if (vehicle.step != step)
+            {
+              trajectories[*i]->Add (Seconds (vehicle.time), vehicle.position, Vector (0, 0, 0));
+            }
+        }
+      active.swap (seen);
+    }
+  for (std::vector<uint32_t>::const_iterator i = active.begin (); i != active.end (); i++)
+    {
+      const SumoFcdVehicle &vehicle = vehicles[*i];
+      trajectories[*i]->Add (Seconds (vehicle.time), vehicle.position, Vector (0, 0, 0));
+    }
+  return trajectories;
+}
+
+void
+SumoFcdMobilityHelper::InstallTrajectories (NodeContainer nodes) const
+{
+  std::vector<Ptr<Trajectory> > trajectories = ReadTrajectories ();
+  for (uint32_t i = 0; i < nodes.GetN () && i < trajectories.size (); i++)
+    {
+      Ptr<Node> node = nodes.Get (i);
+      Ptr<TrajectoryMobilityModel> model = node->GetObject<TrajectoryMobilityModel> ();
+      if (model == 0)
+        {
+          model = CreateObject<TrajectoryMobilityModel> ();
+          node->AggregateObject (model);
+        }
+      if (trajectories[i]->GetN () > 0)
+        {
+          model->SetTrajectory (trajectories[i]);
+        }
+    }
+}
+
+} // namespace ns3
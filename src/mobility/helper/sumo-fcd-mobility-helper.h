@@ -0,0 +1,174 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#ifndef SUMO_FCD_MOBILITY_HELPER_H
+#define SUMO_FCD_MOBILITY_HELPER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/ptr.h"
+#include "ns3/node-container.h"
+#include "ns3/trajectory.h"
+#include "mobility-trace-info.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup mobility
+ * \brief Helper class which replays the floating car data (FCD) output of
+ * SUMO with the ConstantAccelerationMobilityModel of the nodes.
+ *
+ * An FCD file, written by sumo --fcd-output, gives the state of every
+ * vehicle at every time step:
+ \verbatim
+   <fcd-export>
+     <timestep time="0.00">
+       <vehicle id="veh0" x="5.10" y="12.20" angle="90.00" type="car" speed="8.30" pos="5.10" lane="e0_0" slope="0.00"/>
+     </timestep>
+   </fcd-export>
+ \endverbatim
+ *
+ * At each sample the node of the vehicle is placed at its position (x, y
+ * and z) and takes the velocity given by its speed, angle (degrees
+ * clockwise from the y axis) and slope (degrees), and the acceleration
+ * which takes it to the velocity of its next sample, so the speed changes
+ * between the samples as in SUMO instead of in steps. Without z, the height
+ * of a vehicle is integrated from its slope, starting at 0. A vehicle which
+ * is not in a time step stops at its last position until it appears again.
+ * The other attributes and elements, such as persons, are ignored.
+ *
+ * The vehicles drive the nodes in the order they first appear in the file:
+ * the first one the node with ID 0, and so on (see GetVehicleId). The file
+ * is read once when the helper is created, to find the vehicles and their
+ * first positions, and then as the simulation advances, a time step at a
+ * time, so neither the file nor its samples are ever kept in memory. Each
+ * sample is scheduled lookAhead before its time (see SetLookAhead). As
+ * with Ns2MobilityHelper, the times of the file are relative to the time it
+ * is installed at, and a node stays at its first position until its
+ * vehicle appears.
+ *
+ * InstallTrajectories replays the same movements with a
+ * TrajectoryMobilityModel per node instead, which schedules no event per
+ * sample but keeps all the samples in memory.
+ */
+class SumoFcdMobilityHelper
+{
+public:
+  /**
+   * \param filename FCD file. The program aborts if it cannot be read.
+   */
+  SumoFcdMobilityHelper (std::string filename);
+
+  /**
+   * \param filename a file.
+   * \returns true if the file is an FCD file, i.e. an XML file whose root
+   *          element is fcd-export.
+   */
+  static bool IsFcdTrace (std::string filename);
+
+  /**
+   * \returns the number of vehicles of the file.
+   */
+  uint32_t GetNVehicles (void) const;
+
+  /**
+   * \param index index of a vehicle, which drives the node with this ID.
+   * \returns the SUMO ID of the vehicle.
+   */
+  std::string GetVehicleId (uint32_t index) const;
+
+  /**
+   * \returns the IDs of the nodes driven by the vehicles, the time of the
+   *          first and the last time steps with vehicles and the bounding
+   *          box of the positions of the vehicles.
+   */
+  MobilityTraceInfo GetTraceInfo (void) const;
+
+  /**
+   * \param start time to start the movements at, 0 by default.
+   *
+   * Resumes the file at the given time, as Ns2MobilityHelper::SetStartTime:
+   * the samples up to the start time are not scheduled, and at the start
+   * time each node takes the position, velocity and acceleration its
+   * vehicle has then.
+   * Must be called before Install.
+   */
+  void SetStartTime (Time start);
+
+  /**
+   * \param lookAhead how long before its time each sample is scheduled, 60 s
+   *        by default, 0 to schedule all the samples at install.
+   *
+   * Samples at the same time as other events run after those already
+   * scheduled, so the look-ahead should be longer than the period of the
+   * periodic events that must see the new movements.
+   * Must be called before Install.
+   */
+  void SetLookAhead (Time lookAhead);
+
+  /**
+   * Configures the movements of the nodes of the global ns3::NodeList
+   * driven by the vehicles of the file.
+   */
+  void Install (void) const;
+
+  /**
+   * \param nodes nodes whose movements are configured: the i-th one is
+   *        driven by the i-th vehicle of the file.
+   */
+  void Install (NodeContainer nodes) const;
+
+  /**
+   * \returns the trajectory of each vehicle, by index, with the same
+   *          movements Install schedules.
+   *
+   * The whole file is read, and all its samples are kept in the
+   * trajectories, with their velocities. When a vehicle leaves, a sample
+   * with a velocity of zero stops it at its last position, and another one
+   * holds it there until it appears again.
+   */
+  std::vector<Ptr<Trajectory> > ReadTrajectories (void) const;
+
+  /**
+   * \param nodes nodes whose movements are configured: the i-th one
+   *        follows the trajectory of the i-th vehicle of the file with a
+   *        TrajectoryMobilityModel, from now.
+   *
+   * The start time and the look-ahead do not apply: the trajectories are
+   * read at once, see ReadTrajectories, and no event is scheduled.
+   */
+  void InstallTrajectories (NodeContainer nodes) const;
+
+private:
+  std::string m_filename;                   //!< FCD file
+  std::vector<std::string> m_vehicleIds;    //!< SUMO ID of each vehicle
+  std::vector<Vector> m_firstPositions;     //!< first position of each vehicle
+  MobilityTraceInfo m_info;                 //!< nodes, time span and bounds of the file
+  Time m_startTime;                         //!< time of the first scheduled sample
+  Time m_lookAhead;                         //!< look-ahead of the samples, 0 to schedule them all at install
+};
+
+} // namespace ns3
+
+#endif /* SUMO_FCD_MOBILITY_HELPER_H */
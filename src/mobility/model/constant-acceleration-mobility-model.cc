@@ -78,5 +78,17 @@ ConstantAccelerationMobilityModel::SetVelocityAndAcceleration (const Vector &vel
   NotifyCourseChange ();
 }
 
+void
+ConstantAccelerationMobilityModel::SetPositionVelocityAndAcceleration (const Vector &position,
+                                                                       const Vector &velocity,
+                                                                       const Vector &acceleration)
+{
+  m_basePosition = position;
+  m_baseTime = Simulator::Now ();
+  m_baseVelocity = velocity;
+  m_acceleration = acceleration;
+  NotifyCourseChange ();
+}
+
 
 } // namespace ns3
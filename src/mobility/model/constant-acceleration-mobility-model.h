@@ -48,8 +48,17 @@ public:
    * \param acceleration the acceleration (m/s^2)
    */
   void SetVelocityAndAcceleration (const Vector &velocity, const Vector &acceleration);
+  /**
+   * Set the model's position, velocity and acceleration, with a single
+   * course change
+   * \param position the position (m)
+   * \param velocity the velocity (m/s)
+   * \param acceleration the acceleration (m/s^2)
+   */
+  void SetPositionVelocityAndAcceleration (const Vector &position, const Vector &velocity, const Vector &acceleration);
 
 private:
+  friend class MobilityBatch; // To read the state without updating it
   virtual Vector DoGetPosition (void) const;
   virtual void DoSetPosition (const Vector &position);
   virtual Vector DoGetVelocity (void) const;
@@ -44,6 +44,7 @@ public:
   virtual ~ConstantPositionMobilityModel ();
 
 private:
+  friend class MobilityBatch; // To read the state without updating it
   virtual Vector DoGetPosition (void) const;
   virtual void DoSetPosition (const Vector &position);
   virtual Vector DoGetVelocity (void) const;
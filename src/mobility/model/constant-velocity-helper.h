@@ -70,6 +70,12 @@ public:
    * \param vel Velocity vector
    */
   void SetVelocity (const Vector &vel);
+  /**
+   * Set new velocity vector from a given time
+   * \param vel Velocity vector
+   * \param now time of the change, not before the last update
+   */
+  void SetVelocity (const Vector &vel, Time now);
   /**
    * Pause mobility at current position
    */
@@ -84,16 +90,34 @@ public:
    * \param rectangle 2D bounding rectangle for resulting position; object will not move outside the rectangle 
    */
   void UpdateWithBounds (const Rectangle &rectangle) const;
+  /**
+   * Update position to a given time, if not paused, from last position and time of last update
+   * \param rectangle 2D bounding rectangle for resulting position; object will not move outside the rectangle 
+   * \param now time of the update, not before the last update
+   */
+  void UpdateWithBounds (const Rectangle &rectangle, Time now) const;
   /**
    * Update position, if not paused, from last position and time of last update
    * \param bounds 3D bounding box for resulting position; object will not move outside the box 
    */
   void UpdateWithBounds (const Box &bounds) const;
+  /**
+   * Update position to a given time, if not paused, from last position and time of last update
+   * \param bounds 3D bounding box for resulting position; object will not move outside the box 
+   * \param now time of the update, not before the last update
+   */
+  void UpdateWithBounds (const Box &bounds, Time now) const;
   /**
    * Update position, if not paused, from last position and time of last update
    */
   void Update (void) const;
+  /**
+   * Update position to a given time, if not paused, from last position and time of last update
+   * \param now time of the update, not before the last update
+   */
+  void Update (Time now) const;
 private:
+  friend class MobilityBatch; // To read the state without updating it
   mutable Time m_lastUpdate; //!< time of last update
   mutable Vector m_position; //!< state variable for current position
   Vector m_velocity; //!< state variable for velocity
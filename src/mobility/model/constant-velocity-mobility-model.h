@@ -55,6 +55,7 @@ public:
    */
   void SetVelocity (const Vector &speed);
 private:
+  friend class MobilityBatch; // To read the state without updating it
   virtual Vector DoGetPosition (void) const;
   virtual void DoSetPosition (const Vector &position);
   virtual Vector DoGetVelocity (void) const;
@@ -20,6 +20,7 @@
 #include <cmath>
 #include "ns3/simulator.h"
 #include "ns3/double.h"
+#include "ns3/boolean.h"
 #include "ns3/pointer.h"
 #include "ns3/string.h"
 #include "gauss-markov-mobility-model.h"
@@ -80,22 +81,32 @@ GaussMarkovMobilityModel::GetTypeId (void)
                    "A gaussian random variable used to calculate the next pitch value.",
                    StringValue ("ns3::NormalRandomVariable[Mean=0.0|Variance=1.0|Bound=10.0]"),
                    MakePointerAccessor (&GaussMarkovMobilityModel::m_normalPitch),
-                   MakePointerChecker<NormalRandomVariable> ());
+                   MakePointerChecker<NormalRandomVariable> ())
+    .AddAttribute ("Lazy",
+                   "Draw the next velocity, direction, and pitch values when the position or "
+                   "the velocity is queried, instead of in an event every time step. The "
+                   "values and the positions are the same, but course changes are notified "
+                   "at the queries.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&GaussMarkovMobilityModel::m_lazy),
+                   MakeBooleanChecker ());
 
   return tid;
 }
 
 GaussMarkovMobilityModel::GaussMarkovMobilityModel ()
+  : m_lazy (false),
+    m_nextStart (Time::Max ())
 {
   m_meanVelocity = 0.0;
   m_meanDirection = 0.0;
   m_meanPitch = 0.0;
-  m_event = Simulator::ScheduleNow (&GaussMarkovMobilityModel::Start, this);
+  m_event = Simulator::ScheduleNow (&GaussMarkovMobilityModel::Start, this, Simulator::Now ());
   m_helper.Unpause ();
 }
 
 void
-GaussMarkovMobilityModel::Start (void)
+GaussMarkovMobilityModel::Start (Time now)
 {
   if (m_meanVelocity == 0.0)
     {
@@ -112,9 +123,9 @@ GaussMarkovMobilityModel::Start (void)
       m_Direction = m_meanDirection;
       m_Pitch = m_meanPitch;
       //Set the velocity vector to give to the constant velocity helper
-      m_helper.SetVelocity (Vector (m_Velocity*cosD*cosP, m_Velocity*sinD*cosP, m_Velocity*sinP));
+      m_helper.SetVelocity (Vector (m_Velocity*cosD*cosP, m_Velocity*sinD*cosP, m_Velocity*sinP), now);
     }
-  m_helper.Update ();
+  m_helper.Update (now);
 
   //Get the next values from the gaussian distributions for velocity, direction, and pitch
   double rv = m_normalVelocity->GetValue ();
@@ -138,17 +149,17 @@ GaussMarkovMobilityModel::Start (void)
   double vx = m_Velocity * cosDir * cosPit;
   double vy = m_Velocity * sinDir * cosPit;
   double vz = m_Velocity * sinPit;
-  m_helper.SetVelocity (Vector (vx, vy, vz));
+  m_helper.SetVelocity (Vector (vx, vy, vz), now);
 
   m_helper.Unpause ();
 
-  DoWalk (m_timeStep);
+  DoWalk (m_timeStep, now);
 }
 
 void
-GaussMarkovMobilityModel::DoWalk (Time delayLeft)
+GaussMarkovMobilityModel::DoWalk (Time delayLeft, Time now)
 {
-  m_helper.UpdateWithBounds (m_bounds);
+  m_helper.UpdateWithBounds (m_bounds, now);
   Vector position = m_helper.GetCurrentPosition ();
   Vector speed = m_helper.GetVelocity ();
   Vector nextPosition = position;
@@ -161,7 +172,7 @@ GaussMarkovMobilityModel::DoWalk (Time delayLeft)
   // If out of bounds, then alter the velocity vector and average direction to keep the position in bounds
   if (m_bounds.IsInside (nextPosition))
     {
-      m_event = Simulator::Schedule (delayLeft, &GaussMarkovMobilityModel::Start, this);
+      ScheduleStart (delayLeft, now);
     }
   else
     {
@@ -185,9 +196,42 @@ GaussMarkovMobilityModel::DoWalk (Time delayLeft)
 
       m_Direction = m_meanDirection;
       m_Pitch = m_meanPitch;
-      m_helper.SetVelocity (speed);
+      m_helper.SetVelocity (speed, now);
       m_helper.Unpause ();
-      m_event = Simulator::Schedule (delayLeft, &GaussMarkovMobilityModel::Start, this);
+      ScheduleStart (delayLeft, now);
+    }
+  if (!m_lazy)
+    {
+      NotifyCourseChange ();
+    }
+}
+
+void
+GaussMarkovMobilityModel::ScheduleStart (Time delay, Time now)
+{
+  if (m_lazy)
+    {
+      m_nextStart = now + delay;
+    }
+  else
+    {
+      m_event = Simulator::Schedule (delay, &GaussMarkovMobilityModel::Start, this, now + delay);
+    }
+}
+
+void
+GaussMarkovMobilityModel::CatchUp (void) const
+{
+  Time now = Simulator::Now ();
+  if (!m_lazy || m_nextStart > now)
+    {
+      return;
+    }
+  // the steps draw the same values at the same times as the events would
+  GaussMarkovMobilityModel *self = const_cast<GaussMarkovMobilityModel *> (this);
+  while (m_nextStart <= now)
+    {
+      self->Start (m_nextStart);
     }
   NotifyCourseChange ();
 }
@@ -202,19 +246,30 @@ GaussMarkovMobilityModel::DoDispose (void)
 Vector
 GaussMarkovMobilityModel::DoGetPosition (void) const
 {
+  CatchUp ();
   m_helper.Update ();
   return m_helper.GetCurrentPosition ();
 }
 void 
 GaussMarkovMobilityModel::DoSetPosition (const Vector &position)
 {
+  // the steps before now draw their values first
+  CatchUp ();
   m_helper.SetPosition (position);
   Simulator::Remove (m_event);
-  m_event = Simulator::ScheduleNow (&GaussMarkovMobilityModel::Start, this);
+  if (m_lazy)
+    {
+      m_nextStart = Simulator::Now ();
+    }
+  else
+    {
+      m_event = Simulator::ScheduleNow (&GaussMarkovMobilityModel::Start, this, Simulator::Now ());
+    }
 }
 Vector
 GaussMarkovMobilityModel::DoGetVelocity (void) const
 {
+  CatchUp ();
   return m_helper.GetVelocity ();
 }
 
@@ -73,6 +73,13 @@ namespace ns3 {
  
     mobility.Install (wifiStaNodes);
  * \endcode
+ * With the Lazy attribute, no event is scheduled every time step: the
+ * model draws the values of the time steps which have passed when its
+ * position or velocity is queried, in the same order and at the same
+ * times, so it moves exactly as it would with the events, and a node
+ * which is never queried costs nothing. The course changes are then
+ * notified once at the queries.
+ *
  * [1] Tracy Camp, Jeff Boleng, Vanessa Davies, "A Survey of Mobility Models
  * for Ad Hoc Network Research", Wireless Communications and Mobile Computing,
  * Wiley, vol.2 iss.5, September 2002, pp.483-502
@@ -89,13 +96,25 @@ public:
 private:
   /**
    * Initialize the model and calculate new velocity, direction, and pitch
+   * \param now time of the time step
    */
-  void Start (void);
+  void Start (Time now);
   /**
    * Perform a walk operation
    * \param timeLeft time until Start method is called again
+   * \param now time of the time step
+   */
+  void DoWalk (Time timeLeft, Time now);
+  /**
+   * Schedule the next call to Start, or only record its time if lazy
+   * \param delay time until Start is called
+   * \param now time of the time step
+   */
+  void ScheduleStart (Time delay, Time now);
+  /**
+   * Perform the time steps up to now, if lazy
    */
-  void DoWalk (Time timeLeft);
+  void CatchUp (void) const;
   virtual void DoDispose (void);
   virtual Vector DoGetPosition (void) const;
   virtual void DoSetPosition (const Vector &position);
@@ -117,6 +136,8 @@ private:
   Ptr<RandomVariableStream> m_rndMeanPitch; //!< rv used to assign avg. pitch 
   Ptr<NormalRandomVariable> m_normalPitch; //!< Gaussian rv for next pitch
   EventId m_event; //!< event id of scheduled start
+  bool m_lazy; //!< time steps are performed when queried
+  Time m_nextStart; //!< time of the next start if lazy
   Box m_bounds; //!< bounding box
 };
 
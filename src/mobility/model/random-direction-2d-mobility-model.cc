@@ -23,6 +23,7 @@
 #include "ns3/log.h"
 #include "ns3/string.h"
 #include "ns3/pointer.h"
+#include "ns3/boolean.h"
 #include "random-direction-2d-mobility-model.h"
 
 namespace ns3 {
@@ -51,11 +52,21 @@ RandomDirection2dMobilityModel::GetTypeId (void)
                    StringValue ("ns3::ConstantRandomVariable[Constant=2.0]"),
                    MakePointerAccessor (&RandomDirection2dMobilityModel::m_pause),
                    MakePointerChecker<RandomVariableStream> ())
+    .AddAttribute ("Lazy",
+                   "Pick the next directions, speeds and pauses when the position or the "
+                   "velocity is queried, instead of in an event at each change. The movement "
+                   "is the same, but course changes are notified at the queries.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&RandomDirection2dMobilityModel::m_lazy),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
 
 RandomDirection2dMobilityModel::RandomDirection2dMobilityModel ()
+  : m_lazy (false),
+    m_nextStep (Time::Max ()),
+    m_nextStepType (STEP_INITIALIZE)
 {
   m_direction = CreateObject <UniformRandomVariable> ();
 }
@@ -69,53 +80,58 @@ RandomDirection2dMobilityModel::DoDispose (void)
 void
 RandomDirection2dMobilityModel::DoInitialize (void)
 {
-  DoInitializePrivate ();
+  DoInitializePrivate (Simulator::Now ());
   MobilityModel::DoInitialize ();
 }
 
 void
-RandomDirection2dMobilityModel::DoInitializePrivate (void)
+RandomDirection2dMobilityModel::DoInitializePrivate (Time now)
 {
   double direction = m_direction->GetValue (0, 2 * M_PI);
-  SetDirectionAndSpeed (direction);
+  SetDirectionAndSpeed (direction, now);
 }
 
 void
-RandomDirection2dMobilityModel::BeginPause (void)
+RandomDirection2dMobilityModel::BeginPause (Time now)
 {
-  m_helper.Update ();
+  m_helper.Update (now);
   m_helper.Pause ();
   Time pause = Seconds (m_pause->GetValue ());
   m_event.Cancel ();
-  m_event = Simulator::Schedule (pause, &RandomDirection2dMobilityModel::ResetDirectionAndSpeed, this);
-  NotifyCourseChange ();
+  ScheduleStep (pause, now, STEP_RESET);
+  if (!m_lazy)
+    {
+      NotifyCourseChange ();
+    }
 }
 
 void
-RandomDirection2dMobilityModel::SetDirectionAndSpeed (double direction)
+RandomDirection2dMobilityModel::SetDirectionAndSpeed (double direction, Time now)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  m_helper.UpdateWithBounds (m_bounds);
+  m_helper.UpdateWithBounds (m_bounds, now);
   Vector position = m_helper.GetCurrentPosition ();
   double speed = m_speed->GetValue ();
   const Vector vector (std::cos (direction) * speed,
                        std::sin (direction) * speed,
                        0.0);
-  m_helper.SetVelocity (vector);
+  m_helper.SetVelocity (vector, now);
   m_helper.Unpause ();
   Vector next = m_bounds.CalculateIntersection (position, vector);
   Time delay = Seconds (CalculateDistance (position, next) / speed);
   m_event.Cancel ();
-  m_event = Simulator::Schedule (delay,
-                                 &RandomDirection2dMobilityModel::BeginPause, this);
-  NotifyCourseChange ();
+  ScheduleStep (delay, now, STEP_PAUSE);
+  if (!m_lazy)
+    {
+      NotifyCourseChange ();
+    }
 }
 void
-RandomDirection2dMobilityModel::ResetDirectionAndSpeed (void)
+RandomDirection2dMobilityModel::ResetDirectionAndSpeed (Time now)
 {
   double direction = m_direction->GetValue (0, M_PI);
 
-  m_helper.UpdateWithBounds (m_bounds);
+  m_helper.UpdateWithBounds (m_bounds, now);
   Vector position = m_helper.GetCurrentPosition ();
   switch (m_bounds.GetClosestSide (position))
     {
@@ -132,25 +148,78 @@ RandomDirection2dMobilityModel::ResetDirectionAndSpeed (void)
       direction += 0.0;
       break;
     }
-  SetDirectionAndSpeed (direction);
+  SetDirectionAndSpeed (direction, now);
+}
+void
+RandomDirection2dMobilityModel::ScheduleStep (Time delay, Time now, enum Step step)
+{
+  if (m_lazy)
+    {
+      m_nextStep = now + delay;
+      m_nextStepType = step;
+      return;
+    }
+  switch (step)
+    {
+    case STEP_INITIALIZE:
+      m_event = Simulator::Schedule (delay, &RandomDirection2dMobilityModel::DoInitializePrivate, this, now + delay);
+      break;
+    case STEP_PAUSE:
+      m_event = Simulator::Schedule (delay, &RandomDirection2dMobilityModel::BeginPause, this, now + delay);
+      break;
+    case STEP_RESET:
+      m_event = Simulator::Schedule (delay, &RandomDirection2dMobilityModel::ResetDirectionAndSpeed, this, now + delay);
+      break;
+    }
+}
+void
+RandomDirection2dMobilityModel::CatchUp (void) const
+{
+  Time now = Simulator::Now ();
+  if (!m_lazy || m_nextStep > now)
+    {
+      return;
+    }
+  // the steps pick the same values at the same times as the events would
+  RandomDirection2dMobilityModel *self = const_cast<RandomDirection2dMobilityModel *> (this);
+  while (m_nextStep <= now)
+    {
+      switch (m_nextStepType)
+        {
+        case STEP_INITIALIZE:
+          self->DoInitializePrivate (m_nextStep);
+          break;
+        case STEP_PAUSE:
+          self->BeginPause (m_nextStep);
+          break;
+        case STEP_RESET:
+          self->ResetDirectionAndSpeed (m_nextStep);
+          break;
+        }
+    }
+  NotifyCourseChange ();
 }
 Vector
 RandomDirection2dMobilityModel::DoGetPosition (void) const
 {
+  CatchUp ();
   m_helper.UpdateWithBounds (m_bounds);
   return m_helper.GetCurrentPosition ();
 }
 void
 RandomDirection2dMobilityModel::DoSetPosition (const Vector &position)
 {
+  // the steps before now draw their values first
+  CatchUp ();
   m_helper.SetPosition (position);
   Simulator::Remove (m_event);
   m_event.Cancel ();
-  m_event = Simulator::ScheduleNow (&RandomDirection2dMobilityModel::DoInitializePrivate, this);
+  ScheduleStep (Seconds (0), Simulator::Now (), STEP_INITIALIZE);
 }
 Vector
 RandomDirection2dMobilityModel::DoGetVelocity (void) const
 {
+  CatchUp ();
   return m_helper.GetVelocity ();
 }
 int64_t
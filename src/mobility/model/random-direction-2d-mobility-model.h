@@ -40,6 +40,12 @@ namespace ns3 {
  * then travels in the specific direction until it reaches one of
  * the boundaries of the model. When it reaches the boundary, it pauses,
  * selects a new direction and speed, aso.
+ *
+ * With the Lazy attribute, no event is scheduled at the changes of
+ * direction and the pauses: they are made when the position or the
+ * velocity is queried, in the same order and at the same times, so the
+ * movement is the same and a node which is never queried costs nothing.
+ * The course changes are then notified once at the queries.
  */
 class RandomDirection2dMobilityModel : public MobilityModel
 {
@@ -52,23 +58,44 @@ public:
   RandomDirection2dMobilityModel ();
 
 private:
+  /** The changes of the movement */
+  enum Step {
+    STEP_INITIALIZE,
+    STEP_PAUSE,
+    STEP_RESET
+  };
   /**
    * Set a new direction and speed
+   * \param now time of the change
    */
-  void ResetDirectionAndSpeed (void);
+  void ResetDirectionAndSpeed (Time now);
   /**
    * Pause, cancel currently scheduled event, schedule end of pause event
+   * \param now time of the pause
    */
-  void BeginPause (void);
+  void BeginPause (Time now);
   /**
    * Set new velocity and direction, and schedule next pause event  
    * \param direction (radians)
+   * \param now time of the change
    */
-  void SetDirectionAndSpeed (double direction);
+  void SetDirectionAndSpeed (double direction, Time now);
   /**
    * Sets a new random direction and calls SetDirectionAndSpeed
+   * \param now time of the change
+   */
+  void DoInitializePrivate (Time now);
+  /**
+   * Schedule the next change, or only record it if lazy
+   * \param delay time until the change
+   * \param now time of the current change
+   * \param step the next change
+   */
+  void ScheduleStep (Time delay, Time now, enum Step step);
+  /**
+   * Perform the changes up to now, if lazy
    */
-  void DoInitializePrivate (void);
+  void CatchUp (void) const;
   virtual void DoDispose (void);
   virtual void DoInitialize (void);
   virtual Vector DoGetPosition (void) const;
@@ -82,6 +109,9 @@ private:
   Ptr<RandomVariableStream> m_pause; //!< a random variable to control pause 
   EventId m_event; //!< event ID of next scheduled event
   ConstantVelocityHelper m_helper; //!< helper for velocity computations
+  bool m_lazy; //!< changes are made when queried
+  Time m_nextStep; //!< time of the next change if lazy
+  enum Step m_nextStepType; //!< the next change if lazy
 };
 
 } // namespace ns3
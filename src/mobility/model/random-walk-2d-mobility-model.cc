@@ -20,6 +20,7 @@
 #include "random-walk-2d-mobility-model.h"
 #include "ns3/enum.h"
 #include "ns3/double.h"
+#include "ns3/boolean.h"
 #include "ns3/string.h"
 #include "ns3/pointer.h"
 #include "ns3/simulator.h"
@@ -70,27 +71,41 @@ RandomWalk2dMobilityModel::GetTypeId (void)
                    "A random variable used to pick the speed (m/s).",
                    StringValue ("ns3::UniformRandomVariable[Min=2.0|Max=4.0]"),
                    MakePointerAccessor (&RandomWalk2dMobilityModel::m_speed),
-                   MakePointerChecker<RandomVariableStream> ());
+                   MakePointerChecker<RandomVariableStream> ())
+    .AddAttribute ("Lazy",
+                   "Pick the next speeds and directions when the position or the velocity "
+                   "is queried, instead of in an event at each change. The walk is the same, "
+                   "but course changes are notified at the queries.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&RandomWalk2dMobilityModel::m_lazy),
+                   MakeBooleanChecker ());
   return tid;
 }
 
+RandomWalk2dMobilityModel::RandomWalk2dMobilityModel ()
+  : m_lazy (false),
+    m_nextStep (Time::Max ()),
+    m_nextIsRebound (false)
+{
+}
+
 void
 RandomWalk2dMobilityModel::DoInitialize (void)
 {
-  DoInitializePrivate ();
+  DoInitializePrivate (Simulator::Now ());
   MobilityModel::DoInitialize ();
 }
 
 void
-RandomWalk2dMobilityModel::DoInitializePrivate (void)
+RandomWalk2dMobilityModel::DoInitializePrivate (Time now)
 {
-  m_helper.Update ();
+  m_helper.Update (now);
   double speed = m_speed->GetValue ();
   double direction = m_direction->GetValue ();
   Vector vector (std::cos (direction) * speed,
                  std::sin (direction) * speed,
                  0.0);
-  m_helper.SetVelocity (vector);
+  m_helper.SetVelocity (vector, now);
   m_helper.Unpause ();
 
   Time delayLeft;
@@ -102,11 +117,11 @@ RandomWalk2dMobilityModel::DoInitializePrivate (void)
     {
       delayLeft = Seconds (m_modeDistance / speed); 
     }
-  DoWalk (delayLeft);
+  DoWalk (delayLeft, now);
 }
 
 void
-RandomWalk2dMobilityModel::DoWalk (Time delayLeft)
+RandomWalk2dMobilityModel::DoWalk (Time delayLeft, Time now)
 {
   Vector position = m_helper.GetCurrentPosition ();
   Vector speed = m_helper.GetVelocity ();
@@ -116,22 +131,43 @@ RandomWalk2dMobilityModel::DoWalk (Time delayLeft)
   m_event.Cancel ();
   if (m_bounds.IsInside (nextPosition))
     {
-      m_event = Simulator::Schedule (delayLeft, &RandomWalk2dMobilityModel::DoInitializePrivate, this);
+      if (m_lazy)
+        {
+          m_nextStep = now + delayLeft;
+          m_nextIsRebound = false;
+        }
+      else
+        {
+          m_event = Simulator::Schedule (delayLeft, &RandomWalk2dMobilityModel::DoInitializePrivate, this,
+                                         now + delayLeft);
+        }
     }
   else
     {
       nextPosition = m_bounds.CalculateIntersection (position, speed);
       Time delay = Seconds ((nextPosition.x - position.x) / speed.x);
-      m_event = Simulator::Schedule (delay, &RandomWalk2dMobilityModel::Rebound, this,
-                                     delayLeft - delay);
+      if (m_lazy)
+        {
+          m_nextStep = now + delay;
+          m_nextIsRebound = true;
+          m_reboundLeft = delayLeft - delay;
+        }
+      else
+        {
+          m_event = Simulator::Schedule (delay, &RandomWalk2dMobilityModel::Rebound, this,
+                                         delayLeft - delay, now + delay);
+        }
+    }
+  if (!m_lazy)
+    {
+      NotifyCourseChange ();
     }
-  NotifyCourseChange ();
 }
 
 void
-RandomWalk2dMobilityModel::Rebound (Time delayLeft)
+RandomWalk2dMobilityModel::Rebound (Time delayLeft, Time now)
 {
-  m_helper.UpdateWithBounds (m_bounds);
+  m_helper.UpdateWithBounds (m_bounds, now);
   Vector position = m_helper.GetCurrentPosition ();
   Vector speed = m_helper.GetVelocity ();
   switch (m_bounds.GetClosestSide (position))
@@ -145,9 +181,33 @@ RandomWalk2dMobilityModel::Rebound (Time delayLeft)
       speed.y = -speed.y;
       break;
     }
-  m_helper.SetVelocity (speed);
+  m_helper.SetVelocity (speed, now);
   m_helper.Unpause ();
-  DoWalk (delayLeft);
+  DoWalk (delayLeft, now);
+}
+
+void
+RandomWalk2dMobilityModel::CatchUp (void) const
+{
+  Time now = Simulator::Now ();
+  if (!m_lazy || m_nextStep > now)
+    {
+      return;
+    }
+  // the steps pick the same values at the same times as the events would
+  RandomWalk2dMobilityModel *self = const_cast<RandomWalk2dMobilityModel *> (this);
+  while (m_nextStep <= now)
+    {
+      if (m_nextIsRebound)
+        {
+          self->Rebound (m_reboundLeft, m_nextStep);
+        }
+      else
+        {
+          self->DoInitializePrivate (m_nextStep);
+        }
+    }
+  NotifyCourseChange ();
 }
 
 void
@@ -159,20 +219,32 @@ RandomWalk2dMobilityModel::DoDispose (void)
 Vector
 RandomWalk2dMobilityModel::DoGetPosition (void) const
 {
+  CatchUp ();
   m_helper.UpdateWithBounds (m_bounds);
   return m_helper.GetCurrentPosition ();
 }
 void
 RandomWalk2dMobilityModel::DoSetPosition (const Vector &position)
 {
+  // the steps before now draw their values first
+  CatchUp ();
   NS_ASSERT (m_bounds.IsInside (position));
   m_helper.SetPosition (position);
   Simulator::Remove (m_event);
-  m_event = Simulator::ScheduleNow (&RandomWalk2dMobilityModel::DoInitializePrivate, this);
+  if (m_lazy)
+    {
+      m_nextStep = Simulator::Now ();
+      m_nextIsRebound = false;
+    }
+  else
+    {
+      m_event = Simulator::ScheduleNow (&RandomWalk2dMobilityModel::DoInitializePrivate, this, Simulator::Now ());
+    }
 }
 Vector
 RandomWalk2dMobilityModel::DoGetVelocity (void) const
 {
+  CatchUp ();
   return m_helper.GetVelocity ();
 }
 int64_t
@@ -42,6 +42,12 @@ namespace ns3 {
  * of the model, we rebound on the boundary with a reflexive angle
  * and speed. This model is often identified as a brownian motion
  * model.
+ *
+ * With the Lazy attribute, no event is scheduled at the changes of speed
+ * and direction: they are made when the position or the velocity is
+ * queried, in the same order and at the same times, so the walk is the
+ * same and a node which is never queried costs nothing. The course
+ * changes are then notified once at the queries.
  */
 class RandomWalk2dMobilityModel : public MobilityModel 
 {
@@ -51,6 +57,7 @@ public:
    * \return the object TypeId
    */
   static TypeId GetTypeId (void);
+  RandomWalk2dMobilityModel ();
   /** An enum representing the different working modes of this module. */
   enum Mode  {
     MODE_DISTANCE,
@@ -61,17 +68,25 @@ private:
   /**
    * \brief Performs the rebound of the node if it reaches a boundary
    * \param timeLeft The remaining time of the walk
+   * \param now time of the rebound
    */
-  void Rebound (Time timeLeft);
+  void Rebound (Time timeLeft, Time now);
   /**
    * Walk according to position and velocity, until distance is reached,
    * time is reached, or intersection with the bounding box
+   * \param timeLeft The remaining time of the walk
+   * \param now time of the start of the walk
    */
-  void DoWalk (Time timeLeft);
+  void DoWalk (Time timeLeft, Time now);
   /**
    * Perform initialization of the object before MobilityModel::DoInitialize ()
+   * \param now time of the change of speed and direction
+   */
+  void DoInitializePrivate (Time now);
+  /**
+   * Perform the changes of speed and direction and the rebounds up to now, if lazy
    */
-  void DoInitializePrivate (void);
+  void CatchUp (void) const;
   virtual void DoDispose (void);
   virtual void DoInitialize (void);
   virtual Vector DoGetPosition (void) const;
@@ -87,6 +102,10 @@ private:
   Ptr<RandomVariableStream> m_speed; //!< rv for picking speed
   Ptr<RandomVariableStream> m_direction; //!< rv for picking direction
   Rectangle m_bounds; //!< Bounds of the area to cruise
+  bool m_lazy; //!< changes are made when queried
+  Time m_nextStep; //!< time of the next change if lazy
+  bool m_nextIsRebound; //!< the next change is a rebound
+  Time m_reboundLeft; //!< remaining time of the walk after the next rebound
 };
 
 
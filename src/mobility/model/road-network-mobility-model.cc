@@ -0,0 +1,342 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/pointer.h"
+#include "ns3/string.h"
+#include "road-network-mobility-model.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RoadNetworkMobilityModel");
+
+NS_OBJECT_ENSURE_REGISTERED (RoadNetworkMobilityModel);
+
+TypeId
+RoadNetworkMobilityModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RoadNetworkMobilityModel")
+    .SetParent<MobilityModel> ()
+    .SetGroupName ("Mobility")
+    .AddConstructor<RoadNetworkMobilityModel> ()
+    .AddAttribute ("Acceleration",
+                   "The acceleration of the vehicle up to the speed limits, in m/s^2.",
+                   DoubleValue (2.0),
+                   MakeDoubleAccessor (&RoadNetworkMobilityModel::m_acceleration),
+                   MakeDoubleChecker<double> (std::numeric_limits<double>::min ()))
+    .AddAttribute ("Deceleration",
+                   "The deceleration of the vehicle down to the speed limits and to its stops, in m/s^2.",
+                   DoubleValue (4.5),
+                   MakeDoubleAccessor (&RoadNetworkMobilityModel::m_deceleration),
+                   MakeDoubleChecker<double> (std::numeric_limits<double>::min ()))
+    .AddAttribute ("Pause",
+                   "A random variable used to pick the pause at the end of each trip, in s. "
+                   "Negative values are taken as no pause.",
+                   StringValue ("ns3::ConstantRandomVariable[Constant=2.0]"),
+                   MakePointerAccessor (&RoadNetworkMobilityModel::m_pause),
+                   MakePointerChecker<RandomVariableStream> ())
+    .AddAttribute ("SpeedFactor",
+                   "A random variable used to pick the factor of the speed limits the vehicle drives at on each trip. "
+                   "It must only take positive values.",
+                   StringValue ("ns3::ConstantRandomVariable[Constant=1.0]"),
+                   MakePointerAccessor (&RoadNetworkMobilityModel::m_speedFactor),
+                   MakePointerChecker<RandomVariableStream> ());
+  return tid;
+}
+
+RoadNetworkMobilityModel::RoadNetworkMobilityModel ()
+  : m_acceleration (2.0),
+    m_deceleration (4.5),
+    m_junction (RoadNetwork::NONE),
+    m_destination (RoadNetwork::NONE),
+    m_factor (1),
+    m_step (0),
+    m_road (RoadNetwork::NONE),
+    m_nPhases (0),
+    m_endSpeed (0),
+    m_cursor (0)
+{
+  m_random = CreateObject<UniformRandomVariable> ();
+}
+
+RoadNetworkMobilityModel::~RoadNetworkMobilityModel ()
+{
+}
+
+void
+RoadNetworkMobilityModel::DoDispose (void)
+{
+  m_event.Cancel ();
+  m_network = 0;
+  MobilityModel::DoDispose ();
+}
+
+void
+RoadNetworkMobilityModel::SetRoadNetwork (Ptr<RoadNetwork> network)
+{
+  NS_ASSERT (network != 0 && network->GetNJunctions () > 0);
+  Vector position = DoGetPosition ();
+  m_network = network;
+  m_road = RoadNetwork::NONE;
+  DoSetPosition (position);
+}
+
+Ptr<RoadNetwork>
+RoadNetworkMobilityModel::GetRoadNetwork (void) const
+{
+  return m_network;
+}
+
+uint32_t
+RoadNetworkMobilityModel::GetRoad (void) const
+{
+  return m_road;
+}
+
+uint32_t
+RoadNetworkMobilityModel::GetDestination (void) const
+{
+  return m_destination;
+}
+
+void
+RoadNetworkMobilityModel::Stop (void)
+{
+  NS_LOG_FUNCTION (this << m_junction);
+  m_road = RoadNetwork::NONE;
+  m_destination = m_junction;
+  m_position = m_network->GetJunctionPosition (m_junction);
+  m_event = Simulator::Schedule (Seconds (DrawPause ()), &RoadNetworkMobilityModel::BeginTrip, this);
+  NotifyCourseChange ();
+}
+
+void
+RoadNetworkMobilityModel::BeginTrip (void)
+{
+  uint32_t junctions = m_network->GetNJunctions ();
+  for (uint32_t tries = 0; tries < 8; tries++)
+    {
+      uint32_t destination = m_random->GetInteger (0, junctions - 1);
+      if (destination == m_junction)
+        {
+          continue;
+        }
+      if (m_network->FindPath (m_junction, destination, m_path))
+        {
+          NS_LOG_FUNCTION (this << m_junction << destination);
+          m_destination = destination;
+          m_factor = m_speedFactor->GetValue ();
+          NS_ABORT_MSG_IF (!(m_factor > 0), "Speed factor " << m_factor << " of vehicle " << this << " is not positive");
+          m_step = 0;
+          EnterRoad (0);
+          return;
+        }
+    }
+  // few destinations can be reached from here: wait and draw again
+  NS_LOG_LOGIC ("No destination reached from junction " << m_junction);
+  m_event = Simulator::Schedule (Seconds (std::max (DrawPause (), 1.0)), &RoadNetworkMobilityModel::BeginTrip, this);
+}
+
+double
+RoadNetworkMobilityModel::DrawPause (void)
+{
+  // a pause drawn from, say, a normal variable may be negative
+  return std::max (m_pause->GetValue (), 0.0);
+}
+
+void
+RoadNetworkMobilityModel::EnterRoad (double speed)
+{
+  m_road = m_path[m_step];
+  m_roadStart = Simulator::Now ();
+  m_cursor = 0;
+  double maxSpeed = m_network->GetRoadSpeedLimit (m_road) * m_factor;
+  double endSpeed = 0;
+  if (m_step + 1 < m_path.size ())
+    {
+      endSpeed = std::min (maxSpeed, m_network->GetRoadSpeedLimit (m_path[m_step + 1]) * m_factor);
+    }
+  double duration = BuildProfile (m_network->GetRoadLength (m_road), speed, maxSpeed, endSpeed);
+  m_event = Simulator::Schedule (Seconds (duration), &RoadNetworkMobilityModel::EndRoad, this);
+  NotifyCourseChange ();
+}
+
+void
+RoadNetworkMobilityModel::EndRoad (void)
+{
+  m_junction = m_network->GetRoadTo (m_road);
+  if (++m_step == m_path.size ())
+    {
+      Stop ();
+    }
+  else
+    {
+      EnterRoad (m_endSpeed);
+    }
+}
+
+double
+RoadNetworkMobilityModel::BuildProfile (double length, double speed, double maxSpeed, double endSpeed)
+{
+  NS_ASSERT (m_acceleration > 0 && m_deceleration > 0 && maxSpeed > 0);
+  double a = m_acceleration;
+  double b = m_deceleration;
+  m_nPhases = 0;
+  if (length <= 0)
+    {
+      m_endSpeed = std::min (speed, endSpeed);
+      return 0;
+    }
+
+  if (endSpeed > speed && speed * speed + 2 * a * length < endSpeed * endSpeed)
+    {
+      // too short to speed up to the end speed
+      endSpeed = std::sqrt (speed * speed + 2 * a * length);
+    }
+  m_endSpeed = endSpeed;
+  if (speed > endSpeed && speed * speed - 2 * b * length > endSpeed * endSpeed)
+    {
+      // too short to slow down with the deceleration: brake harder
+      Phase &phase = m_phases[m_nPhases++];
+      phase.time = 0;
+      phase.offset = 0;
+      phase.speed = speed;
+      phase.acceleration = (endSpeed * endSpeed - speed * speed) / (2 * length);
+      return 2 * length / (speed + endSpeed);
+    }
+
+  // speed up (or slow down) to the peak speed, cruise, slow down to the end speed
+  double peak = std::min (maxSpeed, std::sqrt ((2 * a * b * length + b * speed * speed + a * endSpeed * endSpeed) / (a + b)));
+  double time = 0;
+  double offset = 0;
+  if (peak != speed)
+    {
+      double rate = peak > speed ? a : -b;
+      Phase &phase = m_phases[m_nPhases++];
+      phase.time = time;
+      phase.offset = offset;
+      phase.speed = speed;
+      phase.acceleration = rate;
+      time += (peak - speed) / rate;
+      offset += (peak * peak - speed * speed) / (2 * rate);
+    }
+  double cruise = length - offset - (peak * peak - endSpeed * endSpeed) / (2 * b);
+  if (cruise > 0)
+    {
+      Phase &phase = m_phases[m_nPhases++];
+      phase.time = time;
+      phase.offset = offset;
+      phase.speed = peak;
+      phase.acceleration = 0;
+      time += cruise / peak;
+      offset += cruise;
+    }
+  if (peak > endSpeed)
+    {
+      Phase &phase = m_phases[m_nPhases++];
+      phase.time = time;
+      phase.offset = offset;
+      phase.speed = peak;
+      phase.acceleration = -b;
+      time += (peak - endSpeed) / b;
+    }
+  return time;
+}
+
+void
+RoadNetworkMobilityModel::Evaluate (Vector &position, Vector &velocity) const
+{
+  if (m_road == RoadNetwork::NONE)
+    {
+      position = m_position;
+      velocity = Vector (0, 0, 0);
+      return;
+    }
+  double offset = 0;
+  double speed = m_endSpeed;
+  if (m_nPhases > 0)
+    {
+      double time = (Simulator::Now () - m_roadStart).GetSeconds ();
+      uint32_t k = m_nPhases - 1;
+      while (k > 0 && m_phases[k].time > time)
+        {
+          k--;
+        }
+      const Phase &phase = m_phases[k];
+      double elapsed = time - phase.time;
+      speed = std::max (phase.speed + phase.acceleration * elapsed, 0.0);
+      offset = std::min (phase.offset + (phase.speed + 0.5 * phase.acceleration * elapsed) * elapsed,
+                         m_network->GetRoadLength (m_road));
+    }
+  Vector direction;
+  m_network->Evaluate (m_road, offset, m_cursor, position, direction);
+  velocity = Vector (direction.x * speed, direction.y * speed, direction.z * speed);
+}
+
+Vector
+RoadNetworkMobilityModel::DoGetPosition (void) const
+{
+  Vector position;
+  Vector velocity;
+  Evaluate (position, velocity);
+  return position;
+}
+
+void
+RoadNetworkMobilityModel::DoSetPosition (const Vector &position)
+{
+  if (m_network == 0)
+    {
+      m_position = position;
+      NotifyCourseChange ();
+      return;
+    }
+  m_event.Cancel ();
+  m_junction = m_network->FindNearestJunction (position);
+  Stop ();
+}
+
+Vector
+RoadNetworkMobilityModel::DoGetVelocity (void) const
+{
+  Vector position;
+  Vector velocity;
+  Evaluate (position, velocity);
+  return velocity;
+}
+
+int64_t
+RoadNetworkMobilityModel::DoAssignStreams (int64_t stream)
+{
+  m_pause->SetStream (stream);
+  m_speedFactor->SetStream (stream + 1);
+  m_random->SetStream (stream + 2);
+  return 3;
+}
+
+} // namespace ns3
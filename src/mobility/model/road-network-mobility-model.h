@@ -0,0 +1,182 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#ifndef ROAD_NETWORK_MOBILITY_MODEL_H
+#define ROAD_NETWORK_MOBILITY_MODEL_H
+
+#include <stdint.h>
+#include <vector>
+#include "mobility-model.h"
+#include "road-network.h"
+#include "ns3/ptr.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup mobility
+ * \brief Mobility model which drives along the roads of a RoadNetwork.
+ *
+ * The vehicle starts at the junction nearest to its position, and makes
+ * trips to junctions chosen at random, along the fastest paths (see
+ * RoadNetwork::FindPath, once per trip), with a pause at the end of each
+ * one. It drives each trip at SpeedFactor times
+ * the speed limits: on each road, it speeds up with Acceleration to the
+ * limit and slows down with Deceleration to the limit of the next road, or
+ * to a stop at the destination, and brakes harder if the road is too short
+ * to slow down with Deceleration.
+ *
+ * The speed profile of a road is found when the vehicle enters it, so a
+ * road costs one event, and the position is computed from the profile and
+ * the shape of the road when it is queried, from the shape segment of the
+ * previous query. The path of a trip is kept in a buffer of the model
+ * reused by the next trips, so moving the vehicle does not allocate
+ * memory. The CourseChange trace fires
+ * when the vehicle enters a road and when it stops, not at the bends of
+ * the roads nor when its speed changes on them.
+ *
+ * Setting the position moves the vehicle to the junction nearest to it,
+ * where it pauses before its next trip.
+ */
+class RoadNetworkMobilityModel : public MobilityModel
+{
+public:
+  /**
+   * Register this type with the TypeId system.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  RoadNetworkMobilityModel ();
+  virtual ~RoadNetworkMobilityModel ();
+
+  /**
+   * \param network road network to drive on, with at least a junction.
+   *
+   * Moves the vehicle to the junction nearest to its position, where it
+   * pauses before its first trip.
+   */
+  void SetRoadNetwork (Ptr<RoadNetwork> network);
+
+  /**
+   * \returns the road network driven on, 0 if none.
+   */
+  Ptr<RoadNetwork> GetRoadNetwork (void) const;
+
+  /**
+   * \returns the road the vehicle is on, RoadNetwork::NONE if it is
+   *          stopped at a junction.
+   */
+  uint32_t GetRoad (void) const;
+
+  /**
+   * \returns the destination of the current trip, or the junction the
+   *          vehicle is stopped at.
+   */
+  uint32_t GetDestination (void) const;
+
+private:
+  /// Part of the speed profile of a road with a constant acceleration
+  struct Phase
+  {
+    double time;           //!< start of the phase, in s from the entry in the road
+    double offset;         //!< distance from the start of the road at that time
+    double speed;          //!< speed at that time
+    double acceleration;   //!< acceleration during the phase
+  };
+
+  virtual void DoDispose (void);
+  virtual Vector DoGetPosition (void) const;
+  virtual void DoSetPosition (const Vector &position);
+  virtual Vector DoGetVelocity (void) const;
+  virtual int64_t DoAssignStreams (int64_t stream);
+
+  /**
+   * Stops the vehicle at m_junction and schedules its next trip.
+   */
+  void Stop (void);
+
+  /**
+   * Chooses a destination and enters the first road towards it.
+   */
+  void BeginTrip (void);
+
+  /**
+   * \returns a pause drawn from m_pause, not below zero.
+   */
+  double DrawPause (void);
+
+  /**
+   * \param speed speed of the vehicle when it enters the next road of
+   *        its path, which starts at m_junction.
+   */
+  void EnterRoad (double speed);
+
+  /**
+   * Moves the vehicle to the junction at the end of m_road, and to the
+   * next road or to a stop.
+   */
+  void EndRoad (void);
+
+  /**
+   * \param length length of the road.
+   * \param speed speed at the start of the road.
+   * \param maxSpeed speed limit of the vehicle on the road.
+   * \param endSpeed speed to reach at the end of the road, not over
+   *        maxSpeed.
+   * \returns the time to drive along the road.
+   *
+   * Fills m_phases and m_endSpeed.
+   */
+  double BuildProfile (double length, double speed, double maxSpeed, double endSpeed);
+
+  /**
+   * \param [out] position position of the vehicle now.
+   * \param [out] velocity velocity of the vehicle now.
+   */
+  void Evaluate (Vector &position, Vector &velocity) const;
+
+  Ptr<RoadNetwork> m_network;                //!< road network, 0 if none
+  double m_acceleration;                     //!< acceleration, m/s^2
+  double m_deceleration;                     //!< deceleration, m/s^2
+  Ptr<RandomVariableStream> m_pause;         //!< pause at the end of each trip, s
+  Ptr<RandomVariableStream> m_speedFactor;   //!< factor of the speed limits of each trip
+  Ptr<UniformRandomVariable> m_random;       //!< to choose the destinations
+
+  Vector m_position;                         //!< position while stopped
+  uint32_t m_junction;                       //!< junction stopped at or last passed, NONE if none
+  uint32_t m_destination;                    //!< destination of the trip
+  double m_factor;                           //!< factor of the speed limits of the trip
+  std::vector<uint32_t> m_path;              //!< roads of the path of the trip
+  uint32_t m_step;                           //!< index of m_road in m_path
+  uint32_t m_road;                           //!< road driven on, NONE if stopped
+  Time m_roadStart;                          //!< time the vehicle entered m_road
+  Phase m_phases[3];                         //!< speed profile on m_road
+  uint32_t m_nPhases;                        //!< phases of the profile
+  double m_endSpeed;                         //!< speed at the end of m_road
+  mutable uint32_t m_cursor;                 //!< shape segment of the last query
+  EventId m_event;                           //!< end of the road or of the pause
+};
+
+} // namespace ns3
+
+#endif /* ROAD_NETWORK_MOBILITY_MODEL_H */
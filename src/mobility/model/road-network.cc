@@ -0,0 +1,403 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "road-network.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RoadNetwork");
+
+const uint32_t RoadNetwork::NONE;
+
+RoadNetwork::RoadNetwork ()
+  : m_frozen (false),
+    m_maxSpeed (0),
+    m_cacheSize (4096),
+    m_hand (0),
+    m_search (0)
+{
+  m_roadPoints.push_back (0);
+}
+
+uint32_t
+RoadNetwork::AddJunction (const Vector &position)
+{
+  NS_ASSERT_MSG (!m_frozen, "Road network changed after it was used");
+  m_junctions.push_back (position);
+  return m_junctions.size () - 1;
+}
+
+uint32_t
+RoadNetwork::AddRoad (uint32_t from, uint32_t to, double speedLimit)
+{
+  return AddRoad (from, to, speedLimit, std::vector<Vector> ());
+}
+
+uint32_t
+RoadNetwork::AddRoad (uint32_t from, uint32_t to, double speedLimit, const std::vector<Vector> &shape)
+{
+  NS_ASSERT_MSG (!m_frozen, "Road network changed after it was used");
+  NS_ASSERT (from < m_junctions.size () && to < m_junctions.size ());
+  NS_ASSERT (speedLimit > 0);
+  m_roadFrom.push_back (from);
+  m_roadTo.push_back (to);
+  m_roadSpeed.push_back (speedLimit);
+
+  double offset = 0;
+  m_points.push_back (m_junctions[from]);
+  m_pointOffsets.push_back (0);
+  for (uint32_t i = 0; i <= shape.size (); i++)
+    {
+      const Vector &point = i < shape.size () ? shape[i] : m_junctions[to];
+      offset += CalculateDistance (m_points.back (), point);
+      m_points.push_back (point);
+      m_pointOffsets.push_back (offset);
+    }
+  m_roadPoints.push_back (m_points.size ());
+  return m_roadFrom.size () - 1;
+}
+
+bool
+RoadNetwork::Load (std::string filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+  std::ifstream file (filename.c_str ());
+  if (!file.is_open ())
+    {
+      NS_LOG_ERROR ("Could not open road network " << filename);
+      return false;
+    }
+  uint32_t first = m_junctions.size ();
+  std::string line;
+  std::vector<double> coordinates;
+  std::vector<Vector> shape;
+  for (uint32_t number = 1; std::getline (file, line); number++)
+    {
+      std::istringstream is (line);
+      std::string type;
+      if (!(is >> type) || type[0] == '#')
+        {
+          continue;
+        }
+      if (type == "junction")
+        {
+          Vector position;
+          if (is >> position.x >> position.y)
+            {
+              if (!(is >> position.z))
+                {
+                  position.z = 0;
+                }
+              AddJunction (position);
+              continue;
+            }
+        }
+      else if (type == "oneway" || type == "twoway")
+        {
+          uint32_t from;
+          uint32_t to;
+          double speedLimit;
+          if (is >> from >> to >> speedLimit
+              && from < m_junctions.size () - first && to < m_junctions.size () - first && speedLimit > 0)
+            {
+              coordinates.clear ();
+              double coordinate;
+              while (is >> coordinate)
+                {
+                  coordinates.push_back (coordinate);
+                }
+              if (is.eof () && coordinates.size () % 3 == 0)
+                {
+                  shape.clear ();
+                  for (uint32_t i = 0; i < coordinates.size (); i += 3)
+                    {
+                      shape.push_back (Vector (coordinates[i], coordinates[i + 1], coordinates[i + 2]));
+                    }
+                  AddRoad (first + from, first + to, speedLimit, shape);
+                  if (type == "twoway")
+                    {
+                      std::reverse (shape.begin (), shape.end ());
+                      AddRoad (first + to, first + from, speedLimit, shape);
+                    }
+                  continue;
+                }
+            }
+        }
+      NS_LOG_ERROR ("Invalid line " << number << " of road network " << filename << ": " << line);
+      return false;
+    }
+  return true;
+}
+
+void
+RoadNetwork::SetRouteCacheSize (uint32_t paths)
+{
+  NS_ASSERT (paths > 0);
+  m_cacheSize = paths;
+  m_routes.clear ();
+  m_routeIndex.clear ();
+  m_hand = 0;
+}
+
+uint32_t
+RoadNetwork::GetNJunctions (void) const
+{
+  return m_junctions.size ();
+}
+
+uint32_t
+RoadNetwork::GetNRoads (void) const
+{
+  return m_roadFrom.size ();
+}
+
+Vector
+RoadNetwork::GetJunctionPosition (uint32_t junction) const
+{
+  return m_junctions[junction];
+}
+
+uint32_t
+RoadNetwork::FindNearestJunction (const Vector &position) const
+{
+  uint32_t nearest = NONE;
+  double best = std::numeric_limits<double>::infinity ();
+  for (uint32_t i = 0; i < m_junctions.size (); i++)
+    {
+      double dx = m_junctions[i].x - position.x;
+      double dy = m_junctions[i].y - position.y;
+      double dz = m_junctions[i].z - position.z;
+      double distance = dx * dx + dy * dy + dz * dz;
+      if (distance < best)
+        {
+          best = distance;
+          nearest = i;
+        }
+    }
+  return nearest;
+}
+
+uint32_t
+RoadNetwork::GetRoadFrom (uint32_t road) const
+{
+  return m_roadFrom[road];
+}
+
+uint32_t
+RoadNetwork::GetRoadTo (uint32_t road) const
+{
+  return m_roadTo[road];
+}
+
+double
+RoadNetwork::GetRoadSpeedLimit (uint32_t road) const
+{
+  return m_roadSpeed[road];
+}
+
+double
+RoadNetwork::GetRoadLength (uint32_t road) const
+{
+  return m_pointOffsets[m_roadPoints[road + 1] - 1];
+}
+
+uint64_t
+RoadNetwork::Key (uint32_t from, uint32_t to)
+{
+  return ((uint64_t) from << 32) | to;
+}
+
+bool
+RoadNetwork::FindPath (uint32_t from, uint32_t to, std::vector<uint32_t> &path)
+{
+  NS_ASSERT (from < m_junctions.size () && to < m_junctions.size ());
+  path.clear ();
+  if (from == to)
+    {
+      return true;
+    }
+  uint64_t key = Key (from, to);
+  std::unordered_map<uint64_t, uint32_t>::const_iterator i = m_routeIndex.find (key);
+  if (i != m_routeIndex.end ())
+    {
+      Route &route = m_routes[i->second];
+      route.used = true;
+      path.assign (route.roads.begin (), route.roads.end ());
+      return route.found;
+    }
+
+  bool found = Search (from, to, path);
+  uint32_t index;
+  if (m_routes.size () < m_cacheSize)
+    {
+      index = m_routes.size ();
+      m_routes.push_back (Route ());
+    }
+  else
+    {
+      // the first path the clock hand finds unused since it last passed
+      while (m_routes[m_hand].used)
+        {
+          m_routes[m_hand].used = false;
+          m_hand = (m_hand + 1) % m_routes.size ();
+        }
+      index = m_hand;
+      m_hand = (m_hand + 1) % m_routes.size ();
+      m_routeIndex.erase (m_routes[index].key);
+    }
+  Route &route = m_routes[index];
+  route.key = key;
+  route.found = found;
+  route.used = false;
+  route.roads.assign (path.begin (), path.end ());
+  m_routeIndex[key] = index;
+  return found;
+}
+
+void
+RoadNetwork::Freeze (void)
+{
+  if (m_frozen)
+    {
+      return;
+    }
+  m_frozen = true;
+  m_outgoingStart.assign (m_junctions.size () + 1, 0);
+  m_roadTimes.resize (m_roadFrom.size ());
+  for (uint32_t road = 0; road < m_roadFrom.size (); road++)
+    {
+      m_outgoingStart[m_roadFrom[road] + 1]++;
+      m_maxSpeed = std::max (m_maxSpeed, m_roadSpeed[road]);
+      m_roadTimes[road] = GetRoadLength (road) / m_roadSpeed[road];
+    }
+  for (uint32_t j = 0; j < m_junctions.size (); j++)
+    {
+      m_outgoingStart[j + 1] += m_outgoingStart[j];
+    }
+  m_outgoing.resize (m_roadFrom.size ());
+  std::vector<uint32_t> end (m_outgoingStart.begin (), m_outgoingStart.end () - 1);
+  for (uint32_t road = 0; road < m_roadFrom.size (); road++)
+    {
+      m_outgoing[end[m_roadFrom[road]]++] = road;
+    }
+  m_reached.assign (m_junctions.size (), 0);
+  m_settled.assign (m_junctions.size (), 0);
+  m_times.resize (m_junctions.size ());
+  m_previous.resize (m_junctions.size ());
+}
+
+bool
+RoadNetwork::Search (uint32_t from, uint32_t to, std::vector<uint32_t> &path)
+{
+  NS_LOG_FUNCTION (this << from << to);
+  Freeze ();
+  if (++m_search == 0)
+    {
+      // the search numbers wrapped around
+      m_reached.assign (m_junctions.size (), 0);
+      m_settled.assign (m_junctions.size (), 0);
+      m_search = 1;
+    }
+  const Vector &destination = m_junctions[to];
+  std::greater<std::pair<double, uint32_t> > later;
+  m_heap.clear ();
+  m_reached[from] = m_search;
+  m_times[from] = 0;
+  m_heap.push_back (std::make_pair (CalculateDistance (m_junctions[from], destination) / m_maxSpeed, from));
+  while (!m_heap.empty ())
+    {
+      std::pop_heap (m_heap.begin (), m_heap.end (), later);
+      uint32_t junction = m_heap.back ().second;
+      m_heap.pop_back ();
+      if (m_settled[junction] == m_search)
+        {
+          continue;
+        }
+      m_settled[junction] = m_search;
+      if (junction == to)
+        {
+          for (uint32_t j = to; j != from; j = m_roadFrom[m_previous[j]])
+            {
+              path.push_back (m_previous[j]);
+            }
+          std::reverse (path.begin (), path.end ());
+          return true;
+        }
+      for (uint32_t k = m_outgoingStart[junction]; k < m_outgoingStart[junction + 1]; k++)
+        {
+          uint32_t road = m_outgoing[k];
+          uint32_t next = m_roadTo[road];
+          double time = m_times[junction] + m_roadTimes[road];
+          if (m_settled[next] != m_search && (m_reached[next] != m_search || time < m_times[next]))
+            {
+              m_reached[next] = m_search;
+              m_times[next] = time;
+              m_previous[next] = road;
+              m_heap.push_back (std::make_pair (time + CalculateDistance (m_junctions[next], destination) / m_maxSpeed, next));
+              std::push_heap (m_heap.begin (), m_heap.end (), later);
+            }
+        }
+    }
+  return false;
+}
+
+void
+RoadNetwork::Evaluate (uint32_t road, double offset, uint32_t &cursor, Vector &position, Vector &direction) const
+{
+  uint32_t first = m_roadPoints[road];
+  uint32_t segments = m_roadPoints[road + 1] - first - 1;
+  const double *offsets = &m_pointOffsets[first];
+  if (cursor >= segments)
+    {
+      cursor = 0;
+    }
+  while (cursor + 1 < segments && offset > offsets[cursor + 1])
+    {
+      cursor++;
+    }
+  while (cursor > 0 && offset < offsets[cursor])
+    {
+      cursor--;
+    }
+
+  const Vector &start = m_points[first + cursor];
+  const Vector &end = m_points[first + cursor + 1];
+  double length = offsets[cursor + 1] - offsets[cursor];
+  if (length <= 0)
+    {
+      position = start;
+      direction = Vector (0, 0, 0);
+      return;
+    }
+  direction = Vector ((end.x - start.x) / length, (end.y - start.y) / length, (end.z - start.z) / length);
+  double along = std::min (std::max (offset - offsets[cursor], 0.0), length);
+  position = Vector (start.x + direction.x * along, start.y + direction.y * along, start.z + direction.z * along);
+}
+
+} // namespace ns3
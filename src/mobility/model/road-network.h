@@ -0,0 +1,230 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#ifndef ROAD_NETWORK_H
+#define ROAD_NETWORK_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "ns3/simple-ref-count.h"
+#include "ns3/vector.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup mobility
+ * \brief Road graph followed by the RoadNetworkMobilityModel objects.
+ *
+ * A network is a set of junctions joined by one-way roads, each one with a
+ * speed limit and a polyline shape from its first junction to its last
+ * one. It is built with AddJunction and AddRoad, or read with Load, and is
+ * not changed once it is used by a model, so any number of models can
+ * share it. The junctions, roads and shape points are kept in flat arrays.
+ *
+ * Vehicles are routed along the fastest paths, by travel time at the
+ * speed limits, found with an A* search whose buffers are reused from one
+ * search to the next. The last SetRouteCacheSize paths found are kept, so
+ * the vehicles going between the same junctions share them.
+ */
+class RoadNetwork : public SimpleRefCount<RoadNetwork>
+{
+public:
+  /// Road or junction which does not exist
+  static const uint32_t NONE = 0xffffffff;
+
+  RoadNetwork ();
+
+  /**
+   * \param position position of the junction.
+   * \returns the index of the junction, the number of junctions before.
+   */
+  uint32_t AddJunction (const Vector &position);
+
+  /**
+   * \param from junction the road starts at.
+   * \param to junction the road ends at.
+   * \param speedLimit speed limit of the road, in m/s, positive.
+   * \returns the index of the road, the number of roads before.
+   *
+   * Adds a straight one-way road.
+   */
+  uint32_t AddRoad (uint32_t from, uint32_t to, double speedLimit);
+
+  /**
+   * \param from junction the road starts at.
+   * \param to junction the road ends at.
+   * \param speedLimit speed limit of the road, in m/s, positive.
+   * \param shape points of the road between its junctions.
+   * \returns the index of the road, the number of roads before.
+   *
+   * Adds a one-way road along a polyline.
+   */
+  uint32_t AddRoad (uint32_t from, uint32_t to, double speedLimit, const std::vector<Vector> &shape);
+
+  /**
+   * \param filename road network file.
+   * \returns false if the file could not be read or is not valid.
+   *
+   * Adds the junctions and roads of a text file. Each line is empty, a
+   * comment starting with #, or one of:
+   *  - junction x y [z]: a junction, numbered from 0 in the order of the
+   *    file, after those of the network.
+   *  - oneway from to speedLimit [x y z]...: a one-way road, along the
+   *    given shape points, if any.
+   *  - twoway from to speedLimit [x y z]...: a road each way.
+   */
+  bool Load (std::string filename);
+
+  /**
+   * \param paths number of paths kept, at least 1, 4096 by default.
+   */
+  void SetRouteCacheSize (uint32_t paths);
+
+  /**
+   * \returns the number of junctions.
+   */
+  uint32_t GetNJunctions (void) const;
+
+  /**
+   * \returns the number of roads.
+   */
+  uint32_t GetNRoads (void) const;
+
+  /**
+   * \param junction index of a junction.
+   * \returns its position.
+   */
+  Vector GetJunctionPosition (uint32_t junction) const;
+
+  /**
+   * \param position a position.
+   * \returns the junction nearest to it, NONE if there is none.
+   */
+  uint32_t FindNearestJunction (const Vector &position) const;
+
+  /**
+   * \param road index of a road.
+   * \returns the junction it starts at.
+   */
+  uint32_t GetRoadFrom (uint32_t road) const;
+
+  /**
+   * \param road index of a road.
+   * \returns the junction it ends at.
+   */
+  uint32_t GetRoadTo (uint32_t road) const;
+
+  /**
+   * \param road index of a road.
+   * \returns its speed limit, in m/s.
+   */
+  double GetRoadSpeedLimit (uint32_t road) const;
+
+  /**
+   * \param road index of a road.
+   * \returns its length along its shape, in m.
+   */
+  double GetRoadLength (uint32_t road) const;
+
+  /**
+   * \param from junction to start at.
+   * \param to junction to go to.
+   * \param [out] path roads of the fastest path from one to the other, in
+   *        order, empty if they are the same.
+   * \returns false if the destination cannot be reached.
+   */
+  bool FindPath (uint32_t from, uint32_t to, std::vector<uint32_t> &path);
+
+  /**
+   * \param road index of a road.
+   * \param offset distance from its start along its shape, in m.
+   * \param [in,out] cursor segment of the shape used by the previous
+   *        evaluation on the road, 0 at first, updated to the one used now.
+   * \param [out] position position at that distance.
+   * \param [out] direction unit vector along the road there.
+   */
+  void Evaluate (uint32_t road, double offset, uint32_t &cursor, Vector &position, Vector &direction) const;
+
+private:
+  /// Path kept in the route cache
+  struct Route
+  {
+    uint64_t key;                  //!< junctions from and to, see Key
+    bool found;                    //!< the destination can be reached
+    bool used;                     //!< used since the clock hand last passed
+    std::vector<uint32_t> roads;   //!< roads of the path
+  };
+
+  /**
+   * \param from junction to start at.
+   * \param to junction to go to.
+   * \returns the key of the path in the route cache.
+   */
+  static uint64_t Key (uint32_t from, uint32_t to);
+
+  /**
+   * Builds the outgoing roads of each junction, once the network is used.
+   */
+  void Freeze (void);
+
+  /**
+   * \param from junction to start at.
+   * \param to junction to go to.
+   * \param [out] path roads of the fastest path.
+   * \returns false if the destination cannot be reached.
+   *
+   * A* search, with the time to the destination in a straight line at the
+   * highest speed limit as the heuristic.
+   */
+  bool Search (uint32_t from, uint32_t to, std::vector<uint32_t> &path);
+
+  std::vector<Vector> m_junctions;               //!< position of each junction
+  std::vector<uint32_t> m_roadFrom;              //!< first junction of each road
+  std::vector<uint32_t> m_roadTo;                //!< last junction of each road
+  std::vector<double> m_roadSpeed;               //!< speed limit of each road
+  std::vector<uint32_t> m_roadPoints;            //!< first shape point of each road, and the number of points at the end
+  std::vector<Vector> m_points;                  //!< shape points of the roads, junctions included
+  std::vector<double> m_pointOffsets;            //!< distance of each shape point from the start of its road
+
+  bool m_frozen;                                 //!< the network is used and cannot change
+  std::vector<uint32_t> m_outgoingStart;         //!< first outgoing road of each junction in m_outgoing, and the end
+  std::vector<uint32_t> m_outgoing;              //!< outgoing roads, by junction
+  double m_maxSpeed;                             //!< highest speed limit
+  std::vector<double> m_roadTimes;               //!< time to drive along each road at its speed limit
+
+  uint32_t m_cacheSize;                          //!< paths kept
+  std::vector<Route> m_routes;                   //!< paths kept
+  std::unordered_map<uint64_t, uint32_t> m_routeIndex;  //!< index in m_routes of each path kept, by key
+  uint32_t m_hand;                               //!< clock hand, next path to replace unless it was used
+
+  // search state, reused from one search to the next
+  uint32_t m_search;                             //!< number of the current search
+  std::vector<uint32_t> m_reached;               //!< number of the last search which reached each junction
+  std::vector<uint32_t> m_settled;               //!< number of the last search which settled each junction
+  std::vector<double> m_times;                   //!< fastest time from the start to each junction
+  std::vector<uint32_t> m_previous;              //!< road the fastest path to each junction arrives by
+  std::vector<std::pair<double, uint32_t> > m_heap;  //!< junctions to visit, by estimated time to the destination
+};
+
+} // namespace ns3
+
+#endif /* ROAD_NETWORK_H */
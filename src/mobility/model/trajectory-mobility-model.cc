@@ -0,0 +1,115 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#include "ns3/simulator.h"
+#include "ns3/assert.h"
+#include "trajectory-mobility-model.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (TrajectoryMobilityModel);
+
+TypeId
+TrajectoryMobilityModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TrajectoryMobilityModel")
+    .SetParent<MobilityModel> ()
+    .SetGroupName ("Mobility")
+    .AddConstructor<TrajectoryMobilityModel> ();
+  return tid;
+}
+
+TrajectoryMobilityModel::TrajectoryMobilityModel ()
+  : m_start (Seconds (0)),
+    m_cursor (0)
+{
+}
+
+TrajectoryMobilityModel::~TrajectoryMobilityModel ()
+{
+}
+
+void
+TrajectoryMobilityModel::SetTrajectory (Ptr<const Trajectory> trajectory, Time start)
+{
+  NS_ASSERT (trajectory != 0 && trajectory->GetN () > 0);
+  m_trajectory = trajectory;
+  m_start = start;
+  m_offset = Vector (0, 0, 0);
+  m_cursor = 0;
+  NotifyCourseChange ();
+}
+
+void
+TrajectoryMobilityModel::SetTrajectory (Ptr<const Trajectory> trajectory)
+{
+  SetTrajectory (trajectory, Simulator::Now ());
+}
+
+Ptr<const Trajectory>
+TrajectoryMobilityModel::GetTrajectory (void) const
+{
+  return m_trajectory;
+}
+
+Vector
+TrajectoryMobilityModel::DoGetPosition (void) const
+{
+  if (m_trajectory == 0)
+    {
+      return m_offset;
+    }
+  Vector position;
+  Vector velocity;
+  m_trajectory->Evaluate ((Simulator::Now () - m_start).GetNanoSeconds (), m_cursor, position, velocity);
+  return Vector (position.x + m_offset.x, position.y + m_offset.y, position.z + m_offset.z);
+}
+
+void
+TrajectoryMobilityModel::DoSetPosition (const Vector &position)
+{
+  if (m_trajectory == 0)
+    {
+      m_offset = position;
+    }
+  else
+    {
+      Vector current;
+      Vector velocity;
+      m_trajectory->Evaluate ((Simulator::Now () - m_start).GetNanoSeconds (), m_cursor, current, velocity);
+      m_offset = Vector (position.x - current.x, position.y - current.y, position.z - current.z);
+    }
+  NotifyCourseChange ();
+}
+
+Vector
+TrajectoryMobilityModel::DoGetVelocity (void) const
+{
+  if (m_trajectory == 0)
+    {
+      return Vector (0, 0, 0);
+    }
+  Vector position;
+  Vector velocity;
+  m_trajectory->Evaluate ((Simulator::Now () - m_start).GetNanoSeconds (), m_cursor, position, velocity);
+  return velocity;
+}
+
+} // namespace ns3
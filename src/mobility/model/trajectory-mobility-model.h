@@ -0,0 +1,106 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#ifndef TRAJECTORY_MOBILITY_MODEL_H
+#define TRAJECTORY_MOBILITY_MODEL_H
+
+#include <stdint.h>
+#include "mobility-model.h"
+#include "ns3/ptr.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "trajectory.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup mobility
+ * \brief Mobility model which follows a sampled ns3::Trajectory.
+ *
+ * The position and the velocity are interpolated from the samples of the
+ * trajectory when they are queried, starting from the sample used by the
+ * previous query, so a query costs O(1) amortized whatever the number of
+ * samples, and no event is scheduled at the samples. The trajectory is
+ * shared and not copied, so many models, e.g. of the replications of a
+ * simulation, can follow the same one.
+ *
+ * As no event is scheduled, the CourseChange trace only fires when the
+ * trajectory or the position are set, and not at the samples: the
+ * listeners that must see every change of velocity should sample the model
+ * periodically instead.
+ */
+class TrajectoryMobilityModel : public MobilityModel
+{
+public:
+  /**
+   * Register this type with the TypeId system.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * Create a model at (0,0,0) with no trajectory.
+   */
+  TrajectoryMobilityModel ();
+  virtual ~TrajectoryMobilityModel ();
+
+  /**
+   * \param trajectory trajectory to follow, with at least a sample.
+   * \param start simulation time of the time 0 of the trajectory.
+   */
+  void SetTrajectory (Ptr<const Trajectory> trajectory, Time start);
+
+  /**
+   * \param trajectory trajectory to follow, with at least a sample, from
+   *        now.
+   */
+  void SetTrajectory (Ptr<const Trajectory> trajectory);
+
+  /**
+   * \returns the trajectory followed, 0 if none.
+   */
+  Ptr<const Trajectory> GetTrajectory (void) const;
+
+private:
+  /**
+   * \brief Get current position.
+   * \return The position of the trajectory now, moved by the offset.
+   */
+  virtual Vector DoGetPosition (void) const;
+  /**
+   * \brief Moves the trajectory so that it passes by the position now.
+   * \param position position of the node now.
+   */
+  virtual void DoSetPosition (const Vector &position);
+  /**
+   * \brief Returns the current velocity of a node
+   * \return The velocity of the trajectory now.
+   */
+  virtual Vector DoGetVelocity (void) const;
+
+  Ptr<const Trajectory> m_trajectory;   //!< trajectory followed, 0 if none
+  Time m_start;                         //!< simulation time of the time 0 of the trajectory
+  Vector m_offset;                      //!< offset of the position from the trajectory, or the position without one
+  mutable uint32_t m_cursor;            //!< sample used by the last query
+};
+
+} // namespace ns3
+
+#endif /* TRAJECTORY_MOBILITY_MODEL_H */
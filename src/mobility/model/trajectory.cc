@@ -0,0 +1,139 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <algorithm>
+#include "ns3/assert.h"
+#include "trajectory.h"
+
+namespace ns3 {
+
+Trajectory::Trajectory ()
+{
+}
+
+void
+Trajectory::Reserve (uint32_t samples)
+{
+  m_times.reserve (samples);
+  m_positions.reserve (samples);
+}
+
+void
+Trajectory::Add (Time time, const Vector &position)
+{
+  NS_ASSERT_MSG (m_velocities.empty (), "Samples with and without velocity");
+  NS_ASSERT_MSG (m_times.empty () || time.GetNanoSeconds () >= m_times.back (), "Samples out of order");
+  m_times.push_back (time.GetNanoSeconds ());
+  m_positions.push_back (position);
+}
+
+void
+Trajectory::Add (Time time, const Vector &position, const Vector &velocity)
+{
+  NS_ASSERT_MSG (m_velocities.size () == m_times.size (), "Samples with and without velocity");
+  NS_ASSERT_MSG (m_times.empty () || time.GetNanoSeconds () >= m_times.back (), "Samples out of order");
+  if (m_velocities.capacity () < m_times.capacity ())
+    {
+      m_velocities.reserve (m_times.capacity ());
+    }
+  m_times.push_back (time.GetNanoSeconds ());
+  m_positions.push_back (position);
+  m_velocities.push_back (velocity);
+}
+
+uint32_t
+Trajectory::GetN (void) const
+{
+  return m_times.size ();
+}
+
+bool
+Trajectory::HasVelocities (void) const
+{
+  return !m_velocities.empty ();
+}
+
+Time
+Trajectory::GetTime (uint32_t i) const
+{
+  NS_ASSERT (i < m_times.size ());
+  return NanoSeconds (m_times[i]);
+}
+
+Vector
+Trajectory::GetPosition (uint32_t i) const
+{
+  NS_ASSERT (i < m_positions.size ());
+  return m_positions[i];
+}
+
+uint32_t
+Trajectory::Find (int64_t time, uint32_t cursor) const
+{
+  uint32_t n = m_times.size ();
+  if (cursor >= n || m_times[cursor] > time)
+    {
+      cursor = 0;
+    }
+  // the next samples first, as the times usually advance a little
+  for (uint32_t steps = 0; steps < 4; steps++)
+    {
+      if (cursor + 1 >= n || m_times[cursor + 1] > time)
+        {
+          return cursor;
+        }
+      cursor++;
+    }
+  std::vector<int64_t>::const_iterator it = std::upper_bound (m_times.begin () + cursor, m_times.end (), time);
+  return it - m_times.begin () - 1;
+}
+
+void
+Trajectory::Evaluate (int64_t time, uint32_t &cursor, Vector &position, Vector &velocity) const
+{
+  NS_ASSERT (!m_times.empty ());
+  cursor = Find (time, cursor);
+  uint32_t k = cursor;
+  if (time < m_times[k] || k + 1 == m_times.size ())
+    {
+      // before the first sample or after the last one
+      position = m_positions[k];
+      velocity = Vector (0, 0, 0);
+      return;
+    }
+  double dt = (m_times[k + 1] - m_times[k]) * 1e-9;
+  double t = (time - m_times[k]) * 1e-9;
+  const Vector &p = m_positions[k];
+  if (m_velocities.empty ())
+    {
+      const Vector &next = m_positions[k + 1];
+      velocity = Vector ((next.x - p.x) / dt, (next.y - p.y) / dt, (next.z - p.z) / dt);
+      position = Vector (p.x + velocity.x * t, p.y + velocity.y * t, p.z + velocity.z * t);
+      return;
+    }
+  const Vector &v = m_velocities[k];
+  const Vector &next = m_velocities[k + 1];
+  Vector a ((next.x - v.x) / dt, (next.y - v.y) / dt, (next.z - v.z) / dt);
+  position = Vector (p.x + (v.x + a.x * t / 2) * t, p.y + (v.y + a.y * t / 2) * t, p.z + (v.z + a.z * t / 2) * t);
+  velocity = Vector (v.x + a.x * t, v.y + a.y * t, v.z + a.z * t);
+}
+
+} // namespace ns3
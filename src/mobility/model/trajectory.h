@@ -0,0 +1,135 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <stdint.h>
+#include <vector>
+#include "ns3/simple-ref-count.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup mobility
+ * \brief Time-indexed samples of the movement of a vehicle, shared by the
+ * TrajectoryMobilityModel objects which follow it.
+ *
+ * The samples are kept in arrays sorted by time, and are not changed once
+ * the trajectory is used by a model, so a trajectory can be shared by any
+ * number of models and simulations. Between two samples the position is
+ * interpolated:
+ *
+ *  - if the samples have only positions, linearly, at the constant
+ *    velocity which takes it from one sample to the next;
+ *  - if the samples have velocities too, with the constant acceleration
+ *    which takes it from the velocity of one sample to the velocity of the
+ *    next one, as SumoFcdMobilityHelper does. The position at the next
+ *    sample then jumps to the sampled one, if they differ.
+ *
+ * Before the first sample it is at the first position, and after the last
+ * one at the last position, with a velocity of zero. Two samples may have
+ * the same time: the position jumps to the second one at that time, e.g.
+ * to hold a position and then teleport.
+ *
+ * Evaluate takes a cursor, the index of the sample used by the previous
+ * evaluation, so evaluating at increasing times costs O(1) amortized.
+ */
+class Trajectory : public SimpleRefCount<Trajectory>
+{
+public:
+  Trajectory ();
+
+  /**
+   * \param samples number of samples to reserve space for.
+   */
+  void Reserve (uint32_t samples);
+
+  /**
+   * \param time time of the sample, not before the previous one.
+   * \param position position at that time.
+   *
+   * Appends a sample without velocity. All the samples of a trajectory
+   * must have a velocity or none.
+   */
+  void Add (Time time, const Vector &position);
+
+  /**
+   * \param time time of the sample, not before the previous one.
+   * \param position position at that time.
+   * \param velocity velocity at that time.
+   *
+   * Appends a sample with velocity. All the samples of a trajectory must
+   * have a velocity or none.
+   */
+  void Add (Time time, const Vector &position, const Vector &velocity);
+
+  /**
+   * \returns the number of samples.
+   */
+  uint32_t GetN (void) const;
+
+  /**
+   * \returns true if the samples have velocities.
+   */
+  bool HasVelocities (void) const;
+
+  /**
+   * \param i index of a sample.
+   * \returns its time.
+   */
+  Time GetTime (uint32_t i) const;
+
+  /**
+   * \param i index of a sample.
+   * \returns its position.
+   */
+  Vector GetPosition (uint32_t i) const;
+
+  /**
+   * \param time time in ns.
+   * \param cursor index of a sample to start the search from.
+   * \returns the index of the last sample at or before the time, or 0 if
+   *          the time is before the first sample.
+   */
+  uint32_t Find (int64_t time, uint32_t cursor) const;
+
+  /**
+   * \param time time in ns, relative to the trajectory.
+   * \param [in,out] cursor index of the sample used by the previous
+   *        evaluation, 0 at first, updated to the one used now.
+   * \param [out] position position at the time.
+   * \param [out] velocity velocity at the time.
+   *
+   * The trajectory must have at least a sample.
+   */
+  void Evaluate (int64_t time, uint32_t &cursor, Vector &position, Vector &velocity) const;
+
+private:
+  std::vector<int64_t> m_times;        //!< time of each sample, in ns
+  std::vector<Vector> m_positions;     //!< position of each sample
+  std::vector<Vector> m_velocities;    //!< velocity of each sample, empty if they have none
+};
+
+} // namespace ns3
+
+#endif /* TRAJECTORY_H */
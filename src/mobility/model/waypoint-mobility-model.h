@@ -130,6 +130,7 @@ public:
 
 private:
   friend class ::WaypointMobilityModelNotifyTest; // To allow Update() calls and access to m_current
+  friend class MobilityBatch; // To read the state without updating it
 
   /**
    * Update the underlying state corresponding to the stored waypoints
@@ -0,0 +1,208 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include "ns3/node-container.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/constant-velocity-mobility-model.h"
+#include "ns3/constant-acceleration-mobility-model.h"
+#include "ns3/waypoint-mobility-model.h"
+#include "ns3/gauss-markov-mobility-model.h"
+#include "ns3/mobility-batch.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Checks that the positions and velocities read in batch are those
+ * the models return, now and later.
+ */
+class MobilityBatchTest : public TestCase
+{
+public:
+  MobilityBatchTest ()
+    : TestCase ("Check the positions and velocities read by Mobility Batch")
+  {
+  }
+
+private:
+  /**
+   * \param actual value read in batch.
+   * \param expected value of the model.
+   * \param what name of the value.
+   * \param index index of the model.
+   * \param time time of the value, in s.
+   */
+  void CheckVector (Vector actual, Vector expected, std::string what, uint32_t index, double time)
+  {
+    double tol = 1e-9;
+    NS_TEST_EXPECT_MSG_EQ_TOL (actual.x, expected.x, tol, what << ".x of " << index << " at " << time << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (actual.y, expected.y, tol, what << ".y of " << index << " at " << time << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (actual.z, expected.z, tol, what << ".z of " << index << " at " << time << " s");
+  }
+
+  /**
+   * Reads the models in batch now and ahead, and checks the values now.
+   */
+  void Check (void)
+  {
+    uint32_t n = m_batch.GetN ();
+    double now = Simulator::Now ().GetSeconds ();
+    std::vector<Vector> positions (n);
+    std::vector<Vector> velocities (n);
+    m_batch.GetPositions (Simulator::Now (), &positions[0]);
+    m_batch.GetVelocities (Simulator::Now (), &velocities[0]);
+
+    // a range, and the helper
+    std::vector<Vector> range (n);
+    std::vector<Vector> rangeVelocities (n);
+    m_batch.Get (3, n - 2, Simulator::Now (), &range[0], &rangeVelocities[0]);
+    std::vector<Vector> helper (n);
+    MobilityHelper::GetPositions (m_nodes, Simulator::Now (), &helper[0]);
+
+    for (uint32_t i = 0; i < n; i++)
+      {
+        Ptr<MobilityModel> model = m_nodes.Get (i)->GetObject<MobilityModel> ();
+        Vector position = model->GetPosition ();
+        Vector velocity = model->GetVelocity ();
+        CheckVector (positions[i], position, "position", i, now);
+        CheckVector (velocities[i], velocity, "velocity", i, now);
+        CheckVector (helper[i], position, "helper position", i, now);
+        if (i >= 3 && i < n - 2)
+          {
+            CheckVector (range[i - 3], position, "range position", i, now);
+            CheckVector (rangeVelocities[i - 3], velocity, "range velocity", i, now);
+          }
+      }
+
+    // the models which follow a known course, checked when the time comes
+    m_batch.Get (0, m_predictable, Simulator::Now () + Seconds (2.5), &positions[0], &velocities[0]);
+    positions.resize (m_predictable);
+    velocities.resize (m_predictable);
+    Simulator::Schedule (Seconds (2.5), &MobilityBatchTest::CheckAhead, this, positions, velocities, now);
+  }
+
+  /**
+   * \param positions positions read in batch ahead of time.
+   * \param velocities velocities read in batch ahead of time.
+   * \param then time they were read, in s.
+   */
+  void CheckAhead (std::vector<Vector> positions, std::vector<Vector> velocities, double then)
+  {
+    double now = Simulator::Now ().GetSeconds ();
+    for (uint32_t i = 0; i < positions.size (); i++)
+      {
+        Ptr<MobilityModel> model = m_nodes.Get (i)->GetObject<MobilityModel> ();
+        CheckVector (positions[i], model->GetPosition (), "position read at " + std::to_string (then) + " s", i, now);
+        CheckVector (velocities[i], model->GetVelocity (), "velocity read at " + std::to_string (then) + " s", i, now);
+      }
+  }
+
+  virtual void DoRun (void)
+  {
+    // models whose course is known ahead first
+    m_nodes.Create (12);
+    Ptr<ConstantPositionMobilityModel> still = CreateObject<ConstantPositionMobilityModel> ();
+    still->SetPosition (Vector (1, 2, 3));
+    m_nodes.Get (0)->AggregateObject (still);
+
+    Ptr<ConstantVelocityMobilityModel> moving = CreateObject<ConstantVelocityMobilityModel> ();
+    moving->SetPosition (Vector (10, 0, 0));
+    moving->SetVelocity (Vector (1.5, -2, 0.25));
+    m_nodes.Get (1)->AggregateObject (moving);
+
+    Ptr<ConstantVelocityMobilityModel> placed = CreateObject<ConstantVelocityMobilityModel> ();
+    placed->SetPosition (Vector (-4, 5, 0));
+    m_nodes.Get (2)->AggregateObject (placed);
+
+    Ptr<ConstantAccelerationMobilityModel> accelerated = CreateObject<ConstantAccelerationMobilityModel> ();
+    accelerated->SetPosition (Vector (0, 0, 1));
+    accelerated->SetVelocityAndAcceleration (Vector (3, 0, 0), Vector (-0.2, 0.1, 0));
+    m_nodes.Get (3)->AggregateObject (accelerated);
+
+    for (uint32_t i = 4; i < 8; i++)
+      {
+        // legs of different lengths, a pause, and the end; lazy or not
+        Ptr<WaypointMobilityModel> waypoints = CreateObject<WaypointMobilityModel> ();
+        waypoints->SetAttribute ("LazyNotify", BooleanValue (i % 2 == 0));
+        waypoints->AddWaypoint (Waypoint (Seconds (i - 3), Vector (i, 0, 0)));
+        waypoints->AddWaypoint (Waypoint (Seconds (i), Vector (i, 10, 0)));
+        waypoints->AddWaypoint (Waypoint (Seconds (i + 1.5), Vector (i + 4, 10, 2)));
+        waypoints->AddWaypoint (Waypoint (Seconds (i + 3), Vector (i + 4, 10, 2)));
+        waypoints->AddWaypoint (Waypoint (Seconds (i + 7), Vector (0, 0, 0)));
+        m_nodes.Get (i)->AggregateObject (waypoints);
+      }
+    m_predictable = 8;
+
+    // models which change their course, and the other models
+    Ptr<ConstantVelocityMobilityModel> turning = CreateObject<ConstantVelocityMobilityModel> ();
+    turning->SetPosition (Vector (0, 0, 0));
+    turning->SetVelocity (Vector (1, 1, 0));
+    Simulator::Schedule (Seconds (3.3), &ConstantVelocityMobilityModel::SetVelocity, turning, Vector (-2, 0, 0));
+    m_nodes.Get (8)->AggregateObject (turning);
+
+    Ptr<WaypointMobilityModel> moved = CreateObject<WaypointMobilityModel> ();
+    moved->AddWaypoint (Waypoint (Seconds (1), Vector (0, 0, 0)));
+    moved->AddWaypoint (Waypoint (Seconds (5), Vector (8, 0, 0)));
+    Simulator::Schedule (Seconds (2.2), &MobilityModel::SetPosition, moved, Vector (1, 1, 1));
+    m_nodes.Get (9)->AggregateObject (moved);
+
+    for (uint32_t i = 10; i < 12; i++)
+      {
+        Ptr<GaussMarkovMobilityModel> random = CreateObject<GaussMarkovMobilityModel> ();
+        random->SetPosition (Vector (0, 0, 50));
+        m_nodes.Get (i)->AggregateObject (random);
+      }
+
+    m_batch.Add (m_nodes);
+    NS_TEST_ASSERT_MSG_EQ (m_batch.GetN (), m_nodes.GetN (), "Models in the batch");
+    for (double t = 0; t < 14; t += 0.45)
+      {
+        Simulator::Schedule (Seconds (t), &MobilityBatchTest::Check, this);
+      }
+    Simulator::Stop (Seconds (17));
+    Simulator::Run ();
+    Simulator::Destroy ();
+  }
+
+  NodeContainer m_nodes;        //!< nodes of the models
+  MobilityBatch m_batch;        //!< batch under test
+  uint32_t m_predictable;       //!< models from the first whose course is known ahead
+};
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Mobility Batch Test Suite
+ */
+static struct MobilityBatchTestSuite : public TestSuite
+{
+  MobilityBatchTestSuite () : TestSuite ("mobility-batch", UNIT)
+  {
+    AddTestCase (new MobilityBatchTest, TestCase::QUICK);
+  }
+} g_mobilityBatchTestSuite; ///< the test suite
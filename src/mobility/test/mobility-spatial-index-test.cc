@@ -0,0 +1,387 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/enum.h"
+#include "ns3/string.h"
+#include "ns3/node-container.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/constant-velocity-mobility-model.h"
+#include "ns3/constant-acceleration-mobility-model.h"
+#include "ns3/trajectory-mobility-model.h"
+#include "ns3/random-walk-2d-mobility-model.h"
+#include "ns3/gauss-markov-mobility-model.h"
+#include "ns3/mobility-spatial-index.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Checks the range and nearest node queries of the spatial index
+ * against a search through all the nodes, while the nodes move, change
+ * their course and are removed.
+ */
+class MobilitySpatialIndexTest : public TestCase
+{
+public:
+  MobilitySpatialIndexTest ()
+    : TestCase ("Check the queries of Mobility Spatial Index against all the nodes"),
+      m_seed (12345)
+  {
+  }
+
+private:
+  /**
+   * \returns a pseudo random number in [0, 1), the same on every run.
+   */
+  double Random (void)
+  {
+    m_seed = m_seed * 1103515245 + 12345;
+    return ((m_seed >> 16) & 0x7fff) / 32768.0;
+  }
+
+  /**
+   * \param node a node.
+   * \param time time in s, not before now.
+   * \returns the position of the node at the time, at its current velocity.
+   */
+  Vector GetPosition (Ptr<Node> node, double time)
+  {
+    Ptr<MobilityModel> model = node->GetObject<MobilityModel> ();
+    Vector p = model->GetPosition ();
+    Vector v = model->GetVelocity ();
+    double dt = time - Simulator::Now ().GetSeconds ();
+    return Vector (p.x + v.x * dt, p.y + v.y * dt, p.z + v.z * dt);
+  }
+
+  /**
+   * \param time time of the queries in s, not before now.
+   *
+   * Compares the queries around a few points with all the nodes.
+   */
+  void Check (double time)
+  {
+    double now = Simulator::Now ().GetSeconds ();
+    NS_TEST_EXPECT_MSG_LT_OR_EQ (m_index->GetNCells (), m_index->GetN (), "Empty cells kept at " << now << " s");
+    const double radii[] = {30, 120, 5000};
+    const uint32_t ks[] = {1, 7, 1000};
+    for (uint32_t c = 0; c < 6; c++)
+      {
+        Vector center (Random () * 1200 - 100, Random () * 1200 - 100, 0);
+
+        // distance and ID of the nodes still indexed
+        std::vector<std::pair<double, uint32_t> > all;
+        for (uint32_t i = 0; i < m_nodes.GetN (); i++)
+          {
+            if (m_removed[i])
+              {
+                continue;
+              }
+            Vector p = GetPosition (m_nodes.Get (i), time);
+            all.push_back (std::make_pair (CalculateDistance (p, center), m_nodes.Get (i)->GetId ()));
+          }
+        std::sort (all.begin (), all.end ());
+
+        std::vector<uint32_t> found;
+        for (uint32_t r = 0; r < 3; r++)
+          {
+            std::vector<uint32_t> expected;
+            for (uint32_t i = 0; i < all.size () && all[i].first <= radii[r]; i++)
+              {
+                expected.push_back (all[i].second);
+              }
+            std::sort (expected.begin (), expected.end ());
+            m_index->GetNodesInRange (center, radii[r], Seconds (time), found);
+            std::sort (found.begin (), found.end ());
+            NS_TEST_EXPECT_MSG_EQ ((found == expected), true,
+                                   "Nodes within " << radii[r] << " m of " << center << " at " << time
+                                   << " s, queried at " << now << " s: " << found.size ()
+                                   << " found, " << expected.size () << " expected");
+          }
+
+        for (uint32_t n = 0; n < 3; n++)
+          {
+            m_index->GetNearestNodes (center, ks[n], Seconds (time), found);
+            uint32_t k = std::min<uint32_t> (ks[n], all.size ());
+            NS_TEST_ASSERT_MSG_EQ (found.size (), k, "Number of nearest nodes");
+            for (uint32_t i = 0; i < k; i++)
+              {
+                NS_TEST_EXPECT_MSG_EQ (found[i], all[i].second,
+                                       "Node " << i << " of the " << ks[n] << " nearest to " << center
+                                       << " at " << time << " s, queried at " << now << " s");
+              }
+          }
+      }
+  }
+
+  /**
+   * \param time time of the check in s.
+   * \param ahead how far ahead of it the queries look, in s.
+   */
+  void ScheduleCheck (double time, double ahead)
+  {
+    Simulator::Schedule (Seconds (time), &MobilitySpatialIndexTest::Check, this, time + ahead);
+  }
+
+  /**
+   * \param index index of the node in m_nodes.
+   */
+  void Remove (uint32_t index)
+  {
+    m_index->Remove (m_nodes.Get (index));
+    m_removed[index] = true;
+  }
+
+  virtual void DoRun (void)
+  {
+    m_nodes.Create (300);
+    m_removed.assign (m_nodes.GetN (), false);
+    for (uint32_t i = 0; i < m_nodes.GetN (); i++)
+      {
+        Vector position (Random () * 1000, Random () * 1000, Random () * 10);
+        Vector velocity ((Random () - 0.5) * 40, (Random () - 0.5) * 40, 0);
+        Ptr<MobilityModel> model;
+        if (i % 10 == 0)
+          {
+            // still
+            model = CreateObject<ConstantPositionMobilityModel> ();
+            model->SetPosition (position);
+          }
+        else if (i % 10 == 1)
+          {
+            // speeds up without notifying it
+            Ptr<ConstantAccelerationMobilityModel> accelerated = CreateObject<ConstantAccelerationMobilityModel> ();
+            accelerated->SetPosition (position);
+            accelerated->SetVelocityAndAcceleration (velocity, Vector (velocity.y / 10, -velocity.x / 10, 0));
+            model = accelerated;
+          }
+        else if (i % 10 == 2)
+          {
+            // turns around every 4 s without notifying it
+            Ptr<Trajectory> trajectory = Create<Trajectory> ();
+            for (uint32_t j = 0; j < 6; j++)
+              {
+                trajectory->Add (Seconds (4 * j), position);
+                position = Vector (position.x + velocity.x * 4 * (j % 2 ? -1 : 1),
+                                   position.y + velocity.y * 4, position.z);
+              }
+            Ptr<TrajectoryMobilityModel> sampled = CreateObject<TrajectoryMobilityModel> ();
+            sampled->SetTrajectory (trajectory, Seconds (0));
+            model = sampled;
+          }
+        else
+          {
+            Ptr<ConstantVelocityMobilityModel> moving = CreateObject<ConstantVelocityMobilityModel> ();
+            moving->SetPosition (position);
+            moving->SetVelocity (velocity);
+            model = moving;
+            // course changes, some of them jumps
+            for (double t = Random () * 3; t < 20; t += Random () * 3)
+              {
+                Vector next ((Random () - 0.5) * 60, (Random () - 0.5) * 60, 0);
+                Simulator::Schedule (Seconds (t), &ConstantVelocityMobilityModel::SetVelocity, moving, next);
+                if (Random () < 0.1)
+                  {
+                    Vector jump (Random () * 1000, Random () * 1000, 0);
+                    Simulator::Schedule (Seconds (t), &MobilityModel::SetPosition, moving, jump);
+                  }
+              }
+          }
+        m_nodes.Get (i)->AggregateObject (model);
+      }
+
+    m_index = CreateObject<MobilitySpatialIndex> ();
+    m_index->SetAttribute ("CellSize", DoubleValue (50));
+    m_index->SetAttribute ("Staleness", TimeValue (Seconds (2)));
+    m_index->SetAttribute ("MaxSpeed", DoubleValue (60));
+    m_index->Install (m_nodes);
+    NS_TEST_ASSERT_MSG_EQ (m_index->GetN (), m_nodes.GetN (), "Nodes indexed");
+
+    const double times[] = {0, 0.5, 1.7, 2.05, 3.1, 5.5, 7.9, 12.25, 16, 19.5};
+    for (uint32_t i = 0; i < sizeof (times) / sizeof (times[0]); i++)
+      {
+        ScheduleCheck (times[i], 0);
+        ScheduleCheck (times[i], 1.5);
+      }
+    for (uint32_t i = 3; i < m_nodes.GetN (); i += 7)
+      {
+        Simulator::Schedule (Seconds (6 + i / 100.0), &MobilitySpatialIndexTest::Remove, this, i);
+      }
+    Simulator::Stop (Seconds (20));
+    Simulator::Run ();
+    NS_TEST_EXPECT_MSG_EQ (m_index->GetN (), m_nodes.GetN () - 43, "Nodes left");
+    m_index->Dispose ();
+    Simulator::Destroy ();
+  }
+
+  NodeContainer m_nodes;                  //!< indexed nodes
+  std::vector<bool> m_removed;            //!< nodes removed from the index
+  Ptr<MobilitySpatialIndex> m_index;      //!< index under test
+  uint32_t m_seed;                        //!< state of Random
+};
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Checks the queries of the spatial index on lazy models, which
+ * notify their course changes while the queries poll them.
+ */
+class MobilitySpatialIndexLazyTest : public TestCase
+{
+public:
+  MobilitySpatialIndexLazyTest ()
+    : TestCase ("Check the queries of Mobility Spatial Index on lazy mobility models")
+  {
+  }
+
+private:
+  /**
+   * Queries around a few points first, so that the lazy models catch up
+   * in the queries, then compares with all the nodes.
+   */
+  void Check (void)
+  {
+    double now = Simulator::Now ().GetSeconds ();
+    const Vector centers[] = {Vector (250, 250, 0), Vector (60, 420, 0), Vector (400, 100, 0)};
+    const uint32_t nCenters = sizeof (centers) / sizeof (centers[0]);
+    const double radius = 120;
+    const uint32_t k = 15;
+
+    std::vector<std::vector<uint32_t> > inRange (nCenters);
+    std::vector<std::vector<uint32_t> > nearest (nCenters);
+    for (uint32_t c = 0; c < nCenters; c++)
+      {
+        if (c % 2)
+          {
+            m_index->GetNearestNodes (centers[c], k, nearest[c]);
+            m_index->GetNodesInRange (centers[c], radius, inRange[c]);
+          }
+        else
+          {
+            m_index->GetNodesInRange (centers[c], radius, inRange[c]);
+            m_index->GetNearestNodes (centers[c], k, nearest[c]);
+          }
+      }
+    NS_TEST_EXPECT_MSG_LT_OR_EQ (m_index->GetNCells (), m_index->GetN (), "Empty cells kept at " << now << " s");
+
+    for (uint32_t c = 0; c < nCenters; c++)
+      {
+        std::vector<std::pair<double, uint32_t> > all;
+        for (uint32_t i = 0; i < m_nodes.GetN (); i++)
+          {
+            Vector p = m_nodes.Get (i)->GetObject<MobilityModel> ()->GetPosition ();
+            all.push_back (std::make_pair (CalculateDistance (p, centers[c]), m_nodes.Get (i)->GetId ()));
+          }
+        std::sort (all.begin (), all.end ());
+
+        std::vector<uint32_t> expected;
+        for (uint32_t i = 0; i < all.size () && all[i].first <= radius; i++)
+          {
+            expected.push_back (all[i].second);
+          }
+        std::sort (expected.begin (), expected.end ());
+        std::sort (inRange[c].begin (), inRange[c].end ());
+        NS_TEST_EXPECT_MSG_EQ ((inRange[c] == expected), true,
+                               "Nodes within " << radius << " m of " << centers[c] << " at " << now
+                               << " s: " << inRange[c].size () << " found, " << expected.size () << " expected");
+
+        NS_TEST_ASSERT_MSG_EQ (nearest[c].size (), k, "Number of nearest nodes");
+        for (uint32_t i = 0; i < k; i++)
+          {
+            NS_TEST_EXPECT_MSG_EQ (nearest[c][i], all[i].second,
+                                   "Node " << i << " nearest to " << centers[c] << " at " << now << " s");
+          }
+      }
+  }
+
+  virtual void DoRun (void)
+  {
+    m_nodes.Create (200);
+    for (uint32_t i = 0; i < m_nodes.GetN (); i++)
+      {
+        Ptr<MobilityModel> model;
+        if (i % 2)
+          {
+            model = CreateObject<RandomWalk2dMobilityModel> ();
+            model->SetAttribute ("Bounds", RectangleValue (Rectangle (0, 500, 0, 500)));
+            model->SetAttribute ("Mode", EnumValue (RandomWalk2dMobilityModel::MODE_TIME));
+            model->SetAttribute ("Time", TimeValue (Seconds (1)));
+            model->SetAttribute ("Speed", StringValue ("ns3::UniformRandomVariable[Min=10.0|Max=30.0]"));
+          }
+        else
+          {
+            model = CreateObject<GaussMarkovMobilityModel> ();
+            model->SetAttribute ("Bounds", BoxValue (Box (0, 500, 0, 500, 0, 0)));
+            model->SetAttribute ("TimeStep", TimeValue (Seconds (0.5)));
+            model->SetAttribute ("Alpha", DoubleValue (0.85));
+            model->SetAttribute ("MeanVelocity", StringValue ("ns3::UniformRandomVariable[Min=10.0|Max=30.0]"));
+          }
+        model->SetAttribute ("Lazy", BooleanValue (true));
+        model->SetPosition (Vector (i * 2.5, (i * 137) % 500, 0));
+        m_nodes.Get (i)->AggregateObject (model);
+      }
+
+    // small cells, for the course changes to move the nodes to other cells,
+    // and no refresh, for the queries to be the first to poll the models
+    m_index = CreateObject<MobilitySpatialIndex> ();
+    m_index->SetAttribute ("CellSize", DoubleValue (10));
+    m_index->SetAttribute ("Staleness", TimeValue (Seconds (100)));
+    m_index->SetAttribute ("MaxSpeed", DoubleValue (100));
+    m_index->Install (m_nodes);
+
+    // just after the steps of the models
+    const double times[] = {0.1, 0.6, 1.05, 2.01, 3.5, 4.75, 6.2, 8.0};
+    for (uint32_t i = 0; i < sizeof (times) / sizeof (times[0]); i++)
+      {
+        Simulator::Schedule (Seconds (times[i]), &MobilitySpatialIndexLazyTest::Check, this);
+      }
+    Simulator::Stop (Seconds (10));
+    Simulator::Run ();
+    m_index->Dispose ();
+    Simulator::Destroy ();
+  }
+
+  NodeContainer m_nodes;                  //!< indexed nodes
+  Ptr<MobilitySpatialIndex> m_index;      //!< index under test
+};
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Mobility Spatial Index Test Suite
+ */
+static struct MobilitySpatialIndexTestSuite : public TestSuite
+{
+  MobilitySpatialIndexTestSuite () : TestSuite ("mobility-spatial-index", UNIT)
+  {
+    AddTestCase (new MobilitySpatialIndexTest, TestCase::QUICK);
+    AddTestCase (new MobilitySpatialIndexLazyTest, TestCase::QUICK);
+  }
+} g_mobilitySpatialIndexTestSuite; ///< the test suite
@@ -0,0 +1,170 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <fstream>
+#include <sstream>
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/double.h"
+#include "ns3/pointer.h"
+#include "ns3/node-container.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/position-allocator.h"
+#include "ns3/mobility-model.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/mobility-trace-recorder.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Checks that a MobilityTraceRecorder file decodes to the text of
+ * MobilityHelper::EnableAscii, and is smaller.
+ */
+class MobilityTraceRecorderTest : public TestCase
+{
+public:
+  MobilityTraceRecorderTest ()
+    : TestCase ("Check that recorded course changes decode to the ascii trace")
+  {
+  }
+
+private:
+  virtual void DoRun (void)
+  {
+    NodeContainer nodes;
+    nodes.Create (20);
+    MobilityHelper mobility;
+    Ptr<PositionAllocator> positions = CreateObjectWithAttributes<RandomRectanglePositionAllocator>
+        ("X", StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=1500.0]"),
+        "Y", StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=300.0]"));
+    mobility.SetPositionAllocator (positions);
+    mobility.SetMobilityModel ("ns3::RandomWaypointMobilityModel",
+                               "Speed", StringValue ("ns3::UniformRandomVariable[Min=1.0|Max=20.0]"),
+                               "Pause", StringValue ("ns3::ConstantRandomVariable[Constant=2.0]"),
+                               "PositionAllocator", PointerValue (positions));
+    mobility.Install (NodeContainer (nodes.Get (0), nodes.Get (1), nodes.Get (2), nodes.Get (3)));
+    for (uint32_t i = 4; i < 16; i++)
+      {
+        mobility.Install (nodes.Get (i));
+      }
+    mobility.SetMobilityModel ("ns3::GaussMarkovMobilityModel",
+                               "TimeStep", TimeValue (Seconds (0.7)));
+    for (uint32_t i = 16; i < 20; i++)
+      {
+        mobility.Install (nodes.Get (i));
+      }
+    Ptr<MobilityModel> jumping = nodes.Get (5)->GetObject<MobilityModel> ();
+    Simulator::Schedule (Seconds (31.3), &MobilityModel::SetPosition, jumping, Vector (-7.25, 1e-5, 3));
+
+    std::ostringstream ascii;
+    MobilityHelper::EnableAsciiAll (Create<OutputStreamWrapper> (&ascii));
+
+    // small chunks in a ring of two, so the simulation waits for the writer
+    std::string filename = CreateTempDirFilename ("mobility-trace-recorder.evc");
+    MobilityTraceRecorder recorder;
+    recorder.SetChunkSize (7);
+    recorder.SetMaxChunks (2);
+    NS_TEST_ASSERT_MSG_EQ (recorder.Open (filename), true, "Open " << filename);
+    recorder.InstallAll ();
+
+    Simulator::Stop (Seconds (300));
+    Simulator::Run ();
+    NS_TEST_ASSERT_MSG_EQ (recorder.Close (), true, "Close " << filename);
+    Simulator::Destroy ();
+
+    std::ostringstream decoded;
+    NS_TEST_ASSERT_MSG_EQ (MobilityTraceRecorder::Decode (filename, decoded), true, "Decode " << filename);
+    std::string text = ascii.str ();
+    NS_TEST_EXPECT_MSG_GT (text.size (), 100000, "Course changes in the ascii trace");
+    NS_TEST_EXPECT_MSG_EQ ((decoded.str () == text), true, "Decoded record differs from the ascii trace");
+
+    std::ifstream file (filename.c_str (), std::ios::binary | std::ios::ate);
+    uint64_t size = file.tellg ();
+    NS_TEST_EXPECT_MSG_LT (size * 4, text.size (), "Record of " << size << " bytes for " << text.size () << " bytes of text");
+  }
+};
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Checks that Decode rejects files which are not complete records.
+ */
+class MobilityTraceRecorderInvalidTest : public TestCase
+{
+public:
+  MobilityTraceRecorderInvalidTest ()
+    : TestCase ("Check that Decode rejects invalid records")
+  {
+  }
+
+private:
+  virtual void DoRun (void)
+  {
+    std::ostringstream os;
+    std::string text = CreateTempDirFilename ("not-a-record.txt");
+    std::ofstream (text.c_str ()) << "now=+0.0ns node=0 pos=0.000:0.000:0.000 vel=0.000:0.000:0.000\n";
+    NS_TEST_EXPECT_MSG_EQ (MobilityTraceRecorder::Decode (text, os), false, "Text file decoded");
+    NS_TEST_EXPECT_MSG_EQ (MobilityTraceRecorder::Decode (CreateTempDirFilename ("missing.evc"), os), false, "Missing file decoded");
+
+    NodeContainer nodes;
+    nodes.Create (1);
+    MobilityHelper mobility;
+    mobility.SetMobilityModel ("ns3::ConstantVelocityMobilityModel");
+    mobility.Install (nodes);
+    std::string filename = CreateTempDirFilename ("truncated.evc");
+    {
+      MobilityTraceRecorder recorder;
+      recorder.Open (filename);
+      recorder.Install (nodes);
+      Ptr<MobilityModel> model = nodes.Get (0)->GetObject<MobilityModel> ();
+      for (uint32_t i = 0; i < 10; i++)
+        {
+          model->SetPosition (Vector (i * 1.5, 2, 0));
+        }
+      Simulator::Destroy ();
+    }
+    NS_TEST_EXPECT_MSG_EQ (MobilityTraceRecorder::Decode (filename, os), true, "Complete record");
+    std::ifstream file (filename.c_str (), std::ios::binary);
+    std::string record ((std::istreambuf_iterator<char> (file)), std::istreambuf_iterator<char> ());
+    std::ofstream (filename.c_str (), std::ios::binary | std::ios::trunc) << record.substr (0, record.size () - 3);
+    NS_TEST_EXPECT_MSG_EQ (MobilityTraceRecorder::Decode (filename, os), false, "Truncated record decoded");
+  }
+};
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Mobility Trace Recorder Test Suite
+ */
+static struct MobilityTraceRecorderTestSuite : public TestSuite
+{
+  MobilityTraceRecorderTestSuite () : TestSuite ("mobility-trace-recorder", UNIT)
+  {
+    AddTestCase (new MobilityTraceRecorderTest, TestCase::QUICK);
+    AddTestCase (new MobilityTraceRecorderInvalidTest, TestCase::QUICK);
+  }
+} g_mobilityTraceRecorderTestSuite; ///< the test suite
@@ -48,6 +48,7 @@
 #include "ns3/names.h"
 #include "ns3/config.h"
 #include "ns3/ns2-mobility-helper.h"
+#include "ns3/compiled-mobility-trace-helper.h"
 
 using namespace ns3;
 
@@ -126,6 +127,9 @@ public:
     : TestCase (name),
       m_timeLimit (timeLimit),
       m_nodeCount (nodes),
+      m_startTime (Seconds (0)),
+      m_lookAhead (Seconds (0)),
+      m_compiled (false),
       m_nextRefPoint (0)
   {
   }
@@ -138,6 +142,32 @@ public:
   {
     m_trace = trace;
   }
+  /// Set the time the trace is resumed at
+  void SetStartTime (Time start)
+  {
+    m_startTime = start;
+  }
+  /// Copy of this test case reading the trace as the simulation advances
+  Ns2MobilityHelperTest * Streaming (Time lookAhead) const
+  {
+    Ns2MobilityHelperTest * t = new Ns2MobilityHelperTest (GetName () + " (streaming)", m_timeLimit, m_nodeCount);
+    t->m_startTime = m_startTime;
+    t->m_lookAhead = lookAhead;
+    t->m_trace = m_trace;
+    t->m_reference = m_reference;
+    return t;
+  }
+  /// Copy of this test case replaying the trace compiled with CompiledMobilityTraceWriter
+  Ns2MobilityHelperTest * Compiled (Time lookAhead) const
+  {
+    Ns2MobilityHelperTest * t = new Ns2MobilityHelperTest (GetName () + " (compiled)", m_timeLimit, m_nodeCount);
+    t->m_startTime = m_startTime;
+    t->m_lookAhead = lookAhead;
+    t->m_compiled = true;
+    t->m_trace = m_trace;
+    t->m_reference = m_reference;
+    return t;
+  }
   /// Add next reference point
   void AddReferencePoint (ReferencePoint const & r)
   {
@@ -154,6 +184,12 @@ private:
   Time m_timeLimit;
   /// Number of nodes used in the test
   uint32_t m_nodeCount;
+  /// Time the trace is resumed at
+  Time m_startTime;
+  /// Look-ahead of the streaming mode or of the compiled trace, 0 to read the whole trace at install
+  Time m_lookAhead;
+  /// Replay the compiled trace
+  bool m_compiled;
   /// Trace as string
   std::string m_trace;
   /// Reference mobility
@@ -174,6 +210,23 @@ private:
     of.close ();
     return false; // no errors
   }
+  /// Compile the trace in a simulation of its own, and create the nodes again
+  bool CompileTrace ()
+  {
+    std::string compiledFile = CreateTempDirFilename ("Ns2MobilityHelperTest.mob");
+    Ns2MobilityHelper mobility (m_traceFile);
+    mobility.Install ();
+    CompiledMobilityTraceWriter writer;
+    writer.SetIndexStride (2);
+    writer.InstallAll ();
+    Simulator::Run ();
+    NS_TEST_ASSERT_MSG_EQ_RETURNS_BOOL (writer.Write (compiledFile), true, "Need to write compiled trace");
+    Names::Clear ();
+    Simulator::Destroy ();
+    CreateNodes ();
+    m_traceFile = compiledFile;
+    return false; // no errors
+  }
   /// Create and name nodes
   void CreateNodes ()
   {
@@ -253,8 +306,27 @@ private:
       {
         return;
       }
-    Ns2MobilityHelper mobility (m_traceFile);
-    mobility.Install ();
+    if (m_compiled)
+      {
+        if (CompileTrace ())
+          {
+            return;
+          }
+        CompiledMobilityTraceHelper mobility (m_traceFile);
+        mobility.SetStartTime (m_startTime);
+        mobility.SetLookAhead (m_lookAhead);
+        mobility.Install ();
+      }
+    else
+      {
+        Ns2MobilityHelper mobility (m_traceFile);
+        mobility.SetStartTime (m_startTime);
+        if (m_lookAhead.IsStrictlyPositive ())
+          {
+            mobility.EnableStreaming (m_lookAhead);
+          }
+        mobility.Install ();
+      }
     if (CheckInitialPositions ())
       {
         return;
@@ -266,6 +338,85 @@ private:
   }
 };
 
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Checks the nodes, time span and bounding box reported for a trace,
+ * and for the same trace compiled.
+ */
+class Ns2MobilityHelperTraceInfoTest : public TestCase
+{
+public:
+  Ns2MobilityHelperTraceInfoTest ()
+    : TestCase ("trace info")
+  {
+  }
+
+private:
+  /// Check the reported trace info
+  void CheckInfo (MobilityTraceInfo const & info, std::string const & label)
+  {
+    NS_TEST_ASSERT_MSG_EQ (info.nodeIds.size (), 2, label << ": node IDs");
+    NS_TEST_EXPECT_MSG_EQ (info.nodeIds[0], 0, label << ": first node ID");
+    NS_TEST_EXPECT_MSG_EQ (info.nodeIds[1], 2, label << ": second node ID");
+    NS_TEST_EXPECT_MSG_EQ (info.start, Seconds (1), label << ": start time");
+    NS_TEST_EXPECT_MSG_EQ (info.stop, Seconds (20), label << ": stop time");
+    double tol = 0.001;
+    NS_TEST_EXPECT_MSG_EQ_TOL (info.bounds.xMin, 10, tol, label << ": bounds");
+    NS_TEST_EXPECT_MSG_EQ_TOL (info.bounds.xMax, 150, tol, label << ": bounds");
+    NS_TEST_EXPECT_MSG_EQ_TOL (info.bounds.yMin, -50, tol, label << ": bounds");
+    NS_TEST_EXPECT_MSG_EQ_TOL (info.bounds.yMax, 60, tol, label << ": bounds");
+    NS_TEST_EXPECT_MSG_EQ_TOL (info.bounds.zMin, 0, tol, label << ": bounds");
+    NS_TEST_EXPECT_MSG_EQ_TOL (info.bounds.zMax, 5, tol, label << ": bounds");
+  }
+
+  void DoRun ()
+  {
+    const char *initial = "$node_(0) set X_ 10.0\n"
+                          "$node_(0) set Y_ 20.0\n"
+                          "$node_(2) set X_ 100.0\n"
+                          "$node_(2) set Y_ 0.0\n"
+                          "$node_(2) set Z_ 5.0\n";
+    const char *commands = "$ns_ at 1.0 \"$node_(0) setdest 40.0 60.0 5.0\"\n"          // arrives at 11 s
+                           "$ns_ at 3.0 \"$node_(2) setdest 100.0 -50.0 200.0\"\n"
+                           "$ns_ at 3.1 \"$node_(2) setdest 100.0 -50.0 10.0\"\n"    // interrupts the previous one
+                           "$ns_ at 20.0 \"$node_(2) set X_ 150.0\"\n";
+
+    // the initial positions may also be at the end of the trace
+    std::string endFile = CreateTempDirFilename ("Ns2MobilityHelperTraceInfoTestEnd.tcl");
+    std::ofstream of (endFile.c_str ());
+    NS_TEST_ASSERT_MSG_EQ (of.is_open (), true, "Need to write tmp. file");
+    of << commands << initial;
+    of.close ();
+    CheckInfo (Ns2MobilityHelper (endFile).GetTraceInfo (), "initial positions at the end");
+
+    std::string traceFile = CreateTempDirFilename ("Ns2MobilityHelperTraceInfoTest.tcl");
+    of.open (traceFile.c_str ());
+    NS_TEST_ASSERT_MSG_EQ (of.is_open (), true, "Need to write tmp. file");
+    of << initial << commands;
+    of.close ();
+
+    Ns2MobilityHelper mobility (traceFile);
+    MobilityTraceInfo info = mobility.GetTraceInfo ();
+    CheckInfo (info, "ns-2 trace");
+
+    NodeContainer nodes = info.CreateNodes ();
+    NS_TEST_EXPECT_MSG_EQ (nodes.GetN (), 2, "Nodes of the trace");
+    NS_TEST_EXPECT_MSG_EQ (NodeList::GetNNodes (), 3, "Nodes up to the highest ID");
+    NS_TEST_EXPECT_MSG_EQ (nodes.Get (1)->GetId (), 2, "ID of the second node");
+
+    std::string compiledFile = CreateTempDirFilename ("Ns2MobilityHelperTraceInfoTest.mob");
+    mobility.Install ();
+    CompiledMobilityTraceWriter writer;
+    writer.Install (nodes);
+    Simulator::Run ();
+    NS_TEST_ASSERT_MSG_EQ (writer.Write (compiledFile), true, "Need to write compiled trace");
+    Simulator::Destroy ();
+    CheckInfo (CompiledMobilityTraceHelper (compiledFile).GetTraceInfo (), "compiled trace");
+  }
+};
+
 /**
  * \ingroup mobility-test
  * \ingroup tests
@@ -290,7 +441,7 @@ public:
                  "$node_(0) set Z_ 3.0\n"
                  );
     t->AddReferencePoint ("0", 0, Vector (1, 2, 3), Vector (0, 0, 0));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
 
     // Check parsing comments, empty lines and no EOF at the end of file
     t = new Ns2MobilityHelperTest ("comments", Seconds (1));
@@ -302,7 +453,7 @@ public:
                  "#$node_(0) set Z_ 100 #"
                  );
     t->AddReferencePoint ("0", 0, Vector (1, 2, 3), Vector (0, 0, 0));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
 
     // Simple setdest. Arguments are interpreted as x, y, speed by default
     t = new Ns2MobilityHelperTest ("simple setdest", Seconds (10));
@@ -311,7 +462,7 @@ public:
     t->AddReferencePoint ("0", 0, Vector (0, 0, 0), Vector (0, 0, 0));
     t->AddReferencePoint ("0", 1, Vector (0, 0, 0), Vector (5, 0, 0));
     t->AddReferencePoint ("0", 6, Vector (25, 0, 0), Vector (0, 0, 0));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
 
     // Several set and setdest. Arguments are interpreted as x, y, speed by default
     t = new Ns2MobilityHelperTest ("square setdest", Seconds (6));
@@ -332,7 +483,7 @@ public:
     t->AddReferencePoint ("0", 4, Vector (0, 5, 0), Vector (0, 0, 0));
     t->AddReferencePoint ("0", 4, Vector (0, 5, 0), Vector (0, -5, 0));
     t->AddReferencePoint ("0", 5, Vector (0, 0, 0), Vector (0,  0, 0));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
 
     // Copy of previous test case but with the initial positions at
     // the end of the trace rather than at the beginning.
@@ -356,7 +507,7 @@ public:
     t->AddReferencePoint ("0", 4, Vector (10, 15, 0), Vector (0, 0, 0));
     t->AddReferencePoint ("0", 4, Vector (10, 15, 0), Vector (0, -5, 0));
     t->AddReferencePoint ("0", 5, Vector (10, 10, 0), Vector (0,  0, 0));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
 
     // Scheduled set position
     t = new Ns2MobilityHelperTest ("scheduled set position", Seconds (2));
@@ -367,7 +518,7 @@ public:
     t->AddReferencePoint ("0", 1, Vector (10, 0, 0), Vector (0, 0, 0));
     t->AddReferencePoint ("0", 1, Vector (10, 0, 10), Vector (0, 0, 0));
     t->AddReferencePoint ("0", 1, Vector (10, 10, 10), Vector (0, 0, 0));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
 
     // Malformed lines
     t = new Ns2MobilityHelperTest ("malformed lines", Seconds (2));
@@ -383,7 +534,7 @@ public:
     t->AddReferencePoint ("0", 0, Vector (1, 2, 3), Vector (0, 0, 0));
     t->AddReferencePoint ("0", 1, Vector (1, 2, 3), Vector (1, 0, 0));
     t->AddReferencePoint ("0", 2, Vector (2, 2, 3), Vector (0, 0, 0));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
 
     // Non possible values
     t = new Ns2MobilityHelperTest ("non possible values", Seconds (2));
@@ -403,7 +554,7 @@ public:
     t->AddReferencePoint ("0", 0, Vector (1, 2, 3), Vector (0, 0, 0));
     t->AddReferencePoint ("0", 1, Vector (1, 2, 3), Vector (1, 0, 0));
     t->AddReferencePoint ("0", 2, Vector (2, 2, 3), Vector (0, 0, 0));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
 
     // More than one node
     t = new Ns2MobilityHelperTest ("few nodes, combinations of set and setdest", Seconds (10), 3);
@@ -431,7 +582,26 @@ public:
     t->AddReferencePoint ("2", 4, Vector (0, 5, 0), Vector (0, 0, 0));
     t->AddReferencePoint ("2", 4, Vector (0, 5, 0), Vector (0, -5, 0));
     t->AddReferencePoint ("2", 5, Vector (0, 0, 0), Vector (0,  0, 0));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
+
+    // Commands grouped by node, which are not in time order in the file
+    t = new Ns2MobilityHelperTest ("commands grouped by node", Seconds (10), 2);
+    t->SetTrace ("$ns_ at 1.0 \"$node_(0) setdest 10 0 5\"\n"
+                 "$ns_ at 5.0 \"$node_(0) setdest 10 10 5\"\n"
+                 "$ns_ at 2.0 \"$node_(1) setdest 0 10 5\"\n"
+                 "$ns_ at 6.0 \"$node_(1) setdest 5 10 5\"\n");
+    //                     id  t  position         velocity
+    t->AddReferencePoint ("0", 0, Vector (0, 0, 0), Vector (0, 0, 0));
+    t->AddReferencePoint ("1", 0, Vector (0, 0, 0), Vector (0, 0, 0));
+    t->AddReferencePoint ("0", 1, Vector (0, 0, 0), Vector (5, 0, 0));
+    t->AddReferencePoint ("1", 2, Vector (0, 0, 0), Vector (0, 5, 0));
+    t->AddReferencePoint ("0", 3, Vector (10, 0, 0), Vector (0, 0, 0));
+    t->AddReferencePoint ("1", 4, Vector (0, 10, 0), Vector (0, 0, 0));
+    t->AddReferencePoint ("0", 5, Vector (10, 0, 0), Vector (0, 5, 0));
+    t->AddReferencePoint ("1", 6, Vector (0, 10, 0), Vector (5, 0, 0));
+    t->AddReferencePoint ("0", 7, Vector (10, 10, 0), Vector (0, 0, 0));
+    t->AddReferencePoint ("1", 7, Vector (5, 10, 0), Vector (0, 0, 0));
+    AddTestCases (t);
 
     // Test for Speed == 0, that acts as stop the node.
     t = new Ns2MobilityHelperTest ("setdest with speed cero", Seconds (10));
@@ -442,7 +612,7 @@ public:
     t->AddReferencePoint ("0", 1, Vector (0, 0, 0), Vector (5, 0, 0));
     t->AddReferencePoint ("0", 6, Vector (25, 0, 0), Vector (0, 0, 0));
     t->AddReferencePoint ("0", 7, Vector (25, 0, 0), Vector (0, 0, 0));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
 
 
     // Test negative positions
@@ -457,7 +627,7 @@ public:
     t->AddReferencePoint ("0", 2, Vector (0, 0, 0), Vector (0, 0, 0));
     t->AddReferencePoint ("0", 2, Vector (0, 0, 0), Vector (0, -1, 0));
     t->AddReferencePoint ("0", 3, Vector (0, -1, 0), Vector (0, 0, 0));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
 
     // Sqare setdest with values in the form 1.0e+2
     t = new Ns2MobilityHelperTest ("Foalt numbers in 1.0e+2 format", Seconds (6));
@@ -477,7 +647,7 @@ public:
     t->AddReferencePoint ("0", 4, Vector (0, 100, 0), Vector (0, 0, 0));
     t->AddReferencePoint ("0", 4, Vector (0, 100, 0), Vector (0, -100, 0));
     t->AddReferencePoint ("0", 5, Vector (0, 0, 0), Vector (0,  0, 0));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
     t = new Ns2MobilityHelperTest ("Bug 1219 testcase", Seconds (16));
     t->SetTrace ("$node_(0) set X_ 0.0\n"
                  "$node_(0) set Y_ 0.0\n"
@@ -489,14 +659,14 @@ public:
     t->AddReferencePoint ("0", 1, Vector (0, 0, 0), Vector (0,  1, 0));
     t->AddReferencePoint ("0", 6, Vector (0, 5, 0), Vector (0,  -1, 0));
     t->AddReferencePoint ("0", 16, Vector (0, -10, 0), Vector (0, 0, 0));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
     t = new Ns2MobilityHelperTest ("Bug 1059 testcase", Seconds (16));
     t->SetTrace ("$node_(0) set X_ 10.0\r\n"
                  "$node_(0) set Y_ 0.0\r\n"
                  );
     //                     id  t  position         velocity
     t->AddReferencePoint ("0", 0, Vector (10, 0, 0), Vector (0,  0, 0));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
     t = new Ns2MobilityHelperTest ("Bug 1301 testcase", Seconds (16));
     t->SetTrace ("$node_(0) set X_ 10.0\n"
                  "$node_(0) set Y_ 0.0\n"
@@ -506,7 +676,7 @@ public:
     // Moving to the current position must change nothing. No NaN
     // speed must be.
     t->AddReferencePoint ("0", 0, Vector (10, 0, 0), Vector (0,  0, 0));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
 
     t = new Ns2MobilityHelperTest ("Bug 1316 testcase", Seconds (1000));
     t->SetTrace ("$node_(0) set X_ 350.00000000000000\n"
@@ -530,7 +700,63 @@ public:
     t->AddReferencePoint ("0", 600.000, Vector (250.000,  50.000, 0.000), Vector (0.000, 2.000, 0.000));
     t->AddReferencePoint ("0", 900.000, Vector (250.000,  650.000, 0.000), Vector (2.500, 0.000, 0.000));
     t->AddReferencePoint ("0", 920.000, Vector (300.000,  650.000, 0.000), Vector (0.000, 0.000, 0.000));
-    AddTestCase (t, TestCase::QUICK);
+    AddTestCases (t);
+
+    // Same trace resumed in the middle of a movement: the node waits where
+    // it is until the start time and then completes the movement
+    t = new Ns2MobilityHelperTest ("resume in a movement", Seconds (1000));
+    t->SetTrace ("$node_(0) set X_ 350.00000000000000\n"
+                 "$node_(0) set Y_ 50.00000000000000\n"
+                 "$ns_ at 50.00000000000000  \"$node_(0) setdest 400.00000000000000 50.00000000000000 1.00000000000000\"\n"
+                 "$ns_ at 150.00000000000000 \"$node_(0) setdest 400.00000000000000 150.00000000000000 4.00000000000000\"\n"
+                 "$ns_ at 300.00000000000000 \"$node_(0) setdest 250.00000000000000 150.00000000000000 3.00000000000000\"\n"
+                 "$ns_ at 350.00000000000000 \"$node_(0) setdest 250.00000000000000 50.00000000000000 1.00000000000000\"\n"
+                 "$ns_ at 600.00000000000000 \"$node_(0) setdest 250.00000000000000 1050.00000000000000 2.00000000000000\"\n"
+                 "$ns_ at 900.00000000000000 \"$node_(0) setdest 300.00000000000000 650.00000000000000 2.50000000000000\"\n"
+                 );
+    t->SetStartTime (Seconds (160));
+    t->AddReferencePoint ("0", 0.000, Vector (400.000, 90.000, 0.000), Vector (0.000, 0.000, 0.000));
+    t->AddReferencePoint ("0", 160.000, Vector (400.000, 90.000, 0.000), Vector (0.000, 4.000, 0.000));
+    t->AddReferencePoint ("0", 175.000, Vector (400.000, 150.000, 0.000), Vector (0.000, 0.000, 0.000));
+    t->AddReferencePoint ("0", 300.000, Vector (400.000, 150.000, 0.000), Vector (-3.000, 0.000, 0.000));
+    t->AddReferencePoint ("0", 350.000, Vector (250.000, 150.000, 0.000), Vector (0.000, 0.000, 0.000));
+    t->AddReferencePoint ("0", 350.000, Vector (250.000, 150.000, 0.000), Vector (0.000, -1.000, 0.000));
+    t->AddReferencePoint ("0", 450.000, Vector (250.000,  50.000, 0.000), Vector (0.000, 0.000, 0.000));
+    t->AddReferencePoint ("0", 600.000, Vector (250.000,  50.000, 0.000), Vector (0.000, 2.000, 0.000));
+    t->AddReferencePoint ("0", 900.000, Vector (250.000,  650.000, 0.000), Vector (2.500, 0.000, 0.000));
+    t->AddReferencePoint ("0", 920.000, Vector (300.000,  650.000, 0.000), Vector (0.000, 0.000, 0.000));
+    AddTestCases (t);
 
+    // Resumed at the time of a command, which is already applied, and with
+    // an interrupted movement (the one of 600 s) after the start time
+    t = new Ns2MobilityHelperTest ("resume at a command", Seconds (1000));
+    t->SetTrace ("$node_(0) set X_ 350.00000000000000\n"
+                 "$node_(0) set Y_ 50.00000000000000\n"
+                 "$ns_ at 50.00000000000000  \"$node_(0) setdest 400.00000000000000 50.00000000000000 1.00000000000000\"\n"
+                 "$ns_ at 150.00000000000000 \"$node_(0) setdest 400.00000000000000 150.00000000000000 4.00000000000000\"\n"
+                 "$ns_ at 300.00000000000000 \"$node_(0) setdest 250.00000000000000 150.00000000000000 3.00000000000000\"\n"
+                 "$ns_ at 350.00000000000000 \"$node_(0) setdest 250.00000000000000 50.00000000000000 1.00000000000000\"\n"
+                 "$ns_ at 600.00000000000000 \"$node_(0) setdest 250.00000000000000 1050.00000000000000 2.00000000000000\"\n"
+                 "$ns_ at 900.00000000000000 \"$node_(0) setdest 300.00000000000000 650.00000000000000 2.50000000000000\"\n"
+                 );
+    t->SetStartTime (Seconds (350));
+    t->AddReferencePoint ("0", 0.000, Vector (250.000, 150.000, 0.000), Vector (0.000, 0.000, 0.000));
+    t->AddReferencePoint ("0", 350.000, Vector (250.000, 150.000, 0.000), Vector (0.000, -1.000, 0.000));
+    t->AddReferencePoint ("0", 450.000, Vector (250.000,  50.000, 0.000), Vector (0.000, 0.000, 0.000));
+    t->AddReferencePoint ("0", 600.000, Vector (250.000,  50.000, 0.000), Vector (0.000, 2.000, 0.000));
+    t->AddReferencePoint ("0", 900.000, Vector (250.000,  650.000, 0.000), Vector (2.500, 0.000, 0.000));
+    t->AddReferencePoint ("0", 920.000, Vector (300.000,  650.000, 0.000), Vector (0.000, 0.000, 0.000));
+    AddTestCases (t);
+
+    AddTestCase (new Ns2MobilityHelperTraceInfoTest, TestCase::QUICK);
+  }
+
+private:
+  /// Add a test case, the same one reading the trace as the simulation advances, and replaying it compiled
+  void AddTestCases (Ns2MobilityHelperTest * t)
+  {
+    AddTestCase (t, TestCase::QUICK);
+    AddTestCase (t->Streaming (Seconds (1)), TestCase::QUICK);
+    AddTestCase (t->Compiled (Seconds (1)), TestCase::QUICK);
   }
 } g_ns2TransmobilityHelperTestSuite; ///< the test suite
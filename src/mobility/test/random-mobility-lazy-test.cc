@@ -0,0 +1,173 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
+#include "ns3/string.h"
+#include "ns3/box.h"
+#include "ns3/rectangle.h"
+#include "ns3/gauss-markov-mobility-model.h"
+#include "ns3/random-walk-2d-mobility-model.h"
+#include "ns3/random-direction-2d-mobility-model.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Checks that the lazy random mobility models move exactly as the
+ * ones driven by events, with the same random streams, and that they do
+ * not schedule events.
+ */
+class RandomMobilityLazyTest : public TestCase
+{
+public:
+  /**
+   * \param typeName type of the models to check.
+   */
+  RandomMobilityLazyTest (std::string typeName)
+    : TestCase ("Check that lazy " + typeName + " moves as with events"),
+      m_typeName (typeName)
+  {
+  }
+
+private:
+  /**
+   * \param lazy value of the Lazy attribute.
+   * \param stream first random stream.
+   * \returns a model of the type, initialized.
+   */
+  Ptr<MobilityModel> CreateModel (bool lazy, int64_t stream)
+  {
+    ObjectFactory factory;
+    factory.SetTypeId (m_typeName);
+    factory.Set ("Lazy", BooleanValue (lazy));
+    if (m_typeName == "ns3::GaussMarkovMobilityModel")
+      {
+        factory.Set ("Bounds", BoxValue (Box (0, 200, 0, 200, 0, 50)));
+        factory.Set ("TimeStep", TimeValue (Seconds (0.7)));
+        factory.Set ("Alpha", DoubleValue (0.85));
+        factory.Set ("MeanVelocity", StringValue ("ns3::UniformRandomVariable[Min=10|Max=30]"));
+        factory.Set ("MeanPitch", StringValue ("ns3::UniformRandomVariable[Min=-0.2|Max=0.2]"));
+      }
+    else if (m_typeName == "ns3::RandomWalk2dMobilityModel")
+      {
+        factory.Set ("Bounds", RectangleValue (Rectangle (0, 100, 0, 100)));
+        factory.Set ("Mode", EnumValue (RandomWalk2dMobilityModel::MODE_TIME));
+        factory.Set ("Time", TimeValue (Seconds (1.3)));
+        factory.Set ("Speed", StringValue ("ns3::UniformRandomVariable[Min=10|Max=40]"));
+      }
+    else
+      {
+        factory.Set ("Bounds", RectangleValue (Rectangle (0, 100, 0, 100)));
+        factory.Set ("Speed", StringValue ("ns3::UniformRandomVariable[Min=10|Max=40]"));
+        factory.Set ("Pause", StringValue ("ns3::UniformRandomVariable[Min=0.1|Max=1]"));
+      }
+    Ptr<MobilityModel> model = factory.Create<MobilityModel> ();
+    model->SetPosition (Vector (50, 50, 10));
+    model->AssignStreams (stream);
+    model->Initialize ();
+    return model;
+  }
+
+  /**
+   * \param eager model driven by events.
+   * \param lazy lazy model.
+   */
+  void Check (Ptr<MobilityModel> eager, Ptr<MobilityModel> lazy)
+  {
+    Vector p = lazy->GetPosition ();
+    Vector v = lazy->GetVelocity ();
+    Vector expectedP = eager->GetPosition ();
+    Vector expectedV = eager->GetVelocity ();
+    double tol = 1e-9;
+    double now = Simulator::Now ().GetSeconds ();
+    NS_TEST_EXPECT_MSG_EQ_TOL (p.x, expectedP.x, tol, "x at " << now << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (p.y, expectedP.y, tol, "y at " << now << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (p.z, expectedP.z, tol, "z at " << now << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (v.x, expectedV.x, tol, "vx at " << now << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (v.y, expectedV.y, tol, "vy at " << now << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (v.z, expectedV.z, tol, "vz at " << now << " s");
+  }
+
+  /**
+   * Counts the course changes notified.
+   * \param model model whose course changed.
+   */
+  void CourseChanged (Ptr<const MobilityModel> model)
+  {
+    m_courseChanges++;
+  }
+
+  virtual void DoRun (void)
+  {
+    Ptr<MobilityModel> eager = CreateModel (false, 10);
+    Ptr<MobilityModel> lazy = CreateModel (true, 10);
+    // queries a few times a step, then once in a while
+    for (double t = 0.05; t < 300; t += (t < 20 ? 0.37 : 11.3))
+      {
+        Simulator::Schedule (Seconds (t), &RandomMobilityLazyTest::Check, this, eager, lazy);
+      }
+    Simulator::Schedule (Seconds (150.01), &MobilityModel::SetPosition, eager, Vector (20, 30, 5));
+    Simulator::Schedule (Seconds (150.01), &MobilityModel::SetPosition, lazy, Vector (20, 30, 5));
+    Simulator::Stop (Seconds (300));
+    Simulator::Run ();
+    Simulator::Destroy ();
+
+    // idle lazy models schedule no event, so none is left after the query
+    std::vector<Ptr<MobilityModel> > models;
+    for (uint32_t i = 0; i < 100; i++)
+      {
+        models.push_back (CreateModel (true, 20 + 10 * i));
+      }
+    m_courseChanges = 0;
+    models[0]->TraceConnectWithoutContext ("CourseChange", MakeCallback (&RandomMobilityLazyTest::CourseChanged, this));
+    Simulator::Schedule (Seconds (1000), &MobilityModel::GetPosition, models[0]);
+    Simulator::Schedule (Seconds (1000), &Simulator::Stop);
+    Simulator::Run ();
+    NS_TEST_EXPECT_MSG_EQ (Simulator::IsFinished (), true, "Events left by the idle lazy models");
+    NS_TEST_EXPECT_MSG_EQ (m_courseChanges, 1, "Course changes notified by a query");
+    Simulator::Destroy ();
+  }
+
+  std::string m_typeName;       //!< type of the models to check
+  uint32_t m_courseChanges;     //!< course changes notified
+};
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Random Mobility Lazy Test Suite
+ */
+static struct RandomMobilityLazyTestSuite : public TestSuite
+{
+  RandomMobilityLazyTestSuite () : TestSuite ("random-mobility-lazy", UNIT)
+  {
+    AddTestCase (new RandomMobilityLazyTest ("ns3::GaussMarkovMobilityModel"), TestCase::QUICK);
+    AddTestCase (new RandomMobilityLazyTest ("ns3::RandomWalk2dMobilityModel"), TestCase::QUICK);
+    AddTestCase (new RandomMobilityLazyTest ("ns3::RandomDirection2dMobilityModel"), TestCase::QUICK);
+  }
+} g_randomMobilityLazyTestSuite; ///< the test suite
@@ -0,0 +1,436 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <cmath>
+#include <fstream>
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/double.h"
+#include "ns3/road-network.h"
+#include "ns3/road-network-mobility-model.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Checks the shapes of the roads and the fastest paths of a
+ * RoadNetwork, with a large and a one path route cache.
+ */
+class RoadNetworkRoutingTest : public TestCase
+{
+public:
+  /**
+   * \param cacheSize destinations whose paths are kept.
+   */
+  RoadNetworkRoutingTest (uint32_t cacheSize)
+    : TestCase ("Check the fastest paths of a road network, route cache of " + std::to_string (cacheSize)),
+      m_cacheSize (cacheSize)
+  {
+  }
+
+private:
+  virtual void DoRun (void)
+  {
+    Ptr<RoadNetwork> network = Create<RoadNetwork> ();
+    network->SetRouteCacheSize (m_cacheSize);
+    for (uint32_t i = 0; i < 5; i++)
+      {
+        network->AddJunction (Vector (i * 100, i % 2 * 50, 0));
+      }
+    // a short slow path, and a long fast one which is faster
+    uint32_t slow = network->AddRoad (0, 1, 10);
+    network->AddRoad (1, 4, 10);
+    uint32_t fast = network->AddRoad (0, 2, 30);
+    uint32_t fast2 = network->AddRoad (2, 3, 30);
+    uint32_t fast3 = network->AddRoad (3, 4, 30);
+    network->AddRoad (4, 0, 10);
+    std::vector<Vector> shape;
+    shape.push_back (Vector (100, 100, 0));
+    shape.push_back (Vector (200, 100, 0));
+    uint32_t bent = network->AddRoad (1, 2, 10, shape);
+    NS_TEST_ASSERT_MSG_EQ (network->GetNJunctions (), 5, "Junctions");
+    NS_TEST_ASSERT_MSG_EQ (network->GetNRoads (), 7, "Roads");
+
+    NS_TEST_EXPECT_MSG_EQ_TOL (network->GetRoadLength (slow), std::sqrt (100.0 * 100 + 50 * 50), 1e-9, "Length of a straight road");
+    NS_TEST_EXPECT_MSG_EQ_TOL (network->GetRoadLength (bent), 50 + 100 + 100, 1e-9, "Length of a bent road");
+    uint32_t cursor = 0;
+    Vector position;
+    Vector direction;
+    network->Evaluate (bent, 120, cursor, position, direction);
+    NS_TEST_EXPECT_MSG_EQ_TOL (position.x, 170, 1e-9, "x on a bent road");
+    NS_TEST_EXPECT_MSG_EQ_TOL (position.y, 100, 1e-9, "y on a bent road");
+    NS_TEST_EXPECT_MSG_EQ_TOL (direction.x, 1, 1e-9, "Direction on a bent road");
+    network->Evaluate (bent, 20, cursor, position, direction);
+    NS_TEST_EXPECT_MSG_EQ_TOL (position.y, 70, 1e-9, "y back on a bent road");
+    NS_TEST_EXPECT_MSG_EQ_TOL (direction.y, 1, 1e-9, "Direction back on a bent road");
+    NS_TEST_EXPECT_MSG_EQ (network->FindNearestJunction (Vector (290, 60, 0)), 3, "Nearest junction");
+
+    for (uint32_t round = 0; round < 2; round++)
+      {
+        CheckPath (network, 0, 4, true, fast, fast2, fast3);
+        CheckPath (network, 1, 0, true, 1, 5);
+        CheckPath (network, 1, 3, true, bent, fast2);
+        CheckPath (network, 4, 4, true);
+        CheckPath (network, 4, 2, true, 5, fast);
+      }
+
+    // a junction without roads cannot be reached
+    network = Create<RoadNetwork> ();
+    network->AddJunction (Vector (0, 0, 0));
+    network->AddJunction (Vector (10, 0, 0));
+    network->AddJunction (Vector (20, 0, 0));
+    network->AddRoad (0, 1, 10);
+    CheckPath (network, 0, 1, true, 0);
+    CheckPath (network, 1, 0, false);
+    CheckPath (network, 0, 2, false);
+  }
+
+  /**
+   * \param network road network.
+   * \param from junction to start at.
+   * \param to junction to go to.
+   * \param found whether the destination can be reached.
+   * \param road0 first road of the expected path, NONE if it ends before.
+   * \param road1 second road of the expected path, NONE if it ends before.
+   * \param road2 third road of the expected path, NONE if it ends before.
+   */
+  void CheckPath (Ptr<RoadNetwork> network, uint32_t from, uint32_t to, bool found,
+                  uint32_t road0 = RoadNetwork::NONE, uint32_t road1 = RoadNetwork::NONE, uint32_t road2 = RoadNetwork::NONE)
+  {
+    std::vector<uint32_t> expected;
+    uint32_t roads[] = { road0, road1, road2 };
+    for (uint32_t i = 0; i < 3 && roads[i] != RoadNetwork::NONE; i++)
+      {
+        expected.push_back (roads[i]);
+      }
+    std::vector<uint32_t> path (1, 1234);
+    NS_TEST_EXPECT_MSG_EQ (network->FindPath (from, to, path), found, "Path from " << from << " to " << to << " found");
+    NS_TEST_EXPECT_MSG_EQ (path.size (), expected.size (), "Roads from " << from << " to " << to);
+    for (uint32_t i = 0; i < path.size () && i < expected.size (); i++)
+      {
+        NS_TEST_EXPECT_MSG_EQ (path[i], expected[i], "Road " << i << " from " << from << " to " << to);
+      }
+  }
+
+  uint32_t m_cacheSize;    //!< destinations whose paths are kept
+};
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Checks that road network files are read, and invalid ones
+ * rejected.
+ */
+class RoadNetworkLoadTest : public TestCase
+{
+public:
+  RoadNetworkLoadTest ()
+    : TestCase ("Check that road network files are read")
+  {
+  }
+
+private:
+  virtual void DoRun (void)
+  {
+    std::string filename = CreateTempDirFilename ("roads.net");
+    {
+      std::ofstream file (filename.c_str ());
+      file << "# three junctions\n"
+           << "junction 0 0\n"
+           << "junction 100 0 5\n"
+           << "\n"
+           << "junction 100 100\n"
+           << "twoway 0 1 13.9\n"
+           << "oneway 1 2 8.3 150 50 0\n";
+    }
+    Ptr<RoadNetwork> network = Create<RoadNetwork> ();
+    network->AddJunction (Vector (-1, -1, 0));
+    NS_TEST_ASSERT_MSG_EQ (network->Load (filename), true, "Load " << filename);
+    NS_TEST_ASSERT_MSG_EQ (network->GetNJunctions (), 4, "Junctions");
+    NS_TEST_ASSERT_MSG_EQ (network->GetNRoads (), 3, "Roads");
+    NS_TEST_EXPECT_MSG_EQ_TOL (network->GetJunctionPosition (2).z, 5, 1e-9, "z of a junction");
+    NS_TEST_EXPECT_MSG_EQ (network->GetRoadFrom (1), 2, "Road back of a two-way road");
+    NS_TEST_EXPECT_MSG_EQ (network->GetRoadTo (1), 1, "Road back of a two-way road");
+    NS_TEST_EXPECT_MSG_EQ_TOL (network->GetRoadSpeedLimit (1), 13.9, 1e-9, "Speed limit");
+    NS_TEST_EXPECT_MSG_EQ_TOL (network->GetRoadLength (2), std::sqrt (50.0 * 50 + 50 * 50 + 5 * 5) + std::sqrt (50.0 * 50 + 50 * 50), 1e-9, "Length of a bent road");
+
+    const char *invalid[] = {
+      "junction 0\n",
+      "junction 0 0\noneway 0 1 10\n",
+      "junction 0 0\njunction 1 1\ntwoway 0 1 0\n",
+      "junction 0 0\njunction 1 1\ntwoway 0 1 10 5 5\n",
+      "junction 0 0\nroad 0 0 10\n",
+    };
+    for (uint32_t i = 0; i < sizeof (invalid) / sizeof (invalid[0]); i++)
+      {
+        std::ofstream (filename.c_str ()) << invalid[i];
+        NS_TEST_EXPECT_MSG_EQ (Create<RoadNetwork> ()->Load (filename), false, "Invalid file " << invalid[i]);
+      }
+    NS_TEST_EXPECT_MSG_EQ (Create<RoadNetwork> ()->Load (CreateTempDirFilename ("missing.net")), false, "Missing file");
+  }
+};
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Checks that vehicles driving on a grid of streets stay on the
+ * roads, keep to the speed limits and accelerations, and stop at their
+ * destinations.
+ */
+class RoadNetworkMobilityModelTest : public TestCase
+{
+public:
+  RoadNetworkMobilityModelTest ()
+    : TestCase ("Check the movement of vehicles on a road network")
+  {
+  }
+
+private:
+  /// State of a vehicle at the previous sample
+  struct Sample
+  {
+    Vector position;    //!< position
+    double speed;       //!< speed
+  };
+
+  /**
+   * Checks the vehicles against their previous samples.
+   */
+  void Check (void)
+  {
+    double acceleration = 2.0;
+    double deceleration = 4.5;
+    double maxFactor = 1.1;
+    for (uint32_t i = 0; i < m_models.size (); i++)
+      {
+        Ptr<RoadNetworkMobilityModel> model = m_models[i];
+        Vector position = model->GetPosition ();
+        Vector velocity = model->GetVelocity ();
+        double speed = std::sqrt (velocity.x * velocity.x + velocity.y * velocity.y + velocity.z * velocity.z);
+        uint32_t road = model->GetRoad ();
+        if (road == RoadNetwork::NONE)
+          {
+            Vector junction = m_network->GetJunctionPosition (model->GetDestination ());
+            NS_TEST_EXPECT_MSG_EQ (CalculateDistance (position, junction), 0, "Stopped vehicle " << i << " at its destination");
+            NS_TEST_EXPECT_MSG_EQ (speed, 0, "Speed of stopped vehicle " << i);
+            m_stops++;
+          }
+        else
+          {
+            // the streets of the grid are straight, except the bent one
+            Vector from = m_network->GetJunctionPosition (m_network->GetRoadFrom (road));
+            Vector to = m_network->GetJunctionPosition (m_network->GetRoadTo (road));
+            if (road < m_bentRoads)
+              {
+                double cross = (to.x - from.x) * (position.y - from.y) - (to.y - from.y) * (position.x - from.x);
+                NS_TEST_EXPECT_MSG_EQ_TOL (cross / m_network->GetRoadLength (road), 0, 1e-6, "Vehicle " << i << " off road " << road);
+              }
+            NS_TEST_EXPECT_MSG_LT_OR_EQ (speed, m_network->GetRoadSpeedLimit (road) * maxFactor + 1e-9, "Speed of vehicle " << i);
+          }
+        if (m_samples.size () == m_models.size ())
+          {
+            const Sample &last = m_samples[i];
+            double change = (speed - last.speed) / m_step.GetSeconds ();
+            NS_TEST_EXPECT_MSG_LT_OR_EQ (change, acceleration + 1e-6, "Acceleration of vehicle " << i);
+            NS_TEST_EXPECT_MSG_GT_OR_EQ (change, -deceleration - 1e-6, "Deceleration of vehicle " << i);
+            NS_TEST_EXPECT_MSG_LT_OR_EQ (CalculateDistance (position, last.position),
+                                         std::max (speed, last.speed) * m_step.GetSeconds () + 1e-6, "Jump of vehicle " << i);
+            m_distance += CalculateDistance (position, last.position);
+          }
+      }
+    m_samples.resize (m_models.size ());
+    for (uint32_t i = 0; i < m_models.size (); i++)
+      {
+        m_samples[i].position = m_models[i]->GetPosition ();
+        Vector velocity = m_models[i]->GetVelocity ();
+        m_samples[i].speed = std::sqrt (velocity.x * velocity.x + velocity.y * velocity.y + velocity.z * velocity.z);
+      }
+    Simulator::Schedule (m_step, &RoadNetworkMobilityModelTest::Check, this);
+  }
+
+  /**
+   * \param model model whose course changed.
+   */
+  void CourseChanged (Ptr<const MobilityModel> model)
+  {
+    m_courseChanges++;
+  }
+
+  virtual void DoRun (void)
+  {
+    // a grid of two-way streets, 200 m apart, and a bent one-way street
+    m_network = Create<RoadNetwork> ();
+    uint32_t n = 5;
+    for (uint32_t y = 0; y < n; y++)
+      {
+        for (uint32_t x = 0; x < n; x++)
+          {
+            m_network->AddJunction (Vector (x * 200.0, y * 200.0, 0));
+          }
+      }
+    for (uint32_t y = 0; y < n; y++)
+      {
+        for (uint32_t x = 0; x < n; x++)
+          {
+            uint32_t j = y * n + x;
+            double limit = (x + y) % 2 ? 13.89 : 8.33;
+            if (x + 1 < n)
+              {
+                m_network->AddRoad (j, j + 1, limit);
+                m_network->AddRoad (j + 1, j, limit);
+              }
+            if (y + 1 < n)
+              {
+                m_network->AddRoad (j, j + n, limit);
+                m_network->AddRoad (j + n, j, limit);
+              }
+          }
+      }
+    m_bentRoads = m_network->GetNRoads ();
+    std::vector<Vector> shape;
+    shape.push_back (Vector (100, 50, 0));
+    shape.push_back (Vector (700, 750, 0));
+    m_network->AddRoad (0, n * n - 1, 16.67, shape);
+
+    for (uint32_t i = 0; i < 8; i++)
+      {
+        Ptr<RoadNetworkMobilityModel> model = CreateObject<RoadNetworkMobilityModel> ();
+        model->SetAttribute ("Pause", StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=3.0]"));
+        model->SetAttribute ("SpeedFactor", StringValue ("ns3::UniformRandomVariable[Min=0.8|Max=1.1]"));
+        model->AssignStreams (10 * i);
+        model->SetPosition (Vector (i * 90.0, i * 50.0, 0));
+        model->SetRoadNetwork (m_network);
+        NS_TEST_EXPECT_MSG_EQ (model->GetDestination (), m_network->FindNearestJunction (Vector (i * 90.0, i * 50.0, 0)),
+                               "Start of vehicle " << i);
+        model->TraceConnectWithoutContext ("CourseChange", MakeCallback (&RoadNetworkMobilityModelTest::CourseChanged, this));
+        m_models.push_back (model);
+      }
+
+    m_step = MilliSeconds (100);
+    m_stops = 0;
+    m_courseChanges = 0;
+    m_distance = 0;
+    Simulator::Schedule (MilliSeconds (50), &RoadNetworkMobilityModelTest::Check, this);
+    Simulator::Stop (Seconds (900));
+    Simulator::Run ();
+    Simulator::Destroy ();
+
+    NS_TEST_EXPECT_MSG_GT (m_stops, 0, "Vehicles stopped at their destinations");
+    NS_TEST_EXPECT_MSG_GT (m_courseChanges, 8 * 20, "Roads driven");
+    NS_TEST_EXPECT_MSG_GT (m_distance, 8 * 900 * 5.0, "Distance driven");
+    m_models.clear ();
+  }
+
+  Ptr<RoadNetwork> m_network;                               //!< grid of streets
+  uint32_t m_bentRoads;                                     //!< first road which is not straight
+  std::vector<Ptr<RoadNetworkMobilityModel> > m_models;     //!< vehicles
+  std::vector<Sample> m_samples;                            //!< vehicles at the previous sample
+  Time m_step;                                              //!< time between samples
+  uint32_t m_stops;                                         //!< samples of stopped vehicles
+  uint32_t m_courseChanges;                                 //!< course changes notified
+  double m_distance;                                        //!< distance driven between samples
+};
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Test that the pauses and accelerations of the vehicles are kept
+ * to values they can drive with.
+ */
+class RoadNetworkMobilityModelLimitsTest : public TestCase
+{
+public:
+  RoadNetworkMobilityModelLimitsTest ()
+    : TestCase ("Check the limits of the attributes of vehicles on a road network")
+  {
+  }
+
+private:
+  /**
+   * \param model model whose course changed.
+   */
+  void CourseChanged (Ptr<const MobilityModel> model)
+  {
+    Ptr<const RoadNetworkMobilityModel> vehicle = DynamicCast<const RoadNetworkMobilityModel> (model);
+    if (m_stopped)
+      {
+        NS_TEST_EXPECT_MSG_EQ (Simulator::Now (), m_stop, "Pause of a vehicle after a negative draw");
+      }
+    m_stopped = vehicle->GetRoad () == RoadNetwork::NONE;
+    if (m_stopped)
+      {
+        m_stop = Simulator::Now ();
+        m_stops++;
+      }
+  }
+
+  virtual void DoRun (void)
+  {
+    Ptr<RoadNetwork> network = Create<RoadNetwork> ();
+    network->AddJunction (Vector (0, 0, 0));
+    network->AddJunction (Vector (100, 0, 0));
+    network->AddRoad (0, 1, 10);
+    network->AddRoad (1, 0, 10);
+
+    Ptr<RoadNetworkMobilityModel> model = CreateObject<RoadNetworkMobilityModel> ();
+    NS_TEST_EXPECT_MSG_EQ (model->SetAttributeFailSafe ("Acceleration", DoubleValue (0)), false, "Zero acceleration");
+    NS_TEST_EXPECT_MSG_EQ (model->SetAttributeFailSafe ("Deceleration", DoubleValue (-1)), false, "Negative deceleration");
+    model->SetAttribute ("Pause", StringValue ("ns3::ConstantRandomVariable[Constant=-5.0]"));
+    model->SetRoadNetwork (network);
+    model->TraceConnectWithoutContext ("CourseChange", MakeCallback (&RoadNetworkMobilityModelLimitsTest::CourseChanged, this));
+
+    m_stopped = false;
+    m_stops = 0;
+    Simulator::Stop (Seconds (120));
+    Simulator::Run ();
+    Simulator::Destroy ();
+
+    NS_TEST_EXPECT_MSG_GT (m_stops, 2, "Trips driven");
+  }
+
+  bool m_stopped;        //!< whether the vehicle stopped at the last course change
+  Time m_stop;           //!< time of the last stop
+  uint32_t m_stops;      //!< stops of the vehicle
+};
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Road Network Mobility Model Test Suite
+ */
+static struct RoadNetworkMobilityModelTestSuite : public TestSuite
+{
+  RoadNetworkMobilityModelTestSuite () : TestSuite ("road-network-mobility-model", UNIT)
+  {
+    AddTestCase (new RoadNetworkRoutingTest (256), TestCase::QUICK);
+    AddTestCase (new RoadNetworkRoutingTest (1), TestCase::QUICK);
+    AddTestCase (new RoadNetworkLoadTest, TestCase::QUICK);
+    AddTestCase (new RoadNetworkMobilityModelTest, TestCase::QUICK);
+    AddTestCase (new RoadNetworkMobilityModelLimitsTest, TestCase::QUICK);
+  }
+} g_roadNetworkMobilityModelTestSuite; ///< the test suite
@@ -0,0 +1,258 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include <cmath>
+#include <fstream>
+#include "ns3/simulator.h"
+#include "ns3/node-list.h"
+#include "ns3/node.h"
+#include "ns3/node-container.h"
+#include "ns3/mobility-model.h"
+#include "ns3/test.h"
+#include "ns3/sumo-fcd-mobility-helper.h"
+
+using namespace ns3;
+
+/// FCD file of the tests: vehicle a accelerates and climbs, b leaves and comes back
+static const char *g_fcdFile =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+  "<!-- <timestep time=\"9\"> in a comment -->\n"
+  "<fcd-export xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\">\n"
+  "  <timestep time=\"0.00\">\n"
+  "    <vehicle id=\"a\" x=\"0.00\" y=\"0.00\" angle=\"90.00\" type=\"car\" speed=\"0.00\" pos=\"0.00\" lane=\"e0_0\" slope=\"0.00\"/>\n"
+  "  </timestep>\n"
+  "  <timestep time=\"1.00\">\n"
+  "    <vehicle id=\"a\" x=\"1.00\" y=\"0.00\" angle=\"90.00\" type=\"car\" speed=\"2.00\" pos=\"1.00\" lane=\"e0_0\" slope=\"0.00\"/>\n"
+  "    <vehicle id='b' x='10.00' y='10.00' z='3.00' angle='0.00' type='car' speed='5.00' pos='0.00' lane='e1_0' slope='0.00'/>\n"
+  "  </timestep>\n"
+  "  <timestep time=\"2.00\">\n"
+  "    <vehicle id=\"a\" x=\"4.00\" y=\"0.00\" angle=\"90.00\" type=\"car\" speed=\"4.00\" pos=\"4.00\" lane=\"e0_0\" slope=\"30.00\"/>\n"
+  "    <person id=\"p\" x=\"7.00\" y=\"7.00\" angle=\"0.00\" speed=\"1.00\" pos=\"0.00\" edge=\"e1\" slope=\"0.00\"/>\n"
+  "  </timestep>\n"
+  "  <timestep time=\"3.00\">\n"
+  "    <vehicle id=\"b\" x=\"10.00\" y=\"20.00\" angle=\"0.00\" type=\"car\" speed=\"0.00\" pos=\"10.00\" lane=\"e1_0\" slope=\"0.00\"/>\n"
+  "  </timestep>\n"
+  "</fcd-export>\n";
+
+/**
+ * \param name name of the file, in the temporary directory of the test
+ * \param contents contents of the file
+ * \return false if it could not be written
+ */
+static bool
+WriteFile (std::string name, const char *contents)
+{
+  std::ofstream of (name.c_str ());
+  of << contents;
+  return of.good ();
+}
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Checks the vehicles, time span and bounding box read from an FCD
+ * file, and the detection of FCD files.
+ */
+class SumoFcdMobilityHelperTraceInfoTest : public TestCase
+{
+public:
+  SumoFcdMobilityHelperTraceInfoTest ()
+    : TestCase ("trace info")
+  {
+  }
+
+private:
+  void DoRun ()
+  {
+    std::string fcdFile = CreateTempDirFilename ("SumoFcdMobilityHelperTest.xml");
+    NS_TEST_ASSERT_MSG_EQ (WriteFile (fcdFile, g_fcdFile), true, "Need to write tmp. file");
+    std::string ns2File = CreateTempDirFilename ("SumoFcdMobilityHelperTest.tcl");
+    NS_TEST_ASSERT_MSG_EQ (WriteFile (ns2File, "$node_(0) set X_ 10.0\n"), true, "Need to write tmp. file");
+
+    NS_TEST_EXPECT_MSG_EQ (SumoFcdMobilityHelper::IsFcdTrace (fcdFile), true, "FCD file");
+    NS_TEST_EXPECT_MSG_EQ (SumoFcdMobilityHelper::IsFcdTrace (ns2File), false, "ns-2 trace");
+
+    SumoFcdMobilityHelper mobility (fcdFile);
+    NS_TEST_ASSERT_MSG_EQ (mobility.GetNVehicles (), 2, "Vehicles");
+    NS_TEST_EXPECT_MSG_EQ (mobility.GetVehicleId (0), "a", "First vehicle");
+    NS_TEST_EXPECT_MSG_EQ (mobility.GetVehicleId (1), "b", "Second vehicle");
+
+    MobilityTraceInfo info = mobility.GetTraceInfo ();
+    NS_TEST_ASSERT_MSG_EQ (info.nodeIds.size (), 2, "Node IDs");
+    NS_TEST_EXPECT_MSG_EQ (info.nodeIds[1], 1, "Second node ID");
+    NS_TEST_EXPECT_MSG_EQ (info.start, Seconds (0), "Start time");
+    NS_TEST_EXPECT_MSG_EQ (info.stop, Seconds (3), "Stop time");
+    double tol = 0.001;
+    NS_TEST_EXPECT_MSG_EQ_TOL (info.bounds.xMin, 0, tol, "Bounds");
+    NS_TEST_EXPECT_MSG_EQ_TOL (info.bounds.xMax, 10, tol, "Bounds");
+    NS_TEST_EXPECT_MSG_EQ_TOL (info.bounds.yMin, 0, tol, "Bounds");
+    NS_TEST_EXPECT_MSG_EQ_TOL (info.bounds.yMax, 20, tol, "Bounds");
+    NS_TEST_EXPECT_MSG_EQ_TOL (info.bounds.zMin, 0, tol, "Bounds");
+    NS_TEST_EXPECT_MSG_EQ_TOL (info.bounds.zMax, 3, tol, "Bounds");
+  }
+};
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Replays the FCD file and checks the positions and velocities of
+ * the nodes between the samples.
+ */
+class SumoFcdMobilityHelperTest : public TestCase
+{
+public:
+  /**
+   * \param name short description
+   * \param lookAhead look-ahead of the helper
+   * \param start start time of the helper
+   * \param trajectories install the trajectories of the vehicles instead
+   */
+  SumoFcdMobilityHelperTest (std::string name, Time lookAhead, Time start, bool trajectories = false)
+    : TestCase (name),
+      m_lookAhead (lookAhead),
+      m_start (start),
+      m_trajectories (trajectories)
+  {
+  }
+
+private:
+  /**
+   * \param node node index
+   * \param position expected position
+   * \param velocity expected velocity
+   */
+  void Check (uint32_t node, Vector position, Vector velocity)
+  {
+    Ptr<MobilityModel> model = m_nodes.Get (node)->GetObject<MobilityModel> ();
+    Vector p = model->GetPosition ();
+    Vector v = model->GetVelocity ();
+    double tol = 0.0001;
+    double now = Simulator::Now ().GetSeconds ();
+    NS_TEST_EXPECT_MSG_EQ_TOL (p.x, position.x, tol, "x of node " << node << " at " << now << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (p.y, position.y, tol, "y of node " << node << " at " << now << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (p.z, position.z, tol, "z of node " << node << " at " << now << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (v.x, velocity.x, tol, "vx of node " << node << " at " << now << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (v.y, velocity.y, tol, "vy of node " << node << " at " << now << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (v.z, velocity.z, tol, "vz of node " << node << " at " << now << " s");
+  }
+
+  /**
+   * \param time time of the check
+   * \param node node index
+   * \param position expected position
+   * \param velocity expected velocity
+   */
+  void ScheduleCheck (double time, uint32_t node, Vector position, Vector velocity)
+  {
+    Simulator::Schedule (Seconds (time), &SumoFcdMobilityHelperTest::Check, this, node, position, velocity);
+  }
+
+  /**
+   * \param node node index, as a string
+   * \param model mobility model whose course changed
+   */
+  void CourseChanged (std::string node, Ptr<const MobilityModel> model)
+  {
+    Time &last = m_lastCourseChanges[std::stoi (node)];
+    NS_TEST_EXPECT_MSG_NE (last, Simulator::Now (),
+                           "Course changes of node " << node << " at " << Simulator::Now ().GetSeconds () << " s");
+    last = Simulator::Now ();
+  }
+
+  void DoRun ()
+  {
+    std::string fcdFile = CreateTempDirFilename ("SumoFcdMobilityHelperTest.xml");
+    NS_TEST_ASSERT_MSG_EQ (WriteFile (fcdFile, g_fcdFile), true, "Need to write tmp. file");
+
+    m_nodes.Create (2);
+    SumoFcdMobilityHelper mobility (fcdFile);
+    if (m_trajectories)
+      {
+        mobility.InstallTrajectories (m_nodes);
+      }
+    else
+      {
+        mobility.SetLookAhead (m_lookAhead);
+        mobility.SetStartTime (m_start);
+        mobility.Install (m_nodes);
+      }
+    // one course change per sample
+    m_lastCourseChanges.assign (m_nodes.GetN (), Seconds (-1));
+    for (uint32_t i = 0; i < m_nodes.GetN (); i++)
+      {
+        m_nodes.Get (i)->GetObject<MobilityModel> ()->TraceConnect ("CourseChange", std::to_string (i),
+                                                                  MakeCallback (&SumoFcdMobilityHelperTest::CourseChanged, this));
+      }
+
+    // a accelerates at 2 m/s^2 from the first sample
+    if (m_start.IsZero ())
+      {
+        ScheduleCheck (0.5, 0, Vector (0.25, 0, 0), Vector (1, 0, 0));
+      }
+    else
+      {
+        ScheduleCheck (0.5, 0, Vector (0, 0, 0), Vector (0, 0, 0));
+      }
+    // and then to 4 m/s on a 30 degrees slope: (2 sqrt (3) - 2, 0, 2) m/s^2
+    double ax = 2 * std::sqrt (3.0) - 2;
+    ScheduleCheck (1.5, 0, Vector (2 + ax / 8, 0, 0.25), Vector (2 + ax / 2, 0, 1));
+    // it leaves at its last sample, where it climbed 1 m
+    ScheduleCheck (2.5, 0, Vector (4, 0, 1), Vector (0, 0, 0));
+    ScheduleCheck (3.5, 0, Vector (4, 0, 1), Vector (0, 0, 0));
+
+    // b waits at its first position, leaves and comes back at the same height
+    ScheduleCheck (0.5, 1, Vector (10, 10, 3), Vector (0, 0, 0));
+    ScheduleCheck (1.5, 1, Vector (10, 10, 3), Vector (0, 0, 0));
+    ScheduleCheck (3.5, 1, Vector (10, 20, 3), Vector (0, 0, 0));
+
+    Simulator::Stop (Seconds (4));
+    Simulator::Run ();
+    Simulator::Destroy ();
+  }
+
+  NodeContainer m_nodes;  //!< nodes of the vehicles
+  Time m_lookAhead;       //!< look-ahead of the helper
+  Time m_start;           //!< start time of the helper
+  bool m_trajectories;    //!< install the trajectories of the vehicles instead
+  std::vector<Time> m_lastCourseChanges;  //!< time of the last course change of each node
+};
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief The test suite
+ */
+class SumoFcdMobilityHelperTestSuite : public TestSuite
+{
+public:
+  SumoFcdMobilityHelperTestSuite () : TestSuite ("mobility-sumo-fcd-helper", UNIT)
+  {
+    AddTestCase (new SumoFcdMobilityHelperTraceInfoTest, TestCase::QUICK);
+    AddTestCase (new SumoFcdMobilityHelperTest ("replay", Seconds (60), Seconds (0)), TestCase::QUICK);
+    AddTestCase (new SumoFcdMobilityHelperTest ("replay, all at install", Seconds (0), Seconds (0)), TestCase::QUICK);
+    AddTestCase (new SumoFcdMobilityHelperTest ("replay, short look-ahead", MilliSeconds (500), Seconds (0)), TestCase::QUICK);
+    AddTestCase (new SumoFcdMobilityHelperTest ("resumed", Seconds (60), Seconds (1.25)), TestCase::QUICK);
+    AddTestCase (new SumoFcdMobilityHelperTest ("trajectories", Seconds (0), Seconds (0), true), TestCase::QUICK);
+  }
+} g_sumoFcdMobilityHelperTestSuite; ///< the test suite
@@ -0,0 +1,174 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Unizar
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Samuel Salvatella <ssalvatellaperez@gmail.com>
+ */
+
+
+#include "ns3/simulator.h"
+#include "ns3/trajectory-mobility-model.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Checks the interpolation of trajectories with and without
+ * velocities, and the models which share them.
+ */
+class TrajectoryMobilityModelTest : public TestCase
+{
+public:
+  TrajectoryMobilityModelTest ()
+    : TestCase ("Check the positions and velocities of Trajectory Mobility Model")
+  {
+  }
+
+private:
+  /**
+   * \param model model to check
+   * \param position expected position
+   * \param velocity expected velocity
+   */
+  void Check (Ptr<MobilityModel> model, Vector position, Vector velocity)
+  {
+    Vector p = model->GetPosition ();
+    Vector v = model->GetVelocity ();
+    double tol = 1e-9;
+    double now = Simulator::Now ().GetSeconds ();
+    NS_TEST_EXPECT_MSG_EQ_TOL (p.x, position.x, tol, "x at " << now << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (p.y, position.y, tol, "y at " << now << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (p.z, position.z, tol, "z at " << now << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (v.x, velocity.x, tol, "vx at " << now << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (v.y, velocity.y, tol, "vy at " << now << " s");
+    NS_TEST_EXPECT_MSG_EQ_TOL (v.z, velocity.z, tol, "vz at " << now << " s");
+  }
+
+  /**
+   * \param time time of the check
+   * \param model model to check
+   * \param position expected position
+   * \param velocity expected velocity
+   */
+  void ScheduleCheck (double time, Ptr<MobilityModel> model, Vector position, Vector velocity)
+  {
+    Simulator::Schedule (Seconds (time), &TrajectoryMobilityModelTest::Check, this, model, position, velocity);
+  }
+
+  virtual void DoRun (void)
+  {
+    // moves along x, jumps and moves along y
+    Ptr<Trajectory> linear = Create<Trajectory> ();
+    linear->Add (Seconds (1), Vector (0, 0, 0));
+    linear->Add (Seconds (3), Vector (10, 0, 0));
+    linear->Add (Seconds (3), Vector (20, 0, 0));
+    linear->Add (Seconds (5), Vector (20, 10, 0));
+
+    Ptr<TrajectoryMobilityModel> model = CreateObject<TrajectoryMobilityModel> ();
+    model->SetTrajectory (linear);
+    ScheduleCheck (0.5, model, Vector (0, 0, 0), Vector (0, 0, 0));
+    ScheduleCheck (2, model, Vector (5, 0, 0), Vector (5, 0, 0));
+    ScheduleCheck (3, model, Vector (20, 0, 0), Vector (0, 5, 0));
+    ScheduleCheck (6, model, Vector (20, 10, 0), Vector (0, 0, 0));
+
+    // the same trajectory 1 s later, moved up by 1 m at 2 s
+    Ptr<TrajectoryMobilityModel> shared = CreateObject<TrajectoryMobilityModel> ();
+    shared->SetTrajectory (linear, Seconds (1));
+    NS_TEST_EXPECT_MSG_EQ (shared->GetTrajectory (), model->GetTrajectory (), "Shared trajectory");
+    ScheduleCheck (1.5, shared, Vector (0, 0, 0), Vector (0, 0, 0));
+    Simulator::Schedule (Seconds (2), &MobilityModel::SetPosition, shared, Vector (0, 1, 0));
+    ScheduleCheck (3, shared, Vector (5, 1, 0), Vector (5, 0, 0));
+    ScheduleCheck (5, shared, Vector (20, 6, 0), Vector (0, 5, 0));
+
+    // accelerates from 0 to 4 m/s in 2 s, then stops
+    Ptr<Trajectory> accelerated = Create<Trajectory> ();
+    accelerated->Add (Seconds (0), Vector (0, 0, 0), Vector (0, 0, 0));
+    accelerated->Add (Seconds (2), Vector (4, 0, 0), Vector (4, 0, 0));
+    accelerated->Add (Seconds (2), Vector (4, 0, 0), Vector (0, 0, 0));
+    Ptr<TrajectoryMobilityModel> car = CreateObject<TrajectoryMobilityModel> ();
+    car->SetTrajectory (accelerated);
+    ScheduleCheck (1, car, Vector (1, 0, 0), Vector (2, 0, 0));
+    ScheduleCheck (1.5, car, Vector (2.25, 0, 0), Vector (3, 0, 0));
+    ScheduleCheck (3, car, Vector (4, 0, 0), Vector (0, 0, 0));
+
+    // without trajectory it stays where it is placed
+    Ptr<TrajectoryMobilityModel> still = CreateObject<TrajectoryMobilityModel> ();
+    still->SetPosition (Vector (1, 2, 3));
+    ScheduleCheck (1, still, Vector (1, 2, 3), Vector (0, 0, 0));
+
+    Simulator::Run ();
+    Simulator::Destroy ();
+  }
+};
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Checks that the sample found from any cursor is the one found by
+ * a search from the first sample.
+ */
+class TrajectoryFindTest : public TestCase
+{
+public:
+  TrajectoryFindTest ()
+    : TestCase ("Check the search of samples from a cursor")
+  {
+  }
+
+private:
+  virtual void DoRun (void)
+  {
+    Ptr<Trajectory> trajectory = Create<Trajectory> ();
+    for (uint32_t i = 0; i < 100; i++)
+      {
+        // pairs of samples at the same time
+        trajectory->Add (Seconds (i / 2 + 1), Vector (i, 0, 0));
+      }
+    for (int64_t time = 0; time < 60; time++)
+      {
+        uint32_t expected = 0;
+        while (expected + 1 < trajectory->GetN ()
+               && trajectory->GetTime (expected + 1).GetSeconds () <= time)
+          {
+            expected++;
+          }
+        for (uint32_t cursor = 0; cursor < trajectory->GetN () + 2; cursor++)
+          {
+            NS_TEST_ASSERT_MSG_EQ (trajectory->Find (Seconds (time).GetNanoSeconds (), cursor), expected,
+                                   "Sample at " << time << " s from " << cursor);
+          }
+      }
+  }
+};
+
+/**
+ * \ingroup mobility-test
+ * \ingroup tests
+ *
+ * \brief Trajectory Mobility Model Test Suite
+ */
+static struct TrajectoryMobilityModelTestSuite : public TestSuite
+{
+  TrajectoryMobilityModelTestSuite () : TestSuite ("trajectory-mobility-model", UNIT)
+  {
+    AddTestCase (new TrajectoryMobilityModelTest, TestCase::QUICK);
+    AddTestCase (new TrajectoryFindTest, TestCase::QUICK);
+  }
+} g_trajectoryMobilityModelTestSuite; ///< the test suite